@@ -1,7 +1,7 @@
 @echo off
 
-set CommonCompilerFlags=-MT -nologo -Gm- -GR- -EHa- -Od -Oi -WX -W4 -wd4201 -wd4100 -wd4189 -wd4701 -wd4127 -DFAITMAIN_INTERNAL=1 -DFAITMAIN_LENT=1 -DFAITMAIN_WIN32=1 -FC -Z7 -Fmwin32_faitmain.map
-set CommonLinkerFlags=-opt:ref user32.lib Gdi32.lib winmm.lib
+set CommonCompilerFlags=-MT -nologo -Gm- -GR- -EHa- -Od -Oi -WX -W4 -wd4201 -wd4100 -wd4189 -wd4701 -wd4127 -wd4505 -DFAITMAIN_INTERNAL=1 -DFAITMAIN_LENT=1 -DFAITMAIN_WIN32=1 -FC -Z7 -Fmwin32_faitmain.map
+set CommonLinkerFlags=-opt:ref user32.lib Gdi32.lib winmm.lib ws2_32.lib
 
 IF NOT EXIST build mkdir build
 pushd build
@@ -13,4 +13,8 @@ REM Compilation 64 bits
 cl %CommonCompilerFlags% ..\code\faitmain.cpp /link /DLL
 cl %CommonCompilerFlags% ..\code\win32_faitmain.cpp /link %CommonLinkerFlags%
 
+REM Tests portables (sans Win32)
+cl -nologo -W4 -WX -Z7 ..\code\faitmain_sound_output_test.cpp
+faitmain_sound_output_test.exe
+
 popd
@@ -1,59 +1,318 @@
 #include "faitmain.h"
+#include "faitmain_pixel.h"
+#include "faitmain_sound_output.h"
+#include "faitmain_music.cpp"
+#include "faitmain_tile.cpp"
+#include "faitmain_nav.cpp"
+#include "faitmain_entity.cpp"
+#include "faitmain_grid.cpp"
+#include "faitmain_draw.cpp"
+#include "faitmain_particle.cpp"
+#include "faitmain_light.cpp"
+#include "faitmain_hash.cpp"
+#include "faitmain_script.cpp"
 
 void
-GameOutputSound(game_sound_output_buffer *SoundBuffer, int ToneHz)
+GameOutputSound(game_sound_output_buffer *SoundBuffer, int ToneHz, music_track *Music)
 {
   local_persist real32 tSine;
-  int16 ToneVolume = 3000;
-  int WavePeriod = SoundBuffer->SamplesPerSecond / ToneHz;
+  local_persist sound_dither Dither;
+  if (!Dither.State[0])
+  {
+    InitializeSoundDither(&Dither, 0x5EED);
+  }
+  real32 ToneVolume = 3000.0f / 32768.0f;
+  // Incrment de phase en flottant : une priode arrondie  un nombre entier
+  // d'chantillons faussait la hauteur, surtout  44100 Hz
+  real32 PhaseIncrement = (real32)(2.0f * PI32 * (real32)ToneHz / (real32)SoundBuffer->SamplesPerSecond);
 
+  // Le mix se fait en flottant par petits blocs sur la pile, puis est converti en int16
+  real32 Mix[2*MusicMixBlockFrameCount];
   int16 *SampleOut = SoundBuffer->Samples;
-  for (int SampleIndex = 0; SampleIndex < SoundBuffer->SampleCount; ++SampleIndex)
-  {
-    real32 SineValue = sinf(tSine);
-    int16 SampleValue = (int16)(SineValue * ToneVolume);
-    *SampleOut++ = SampleValue;
-    *SampleOut++ = SampleValue;
-    tSine += (real32)(2.0f * PI32 * 1.0f / (real32)WavePeriod);
-    // A partir d'un moment sinf perd sa prcision quand les chiffres sont trs hauts
-    if(tSine > 2.0f*PI32)
+  for (int FrameIndex = 0; FrameIndex < SoundBuffer->SampleCount; FrameIndex += MusicMixBlockFrameCount)
+  {
+    int BlockFrameCount = SoundBuffer->SampleCount - FrameIndex;
+    if (BlockFrameCount > MusicMixBlockFrameCount) BlockFrameCount = MusicMixBlockFrameCount;
+
+    for (int Index = 0; Index < BlockFrameCount; ++Index)
+    {
+      real32 SineValue = ToneVolume*sinf(tSine);
+      Mix[2*Index] = SineValue;
+      Mix[2*Index + 1] = SineValue;
+      tSine += PhaseIncrement;
+      // A partir d'un moment sinf perd sa prcision quand les chiffres sont trs hauts
+      if(tSine > 2.0f*PI32)
+      {
+        tSine -= (real32)(2.0f*PI32);
+      }
+    }
+    if (Music)
     {
-      tSine -= 2.0f*PI32;
+      MixMusicTrack(Music, Mix, BlockFrameCount, SoundBuffer->SamplesPerSecond);
     }
+    ConvertSamplesToInt16(SampleOut, Mix, 2*BlockFrameCount, &Dither, 1.0f);
+    SampleOut += 2*BlockFrameCount;
   }
 }
 
-/* Fonction qui va dessiner dans le backbuffer un gradient de couleur trange */
-void
-RenderWeirdGradient(game_offscreen_buffer *Buffer, int XOffset, int YOffset)
+/*
+  Simulation  pas fixe, dcouple de la frquence d'affichage
+*/
+#define SimulationHz 60
+#define SimulationStepSeconds (1.0f / (real32)SimulationHz)
+#define MaxSimulationStepsPerFrame 4
+
+// Les premires entits sont des agents qui suivent un chemin sur la carte
+#define NavAgentCount 256
+#define NavAgentSpeed 3.0f
+
+/*
+  Scripts du jeu
+*/
+#define GameScriptMaxCount 64
+#define GameScriptWorkBudget 4096
+
+enum game_script_type
+{
+  GameScript_AgentGoals,
+
+  GameScript_Count,
+};
+
+// Les agents vont vers un coin de la salle, qui change toutes les 4 secondes
+struct agent_goals_frame
+{
+  uint32 Corner;
+};
+
+internal SCRIPT_FUNCTION(AgentGoalsScript)
 {
-  // on va se dplacer dans la mmoire par pas de 8 bits
-  uint8 *Row = (uint8 *)Buffer->Memory;
-  for (int Y = 0; Y < Buffer->Height; ++Y)
+  game_state *GameState = (game_state *)Context->Game;
+  agent_goals_frame *Frame = (agent_goals_frame *)Context->Frame;
+  SCRIPT_BEGIN(Context);
+  for (;;)
   {
-    // Pixel par pixel, on commence par le premier de la ligne
-    uint32 *Pixel = (uint32 *)Row;
-    for (int X = 0; X < Buffer->Width; ++X)
+    GameState->AgentGoalX = (Frame->Corner & 1) ? 13 : -14;
+    GameState->AgentGoalY = (Frame->Corner & 2) ? 6 : -7;
+    Frame->Corner = (Frame->Corner + 1) % 4;
+    SCRIPT_WORK(Context, 1);
+    SCRIPT_WAIT_STEPS(Context, 4*SimulationHz);
+  }
+  SCRIPT_END(Context);
+}
+
+global_variable script_function *GameScriptFunctions[GameScript_Count] =
+{
+  AgentGoalsScript,
+};
+
+/**
+ * Un pas de simulation de dt secondes, toujours le mme quelle que soit la
+ * frquence d'affichage : la simulation est reproductible
+ **/
+internal void
+SimulateGameStep(game_memory *Memory, game_state *GameState, transient_state *TranState, real32 dt)
+{
+  // La salle fait 32x18 tuiles de 1.4 m autour de l'origine, murs compris
+  tile_map *TileMap = &GameState->TileMap;
+  SaveEntityPositions(&GameState->Entities);
+
+  // Les scripts passent en premier : ce qu'ils dcident vaut pour tout le pas
+  RunScripts(&GameState->Scripts, GameScriptFunctions, GameScript_Count, GameState,
+             GameState->SimulationStepIndex);
+
+  // Les agents vont vers le but choisi par leur script.
+  // Seule la prochaine tuile du chemin sert : le chemin n'est raffin que jusque-l.
+  {
+    temporary_memory NavMemory = BeginTemporaryMemory(&TranState->TranArena);
+    entity_storage *Entities = &GameState->Entities;
+    uint32 AgentCount = (Entities->Count < NavAgentCount) ? Entities->Count : NavAgentCount;
+    nav_query *Queries = PushArray(&TranState->TranArena, AgentCount, nav_query);
+    nav_tile *PathTiles = PushArray(&TranState->TranArena, 2*AgentCount, nav_tile);
+    for (uint32 AgentIndex = 0; AgentIndex < AgentCount; ++AgentIndex)
     {
-      /*
-      Pixels en little endian architecture
-      0  1  2  3 ...
-      Pixels en mmoire : 00 00 00 00 ...
-      Couleur             BB GG RR XX
-      en hexa: 0xXXRRGGBB
-      */
-      uint8 Blue = (uint8)(X + XOffset);
-      uint8 Green = (uint8)(Y + YOffset);
-      uint8 Red = (uint8)(X + Y);
-      // On peut changer directement la couleur d'un pixel :  *Pixel = 0xFF00FF00;
-      // ce qui quivaut en hexa  0x00BBGG00
-      *Pixel++ = ((Red << 16) | (Green << 8) | Blue);
+      nav_query *Query = Queries + AgentIndex;
+      Query->StartX = (int32)floorf(Entities->PositionX[AgentIndex] / TileMap->TileSideInMeters);
+      Query->StartY = (int32)floorf(Entities->PositionY[AgentIndex] / TileMap->TileSideInMeters);
+      Query->GoalX = GameState->AgentGoalX;
+      Query->GoalY = GameState->AgentGoalY;
+      Query->Path.MaxLength = 2;
+      Query->Path.Tiles = PathTiles + 2*AgentIndex;
     }
-    Row += Buffer->Pitch; // Ligne suivante
+    RunNavQueries(&GameState->NavGraph, Queries, AgentCount, &TranState->TranArena, 1024,
+                  &Memory->PlatformAPI, Memory->HighPriorityQueue, NavMaxJobCount);
+    for (uint32 AgentIndex = 0; AgentIndex < AgentCount; ++AgentIndex)
+    {
+      nav_path *Path = &Queries[AgentIndex].Path;
+      if (Queries[AgentIndex].Found && (Path->Length >= 2))
+      {
+        // Vers le centre de la prochaine tuile
+        real32 dX = ((real32)Path->Tiles[1].X + 0.5f)*TileMap->TileSideInMeters - Entities->PositionX[AgentIndex];
+        real32 dY = ((real32)Path->Tiles[1].Y + 0.5f)*TileMap->TileSideInMeters - Entities->PositionY[AgentIndex];
+        real32 Length = sqrtf(dX*dX + dY*dY);
+        if (Length > 0.0f)
+        {
+          Entities->VelocityX[AgentIndex] = NavAgentSpeed*dX / Length;
+          Entities->VelocityY[AgentIndex] = NavAgentSpeed*dY / Length;
+        }
+      }
+    }
+    EndTemporaryMemory(NavMemory);
+  }
+
+  UpdateEntities(&GameState->Entities, dt,
+                 -15.0f*TileMap->TileSideInMeters, -8.0f*TileMap->TileSideInMeters,
+                 15.0f*TileMap->TileSideInMeters, 8.0f*TileMap->TileSideInMeters);
+  CompactEntities(&GameState->Entities);
+
+  // Une fontaine de particules au milieu du sol de la salle
+  particle_system *Particles = &TranState->Particles;
+  particle_emitter Fountain = {};
+  Fountain.PositionY = -7.0f*TileMap->TileSideInMeters;
+  Fountain.VelocityY = 10.0f;
+  Fountain.Spread = 3.0f;
+  Fountain.MinLifetime = 1.0f;
+  Fountain.MaxLifetime = 2.5f;
+  EmitParticles(Particles, &Fountain, 1000);
+  UpdateParticles(Particles, dt, 0.0f, -9.81f, 0.5f);
+  CompactParticles(Particles);
+
+  // Collisions entre entits : les paires qui se rapprochent changent leurs vitesses
+  {
+    temporary_memory GridMemory = BeginTemporaryMemory(&TranState->TranArena);
+    entity_storage *Entities = &GameState->Entities;
+    real32 EntityDiameter = 0.4f;
+    spatial_grid Grid;
+    BuildSpatialGrid(&Grid, &TranState->TranArena, Entities->PositionX, Entities->PositionY,
+                     Entities->Count, EntityDiameter, &Memory->PlatformAPI,
+                     Memory->HighPriorityQueue, SpatialGridMaxJobCount);
+    uint32 MaxPairs = 4*Entities->Count;
+    spatial_pair *Pairs = PushArray(&TranState->TranArena, MaxPairs, spatial_pair);
+    uint32 PairCount = FindSpatialGridPairs(&Grid, 0, Entities->Count, EntityDiameter, Pairs, MaxPairs);
+    if (PairCount > MaxPairs) PairCount = MaxPairs;
+    for (uint32 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+    {
+      uint32 A = Pairs[PairIndex].A;
+      uint32 B = Pairs[PairIndex].B;
+      real32 dX = Entities->PositionX[B] - Entities->PositionX[A];
+      real32 dY = Entities->PositionY[B] - Entities->PositionY[A];
+      real32 dVX = Entities->VelocityX[B] - Entities->VelocityX[A];
+      real32 dVY = Entities->VelocityY[B] - Entities->VelocityY[A];
+      if (dX*dVX + dY*dVY < 0.0f)
+      {
+        real32 VX = Entities->VelocityX[A];
+        real32 VY = Entities->VelocityY[A];
+        Entities->VelocityX[A] = Entities->VelocityX[B];
+        Entities->VelocityY[A] = Entities->VelocityY[B];
+        Entities->VelocityX[B] = VX;
+        Entities->VelocityY[B] = VY;
+      }
+    }
+    EndTemporaryMemory(GridMemory);
   }
 }
 
-GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
+// La salle de 32x18 tuiles remplit le buffer, centre sur l'origine
+internal world_view
+GetRoomView(game_offscreen_buffer *Buffer, tile_map *TileMap)
+{
+  real32 RoomWidth = 32.0f*TileMap->TileSideInMeters;
+  real32 RoomHeight = 18.0f*TileMap->TileSideInMeters;
+  world_view Result;
+  Result.PixelsPerMeter = (real32)Buffer->Width / RoomWidth;
+  if ((real32)Buffer->Height / RoomHeight < Result.PixelsPerMeter)
+  {
+    Result.PixelsPerMeter = (real32)Buffer->Height / RoomHeight;
+  }
+  Result.CenterX = 0.5f*(real32)Buffer->Width;
+  Result.CenterY = 0.5f*(real32)Buffer->Height;
+  return(Result);
+}
+
+/**
+ * Les entits, interpoles entre les deux derniers pas de simulation
+ * Alpha dans [0, 1) : 0 donne l'avant-dernier tat, 1 le dernier
+ **/
+internal void
+RenderEntities(draw_kernels *Kernels, game_offscreen_buffer *Buffer,
+               entity_storage *Entities, world_view View, real32 Alpha)
+{
+  int HalfSide = (int)(0.2f*View.PixelsPerMeter);
+  draw_color EntityColor = {1.0f, 1.0f, 1.0f, 0.75f};
+  if (HalfSide < 1) HalfSide = 1;
+
+  for (uint32 Index = 0; Index < Entities->Count; ++Index)
+  {
+    real32 PreviousX = Entities->PreviousPositionX[Index];
+    real32 PreviousY = Entities->PreviousPositionY[Index];
+    real32 X = PreviousX + Alpha*(Entities->PositionX[Index] - PreviousX);
+    real32 Y = PreviousY + Alpha*(Entities->PositionY[Index] - PreviousY);
+    // Y monte dans le monde et descend  l'cran
+    int ScreenX = (int)(View.CenterX + X*View.PixelsPerMeter);
+    int ScreenY = (int)(View.CenterY - Y*View.PixelsPerMeter);
+    DrawRectangle(Kernels, Buffer, ScreenX - HalfSide, ScreenY - HalfSide,
+                  ScreenX + HalfSide, ScreenY + HalfSide, EntityColor, BlendMode_Alpha);
+  }
+}
+
+/**
+ * Les lumires de l'image : une par agent, de la couleur de son index, et
+ * une lumire chaude au-dessus de la fontaine. Positions interpoles comme
+ * les entits. Renvoie le nombre de lumires crites.
+ **/
+internal uint32
+GetGameLights(game_state *GameState, point_light *Lights, uint32 MaxLights, real32 Alpha)
+{
+  entity_storage *Entities = &GameState->Entities;
+  real32 TileSide = GameState->TileMap.TileSideInMeters;
+  uint32 Result = 0;
+  if (Result < MaxLights)
+  {
+    point_light *Fountain = Lights + Result++;
+    Fountain->X = 0.0f;
+    Fountain->Y = -6.0f*TileSide;
+    Fountain->Radius = 6.0f*TileSide;
+    Fountain->R = 1.6f;
+    Fountain->G = 0.9f;
+    Fountain->B = 0.4f;
+  }
+  uint32 AgentCount = (Entities->Count < NavAgentCount) ? Entities->Count : NavAgentCount;
+  for (uint32 Index = 0; (Index < AgentCount) && (Result < MaxLights); ++Index)
+  {
+    real32 PreviousX = Entities->PreviousPositionX[Index];
+    real32 PreviousY = Entities->PreviousPositionY[Index];
+    point_light *Light = Lights + Result++;
+    Light->X = PreviousX + Alpha*(Entities->PositionX[Index] - PreviousX);
+    Light->Y = PreviousY + Alpha*(Entities->PositionY[Index] - PreviousY);
+    Light->Radius = 1.5f*TileSide;
+    Light->R = (Index & 1) ? 0.8f : 0.2f;
+    Light->G = (Index & 2) ? 0.8f : 0.2f;
+    Light->B = (Index & 4) ? 0.8f : 0.2f;
+  }
+  return(Result);
+}
+
+// Arne du reste d'une mmoire du jeu, paresseuse si la plateforme ne l'a que rserve
+internal void
+InitializeGameArena(game_memory *Memory, memory_arena *Arena, uint64 Size, void *Base)
+{
+  if (Memory->IsCommittedOnDemand)
+  {
+    InitializeLazyArena(Arena, Size, Base, Memory->PlatformAPI.CommitMemory);
+  }
+  else
+  {
+    InitializeArena(Arena, Size, Base);
+  }
+}
+
+/**
+ * Tout ce que l'image change dans l'tat simul : initialisation  la
+ * premire image, entres, puis les pas de simulation. Le rendu n'en fait
+ * pas partie, le rollback resimule des images sans les afficher.
+ **/
+internal void
+UpdateGameState(game_memory *Memory, game_input *Input)
 {
   // On vrifie que l'on a allou assez de mmoire pour le jeu
   Assert(sizeof(game_state) <= Memory->PermanentStorageSize);
@@ -63,8 +322,18 @@ GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
     == ArrayCount(Input->Controllers[0].Buttons) - 1);
 
   game_state *GameState = (game_state*)Memory->PermanentStorage;
+  transient_state *TranState = (transient_state *)Memory->TransientStorage;
   if (!Memory->IsInitialized)
   {
+    // Mmoire seulement rserve : les deux en-ttes sont engags ici, les
+    // arnes qui les suivent engagent leurs pages en grandissant
+    if (Memory->IsCommittedOnDemand)
+    {
+      Memory->PlatformAPI.CommitMemory(GameState, sizeof(game_state));
+      Memory->PlatformAPI.CommitMemory(TranState, sizeof(transient_state));
+    }
+
+#if FAITMAIN_INTERNAL
     char *Filename = __FILE__; // Le nom du fichier source en cours
 
     debug_read_file_result File = Memory->DEBUGPlatformReadEntireFile(Filename);
@@ -73,10 +342,58 @@ GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
       Memory->DEBUGPlatformWriteEntireFile("test.out", File.ContentsSize, File.Contents);
       Memory->DEBUGPlatformFreeFileMemory(File.Contents);
     }
+#endif
 
     GameState->ToneHz = 512;
     GameState->BlueOffset = 0;
     GameState->GreenOffset = 0;
+
+    // Le monde utilise le reste de la mmoire permanente
+    InitializeGameArena(Memory, &GameState->WorldArena,
+                        Memory->PermanentStorageSize - sizeof(game_state),
+                        (uint8 *)Memory->PermanentStorage + sizeof(game_state));
+    InitializeTileMap(&GameState->TileMap, &GameState->WorldArena, 4096, 1.4f);
+
+    // Une premire salle autour de l'origine, les murs valent 2 et le sol 1
+    for (int32 TileY = -9; TileY < 9; ++TileY)
+    {
+      for (int32 TileX = -16; TileX < 16; ++TileX)
+      {
+        bool32 IsWall = ((TileX == -16) || (TileX == 15) || (TileY == -9) || (TileY == 8));
+        SetTileValue(&GameState->WorldArena, &GameState->TileMap, TileX, TileY, IsWall ? 2 : 1);
+      }
+    }
+
+    // Graphe de navigation sur les 2x2 chunks de la salle, construit tout de suite
+    InitializeNavGraph(&GameState->NavGraph, &GameState->WorldArena, &GameState->TileMap, -1, -1, 2, 2);
+    UpdateNavGraph(&GameState->NavGraph, &GameState->WorldArena,
+                   &Memory->PlatformAPI, Memory->HighPriorityQueue, NavMaxJobCount);
+
+    // Quelques entits qui rebondissent dans la salle
+    InitializeEntityStorage(&GameState->Entities, &GameState->WorldArena, 65536);
+    uint32 Random = 1;
+    for (int EntityIndex = 0; EntityIndex < 1024; ++EntityIndex)
+    {
+      Random = Random*1664525 + 1013904223;
+      real32 X = ((real32)(Random >> 8) / (real32)(1 << 24) - 0.5f)*40.0f;
+      real32 VX = ((real32)(Random & 0xFF) / 255.0f - 0.5f)*8.0f;
+      Random = Random*1664525 + 1013904223;
+      real32 Y = ((real32)(Random >> 8) / (real32)(1 << 24) - 0.5f)*22.0f;
+      real32 VY = ((real32)(Random & 0xFF) / 255.0f - 0.5f)*8.0f;
+      AddEntity(&GameState->Entities, X, Y, VX, VY, EntityFlag_Moving);
+    }
+
+    // Scripts repris  chaque pas de simulation, le premier commence au pas 0
+    InitializeScriptScheduler(&GameState->Scripts, &GameState->WorldArena, GameScriptMaxCount,
+                              GameScriptWorkBudget);
+    StartScript(&GameState->Scripts, GameScript_AgentGoals, sizeof(agent_goals_frame),
+                GameState->SimulationStepIndex);
+
+    // La musique est lue en streaming, elle est absente si le fichier n'existe pas
+    if (OpenMusicTrack(&Memory->PlatformAPI, &GameState->Music, "music.wav"))
+    {
+      GameState->Music.IsLooping = true;
+    }
     Memory->IsInitialized = true;
   }
 
@@ -106,12 +423,106 @@ GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
     }
   }
 
-  
-  RenderWeirdGradient(Buffer, GameState->BlueOffset, GameState->GreenOffset);
+  // La mmoire transitoire commence par transient_state, le reste est une arne
+  Assert(sizeof(transient_state) <= Memory->TransientStorageSize);
+  if (!TranState->IsInitialized)
+  {
+    InitializeGameArena(Memory, &TranState->TranArena,
+                        Memory->TransientStorageSize - sizeof(transient_state),
+                        (uint8 *)Memory->TransientStorage + sizeof(transient_state));
+    // Allous avant toute mmoire temporaire, ils restent d'une image  l'autre
+    InitializeGlyphAtlas(&TranState->DebugFont, &TranState->TranArena, 2);
+    InitializeTextBatch(&TranState->DebugText, &TranState->TranArena, 8192);
+    InitializeParticleSystem(&TranState->Particles, &TranState->TranArena, 1 << 20, 0x5EED);
+    TranState->IsInitialized = true;
+  }
+
+  // Autant de pas fixes que le temps coul en contient. Au-del de
+  // MaxSimulationStepsPerFrame le temps en trop est perdu : le jeu ralentit
+  // au lieu de prendre de plus en plus de retard (spirale de la mort)
+  GameState->SimulationAccumulator += Input->dtForFrame;
+  real32 MaxAccumulated = (real32)MaxSimulationStepsPerFrame*SimulationStepSeconds;
+  if (GameState->SimulationAccumulator > MaxAccumulated)
+  {
+    GameState->SimulationAccumulator = MaxAccumulated;
+  }
+  while (GameState->SimulationAccumulator >= SimulationStepSeconds)
+  {
+    SimulateGameStep(Memory, GameState, TranState, SimulationStepSeconds);
+    GameState->SimulationAccumulator -= SimulationStepSeconds;
+    ++GameState->SimulationStepIndex;
+  }
+
+  // L'arne du monde est dans la partie sauvegarde : restaurer l'tat rend aussi ses allocations
+  Memory->SimulatedStateFirstByte = (uint64)((uint8 *)&GameState->WorldArena - (uint8 *)Memory->PermanentStorage);
+  Memory->SimulatedStateSize = sizeof(game_state) + GameState->WorldArena.Used - Memory->SimulatedStateFirstByte;
+}
+
+GAME_SIMULATE_FRAME(GameSimulateFrame)
+{
+  UpdateGameState(Memory, Input);
+}
+
+GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
+{
+  UpdateGameState(Memory, Input);
+  game_state *GameState = (game_state*)Memory->PermanentStorage;
+  transient_state *TranState = (transient_state *)Memory->TransientStorage;
+
+  // Chargement en avance des morceaux de musique
+  UpdateMusicTrack(&Memory->PlatformAPI, Memory->LowPriorityQueue, &GameState->Music);
+
+  // Le rendu ne touche plus  l'tat simul : son empreinte est celle de l'image
+  if (Memory->IsStateHashRequested)
+  {
+    uint64 FirstByte = (uint64)((uint8 *)&GameState->ToneHz - (uint8 *)Memory->PermanentStorage);
+    uint64 OnePastLastByte = sizeof(game_state) + GameState->WorldArena.Used;
+    HashGameState(&Memory->StateHash, Memory->PermanentStorage, FirstByte, OnePastLastByte - FirstByte,
+                  &Memory->PlatformAPI, Memory->HighPriorityQueue, StateHashMaxJobCount);
+  }
+
+  // Les noyaux de dessin sont choisis une fois pour toute l'image
+  draw_kernels *Kernels = GetDrawKernels(Buffer);
+  Kernels->RenderGradient(Buffer, GameState->BlueOffset, GameState->GreenOffset);
+  // Fraction du prochain pas dj coule, pour placer les entits entre deux tats
+  real32 Alpha = GameState->SimulationAccumulator / SimulationStepSeconds;
+  world_view View = GetRoomView(Buffer, &GameState->TileMap);
+  RenderEntities(Kernels, Buffer, &GameState->Entities, View, Alpha);
+  // L'clairage assombrit la scne ; les particules, qui mettent leur lumire, viennent aprs
+  uint32 LightCount;
+  {
+    temporary_memory LightMemory = BeginTemporaryMemory(&TranState->TranArena);
+    uint32 MaxLights = NavAgentCount + 1;
+    point_light *Lights = PushArray(&TranState->TranArena, MaxLights, point_light);
+    LightCount = GetGameLights(GameState, Lights, MaxLights, Alpha);
+    light_ambient Ambient = {0.25f, 0.25f, 0.3f};
+    RenderLighting(Buffer, Lights, LightCount, View, Ambient, &TranState->TranArena,
+                   &Memory->PlatformAPI, Memory->HighPriorityQueue, LightingMaxJobCount);
+    EndTemporaryMemory(LightMemory);
+  }
+  draw_color ParticleColor = {1.0f, 0.6f, 0.2f, 0.5f};
+  RenderParticles(Kernels, Buffer, &TranState->Particles, View, ParticleColor);
+
+  // Texte de debug, dessin en un seul lot par-dessus l'image
+  glyph_atlas *DebugFont = &TranState->DebugFont;
+  text_batch *DebugText = &TranState->DebugText;
+  PrepareGlyphAtlas(DebugFont, Buffer->PixelFormat, (Buffer->Height >= 720) ? 2 : 1, 0x00FFFFFF);
+  int TextY = 8;
+  TextY = PushTextFormat(DebugText, Buffer, DebugFont, 8, TextY, "entites %u / %u",
+                         GameState->Entities.Count, GameState->Entities.MaxCount);
+  TextY = PushTextFormat(DebugText, Buffer, DebugFont, 8, TextY, "pas de simulation %llu, alpha %.2f",
+                         GameState->SimulationStepIndex, Alpha);
+  TextY = PushTextFormat(DebugText, Buffer, DebugFont, 8, TextY, "particules %u / %u",
+                         TranState->Particles.Count, TranState->Particles.MaxCount);
+  TextY = PushTextFormat(DebugText, Buffer, DebugFont, 8, TextY, "lumieres %u", LightCount);
+  TextY = PushTextFormat(DebugText, Buffer, DebugFont, 8, TextY, "scripts %u, travail %d / %d, %u reportes",
+                         GameState->Scripts.RunningCount, GameState->Scripts.LastWork,
+                         GameState->Scripts.WorkBudget, GameState->Scripts.LastDeferredCount);
+  DrawTextBatch(Buffer, DebugFont, DebugText);
 }
 
 GAME_GET_SOUND_SAMPLES(GameGetSoundSamples)
 {
   game_state *GameState = (game_state*)Memory->PermanentStorage;
-  GameOutputSound(SoundBuffer, GameState->ToneHz);
+  GameOutputSound(SoundBuffer, GameState->ToneHz, &GameState->Music);
 }
\ No newline at end of file
@@ -24,9 +24,91 @@ SafeTruncateUint64(uint64 Value)
   return (uint32)Value;
 }
 
+/*
+  Barrires et oprations atomiques pour partager des donnes entre threads
+*/
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CompletePreviousWritesBeforeFutureWrites _WriteBarrier(); _mm_sfence()
+#define CompletePreviousReadsBeforeFutureReads _ReadBarrier()
+inline uint32
+AtomicCompareExchangeUInt32(uint32 volatile *Value, uint32 New, uint32 Expected)
+{
+  uint32 Result = (uint32)_InterlockedCompareExchange((long volatile *)Value, (long)New, (long)Expected);
+  return(Result);
+}
+inline uint32
+AtomicIncrementUInt32(uint32 volatile *Value)
+{
+  uint32 Result = (uint32)_InterlockedIncrement((long volatile *)Value);
+  return(Result);
+}
+#else
+#define CompletePreviousWritesBeforeFutureWrites __atomic_thread_fence(__ATOMIC_RELEASE)
+#define CompletePreviousReadsBeforeFutureReads __atomic_thread_fence(__ATOMIC_ACQUIRE)
+inline uint32
+AtomicCompareExchangeUInt32(uint32 volatile *Value, uint32 New, uint32 Expected)
+{
+  uint32 Result = __sync_val_compare_and_swap(Value, Expected, New);
+  return(Result);
+}
+inline uint32
+AtomicIncrementUInt32(uint32 volatile *Value)
+{
+  uint32 Result = __sync_add_and_fetch(Value, 1);
+  return(Result);
+}
+#endif
+
 /*
   Services fournis par la couche plateforme au jeu
 */
+
+// File de travaux excuts par les threads de la plateforme
+struct platform_work_queue;
+#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(platform_work_queue *Queue, void *Data)
+typedef PLATFORM_WORK_QUEUE_CALLBACK(platform_work_queue_callback);
+
+#define PLATFORM_ADD_WORK_ENTRY(name) void name(platform_work_queue *Queue, platform_work_queue_callback *Callback, void *Data)
+typedef PLATFORM_ADD_WORK_ENTRY(platform_add_work_entry);
+
+#define PLATFORM_COMPLETE_ALL_WORK(name) void name(platform_work_queue *Queue)
+typedef PLATFORM_COMPLETE_ALL_WORK(platform_complete_all_work);
+
+// Lecture de fichiers par morceaux, pour les donnes trop grosses pour tre lues d'un coup
+// Les lectures sont positionnelles : plusieurs threads peuvent lire le mme fichier
+struct platform_file_handle
+{
+  bool32 NoErrors;
+  uint64 Size;
+  void *Platform;
+};
+
+#define PLATFORM_OPEN_FILE(name) platform_file_handle name(char *Filename)
+typedef PLATFORM_OPEN_FILE(platform_open_file);
+
+#define PLATFORM_READ_DATA_FROM_FILE(name) uint32 name(platform_file_handle *Handle, uint64 Offset, uint32 Size, void *Dest)
+typedef PLATFORM_READ_DATA_FROM_FILE(platform_read_data_from_file);
+
+#define PLATFORM_CLOSE_FILE(name) void name(platform_file_handle *Handle)
+typedef PLATFORM_CLOSE_FILE(platform_close_file);
+
+// Engagement de pages dans une plage seulement rserve, dj engages ou non
+#define PLATFORM_COMMIT_MEMORY(name) bool32 name(void *Memory, uint64 Size)
+typedef PLATFORM_COMMIT_MEMORY(platform_commit_memory);
+
+struct platform_api
+{
+  platform_add_work_entry *AddWorkEntry;
+  platform_complete_all_work *CompleteAllWork;
+
+  platform_open_file *OpenFile;
+  platform_read_data_from_file *ReadDataFromFile;
+  platform_close_file *CloseFile;
+
+  platform_commit_memory *CommitMemory;
+};
+
 #if FAITMAIN_INTERNAL
 struct debug_read_file_result
 {
@@ -49,14 +131,26 @@ typedef DEBUG_PLATEFORM_WRITE_ENTIRE_FILE(debug_plateform_write_entire_file);
   Services fournis par le jeu  couche plateforme
 */
 
+// Formats de pixels que peut avoir le backbuffer
+enum game_pixel_format
+{
+  PixelFormat_XRGB8888, // 0xXXRRGGBB en sRGB, le format natif de GDI
+  PixelFormat_RGBA8888, // Octets R G B A en mmoire, en sRGB
+  PixelFormat_RGB565,   // 16 bits par pixel, sans espace de couleur particulier
+  PixelFormat_RGBA32F,  // 4 floats par pixel en espace linaire, pour l'clairage
+
+  PixelFormat_Count,
+};
+
 // Struct qui reprsente un backbuffer qui nous permet de dessiner
 struct game_offscreen_buffer {
   // BITMAPINFO Info;
   void *Memory;
   int Width;
   int Height;
-  int BytesPerPixel;
+  int BytesPerPixel; // Toujours cohrent avec PixelFormat
   int Pitch; // Pitch reprsente la taille d'une ligne en octets
+  game_pixel_format PixelFormat;
 };
 
 struct game_sound_output_buffer
@@ -111,6 +205,7 @@ struct game_controller_input
 
 struct game_input
 {
+  real32 dtForFrame; // Dure simule par cette image, en secondes
   game_controller_input Controllers[5];
 };
 inline game_controller_input *GetController(game_input *Input, int unsigned ControllerIndex)
@@ -120,11 +215,155 @@ inline game_controller_input *GetController(game_input *Input, int unsigned Cont
   return Result;
 }
 
+/*
+  Arne mmoire : allocation linaire dans un bloc de la mmoire du jeu,
+  rien n'est libr individuellement
+
+  Une arne paresseuse est pose sur une plage seulement rserve : elle
+  fait engager ses pages par la plateforme au fur et  mesure qu'elle
+  grandit, par blocs de ArenaCommitGranularity. Les pages restent engages
+  quand la mmoire temporaire est rendue.
+*/
+#define ArenaCommitGranularity Kilobytes(64)
+
+struct memory_arena
+{
+  uint64 Size;
+  uint8 *Base;
+  uint64 Used;
+
+  // Octets engags depuis Base, Size pour une arne engage ds le dpart
+  uint64 CommittedSize;
+  platform_commit_memory *CommitMemory;
+};
+
+inline void
+InitializeArena(memory_arena *Arena, uint64 Size, void *Base)
+{
+  Arena->Size = Size;
+  Arena->Base = (uint8 *)Base;
+  Arena->Used = 0;
+  Arena->CommittedSize = Size;
+  Arena->CommitMemory = 0;
+}
+
+inline void
+InitializeLazyArena(memory_arena *Arena, uint64 Size, void *Base, platform_commit_memory *CommitMemory)
+{
+  InitializeArena(Arena, Size, Base);
+  Arena->CommittedSize = 0;
+  Arena->CommitMemory = CommitMemory;
+}
+
+// Engage au moins jusqu' Base + Used, hors du chemin courant de PushSize_
+internal void
+CommitArenaMemory(memory_arena *Arena, uint64 Used)
+{
+  uint64 CommittedSize = (Used + ArenaCommitGranularity - 1) & ~(uint64)(ArenaCommitGranularity - 1);
+  if (CommittedSize > Arena->Size) CommittedSize = Arena->Size;
+  bool32 Committed = Arena->CommitMemory(Arena->Base + Arena->CommittedSize,
+                                         CommittedSize - Arena->CommittedSize);
+  Assert(Committed);
+  Arena->CommittedSize = CommittedSize;
+}
+
+// Alignement sur 16 octets par dfaut, pour les chargements SSE
+#define PushStruct(Arena, type) (type *)PushSize_(Arena, sizeof(type))
+#define PushArray(Arena, Count, type) (type *)PushSize_(Arena, (Count)*sizeof(type))
+#define PushSize(Arena, Size) PushSize_(Arena, Size)
+inline void *
+PushSize_(memory_arena *Arena, uint64 Size, uint64 Alignment = 16)
+{
+  uint64 AlignmentMask = Alignment - 1;
+  uint64 ResultPointer = (uint64)(Arena->Base + Arena->Used);
+  uint64 AlignmentOffset = (Alignment - (ResultPointer & AlignmentMask)) & AlignmentMask;
+  uint64 Used = Arena->Used + AlignmentOffset + Size;
+  Assert(Used <= Arena->Size);
+  if (Used > Arena->CommittedSize)
+  {
+    CommitArenaMemory(Arena, Used);
+  }
+  void *Result = Arena->Base + Arena->Used + AlignmentOffset;
+  Arena->Used = Used;
+  return(Result);
+}
+
+// Mmoire temporaire : tout ce qui est allou entre Begin et End est rendu d'un coup
+struct temporary_memory
+{
+  memory_arena *Arena;
+  uint64 Used;
+};
+
+inline temporary_memory
+BeginTemporaryMemory(memory_arena *Arena)
+{
+  temporary_memory Result;
+  Result.Arena = Arena;
+  Result.Used = Arena->Used;
+  return(Result);
+}
+
+inline void
+EndTemporaryMemory(temporary_memory TempMem)
+{
+  Assert(TempMem.Arena->Used >= TempMem.Used);
+  TempMem.Arena->Used = TempMem.Used;
+}
+
+// Sous-systmes du jeu
+#include "faitmain_music.h"
+#include "faitmain_tile.h"
+#include "faitmain_nav.h"
+#include "faitmain_entity.h"
+#include "faitmain_grid.h"
+#include "faitmain_draw.h"
+#include "faitmain_text.h"
+#include "faitmain_particle.h"
+#include "faitmain_light.h"
+#include "faitmain_hash.h"
+#include "faitmain_script.h"
+
 struct game_state
 {
+  // Hors de l'empreinte de l'tat simul : la musique avance au rythme du
+  // mixeur, et une arne paresseuse pointe vers une fonction de la plateforme
+  music_track Music;
+  // Le monde est allou dans la mmoire permanente, juste aprs game_state
+  memory_arena WorldArena;
+
+  // Etat simul : de ToneHz  la fin de game_state, puis le contenu de WorldArena
   int ToneHz;
   int BlueOffset;
   int GreenOffset;
+
+  tile_map TileMap;
+  nav_graph NavGraph;
+  entity_storage Entities;
+
+  // Comportements qui durent plusieurs pas, et ce qu'ils dcident
+  script_scheduler Scripts;
+  int32 AgentGoalX;
+  int32 AgentGoalY;
+
+  // Simulation  pas fixe : le temps affich s'accumule et est consomm par pas
+  // de SimulationStepSeconds, le reste sert  interpoler l'affichage
+  real32 SimulationAccumulator;
+  uint64 SimulationStepIndex;
+};
+
+// Etat reconstruit  chaque image dans la mmoire transitoire
+struct transient_state
+{
+  bool32 IsInitialized;
+  memory_arena TranArena;
+
+  // Texte de debug : l'atlas est gard d'une image  l'autre, le lot est vid  chaque image
+  glyph_atlas DebugFont;
+  text_batch DebugText;
+
+  // Effets visuels : rien n'en dpend, ils peuvent vivre dans la mmoire transitoire
+  particle_system Particles;
 };
 
 struct game_memory
@@ -134,10 +373,31 @@ struct game_memory
   void *PermanentStorage;
   uint64 TransientStorageSize;
   void *TransientStorage;
+  // Les deux mmoires sont seulement rserves : le jeu fait engager ce qu'il utilise
+  bool32 IsCommittedOnDemand;
+
+  // Empreinte de l'tat simul, calcule aprs la simulation de chaque image si demande
+  bool32 IsStateHashRequested;
+  game_state_hash StateHash;
 
+  // Partie de la mmoire permanente que modifie la simulation, tenue  jour
+  // par le jeu aprs chaque image : le rollback la sauvegarde et la restaure
+  // telle quelle, octets [SimulatedStateFirstByte, + SimulatedStateSize)
+  // Elle commence par l'en-tte (memory_arena) de l'arne o la simulation alloue
+  uint64 SimulatedStateFirstByte;
+  uint64 SimulatedStateSize;
+
+#if FAITMAIN_INTERNAL
   debug_plateform_free_file_memory *DEBUGPlatformFreeFileMemory;
   debug_platform_read_entire_file *DEBUGPlatformReadEntireFile;
   debug_plateform_write_entire_file *DEBUGPlatformWriteEntireFile;
+#endif
+
+  // Travaux dcoups en parallle pendant l'image
+  platform_work_queue *HighPriorityQueue;
+  // Travaux de fond (chargement, dcodage), qui ne doivent pas bloquer une image
+  platform_work_queue *LowPriorityQueue;
+  platform_api PlatformAPI;
 };
 
 // Pour permettre de charger dynamiquement la DLL du moteur de jeu
@@ -147,6 +407,13 @@ GAME_UPDATE_AND_RENDER(GameUpdateAndRenderStub)
 {
 }
 
+// La simulation d'une image seule, sans rendu : pour resimuler les images corriges par le rollback
+#define GAME_SIMULATE_FRAME(name) void name(game_memory *Memory, game_input *Input)
+typedef GAME_SIMULATE_FRAME(game_simulate_frame);
+GAME_SIMULATE_FRAME(GameSimulateFrameStub)
+{
+}
+
 #define GAME_GET_SOUND_SAMPLES(name) void name(game_memory *Memory, game_sound_output_buffer *SoundBuffer)
 typedef GAME_GET_SOUND_SAMPLES(game_get_sound_samples);
 GAME_GET_SOUND_SAMPLES(GameGetSoundSamplesStub)
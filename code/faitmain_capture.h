@@ -0,0 +1,270 @@
+#if !defined(FAITMAIN_CAPTURE_H)
+
+/*
+  Capture des images affiches : copie rapide, compression QOI, fichier de capture
+
+  Le thread de l'image ne fait que copier l'image affiche (XRGB8888) dans
+  un buffer de capture, en critures non temporelles pour ne pas chasser
+  le cache du jeu, dcoupe en bandes de lignes sur la file de travail.
+  Compression et criture se font ailleurs.
+
+  QOI ("Quite OK Image", qoiformat.org) : sans perte, un seul passage,
+  quelques oprations par pixel. Une image QOI isole est un fichier .qoi
+  standard. Une vido est un fichier de capture : un en-tte, les images
+  (QOI ou brutes) dans l'ordre o elles ont t crites, puis un index des
+  images dans l'ordre d'affichage, avec leur horodatage.
+
+  Ce fichier ne dpend pas de la plateforme : threads et fichiers sont
+  fournis par la couche plateforme.
+*/
+#include <emmintrin.h> // SSE2, critures non temporelles
+#include <string.h>    // memcpy
+
+#define CaptureCopyMaxJobCount 8
+#define CaptureCopyMinRowsPerJob 64
+
+// Une bande de lignes de l'image  copier
+struct capture_copy_job
+{
+  uint32 *Dest; // Lignes contigus de Width pixels
+  uint8 *Source;
+  int Width;
+  int SourcePitch;
+  int FirstRow;
+  int OnePastLastRow;
+};
+
+internal void
+CopyCaptureRows(capture_copy_job *Job)
+{
+  for (int Row = Job->FirstRow; Row < Job->OnePastLastRow; ++Row)
+  {
+    uint32 *Dest = Job->Dest + (size_t)Row*Job->Width;
+    uint32 *Source = (uint32 *)(Job->Source + (size_t)Row*Job->SourcePitch);
+    int X = 0;
+    // Dbut de la ligne jusqu' l'alignement sur 16 octets, exig par _mm_stream_si128
+    for (; (X < Job->Width) && ((size_t)(Dest + X) & 15); ++X)
+    {
+      Dest[X] = Source[X];
+    }
+    for (; X + 16 <= Job->Width; X += 16)
+    {
+      __m128i A = _mm_loadu_si128((__m128i *)(Source + X));
+      __m128i B = _mm_loadu_si128((__m128i *)(Source + X + 4));
+      __m128i C = _mm_loadu_si128((__m128i *)(Source + X + 8));
+      __m128i D = _mm_loadu_si128((__m128i *)(Source + X + 12));
+      _mm_stream_si128((__m128i *)(Dest + X), A);
+      _mm_stream_si128((__m128i *)(Dest + X + 4), B);
+      _mm_stream_si128((__m128i *)(Dest + X + 8), C);
+      _mm_stream_si128((__m128i *)(Dest + X + 12), D);
+    }
+    for (; X < Job->Width; ++X)
+    {
+      Dest[X] = Source[X];
+    }
+  }
+  // Les critures non temporelles doivent tre visibles avant de passer l'image  un autre thread
+  _mm_sfence();
+}
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(CopyCaptureWork)
+{
+  CopyCaptureRows((capture_copy_job *)Data);
+}
+
+/**
+ * Copie d'une image XRGB8888 en lignes contigus, dcoupe en au plus
+ * JobCount bandes sur la file (0 : tout sur le thread appelant)
+ **/
+internal void
+CopyCaptureFrame(uint32 *Dest, void *Source, int Width, int Height, int SourcePitch,
+                 platform_api *Platform, platform_work_queue *Queue, uint32 JobCount)
+{
+  if (!Queue) JobCount = 1;
+  if (JobCount > CaptureCopyMaxJobCount) JobCount = CaptureCopyMaxJobCount;
+  uint32 MaxJobCount = (uint32)(Height / CaptureCopyMinRowsPerJob);
+  if (JobCount > MaxJobCount) JobCount = MaxJobCount;
+  if (JobCount < 1) JobCount = 1;
+
+  capture_copy_job Jobs[CaptureCopyMaxJobCount];
+  for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+  {
+    capture_copy_job *Job = Jobs + JobIndex;
+    Job->Dest = Dest;
+    Job->Source = (uint8 *)Source;
+    Job->Width = Width;
+    Job->SourcePitch = SourcePitch;
+    Job->FirstRow = (int)((uint64)Height*JobIndex / JobCount);
+    Job->OnePastLastRow = (int)((uint64)Height*(JobIndex + 1) / JobCount);
+  }
+  if (JobCount > 1)
+  {
+    for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+    {
+      Platform->AddWorkEntry(Queue, CopyCaptureWork, Jobs + JobIndex);
+    }
+    Platform->CompleteAllWork(Queue);
+  }
+  else
+  {
+    CopyCaptureRows(Jobs);
+  }
+}
+
+/*
+  QOI
+*/
+#define QOIHeaderSize 14
+#define QOIEndMarkerSize 8
+#define QOIOpIndex 0x00
+#define QOIOpDiff 0x40
+#define QOIOpLuma 0x80
+#define QOIOpRun 0xC0
+#define QOIOpRGB 0xFE
+#define QOIMaxRun 62
+
+// Taille maximale d'une image QOI sans alpha : 4 octets par pixel au pire (QOIOpRGB)
+inline uint64
+GetQOIMaxSize(int Width, int Height)
+{
+  uint64 Result = QOIHeaderSize + (uint64)Width*Height*4 + QOIEndMarkerSize;
+  return(Result);
+}
+
+inline uint8 *
+WriteBigEndian32(uint8 *At, uint32 Value)
+{
+  At[0] = (uint8)(Value >> 24);
+  At[1] = (uint8)(Value >> 16);
+  At[2] = (uint8)(Value >> 8);
+  At[3] = (uint8)Value;
+  return(At + 4);
+}
+
+/**
+ * Image XRGB8888 en lignes contigus compresse en QOI, 3 canaux sRGB
+ * Dest doit contenir GetQOIMaxSize octets. Renvoie la taille crite.
+ **/
+internal uint32
+EncodeQOI(uint32 *Pixels, int Width, int Height, uint8 *Dest)
+{
+  uint8 *At = Dest;
+  *At++ = 'q';
+  *At++ = 'o';
+  *At++ = 'i';
+  *At++ = 'f';
+  At = WriteBigEndian32(At, (uint32)Width);
+  At = WriteBigEndian32(At, (uint32)Height);
+  *At++ = 3; // RGB
+  *At++ = 0; // sRGB, alpha linaire
+
+  // Les pixels sont compars en entier, alpha  255 : les entres vides de
+  // la table (alpha  0) ne correspondent jamais  un pixel
+  uint32 Index[64] = {};
+  uint32 Previous = 0xFF000000;
+  uint32 Run = 0;
+  size_t PixelCount = (size_t)Width*Height;
+  for (size_t PixelIndex = 0; PixelIndex < PixelCount; ++PixelIndex)
+  {
+    uint32 Pixel = Pixels[PixelIndex] | 0xFF000000;
+    if (Pixel == Previous)
+    {
+      ++Run;
+      if (Run == QOIMaxRun)
+      {
+        *At++ = (uint8)(QOIOpRun | (Run - 1));
+        Run = 0;
+      }
+      continue;
+    }
+    if (Run)
+    {
+      *At++ = (uint8)(QOIOpRun | (Run - 1));
+      Run = 0;
+    }
+
+    int32 R = (int32)((Pixel >> 16) & 0xFF);
+    int32 G = (int32)((Pixel >> 8) & 0xFF);
+    int32 B = (int32)(Pixel & 0xFF);
+    uint32 Hash = (uint32)(R*3 + G*5 + B*7 + 255*11) & 63;
+    if (Index[Hash] == Pixel)
+    {
+      *At++ = (uint8)(QOIOpIndex | Hash);
+    }
+    else
+    {
+      Index[Hash] = Pixel;
+      // Diffrences sur 8 bits, avec le bouclage de QOI
+      int32 dR = (int8)(uint8)(R - (int32)((Previous >> 16) & 0xFF));
+      int32 dG = (int8)(uint8)(G - (int32)((Previous >> 8) & 0xFF));
+      int32 dB = (int8)(uint8)(B - (int32)(Previous & 0xFF));
+      int32 dRG = dR - dG;
+      int32 dBG = dB - dG;
+      if ((dR >= -2) && (dR <= 1) && (dG >= -2) && (dG <= 1) && (dB >= -2) && (dB <= 1))
+      {
+        *At++ = (uint8)(QOIOpDiff | ((dR + 2) << 4) | ((dG + 2) << 2) | (dB + 2));
+      }
+      else if ((dG >= -32) && (dG <= 31) && (dRG >= -8) && (dRG <= 7) && (dBG >= -8) && (dBG <= 7))
+      {
+        *At++ = (uint8)(QOIOpLuma | (dG + 32));
+        *At++ = (uint8)(((dRG + 8) << 4) | (dBG + 8));
+      }
+      else
+      {
+        *At++ = QOIOpRGB;
+        *At++ = (uint8)R;
+        *At++ = (uint8)G;
+        *At++ = (uint8)B;
+      }
+    }
+    Previous = Pixel;
+  }
+  if (Run)
+  {
+    *At++ = (uint8)(QOIOpRun | (Run - 1));
+  }
+  for (int Zero = 0; Zero < QOIEndMarkerSize - 1; ++Zero)
+  {
+    *At++ = 0;
+  }
+  *At++ = 1;
+  uint32 Result = (uint32)(At - Dest);
+  return(Result);
+}
+
+/*
+  Fichier de capture : en-tte, images, puis index
+  L'en-tte est rcrit  la fin avec le nombre d'images et la place de l'index.
+*/
+#define CaptureFileMagic 0x43564D46 // "FMVC"
+#define CaptureFileVersion 1
+
+enum capture_format
+{
+  CaptureFormat_QOI,
+  CaptureFormat_Raw, // XRGB8888 en lignes contigus
+};
+
+struct capture_file_header
+{
+  uint32 Magic;
+  uint32 Version;
+  uint32 Format; // capture_format
+  int32 Width;
+  int32 Height;
+  uint32 FrameCount;
+  uint64 IndexOffset;
+  uint64 TimestampFrequency; // Horodatages par seconde
+};
+
+// Une entre par image, dans l'ordre d'affichage
+struct capture_index_entry
+{
+  uint64 Offset;
+  uint64 Timestamp;
+  uint32 Size;
+  uint32 Pad;
+};
+
+#define FAITMAIN_CAPTURE_H
+#endif
\ No newline at end of file
@@ -0,0 +1,301 @@
+/*
+  Noyaux de dessin : un template par noyau, spcialis par format de pixel
+  (pixel_traits), mode de mlange (blend_op) et dcoupage
+*/
+
+/*
+  Accs aux pixels de chaque format. Les canaux sont manipuls en flottants
+  dans l'chelle native du format (0-255 pour les formats 8 bits, linaire
+  0-1 pour RGBA32F), ce qui rend les mlanges identiques pour tous les formats.
+*/
+struct draw_channels
+{
+  real32 R;
+  real32 G;
+  real32 B;
+  real32 A;
+};
+
+struct pixel_rgba32f
+{
+  real32 R;
+  real32 G;
+  real32 B;
+  real32 A;
+};
+
+inline uint32
+RoundChannel(real32 Value)
+{
+  uint32 Result = (uint32)(Value + 0.5f);
+  return(Result);
+}
+
+template <game_pixel_format Format> struct pixel_traits;
+
+template <> struct pixel_traits<PixelFormat_XRGB8888>
+{
+  typedef uint32 pixel;
+  static inline pixel FromBytes(uint8 R, uint8 G, uint8 B)
+  {
+    return(((uint32)R << 16) | ((uint32)G << 8) | B);
+  }
+  static inline draw_channels FromColor(draw_color Color)
+  {
+    draw_channels Result = {255.0f*Color.R, 255.0f*Color.G, 255.0f*Color.B, Color.A};
+    return(Result);
+  }
+  static inline pixel Pack(draw_channels C)
+  {
+    return((RoundChannel(C.R) << 16) | (RoundChannel(C.G) << 8) | RoundChannel(C.B));
+  }
+  static inline draw_channels Unpack(pixel P)
+  {
+    draw_channels Result = {(real32)((P >> 16) & 0xFF), (real32)((P >> 8) & 0xFF), (real32)(P & 0xFF), 1.0f};
+    return(Result);
+  }
+  static inline real32 MaxChannel(void) { return(255.0f); }
+};
+
+template <> struct pixel_traits<PixelFormat_RGBA8888>
+{
+  typedef uint32 pixel;
+  static inline pixel FromBytes(uint8 R, uint8 G, uint8 B)
+  {
+    return(0xFF000000 | ((uint32)B << 16) | ((uint32)G << 8) | R);
+  }
+  static inline draw_channels FromColor(draw_color Color)
+  {
+    draw_channels Result = {255.0f*Color.R, 255.0f*Color.G, 255.0f*Color.B, Color.A};
+    return(Result);
+  }
+  static inline pixel Pack(draw_channels C)
+  {
+    return(0xFF000000 | (RoundChannel(C.B) << 16) | (RoundChannel(C.G) << 8) | RoundChannel(C.R));
+  }
+  static inline draw_channels Unpack(pixel P)
+  {
+    draw_channels Result = {(real32)(P & 0xFF), (real32)((P >> 8) & 0xFF), (real32)((P >> 16) & 0xFF), 1.0f};
+    return(Result);
+  }
+  static inline real32 MaxChannel(void) { return(255.0f); }
+};
+
+template <> struct pixel_traits<PixelFormat_RGB565>
+{
+  typedef uint16 pixel;
+  static inline pixel FromBytes(uint8 R, uint8 G, uint8 B)
+  {
+    return((uint16)(((R & 0xF8) << 8) | ((G & 0xFC) << 3) | (B >> 3)));
+  }
+  static inline draw_channels FromColor(draw_color Color)
+  {
+    draw_channels Result = {255.0f*Color.R, 255.0f*Color.G, 255.0f*Color.B, Color.A};
+    return(Result);
+  }
+  static inline pixel Pack(draw_channels C)
+  {
+    return(FromBytes((uint8)RoundChannel(C.R), (uint8)RoundChannel(C.G), (uint8)RoundChannel(C.B)));
+  }
+  // Comme Unpack565ToXRGB_4x : les bits hauts recopis en bas, 0x1F donne 0xFF
+  static inline draw_channels Unpack(pixel P)
+  {
+    uint32 R5 = (P >> 11) & 0x1F;
+    uint32 G6 = (P >> 5) & 0x3F;
+    uint32 B5 = P & 0x1F;
+    draw_channels Result = {(real32)((R5 << 3) | (R5 >> 2)), (real32)((G6 << 2) | (G6 >> 4)),
+                            (real32)((B5 << 3) | (B5 >> 2)), 1.0f};
+    return(Result);
+  }
+  static inline real32 MaxChannel(void) { return(255.0f); }
+};
+
+template <> struct pixel_traits<PixelFormat_RGBA32F>
+{
+  typedef pixel_rgba32f pixel;
+  // GlobalSRGBTables doit tre initialise, voir GetDrawKernels
+  static inline pixel FromBytes(uint8 R, uint8 G, uint8 B)
+  {
+    real32 *Table = GlobalSRGBTables.SRGB8ToLinear;
+    pixel Result = {Table[R], Table[G], Table[B], 1.0f};
+    return(Result);
+  }
+  static inline draw_channels FromColor(draw_color Color)
+  {
+    real32 *Table = GlobalSRGBTables.SRGB8ToLinear;
+    draw_channels Result = {Table[RoundChannel(255.0f*Color.R)], Table[RoundChannel(255.0f*Color.G)],
+                            Table[RoundChannel(255.0f*Color.B)], Color.A};
+    return(Result);
+  }
+  static inline pixel Pack(draw_channels C)
+  {
+    pixel Result = {C.R, C.G, C.B, 1.0f};
+    return(Result);
+  }
+  static inline draw_channels Unpack(pixel P)
+  {
+    draw_channels Result = {P.R, P.G, P.B, 1.0f};
+    return(Result);
+  }
+  static inline real32 MaxChannel(void) { return(1.0f); }
+};
+
+/*
+  Modes de mlange. Packed est la couleur dj au format du buffer, Source
+  la mme en canaux : chaque mode n'utilise que ce dont il a besoin.
+*/
+template <blend_mode Mode> struct blend_op;
+
+template <> struct blend_op<BlendMode_Replace>
+{
+  template <typename traits>
+  static inline typename traits::pixel Apply(typename traits::pixel Dest, typename traits::pixel Packed,
+                                             draw_channels Source)
+  {
+    return(Packed);
+  }
+};
+
+template <> struct blend_op<BlendMode_Alpha>
+{
+  template <typename traits>
+  static inline typename traits::pixel Apply(typename traits::pixel Dest, typename traits::pixel Packed,
+                                             draw_channels Source)
+  {
+    draw_channels D = traits::Unpack(Dest);
+    D.R += (Source.R - D.R)*Source.A;
+    D.G += (Source.G - D.G)*Source.A;
+    D.B += (Source.B - D.B)*Source.A;
+    return(traits::Pack(D));
+  }
+};
+
+template <> struct blend_op<BlendMode_Additive>
+{
+  template <typename traits>
+  static inline typename traits::pixel Apply(typename traits::pixel Dest, typename traits::pixel Packed,
+                                             draw_channels Source)
+  {
+    draw_channels D = traits::Unpack(Dest);
+    real32 Max = traits::MaxChannel();
+    D.R += Source.R*Source.A;
+    D.G += Source.G*Source.A;
+    D.B += Source.B*Source.A;
+    if (D.R > Max) D.R = Max;
+    if (D.G > Max) D.G = Max;
+    if (D.B > Max) D.B = Max;
+    return(traits::Pack(D));
+  }
+};
+
+/* Le gradient trange du jeu, directement au format du buffer */
+template <game_pixel_format Format>
+internal RENDER_GRADIENT_KERNEL(RenderGradientKernel)
+{
+  typedef pixel_traits<Format> traits;
+  uint8 *Row = (uint8 *)Buffer->Memory;
+  for (int Y = 0; Y < Buffer->Height; ++Y)
+  {
+    typename traits::pixel *Pixel = (typename traits::pixel *)Row;
+    uint8 Green = (uint8)(Y + YOffset);
+    for (int X = 0; X < Buffer->Width; ++X)
+    {
+      uint8 Blue = (uint8)(X + XOffset);
+      uint8 Red = (uint8)(X + Y);
+      *Pixel++ = traits::FromBytes(Red, Green, Blue);
+    }
+    Row += Buffer->Pitch;
+  }
+}
+
+template <game_pixel_format Format, blend_mode Mode, bool Clip>
+internal FILL_RECTANGLE_KERNEL(FillRectangleKernel)
+{
+  typedef pixel_traits<Format> traits;
+  // Constantes  la compilation : ces tests disparaissent des versions sans dcoupage
+  if (Clip)
+  {
+    if (MinX < 0) MinX = 0;
+    if (MinY < 0) MinY = 0;
+    if (MaxX > Buffer->Width) MaxX = Buffer->Width;
+    if (MaxY > Buffer->Height) MaxY = Buffer->Height;
+  }
+  else
+  {
+    Assert((MinX >= 0) && (MinY >= 0) && (MaxX <= Buffer->Width) && (MaxY <= Buffer->Height));
+  }
+
+  draw_channels Source = traits::FromColor(Color);
+  typename traits::pixel Packed = traits::Pack(Source);
+  uint8 *Row = (uint8 *)Buffer->Memory + MinY*Buffer->Pitch;
+  for (int Y = MinY; Y < MaxY; ++Y)
+  {
+    typename traits::pixel *Pixel = (typename traits::pixel *)Row + MinX;
+    for (int X = MinX; X < MaxX; ++X)
+    {
+      *Pixel = blend_op<Mode>::template Apply<traits>(*Pixel, Packed, Source);
+      ++Pixel;
+    }
+    Row += Buffer->Pitch;
+  }
+}
+
+template <game_pixel_format Format>
+internal SPLAT_ADDITIVE_KERNEL(SplatAdditiveKernel)
+{
+  typedef pixel_traits<Format> traits;
+  draw_channels Source = traits::FromColor(Color);
+  typename traits::pixel Packed = traits::Pack(Source);
+  real32 Alpha = Source.A;
+  uint8 *Base = (uint8 *)Buffer->Memory;
+  for (uint32 Index = 0; Index < Count; ++Index)
+  {
+    typename traits::pixel *Pixel = (typename traits::pixel *)(Base + Offsets[Index]);
+    Source.A = Alpha*Intensities[Index];
+    *Pixel = blend_op<BlendMode_Additive>::template Apply<traits>(*Pixel, Packed, Source);
+  }
+}
+
+// Table des noyaux, dans l'ordre de game_pixel_format
+#define DRAW_KERNELS_FOR_MODE(Format, Mode) \
+  {FillRectangleKernel<Format, Mode, false>, FillRectangleKernel<Format, Mode, true>}
+#define DRAW_KERNELS_FOR_FORMAT(Format) \
+  {Format, RenderGradientKernel<Format>, \
+   {DRAW_KERNELS_FOR_MODE(Format, BlendMode_Replace), \
+    DRAW_KERNELS_FOR_MODE(Format, BlendMode_Alpha), \
+    DRAW_KERNELS_FOR_MODE(Format, BlendMode_Additive)}, \
+   SplatAdditiveKernel<Format>}
+
+global_variable draw_kernels GlobalDrawKernels[PixelFormat_Count] =
+{
+  DRAW_KERNELS_FOR_FORMAT(PixelFormat_XRGB8888),
+  DRAW_KERNELS_FOR_FORMAT(PixelFormat_RGBA8888),
+  DRAW_KERNELS_FOR_FORMAT(PixelFormat_RGB565),
+  DRAW_KERNELS_FOR_FORMAT(PixelFormat_RGBA32F),
+};
+
+/**
+ * Les noyaux pour le format du buffer,  chercher une fois par buffer
+ **/
+internal draw_kernels *
+GetDrawKernels(game_offscreen_buffer *Buffer)
+{
+  Assert(Buffer->PixelFormat < PixelFormat_Count);
+  draw_kernels *Result = GlobalDrawKernels + Buffer->PixelFormat;
+  Assert(Result->PixelFormat == Buffer->PixelFormat);
+  // Les noyaux RGBA32F lisent la table sRGB -> linaire
+  if (!GlobalSRGBTables.IsInitialized) InitializeSRGBTables(&GlobalSRGBTables);
+  return(Result);
+}
+
+/**
+ * Rectangle en coordonnes cran : la version sans dcoupage est choisie
+ * quand le rectangle est entirement dans le buffer
+ **/
+inline void
+DrawRectangle(draw_kernels *Kernels, game_offscreen_buffer *Buffer,
+              int MinX, int MinY, int MaxX, int MaxY, draw_color Color, blend_mode Mode)
+{
+  bool32 IsInside = ((MinX >= 0) && (MinY >= 0) && (MaxX <= Buffer->Width) && (MaxY <= Buffer->Height));
+  Kernels->FillRectangle[Mode][IsInside ? 0 : 1](Buffer, MinX, MinY, MaxX, MaxY, Color);
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#if !defined(FAITMAIN_DRAW_H)
+
+/*
+  Noyaux de dessin spcialiss  la compilation
+
+  Chaque noyau est un template sur le format de pixel, le mode de mlange
+  et le dcoupage aux bords. Le compilateur en gnre une version par
+  combinaison : aucune boucle interne ne teste le format ou le mode.
+  Le choix se fait une seule fois par buffer, dans une table indexe par
+  le format (GetDrawKernels), puis par mode et dcoupage.
+*/
+
+enum blend_mode
+{
+  BlendMode_Replace,  // La couleur remplace le pixel, l'alpha est ignor
+  BlendMode_Alpha,    // Mlange par l'alpha de la couleur
+  BlendMode_Additive, // Ajout de la couleur multiplie par son alpha, satur
+
+  BlendMode_Count,
+};
+
+// Couleur en sRGB, canaux dans [0, 1]
+struct draw_color
+{
+  real32 R;
+  real32 G;
+  real32 B;
+  real32 A;
+};
+
+// Passage du monde (mtres, Y vers le haut)  l'cran (pixels, Y vers le bas)
+struct world_view
+{
+  real32 CenterX;
+  real32 CenterY;
+  real32 PixelsPerMeter;
+};
+
+#define RENDER_GRADIENT_KERNEL(name) void name(game_offscreen_buffer *Buffer, int XOffset, int YOffset)
+typedef RENDER_GRADIENT_KERNEL(render_gradient_kernel);
+
+// Rectangle [Min, Max) en pixels ; sans dcoupage il doit tre dans le buffer
+#define FILL_RECTANGLE_KERNEL(name) void name(game_offscreen_buffer *Buffer, int MinX, int MinY, \
+                                              int MaxX, int MaxY, draw_color Color)
+typedef FILL_RECTANGLE_KERNEL(fill_rectangle_kernel);
+
+// Lot de points d'un pixel, mlangs en additif : Offsets en octets depuis
+// Buffer->Memory (dj dcoups), Intensities multiplie l'alpha de la couleur
+#define SPLAT_ADDITIVE_KERNEL(name) void name(game_offscreen_buffer *Buffer, uint32 *Offsets, \
+                                              real32 *Intensities, uint32 Count, draw_color Color)
+typedef SPLAT_ADDITIVE_KERNEL(splat_additive_kernel);
+
+struct draw_kernels
+{
+  game_pixel_format PixelFormat;
+  render_gradient_kernel *RenderGradient;
+  fill_rectangle_kernel *FillRectangle[BlendMode_Count][2]; // [Mode][Dcoupage]
+  splat_additive_kernel *SplatAdditive;
+};
+
+#define FAITMAIN_DRAW_H
+#endif
\ No newline at end of file
@@ -0,0 +1,195 @@
+/*
+  Entits : cration, handles stables, mise  jour SSE et compactage
+*/
+
+#define EntityNullSlot 0xFFFFFFFF
+
+internal void
+InitializeEntityStorage(entity_storage *Storage, memory_arena *Arena, uint32 MaxCount)
+{
+  MaxCount = (MaxCount + 3) & ~3;
+  Storage->MaxCount = MaxCount;
+  Storage->Count = 0;
+  Storage->PositionX = PushArray(Arena, MaxCount, real32);
+  Storage->PositionY = PushArray(Arena, MaxCount, real32);
+  Storage->PreviousPositionX = PushArray(Arena, MaxCount, real32);
+  Storage->PreviousPositionY = PushArray(Arena, MaxCount, real32);
+  Storage->VelocityX = PushArray(Arena, MaxCount, real32);
+  Storage->VelocityY = PushArray(Arena, MaxCount, real32);
+  Storage->Flags = PushArray(Arena, MaxCount, uint32);
+  Storage->SlotOfEntity = PushArray(Arena, MaxCount, uint32);
+  Storage->EntityOfSlot = PushArray(Arena, MaxCount, uint32);
+  Storage->Generation = PushArray(Arena, MaxCount, uint32);
+
+  // Tous les slots sont libres et chans entre eux
+  for (uint32 Slot = 0; Slot < MaxCount; ++Slot)
+  {
+    Storage->EntityOfSlot[Slot] = Slot + 1;
+    Storage->Generation[Slot] = 1;
+    Storage->PositionX[Slot] = Storage->PositionY[Slot] = 0.0f;
+    Storage->PreviousPositionX[Slot] = Storage->PreviousPositionY[Slot] = 0.0f;
+    Storage->VelocityX[Slot] = Storage->VelocityY[Slot] = 0.0f;
+    Storage->Flags[Slot] = 0;
+  }
+  Storage->EntityOfSlot[MaxCount - 1] = EntityNullSlot;
+  Storage->FirstFreeSlot = 0;
+}
+
+/**
+ * Ajout d'une entit  la fin des tableaux denses
+ * Renvoie un handle nul (gnration 0) si le stockage est plein
+ **/
+internal entity_handle
+AddEntity(entity_storage *Storage, real32 PositionX, real32 PositionY,
+          real32 VelocityX, real32 VelocityY, uint32 Flags)
+{
+  entity_handle Result = {};
+  uint32 Slot = Storage->FirstFreeSlot;
+  if (Slot != EntityNullSlot)
+  {
+    Storage->FirstFreeSlot = Storage->EntityOfSlot[Slot];
+
+    uint32 Index = Storage->Count++;
+    Storage->PositionX[Index] = PositionX;
+    Storage->PositionY[Index] = PositionY;
+    Storage->PreviousPositionX[Index] = PositionX;
+    Storage->PreviousPositionY[Index] = PositionY;
+    Storage->VelocityX[Index] = VelocityX;
+    Storage->VelocityY[Index] = VelocityY;
+    Storage->Flags[Index] = Flags;
+    Storage->SlotOfEntity[Index] = Slot;
+    Storage->EntityOfSlot[Slot] = Index;
+
+    Result.Slot = Slot;
+    Result.Generation = Storage->Generation[Slot];
+  }
+  return(Result);
+}
+
+// Index dense de l'entit, ou -1 si le handle ne dsigne plus rien
+inline int32
+GetEntityIndex(entity_storage *Storage, entity_handle Handle)
+{
+  int32 Result = -1;
+  if ((Handle.Slot < Storage->MaxCount) &&
+      (Handle.Generation != 0) &&
+      (Storage->Generation[Handle.Slot] == Handle.Generation))
+  {
+    Result = (int32)Storage->EntityOfSlot[Handle.Slot];
+  }
+  return(Result);
+}
+
+/*
+  Retire l'entit d'index dense Index : la dernire prend sa place et son
+  slot est invalid en changeant de gnration
+*/
+internal void
+RemoveEntityAt(entity_storage *Storage, uint32 Index)
+{
+  Assert(Index < Storage->Count);
+  uint32 Slot = Storage->SlotOfEntity[Index];
+  uint32 Last = --Storage->Count;
+  if (Index != Last)
+  {
+    Storage->PositionX[Index] = Storage->PositionX[Last];
+    Storage->PositionY[Index] = Storage->PositionY[Last];
+    Storage->PreviousPositionX[Index] = Storage->PreviousPositionX[Last];
+    Storage->PreviousPositionY[Index] = Storage->PreviousPositionY[Last];
+    Storage->VelocityX[Index] = Storage->VelocityX[Last];
+    Storage->VelocityY[Index] = Storage->VelocityY[Last];
+    Storage->Flags[Index] = Storage->Flags[Last];
+    uint32 LastSlot = Storage->SlotOfEntity[Last];
+    Storage->SlotOfEntity[Index] = LastSlot;
+    Storage->EntityOfSlot[LastSlot] = Index;
+  }
+  // La case libre ne doit pas tre intgre avec des valeurs au hasard
+  Storage->Flags[Last] = 0;
+
+  if (++Storage->Generation[Slot] == 0) Storage->Generation[Slot] = 1;
+  Storage->EntityOfSlot[Slot] = Storage->FirstFreeSlot;
+  Storage->FirstFreeSlot = Slot;
+}
+
+inline void
+RemoveEntity(entity_storage *Storage, entity_handle Handle)
+{
+  int32 Index = GetEntityIndex(Storage, Handle);
+  if (Index >= 0)
+  {
+    RemoveEntityAt(Storage, (uint32)Index);
+  }
+}
+
+/**
+ * Retire toutes les entits marques EntityFlag_Dead
+ * On parcourt  l'envers pour que l'entit dplace ait dj t teste
+ **/
+internal uint32
+CompactEntities(entity_storage *Storage)
+{
+  uint32 RemovedCount = 0;
+  for (uint32 Index = Storage->Count; Index-- > 0;)
+  {
+    if (Storage->Flags[Index] & EntityFlag_Dead)
+    {
+      RemoveEntityAt(Storage, Index);
+      ++RemovedCount;
+    }
+  }
+  return(RemovedCount);
+}
+
+// Dbut d'un pas de simulation : les positions courantes deviennent les prcdentes
+inline void
+SaveEntityPositions(entity_storage *Storage)
+{
+  memcpy(Storage->PreviousPositionX, Storage->PositionX, Storage->Count*sizeof(real32));
+  memcpy(Storage->PreviousPositionY, Storage->PositionY, Storage->Count*sizeof(real32));
+}
+
+/**
+ * Intgration des entits mobiles par paquets de 4, avec rebond sur les
+ * bords de la zone [Min, Max]. Pas de branche : les masques SSE choisissent
+ * entre ancienne et nouvelle valeur.
+ **/
+internal void
+UpdateEntities(entity_storage *Storage, real32 dt,
+               real32 MinX, real32 MinY, real32 MaxX, real32 MaxY)
+{
+  __m128 dtWide = _mm_set1_ps(dt);
+  __m128 MinXWide = _mm_set1_ps(MinX);
+  __m128 MinYWide = _mm_set1_ps(MinY);
+  __m128 MaxXWide = _mm_set1_ps(MaxX);
+  __m128 MaxYWide = _mm_set1_ps(MaxY);
+  __m128 SignMask = _mm_set1_ps(-0.0f);
+  __m128i MovingFlag = _mm_set1_epi32(EntityFlag_Moving);
+
+  for (uint32 Index = 0; Index < Storage->Count; Index += 4)
+  {
+    __m128 PX = _mm_load_ps(Storage->PositionX + Index);
+    __m128 PY = _mm_load_ps(Storage->PositionY + Index);
+    __m128 VX = _mm_load_ps(Storage->VelocityX + Index);
+    __m128 VY = _mm_load_ps(Storage->VelocityY + Index);
+    __m128i Flags = _mm_load_si128((__m128i *)(Storage->Flags + Index));
+    __m128 Moving = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(Flags, MovingFlag), MovingFlag));
+
+    __m128 NewPX = _mm_add_ps(PX, _mm_mul_ps(VX, dtWide));
+    __m128 NewPY = _mm_add_ps(PY, _mm_mul_ps(VY, dtWide));
+
+    // Rebond : la vitesse change de signe et la position est ramene dans la zone
+    __m128 OutX = _mm_or_ps(_mm_cmplt_ps(NewPX, MinXWide), _mm_cmpgt_ps(NewPX, MaxXWide));
+    __m128 OutY = _mm_or_ps(_mm_cmplt_ps(NewPY, MinYWide), _mm_cmpgt_ps(NewPY, MaxYWide));
+    VX = _mm_xor_ps(VX, _mm_and_ps(_mm_and_ps(OutX, Moving), SignMask));
+    VY = _mm_xor_ps(VY, _mm_and_ps(_mm_and_ps(OutY, Moving), SignMask));
+    NewPX = _mm_min_ps(_mm_max_ps(NewPX, MinXWide), MaxXWide);
+    NewPY = _mm_min_ps(_mm_max_ps(NewPY, MinYWide), MaxYWide);
+
+    PX = _mm_or_ps(_mm_and_ps(Moving, NewPX), _mm_andnot_ps(Moving, PX));
+    PY = _mm_or_ps(_mm_and_ps(Moving, NewPY), _mm_andnot_ps(Moving, PY));
+    _mm_store_ps(Storage->PositionX + Index, PX);
+    _mm_store_ps(Storage->PositionY + Index, PY);
+    _mm_store_ps(Storage->VelocityX + Index, VX);
+    _mm_store_ps(Storage->VelocityY + Index, VY);
+  }
+}
\ No newline at end of file
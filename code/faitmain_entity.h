@@ -0,0 +1,52 @@
+#if !defined(FAITMAIN_ENTITY_H)
+
+/*
+  Stockage des entits en structure de tableaux (SoA)
+
+  Chaque champ a son propre tableau, les entits vivantes sont tasses au
+  dbut ([0, Count)), ce qui permet de mettre  jour 4 entits  la fois en
+  SSE sans trou ni test. Les tableaux sont aligns sur 16 octets et leur
+  taille arrondie  un multiple de 4, la mise  jour peut donc dborder
+  sans risque sur les dernires cases.
+
+  Une entit supprime est remplace par la dernire : les index changent,
+  on garde donc une table de handles (index + gnration) qui reste stable.
+  Les positions sont en mtres dans la zone simule. Les positions du pas
+  de simulation prcdent sont gardes pour interpoler l'affichage.
+*/
+
+enum entity_flags
+{
+  EntityFlag_Moving = (1 << 0), // Intgre par UpdateEntities
+  EntityFlag_Dead = (1 << 1),   // Retire au prochain CompactEntities
+};
+
+struct entity_handle
+{
+  uint32 Slot;
+  uint32 Generation; // 0 n'est jamais une gnration valide
+};
+
+struct entity_storage
+{
+  uint32 MaxCount; // Multiple de 4
+  uint32 Count;
+
+  // Tableaux denses, indexs par la position de l'entit
+  real32 *PositionX;
+  real32 *PositionY;
+  real32 *PreviousPositionX; // Avant le dernier pas de simulation
+  real32 *PreviousPositionY;
+  real32 *VelocityX;
+  real32 *VelocityY;
+  uint32 *Flags;
+  uint32 *SlotOfEntity;
+
+  // Table des handles, indexe par Slot
+  uint32 *EntityOfSlot; // Index dense, ou prochain slot libre si le slot est libre
+  uint32 *Generation;
+  uint32 FirstFreeSlot;
+};
+
+#define FAITMAIN_ENTITY_H
+#endif
\ No newline at end of file
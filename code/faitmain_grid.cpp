@@ -0,0 +1,256 @@
+/*
+  Grille de hachage spatiale : construction par tri par comptage et requtes
+*/
+
+inline int32
+GetGridCoord(real32 Value)
+{
+  // floorf est lent, la troncature suffit  condition de corriger les ngatifs
+  int32 Result = (int32)Value;
+  if ((real32)Result > Value) --Result;
+  return(Result);
+}
+
+inline uint32
+GetGridCellHash(spatial_grid *Grid, int32 CellX, int32 CellY)
+{
+  uint32 Result = (uint32)CellX*0x9E3779B1 + (uint32)CellY*0x85EBCA77;
+  Result ^= Result >> 16;
+  return(Result & (Grid->CellCount - 1));
+}
+
+/*
+  Les phases de la construction, chacune dcoupe en JobCount tches
+*/
+internal PLATFORM_WORK_QUEUE_CALLBACK(SpatialGridCountWork)
+{
+  spatial_grid_job *Job = (spatial_grid_job *)Data;
+  spatial_grid *Grid = Job->Grid;
+  uint32 *Histogram = Grid->Histograms + Job->JobIndex*Grid->CellCount;
+  for (uint32 Cell = 0; Cell < Grid->CellCount; ++Cell)
+  {
+    Histogram[Cell] = 0;
+  }
+  for (uint32 Index = Job->FirstEntity; Index < Job->OnePastLastEntity; ++Index)
+  {
+    uint32 Cell = GetGridCellHash(Grid,
+                                  GetGridCoord(Grid->SourceX[Index]*Grid->InvCellSize),
+                                  GetGridCoord(Grid->SourceY[Index]*Grid->InvCellSize));
+    Grid->CellOfEntity[Index] = Cell;
+    ++Histogram[Cell];
+  }
+}
+
+// Total des entits dans la tranche de seaux de la tche
+internal PLATFORM_WORK_QUEUE_CALLBACK(SpatialGridSumWork)
+{
+  spatial_grid_job *Job = (spatial_grid_job *)Data;
+  spatial_grid *Grid = Job->Grid;
+  uint32 Total = 0;
+  for (uint32 JobIndex = 0; JobIndex < Grid->JobCount; ++JobIndex)
+  {
+    uint32 *Histogram = Grid->Histograms + JobIndex*Grid->CellCount;
+    for (uint32 Cell = Job->FirstCell; Cell < Job->OnePastLastCell; ++Cell)
+    {
+      Total += Histogram[Cell];
+    }
+  }
+  Grid->JobTotals[Job->JobIndex] = Total;
+}
+
+// Sommes prfixes : dbut de chaque seau, et de chaque tche dans chaque seau
+internal PLATFORM_WORK_QUEUE_CALLBACK(SpatialGridOffsetWork)
+{
+  spatial_grid_job *Job = (spatial_grid_job *)Data;
+  spatial_grid *Grid = Job->Grid;
+  uint32 Running = Grid->JobTotals[Job->JobIndex];
+  for (uint32 Cell = Job->FirstCell; Cell < Job->OnePastLastCell; ++Cell)
+  {
+    Grid->CellStart[Cell] = Running;
+    for (uint32 JobIndex = 0; JobIndex < Grid->JobCount; ++JobIndex)
+    {
+      uint32 *Count = Grid->Histograms + JobIndex*Grid->CellCount + Cell;
+      uint32 CellCount = *Count;
+      *Count = Running;
+      Running += CellCount;
+    }
+  }
+}
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(SpatialGridScatterWork)
+{
+  spatial_grid_job *Job = (spatial_grid_job *)Data;
+  spatial_grid *Grid = Job->Grid;
+  uint32 *Offsets = Grid->Histograms + Job->JobIndex*Grid->CellCount;
+  for (uint32 Index = Job->FirstEntity; Index < Job->OnePastLastEntity; ++Index)
+  {
+    uint32 Dest = Offsets[Grid->CellOfEntity[Index]]++;
+    Grid->EntityIndices[Dest] = Index;
+    Grid->SortedX[Dest] = Grid->SourceX[Index];
+    Grid->SortedY[Dest] = Grid->SourceY[Index];
+  }
+}
+
+internal void
+RunSpatialGridPhase(platform_api *Platform, platform_work_queue *Queue,
+                    platform_work_queue_callback *Callback, spatial_grid_job *Jobs, uint32 JobCount)
+{
+  if (Queue && (JobCount > 1))
+  {
+    for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+    {
+      Platform->AddWorkEntry(Queue, Callback, Jobs + JobIndex);
+    }
+    Platform->CompleteAllWork(Queue);
+  }
+  else
+  {
+    for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+    {
+      Callback(Queue, Jobs + JobIndex);
+    }
+  }
+}
+
+/**
+ * Construction de la grille dans l'arne (mmoire transitoire de l'image)
+ * Sans file de travail (Queue  0) tout est fait sur le thread appelant.
+ **/
+internal void
+BuildSpatialGrid(spatial_grid *Grid, memory_arena *Arena,
+                 real32 *PositionX, real32 *PositionY, uint32 EntityCount, real32 CellSize,
+                 platform_api *Platform, platform_work_queue *Queue, uint32 JobCount)
+{
+  if (JobCount < 1) JobCount = 1;
+  if (JobCount > SpatialGridMaxJobCount) JobCount = SpatialGridMaxJobCount;
+  if (!Queue) JobCount = 1;
+
+  // Environ une entit par seau
+  uint32 CellCount = 64;
+  while (CellCount < EntityCount) CellCount *= 2;
+
+  Grid->CellSize = CellSize;
+  Grid->InvCellSize = 1.0f / CellSize;
+  Grid->CellCount = CellCount;
+  Grid->EntityCount = EntityCount;
+  Grid->JobCount = JobCount;
+  Grid->SourceX = PositionX;
+  Grid->SourceY = PositionY;
+  Grid->CellStart = PushArray(Arena, CellCount + 1, uint32);
+  Grid->EntityIndices = PushArray(Arena, EntityCount, uint32);
+  Grid->SortedX = PushArray(Arena, EntityCount, real32);
+  Grid->SortedY = PushArray(Arena, EntityCount, real32);
+  Grid->CellOfEntity = PushArray(Arena, EntityCount, uint32);
+  Grid->Histograms = PushArray(Arena, JobCount*CellCount, uint32);
+
+  spatial_grid_job Jobs[SpatialGridMaxJobCount];
+  for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+  {
+    spatial_grid_job *Job = Jobs + JobIndex;
+    Job->Grid = Grid;
+    Job->JobIndex = JobIndex;
+    Job->FirstEntity = (uint32)(((uint64)EntityCount*JobIndex) / JobCount);
+    Job->OnePastLastEntity = (uint32)(((uint64)EntityCount*(JobIndex + 1)) / JobCount);
+    Job->FirstCell = (uint32)(((uint64)CellCount*JobIndex) / JobCount);
+    Job->OnePastLastCell = (uint32)(((uint64)CellCount*(JobIndex + 1)) / JobCount);
+  }
+
+  RunSpatialGridPhase(Platform, Queue, SpatialGridCountWork, Jobs, JobCount);
+  RunSpatialGridPhase(Platform, Queue, SpatialGridSumWork, Jobs, JobCount);
+  // Somme prfixe des totaux, il y a au plus SpatialGridMaxJobCount valeurs
+  uint32 Running = 0;
+  for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+  {
+    uint32 Total = Grid->JobTotals[JobIndex];
+    Grid->JobTotals[JobIndex] = Running;
+    Running += Total;
+  }
+  Assert(Running == EntityCount);
+  RunSpatialGridPhase(Platform, Queue, SpatialGridOffsetWork, Jobs, JobCount);
+  Grid->CellStart[CellCount] = EntityCount;
+  RunSpatialGridPhase(Platform, Queue, SpatialGridScatterWork, Jobs, JobCount);
+}
+
+#define SpatialGridMaxQueryCells 64
+
+/**
+ * Toutes les entits  moins de Radius du point, au plus MaxResults
+ * Renvoie le nombre d'entits trouves (qui peut dpasser MaxResults)
+ **/
+internal uint32
+QuerySpatialGridRadius(spatial_grid *Grid, real32 X, real32 Y, real32 Radius,
+                       uint32 *Results, uint32 MaxResults)
+{
+  uint32 Result = 0;
+  int32 MinCellX = GetGridCoord((X - Radius)*Grid->InvCellSize);
+  int32 MaxCellX = GetGridCoord((X + Radius)*Grid->InvCellSize);
+  int32 MinCellY = GetGridCoord((Y - Radius)*Grid->InvCellSize);
+  int32 MaxCellY = GetGridCoord((Y + Radius)*Grid->InvCellSize);
+  Assert((MaxCellX - MinCellX + 1)*(MaxCellY - MinCellY + 1) <= SpatialGridMaxQueryCells);
+
+  // Deux cases peuvent tomber dans le mme seau : on ne le lit qu'une fois
+  uint32 Visited[SpatialGridMaxQueryCells];
+  uint32 VisitedCount = 0;
+  real32 RadiusSq = Radius*Radius;
+  for (int32 CellY = MinCellY; CellY <= MaxCellY; ++CellY)
+  {
+    for (int32 CellX = MinCellX; CellX <= MaxCellX; ++CellX)
+    {
+      uint32 Cell = GetGridCellHash(Grid, CellX, CellY);
+      bool32 AlreadyVisited = false;
+      for (uint32 VisitedIndex = 0; VisitedIndex < VisitedCount; ++VisitedIndex)
+      {
+        if (Visited[VisitedIndex] == Cell) AlreadyVisited = true;
+      }
+      if (AlreadyVisited || (VisitedCount == SpatialGridMaxQueryCells)) continue;
+      Visited[VisitedCount++] = Cell;
+
+      for (uint32 Sorted = Grid->CellStart[Cell]; Sorted < Grid->CellStart[Cell + 1]; ++Sorted)
+      {
+        real32 dX = Grid->SortedX[Sorted] - X;
+        real32 dY = Grid->SortedY[Sorted] - Y;
+        if (dX*dX + dY*dY <= RadiusSq)
+        {
+          if (Result < MaxResults) Results[Result] = Grid->EntityIndices[Sorted];
+          ++Result;
+        }
+      }
+    }
+  }
+  return(Result);
+}
+
+/**
+ * Paires d'entits  moins de Distance l'une de l'autre, chaque paire une seule
+ * fois (A < B). On ne traite que les entits tries de [First, OnePastLast) :
+ * plusieurs tches peuvent se partager les entits avec chacune leur tableau.
+ * Renvoie le nombre de paires trouves (qui peut dpasser MaxPairs)
+ **/
+internal uint32
+FindSpatialGridPairs(spatial_grid *Grid, uint32 First, uint32 OnePastLast, real32 Distance,
+                     spatial_pair *Pairs, uint32 MaxPairs)
+{
+  uint32 Result = 0;
+  uint32 Neighbours[256];
+  for (uint32 Sorted = First; Sorted < OnePastLast; ++Sorted)
+  {
+    uint32 A = Grid->EntityIndices[Sorted];
+    uint32 NeighbourCount = QuerySpatialGridRadius(Grid, Grid->SortedX[Sorted], Grid->SortedY[Sorted],
+                                                   Distance, Neighbours, ArrayCount(Neighbours));
+    if (NeighbourCount > ArrayCount(Neighbours)) NeighbourCount = ArrayCount(Neighbours);
+    for (uint32 NeighbourIndex = 0; NeighbourIndex < NeighbourCount; ++NeighbourIndex)
+    {
+      uint32 B = Neighbours[NeighbourIndex];
+      if (A < B)
+      {
+        if (Result < MaxPairs)
+        {
+          Pairs[Result].A = A;
+          Pairs[Result].B = B;
+        }
+        ++Result;
+      }
+    }
+  }
+  return(Result);
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#if !defined(FAITMAIN_GRID_H)
+
+/*
+  Grille de hachage spatiale pour la dtection de collisions (broadphase)
+
+  Reconstruite  chaque image dans la mmoire transitoire par un tri par
+  comptage : on compte les entits par case, les sommes prfixes donnent
+  le dbut de chaque case, puis on range les entits. Aucune allocation
+  par case, et les positions sont recopies dans l'ordre des cases pour
+  que les requtes lisent la mmoire de faon contigu.
+
+  Les cases sont haches, le monde n'a donc pas de limite. Deux cases
+  peuvent partager un seau : les requtes testent toujours la distance.
+
+  La construction peut tre dcoupe en tches : chaque tche compte et
+  range sa tranche d'entits avec son propre histogramme, l'ordre final
+  ne dpend donc pas du nombre de threads.
+*/
+
+#define SpatialGridMaxJobCount 8
+
+struct spatial_grid
+{
+  real32 CellSize;
+  real32 InvCellSize;
+  uint32 CellCount; // Nombre de seaux, puissance de 2
+  uint32 EntityCount;
+
+  uint32 *CellStart;     // [CellCount + 1], dbut de chaque seau dans les tableaux tris
+  uint32 *EntityIndices; // Index des entits, tris par seau
+  real32 *SortedX;
+  real32 *SortedY;
+
+  // Pour la construction
+  real32 *SourceX;
+  real32 *SourceY;
+  uint32 *CellOfEntity;
+  uint32 JobCount;
+  uint32 *Histograms;  // [JobCount][CellCount]
+  uint32 JobTotals[SpatialGridMaxJobCount];
+};
+
+struct spatial_grid_job
+{
+  spatial_grid *Grid;
+  uint32 JobIndex;
+  uint32 FirstEntity;
+  uint32 OnePastLastEntity;
+  uint32 FirstCell;
+  uint32 OnePastLastCell;
+};
+
+struct spatial_pair
+{
+  uint32 A;
+  uint32 B;
+};
+
+#define FAITMAIN_GRID_H
+#endif
\ No newline at end of file
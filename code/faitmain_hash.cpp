@@ -0,0 +1,182 @@
+/*
+  Hachage de l'tat simul (voir faitmain_hash.h)
+*/
+
+#define HashStripeSize 64
+#define HashKeySize 192
+#define HashStripesPerBlock ((HashKeySize - HashStripeSize) / 8)
+#define HashPrime32 0x9E3779B1U
+#define HashPrime64 0x9E3779B185EBCA87ULL
+
+// Cl de 192 octets, tire une fois pour toutes (splitmix64)
+global_variable uint64 HashKey[HashKeySize / 8] =
+{
+  0xC89C9F771F4B01B9ULL, 0xC52D3A18B2B7E5DEULL, 0x01BF373D17E914B5ULL,
+  0x4598FA3450A26606ULL, 0x48BC0E1BF966DD68ULL, 0x6A2E2823E005CA8EULL,
+  0x0E1992E2030F710CULL, 0x3E82C4CE93B16112ULL, 0x31E8356719D34A75ULL,
+  0x4C6C721F54BF376DULL, 0x2EE2CC327C4F8605ULL, 0xF7326736E3800798ULL,
+  0x0068E048CB6DBEB6ULL, 0xA9B0D5254782CAB2ULL, 0x0B523517822813A1ULL,
+  0xC3C382264D15E20FULL, 0x1F4230DECD08E901ULL, 0x69773F9179DD81B1ULL,
+  0x84508BD3799DA0ACULL, 0x48F40B768E8755E7ULL, 0xA675134870264EB5ULL,
+  0xA68B2D9DEDE78B37ULL, 0x1E7C594718EF893CULL, 0x8229E1CF2E361117ULL,
+};
+
+inline uint64
+HashMix64(uint64 Value)
+{
+  Value ^= Value >> 33;
+  Value *= 0xFF51AFD7ED558CCDULL;
+  Value ^= Value >> 33;
+  Value *= 0xC4CEB9FE1A85EC53ULL;
+  Value ^= Value >> 33;
+  return(Value);
+}
+
+// Une bande de 64 octets : 8 mots de 64 bits, deux par registre
+inline void
+HashAccumulateStripe(__m128i *Accumulators, uint8 *Data, uint8 *Key)
+{
+  for (int Lane = 0; Lane < 4; ++Lane)
+  {
+    __m128i Value = _mm_loadu_si128((__m128i *)(Data + 16*Lane));
+    __m128i Keyed = _mm_xor_si128(Value, _mm_loadu_si128((__m128i *)(Key + 16*Lane)));
+    // Moiti basse x moiti haute de chaque mot, et le mot voisin ajout tel quel
+    __m128i Product = _mm_mul_epu32(Keyed, _mm_shuffle_epi32(Keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+    __m128i Swapped = _mm_shuffle_epi32(Value, _MM_SHUFFLE(1, 0, 3, 2));
+    Accumulators[Lane] = _mm_add_epi64(Accumulators[Lane], _mm_add_epi64(Product, Swapped));
+  }
+}
+
+// Brassage en fin de bloc, pour que les bits hauts retombent dans les produits suivants
+inline void
+HashScramble(__m128i *Accumulators, uint8 *Key)
+{
+  __m128i Prime = _mm_set1_epi32((int)HashPrime32);
+  for (int Lane = 0; Lane < 4; ++Lane)
+  {
+    __m128i Value = Accumulators[Lane];
+    Value = _mm_xor_si128(Value, _mm_srli_epi64(Value, 47));
+    Value = _mm_xor_si128(Value, _mm_loadu_si128((__m128i *)(Key + 16*Lane)));
+    __m128i Low = _mm_mul_epu32(Value, Prime);
+    __m128i High = _mm_mul_epu32(_mm_srli_epi64(Value, 32), Prime);
+    Accumulators[Lane] = _mm_add_epi64(Low, _mm_slli_epi64(High, 32));
+  }
+}
+
+/**
+ * Hachage 64 bits d'un bloc de mmoire quelconque
+ * La fin qui ne remplit pas une bande est complte de zros, la taille
+ * entre dans le rsultat : deux tailles diffrentes ne se confondent pas.
+ **/
+internal uint64
+HashMemory(void *Memory, uint64 Size, uint64 Seed)
+{
+  uint8 *Key = (uint8 *)HashKey;
+  uint8 *At = (uint8 *)Memory;
+  __m128i Accumulators[4];
+  for (int Lane = 0; Lane < 4; ++Lane)
+  {
+    Accumulators[Lane] = _mm_xor_si128(_mm_loadu_si128((__m128i *)(Key + 16*Lane)),
+                                       _mm_set1_epi64x((int64)Seed));
+  }
+
+  uint64 BlockSize = HashStripesPerBlock*HashStripeSize;
+  uint64 BlockCount = Size / BlockSize;
+  for (uint64 Block = 0; Block < BlockCount; ++Block)
+  {
+    for (uint32 Stripe = 0; Stripe < HashStripesPerBlock; ++Stripe)
+    {
+      HashAccumulateStripe(Accumulators, At + Stripe*HashStripeSize, Key + 8*Stripe);
+    }
+    HashScramble(Accumulators, Key + HashKeySize - HashStripeSize);
+    At += BlockSize;
+  }
+
+  uint64 Remaining = Size - BlockCount*BlockSize;
+  uint32 Stripe = 0;
+  for (; Remaining >= HashStripeSize; ++Stripe)
+  {
+    HashAccumulateStripe(Accumulators, At, Key + 8*Stripe);
+    At += HashStripeSize;
+    Remaining -= HashStripeSize;
+  }
+  if (Remaining)
+  {
+    uint8 Tail[HashStripeSize] = {};
+    memcpy(Tail, At, (size_t)Remaining);
+    HashAccumulateStripe(Accumulators, Tail, Key + 8*Stripe);
+  }
+
+  uint64 Words[8];
+  _mm_storeu_si128((__m128i *)Words + 0, Accumulators[0]);
+  _mm_storeu_si128((__m128i *)Words + 1, Accumulators[1]);
+  _mm_storeu_si128((__m128i *)Words + 2, Accumulators[2]);
+  _mm_storeu_si128((__m128i *)Words + 3, Accumulators[3]);
+  uint64 Result = (Size*HashPrime64) ^ Seed;
+  for (int Word = 0; Word < 8; ++Word)
+  {
+    Result = HashMix64(Result + (Words[Word] ^ HashKey[16 + Word]));
+  }
+  return(Result);
+}
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(StateHashWork)
+{
+  state_hash_job *Job = (state_hash_job *)Data;
+  game_state_hash *Hash = Job->Hash;
+  for (uint32 Range = Job->FirstRange; Range < Job->OnePastLastRange; ++Range)
+  {
+    uint64 Start = Range*Hash->RangeSize;
+    uint64 Size = 0;
+    if (Start < Hash->Size)
+    {
+      Size = Hash->Size - Start;
+      if (Size > Hash->RangeSize) Size = Hash->RangeSize;
+    }
+    Hash->Ranges[Range] = HashMemory(Job->Memory + Start, Size, Range);
+  }
+}
+
+/**
+ * Empreinte de Size octets de la mmoire permanente  partir de FirstByte
+ * Les morceaux sont rpartis sur JobCount tches de la file, le rsultat
+ * ne dpend pas du nombre de tches.
+ **/
+internal void
+HashGameState(game_state_hash *Hash, void *PermanentStorage, uint64 FirstByte, uint64 Size,
+              platform_api *Platform, platform_work_queue *Queue, uint32 JobCount)
+{
+  Hash->FirstByte = FirstByte;
+  Hash->Size = Size;
+  // Des morceaux de bandes entires, pour ne pas repasser par la fin complte
+  uint64 RangeSize = (Size + StateHashRangeCount - 1) / StateHashRangeCount;
+  Hash->RangeSize = (RangeSize + HashStripeSize - 1) & ~(uint64)(HashStripeSize - 1);
+  if (!Hash->RangeSize) Hash->RangeSize = HashStripeSize;
+
+  if (JobCount < 1) JobCount = 1;
+  if (JobCount > StateHashMaxJobCount) JobCount = StateHashMaxJobCount;
+  if (!Queue) JobCount = 1;
+
+  state_hash_job Jobs[StateHashMaxJobCount];
+  for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+  {
+    state_hash_job *Job = Jobs + JobIndex;
+    Job->Hash = Hash;
+    Job->Memory = (uint8 *)PermanentStorage + FirstByte;
+    Job->FirstRange = (StateHashRangeCount*JobIndex) / JobCount;
+    Job->OnePastLastRange = (StateHashRangeCount*(JobIndex + 1)) / JobCount;
+  }
+  if (JobCount > 1)
+  {
+    for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+    {
+      Platform->AddWorkEntry(Queue, StateHashWork, Jobs + JobIndex);
+    }
+    Platform->CompleteAllWork(Queue);
+  }
+  else
+  {
+    StateHashWork(Queue, Jobs);
+  }
+  Hash->Total = HashMemory(Hash->Ranges, sizeof(Hash->Ranges), Size);
+}
@@ -0,0 +1,60 @@
+#if !defined(FAITMAIN_HASH_H)
+
+/*
+  Empreinte de l'tat simul, pour vrifier le dterminisme
+
+  Aprs la simulation d'une image, la partie simule de la mmoire
+  permanente (la fin de game_state puis ce qu'utilise l'arne du monde,
+  contigus) est dcoupe en StateHashRangeCount morceaux gaux, hachs en
+  parallle. L'empreinte de l'image est le hachage de ces empreintes : deux
+  excutions qui divergent donnent aussi le premier morceau diffrent.
+
+  Le hachage suit le schma de xxHash3 (bandes de 64 octets, produit
+  32 x 32 -> 64 bits des moitis de chaque mot combin  une cl, brassage
+   chaque bloc de 16 bandes), en SSE2, avec notre propre cl : il n'est pas
+  compatible avec xxHash3, seulement aussi rapide.
+*/
+
+#define StateHashRangeCount 64
+#define StateHashMaxJobCount 8
+
+struct game_state_hash
+{
+  uint64 Total;
+  // Octets hachs depuis le dbut de la mmoire permanente : [FirstByte, FirstByte + Size)
+  uint64 FirstByte;
+  uint64 Size;
+  uint64 RangeSize; // Le dernier morceau peut tre plus court
+  uint64 Ranges[StateHashRangeCount];
+};
+
+struct state_hash_job
+{
+  game_state_hash *Hash;
+  uint8 *Memory; // Dbut de la partie hache
+  uint32 FirstRange;
+  uint32 OnePastLastRange;
+};
+
+/**
+ * Premier morceau dont l'empreinte diffre, StateHashRangeCount si aucun
+ * N'a de sens que pour deux empreintes de mme taille : sinon le dcoupage
+ * en morceaux n'est pas le mme.
+ **/
+inline uint32
+FirstDifferentStateRange(game_state_hash *A, game_state_hash *B)
+{
+  uint32 Result = StateHashRangeCount;
+  for (uint32 Range = 0; Range < StateHashRangeCount; ++Range)
+  {
+    if (A->Ranges[Range] != B->Ranges[Range])
+    {
+      Result = Range;
+      break;
+    }
+  }
+  return(Result);
+}
+
+#define FAITMAIN_HASH_H
+#endif
\ No newline at end of file
@@ -0,0 +1,352 @@
+/*
+  Eclairage 2D : rangement des lumires par tuile, accumulation SSE en
+  linaire et application  l'image
+*/
+
+// Coordonne d'cran borne  [0, Max], avant la conversion en entier
+inline int32
+GetLightPixelBound(real32 Value, int32 Max)
+{
+  if (Value < 0.0f) Value = 0.0f;
+  if (Value > (real32)Max) Value = (real32)Max;
+  int32 Result = (int32)Value;
+  return(Result);
+}
+
+/**
+ * Passage des lumires  l'cran et rangement par tuile dans l'arne
+ * Les lumires hors de l'cran ne sont pas gardes.
+ **/
+internal void
+BinLights(light_bins *Bins, memory_arena *Arena, game_offscreen_buffer *Buffer,
+          point_light *Lights, uint32 LightCount, world_view View)
+{
+  Bins->TileCountX = (Buffer->Width + LightTileDim - 1) / LightTileDim;
+  Bins->TileCountY = (Buffer->Height + LightTileDim - 1) / LightTileDim;
+  uint32 TileCount = Bins->TileCountX*Bins->TileCountY;
+  Bins->ScreenX = PushArray(Arena, LightCount, real32);
+  Bins->ScreenY = PushArray(Arena, LightCount, real32);
+  Bins->InvRadiusSq = PushArray(Arena, LightCount, real32);
+  Bins->R = PushArray(Arena, LightCount, real32);
+  Bins->G = PushArray(Arena, LightCount, real32);
+  Bins->B = PushArray(Arena, LightCount, real32);
+  Bins->MinX = PushArray(Arena, LightCount, int32);
+  Bins->MinY = PushArray(Arena, LightCount, int32);
+  Bins->MaxX = PushArray(Arena, LightCount, int32);
+  Bins->MaxY = PushArray(Arena, LightCount, int32);
+  Bins->TileStart = PushArray(Arena, TileCount + 1, uint32);
+  memset(Bins->TileStart, 0, (TileCount + 1)*sizeof(uint32));
+
+  // Une lumire claire les centres de pixels  moins de son rayon : un
+  // pixel de marge de chaque ct couvre les arrondis du calcul de distance
+  uint32 Visible = 0;
+  for (uint32 LightIndex = 0; LightIndex < LightCount; ++LightIndex)
+  {
+    point_light *Light = Lights + LightIndex;
+    real32 ScreenX = View.CenterX + Light->X*View.PixelsPerMeter;
+    real32 ScreenY = View.CenterY - Light->Y*View.PixelsPerMeter;
+    real32 ScreenRadius = Light->Radius*View.PixelsPerMeter;
+    if (!(ScreenRadius > 0.0f)) continue;
+
+    int32 MinX = GetLightPixelBound(ScreenX - ScreenRadius - 1.0f, Buffer->Width);
+    int32 MinY = GetLightPixelBound(ScreenY - ScreenRadius - 1.0f, Buffer->Height);
+    int32 MaxX = GetLightPixelBound(ScreenX + ScreenRadius + 2.0f, Buffer->Width);
+    int32 MaxY = GetLightPixelBound(ScreenY + ScreenRadius + 2.0f, Buffer->Height);
+    if ((MinX >= MaxX) || (MinY >= MaxY)) continue;
+
+    Bins->ScreenX[Visible] = ScreenX;
+    Bins->ScreenY[Visible] = ScreenY;
+    Bins->InvRadiusSq[Visible] = 1.0f / (ScreenRadius*ScreenRadius);
+    Bins->R[Visible] = Light->R;
+    Bins->G[Visible] = Light->G;
+    Bins->B[Visible] = Light->B;
+    Bins->MinX[Visible] = MinX;
+    Bins->MinY[Visible] = MinY;
+    Bins->MaxX[Visible] = MaxX;
+    Bins->MaxY[Visible] = MaxY;
+    for (int32 TileY = MinY / LightTileDim; TileY <= (MaxY - 1) / LightTileDim; ++TileY)
+    {
+      for (int32 TileX = MinX / LightTileDim; TileX <= (MaxX - 1) / LightTileDim; ++TileX)
+      {
+        ++Bins->TileStart[TileY*Bins->TileCountX + TileX];
+      }
+    }
+    ++Visible;
+  }
+  Bins->LightCount = Visible;
+
+  // Sommes prfixes, puis rangement dans l'ordre des lumires
+  uint32 Running = 0;
+  for (uint32 Tile = 0; Tile < TileCount; ++Tile)
+  {
+    uint32 Count = Bins->TileStart[Tile];
+    Bins->TileStart[Tile] = Running;
+    Running += Count;
+  }
+  Bins->TileStart[TileCount] = Running;
+  Bins->TileLights = PushArray(Arena, Running, uint32);
+  uint32 *Cursor = PushArray(Arena, TileCount, uint32);
+  memcpy(Cursor, Bins->TileStart, TileCount*sizeof(uint32));
+  for (uint32 LightIndex = 0; LightIndex < Visible; ++LightIndex)
+  {
+    for (int32 TileY = Bins->MinY[LightIndex] / LightTileDim;
+         TileY <= (Bins->MaxY[LightIndex] - 1) / LightTileDim;
+         ++TileY)
+    {
+      for (int32 TileX = Bins->MinX[LightIndex] / LightTileDim;
+           TileX <= (Bins->MaxX[LightIndex] - 1) / LightTileDim;
+           ++TileX)
+      {
+        Bins->TileLights[Cursor[TileY*Bins->TileCountX + TileX]++] = LightIndex;
+      }
+    }
+  }
+}
+
+/**
+ * Lumire d'une tuile, en linaire, un tableau par canal de LightTileDim
+ * flottants. Chaque lumire ne parcourt que son rectangle dans la tuile,
+ * largi  un multiple de 4 pixels : l'attnuation est nulle au-del du
+ * rayon, les pixels en plus ne reoivent rien.
+ **/
+internal void
+AccumulateLightTile(light_bins *Bins, uint32 TileX, uint32 TileY, light_ambient Ambient,
+                    real32 *LightR, real32 *LightG, real32 *LightB)
+{
+  __m128 AmbientR = _mm_set1_ps(Ambient.R);
+  __m128 AmbientG = _mm_set1_ps(Ambient.G);
+  __m128 AmbientB = _mm_set1_ps(Ambient.B);
+  for (uint32 Index = 0; Index < LightTileDim*LightTileDim; Index += 4)
+  {
+    _mm_store_ps(LightR + Index, AmbientR);
+    _mm_store_ps(LightG + Index, AmbientG);
+    _mm_store_ps(LightB + Index, AmbientB);
+  }
+
+  int32 TileMinX = (int32)TileX*LightTileDim;
+  int32 TileMinY = (int32)TileY*LightTileDim;
+  __m128 Zero = _mm_setzero_ps();
+  __m128 One = _mm_set1_ps(1.0f);
+  __m128 Four = _mm_set1_ps(4.0f);
+  // Centres des pixels, en coordonnes d'cran absolues comme la rfrence
+  __m128 LaneCenters = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+  uint32 Tile = TileY*Bins->TileCountX + TileX;
+  for (uint32 Entry = Bins->TileStart[Tile]; Entry < Bins->TileStart[Tile + 1]; ++Entry)
+  {
+    uint32 Light = Bins->TileLights[Entry];
+    int32 MinX = Bins->MinX[Light] - TileMinX;
+    int32 MinY = Bins->MinY[Light] - TileMinY;
+    int32 MaxX = Bins->MaxX[Light] - TileMinX;
+    int32 MaxY = Bins->MaxY[Light] - TileMinY;
+    if (MinX < 0) MinX = 0;
+    if (MinY < 0) MinY = 0;
+    if (MaxX > LightTileDim) MaxX = LightTileDim;
+    if (MaxY > LightTileDim) MaxY = LightTileDim;
+    MinX &= ~3;
+
+    real32 ScreenY = Bins->ScreenY[Light];
+    __m128 ScreenX = _mm_set1_ps(Bins->ScreenX[Light]);
+    __m128 InvRadiusSq = _mm_set1_ps(Bins->InvRadiusSq[Light]);
+    __m128 ColorR = _mm_set1_ps(Bins->R[Light]);
+    __m128 ColorG = _mm_set1_ps(Bins->G[Light]);
+    __m128 ColorB = _mm_set1_ps(Bins->B[Light]);
+    __m128 FirstCenterX = _mm_add_ps(_mm_set1_ps((real32)(TileMinX + MinX)), LaneCenters);
+
+    for (int32 Y = MinY; Y < MaxY; ++Y)
+    {
+      real32 dY = ((real32)(TileMinY + Y) + 0.5f) - ScreenY;
+      __m128 dYSq = _mm_set1_ps(dY*dY);
+      __m128 CenterX = FirstCenterX;
+      uint32 Index = Y*LightTileDim + MinX;
+      for (int32 X = MinX; X < MaxX; X += 4)
+      {
+        __m128 dX = _mm_sub_ps(CenterX, ScreenX);
+        __m128 DistanceSq = _mm_add_ps(_mm_mul_ps(dX, dX), dYSq);
+        __m128 Falloff = _mm_max_ps(Zero, _mm_sub_ps(One, _mm_mul_ps(DistanceSq, InvRadiusSq)));
+        Falloff = _mm_mul_ps(Falloff, Falloff);
+        _mm_store_ps(LightR + Index, _mm_add_ps(_mm_load_ps(LightR + Index), _mm_mul_ps(Falloff, ColorR)));
+        _mm_store_ps(LightG + Index, _mm_add_ps(_mm_load_ps(LightG + Index), _mm_mul_ps(Falloff, ColorG)));
+        _mm_store_ps(LightB + Index, _mm_add_ps(_mm_load_ps(LightB + Index), _mm_mul_ps(Falloff, ColorB)));
+        CenterX = _mm_add_ps(CenterX, Four);
+        Index += 4;
+      }
+    }
+  }
+}
+
+/**
+ * Une ligne de pixels 8 bits sRGB multiplie par sa lumire, 4 par 4
+ * RedShift/BlueShift distinguent XRGB8888 (16/0) de RGBA8888 (0/16), les
+ * bits hors des trois canaux sont gards. Light* doivent tre aligns.
+ **/
+template <int RedShift, int BlueShift>
+internal void
+ResolveLightRowSRGB8(uint32 *Pixels, real32 *LightR, real32 *LightG, real32 *LightB, int Count)
+{
+  real32 *ToLinear = GlobalSRGBTables.SRGB8ToLinear;
+  uint8 *ToSRGB = GlobalSRGBTables.LinearToSRGB8;
+  uint32 KeepMask = ~((0xFFu << RedShift) | 0xFF00u | (0xFFu << BlueShift));
+  __m128 Zero = _mm_setzero_ps();
+  __m128 One = _mm_set1_ps(1.0f);
+  __m128 Scale = _mm_set1_ps(4095.0f);
+  for (int Index = 0; Index < Count; Index += 4)
+  {
+    // Au bord droit de l'cran, les voies aprs Count ne sont ni lues ni crites
+    int LaneCount = Count - Index;
+    if (LaneCount > 4) LaneCount = 4;
+    uint32 P[4] = {};
+    for (int Lane = 0; Lane < LaneCount; ++Lane)
+    {
+      P[Lane] = Pixels[Index + Lane];
+    }
+    __m128 R = _mm_setr_ps(ToLinear[(P[0] >> RedShift) & 0xFF], ToLinear[(P[1] >> RedShift) & 0xFF],
+                           ToLinear[(P[2] >> RedShift) & 0xFF], ToLinear[(P[3] >> RedShift) & 0xFF]);
+    __m128 G = _mm_setr_ps(ToLinear[(P[0] >> 8) & 0xFF], ToLinear[(P[1] >> 8) & 0xFF],
+                           ToLinear[(P[2] >> 8) & 0xFF], ToLinear[(P[3] >> 8) & 0xFF]);
+    __m128 B = _mm_setr_ps(ToLinear[(P[0] >> BlueShift) & 0xFF], ToLinear[(P[1] >> BlueShift) & 0xFF],
+                           ToLinear[(P[2] >> BlueShift) & 0xFF], ToLinear[(P[3] >> BlueShift) & 0xFF]);
+    __m128 LitR = _mm_mul_ps(R, _mm_load_ps(LightR + Index));
+    __m128 LitG = _mm_mul_ps(G, _mm_load_ps(LightG + Index));
+    __m128 LitB = _mm_mul_ps(B, _mm_load_ps(LightB + Index));
+    // Quantification sur 12 bits pour la table linaire -> sRGB
+    uint32 QR[4];
+    uint32 QG[4];
+    uint32 QB[4];
+    _mm_storeu_si128((__m128i *)QR, _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(LitR, Zero), One), Scale)));
+    _mm_storeu_si128((__m128i *)QG, _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(LitG, Zero), One), Scale)));
+    _mm_storeu_si128((__m128i *)QB, _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(LitB, Zero), One), Scale)));
+    for (int Lane = 0; Lane < LaneCount; ++Lane)
+    {
+      Pixels[Index + Lane] = ((P[Lane] & KeepMask) |
+                              ((uint32)ToSRGB[QR[Lane]] << RedShift) |
+                              ((uint32)ToSRGB[QG[Lane]] << 8) |
+                              ((uint32)ToSRGB[QB[Lane]] << BlueShift));
+    }
+  }
+}
+
+// RGBA32F est dj linaire : un produit par pixel, born  1 comme les autres formats
+internal void
+ResolveLightRowLinear(pixel_rgba32f *Pixels, real32 *LightR, real32 *LightG, real32 *LightB, int Count)
+{
+  __m128 Zero = _mm_setzero_ps();
+  __m128 One = _mm_set1_ps(1.0f);
+  for (int Index = 0; Index < Count; ++Index)
+  {
+    real32 *P = (real32 *)(Pixels + Index);
+    __m128 Light = _mm_setr_ps(LightR[Index], LightG[Index], LightB[Index], 1.0f);
+    // L'alpha est multipli par 1 : il ne change pas
+    __m128 Lit = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(P), Light), Zero), One);
+    _mm_storeu_ps(P, Lit);
+  }
+}
+
+internal void
+ResolveLightTile(game_offscreen_buffer *Buffer, uint32 TileX, uint32 TileY,
+                 real32 *LightR, real32 *LightG, real32 *LightB)
+{
+  int MinX = (int)TileX*LightTileDim;
+  int MinY = (int)TileY*LightTileDim;
+  int Width = Buffer->Width - MinX;
+  int Height = Buffer->Height - MinY;
+  if (Width > LightTileDim) Width = LightTileDim;
+  if (Height > LightTileDim) Height = LightTileDim;
+
+  uint8 *Row = (uint8 *)Buffer->Memory + MinY*Buffer->Pitch + MinX*Buffer->BytesPerPixel;
+  for (int Y = 0; Y < Height; ++Y)
+  {
+    uint32 Offset = Y*LightTileDim;
+    switch (Buffer->PixelFormat)
+    {
+      case PixelFormat_XRGB8888:
+      {
+        ResolveLightRowSRGB8<16, 0>((uint32 *)Row, LightR + Offset, LightG + Offset, LightB + Offset, Width);
+      } break;
+      case PixelFormat_RGBA8888:
+      {
+        ResolveLightRowSRGB8<0, 16>((uint32 *)Row, LightR + Offset, LightG + Offset, LightB + Offset, Width);
+      } break;
+      case PixelFormat_RGBA32F:
+      {
+        ResolveLightRowLinear((pixel_rgba32f *)Row, LightR + Offset, LightG + Offset, LightB + Offset, Width);
+      } break;
+      default:
+      {
+        // Les autres formats passent par le format pivot
+        uint32 Pivot[LightTileDim];
+        ConvertRowToXRGB(Pivot, Buffer->PixelFormat, Row, Width);
+        ResolveLightRowSRGB8<16, 0>(Pivot, LightR + Offset, LightG + Offset, LightB + Offset, Width);
+        ConvertRowFromXRGB(Buffer->PixelFormat, Row, Pivot, Width);
+      } break;
+    }
+    Row += Buffer->Pitch;
+  }
+}
+
+// Les tuiles d'une bande de lignes de tuiles : accumulation puis application
+internal PLATFORM_WORK_QUEUE_CALLBACK(LightingWork)
+{
+  lighting_job *Job = (lighting_job *)Data;
+  light_bins *Bins = Job->Bins;
+  // __m128 pour l'alignement, 12 Ko qui restent dans le cache L1
+  __m128 LightR[LightTileDim*LightTileDim / 4];
+  __m128 LightG[LightTileDim*LightTileDim / 4];
+  __m128 LightB[LightTileDim*LightTileDim / 4];
+  for (uint32 TileY = Job->FirstTileY; TileY < Job->OnePastLastTileY; ++TileY)
+  {
+    for (uint32 TileX = 0; TileX < Bins->TileCountX; ++TileX)
+    {
+      AccumulateLightTile(Bins, TileX, TileY, Job->Ambient,
+                          (real32 *)LightR, (real32 *)LightG, (real32 *)LightB);
+      ResolveLightTile(Job->Buffer, TileX, TileY,
+                       (real32 *)LightR, (real32 *)LightG, (real32 *)LightB);
+    }
+  }
+}
+
+/**
+ * Eclairage de l'image dj dessine par les lumires, dans le repre View
+ * Le rangement est fait sur le thread appelant, dans de la mmoire
+ * temporaire de l'arne ; les bandes de tuiles vont sur la file de travail
+ * (toutes sur le thread appelant si Queue vaut 0).
+ **/
+internal void
+RenderLighting(game_offscreen_buffer *Buffer, point_light *Lights, uint32 LightCount,
+               world_view View, light_ambient Ambient, memory_arena *Arena,
+               platform_api *Platform, platform_work_queue *Queue, uint32 JobCount)
+{
+  if (!GlobalSRGBTables.IsInitialized) InitializeSRGBTables(&GlobalSRGBTables);
+  temporary_memory LightMemory = BeginTemporaryMemory(Arena);
+  light_bins Bins;
+  BinLights(&Bins, Arena, Buffer, Lights, LightCount, View);
+
+  if (JobCount < 1) JobCount = 1;
+  if (JobCount > LightingMaxJobCount) JobCount = LightingMaxJobCount;
+  if (!Queue) JobCount = 1;
+  if (JobCount > Bins.TileCountY) JobCount = Bins.TileCountY;
+
+  lighting_job Jobs[LightingMaxJobCount];
+  for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+  {
+    lighting_job *Job = Jobs + JobIndex;
+    Job->Buffer = Buffer;
+    Job->Bins = &Bins;
+    Job->Ambient = Ambient;
+    Job->FirstTileY = (Bins.TileCountY*JobIndex) / JobCount;
+    Job->OnePastLastTileY = (Bins.TileCountY*(JobIndex + 1)) / JobCount;
+  }
+  if (JobCount > 1)
+  {
+    for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+    {
+      Platform->AddWorkEntry(Queue, LightingWork, Jobs + JobIndex);
+    }
+    Platform->CompleteAllWork(Queue);
+  }
+  else if (JobCount == 1)
+  {
+    LightingWork(Queue, Jobs);
+  }
+  EndTemporaryMemory(LightMemory);
+}
\ No newline at end of file
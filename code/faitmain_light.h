@@ -0,0 +1,77 @@
+#if !defined(FAITMAIN_LIGHT_H)
+
+/*
+  Eclairage 2D : lumires ponctuelles accumules par tuiles d'cran
+
+  L'cran est dcoup en tuiles de LightTileDim pixels de ct. Chaque image,
+  les lumires passent  l'cran et sont ranges par tuile (tri par comptage,
+  comme la grille spatiale) : une tuile ne voit que les lumires dont le
+  rectangle la touche. Une tuile accumule sa lumire en linaire dans un
+  buffer flottant sur la pile (un tableau par canal, 4 pixels par registre
+  SSE), en ne parcourant que le rectangle de chaque lumire. L'image dj
+  dessine est ensuite multiplie par cette lumire : sRGB -> linaire,
+  produit, linaire -> sRGB, avec les tables de faitmain_pixel.h.
+
+  L'attnuation (1 - d/r) s'annule au rayon, sans racine. Les lumires
+  sont ajoutes dans l'ordre du tableau quelle que soit la tuile : le
+  rsultat ne dpend ni du dcoupage ni du nombre de threads.
+*/
+
+#define LightTileDim 32
+#define LightingMaxJobCount 8
+
+struct point_light
+{
+  real32 X; // Mtres, dans le monde
+  real32 Y;
+  real32 Radius;
+  // Intensit linaire, peut dpasser 1
+  real32 R;
+  real32 G;
+  real32 B;
+};
+
+// Intensit sans aucune lumire, linaire
+struct light_ambient
+{
+  real32 R;
+  real32 G;
+  real32 B;
+};
+
+/*
+  Lumires visibles passes  l'cran, en tableaux, et leur rangement par
+  tuile. Construit dans la mmoire transitoire de l'image.
+*/
+struct light_bins
+{
+  uint32 TileCountX;
+  uint32 TileCountY;
+  uint32 *TileStart;  // [TileCountX*TileCountY + 1]
+  uint32 *TileLights; // Index dans les tableaux ci-dessous, tris par tuile
+
+  uint32 LightCount;
+  real32 *ScreenX;
+  real32 *ScreenY;
+  real32 *InvRadiusSq;
+  real32 *R;
+  real32 *G;
+  real32 *B;
+  // Rectangle de pixels [Min, Max) touch, dans l'cran
+  int32 *MinX;
+  int32 *MinY;
+  int32 *MaxX;
+  int32 *MaxY;
+};
+
+struct lighting_job
+{
+  game_offscreen_buffer *Buffer;
+  light_bins *Bins;
+  light_ambient Ambient;
+  uint32 FirstTileY;
+  uint32 OnePastLastTileY;
+};
+
+#define FAITMAIN_LIGHT_H
+#endif
\ No newline at end of file
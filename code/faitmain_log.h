@@ -0,0 +1,347 @@
+#if !defined(FAITMAIN_LOG_H)
+
+/*
+  Journal binaire : enregistrements dans des anneaux par thread, texte plus tard
+
+  Le thread qui journalise ne formate rien : il crit dans son propre anneau
+  un enregistrement de taille fixe (72 octets) avec l'horodatage
+  (__rdtsc), le numro du format et au plus LogMaxArgs arguments bruts.
+  Chaque anneau n'a qu'un crivain (son thread) et qu'un lecteur (le thread
+  de vidage) : pas de verrou ni d'opration atomique, seulement une barrire
+  d'criture avant de publier l'index. Un anneau plein perd l'enregistrement
+  et le compte, le thread qui journalise n'attend jamais.
+
+  Le lecteur formate ensuite chaque conversion printf du format avec son
+  argument : les entiers sans modificateur sont des 32 bits, "ll" des 64
+  bits, les flottants sont gards en real64. Un %s doit dsigner une chane
+  qui vit aussi longtemps que le programme (un littral) : seul le pointeur
+  est enregistr.
+
+  Ce fichier ne dpend pas de la plateforme : les anneaux, le thread de
+  vidage et le fichier sont fournis par la couche plateforme.
+*/
+#if defined(_MSC_VER)
+#include <intrin.h>    // __rdtsc
+#else
+#include <x86intrin.h> // __rdtsc
+#endif
+#include <stdio.h>     // _snprintf_s
+#include <string.h>    // memcpy
+
+#define LogMaxArgs 7
+#define LogRingRecordCount 4096 // Puissance de 2, 288 Ko par thread
+
+struct log_record
+{
+  uint64 Timestamp; // __rdtsc
+  uint32 FormatId;
+  uint32 ArgCount;
+  uint64 Args[LogMaxArgs];
+};
+
+struct log_ring
+{
+  // Ecrits par le thread propritaire seulement, sur leur propre ligne de cache
+  uint32 volatile WriteIndex; // Ne font qu'augmenter, modulo LogRingRecordCount pour l'index
+  uint32 volatile DroppedCount;
+  uint32 ThreadId;
+  uint8 WriterPad[52];
+  // Ecrit par le thread de vidage seulement
+  uint32 volatile ReadIndex;
+  uint8 ReaderPad[60];
+
+  log_record Records[LogRingRecordCount];
+};
+
+/*
+  Conversion des arguments en 64 bits bruts : les entiers et les pointeurs
+  tels quels, les flottants en real64 comme pour printf
+*/
+template <typename T>
+inline uint64
+LogArg(T Value)
+{
+  return((uint64)Value);
+}
+
+inline uint64
+LogArg(real64 Value)
+{
+  uint64 Result;
+  memcpy(&Result, &Value, sizeof(Result));
+  return(Result);
+}
+
+inline uint64
+LogArg(real32 Value)
+{
+  return(LogArg((real64)Value));
+}
+
+/**
+ * Place du prochain enregistrement, horodat, ou 0 si l'anneau est plein
+ * A publier par EndLogRecord une fois les arguments crits.
+ **/
+inline log_record *
+BeginLogRecord(log_ring *Ring, uint32 FormatId, uint32 ArgCount)
+{
+  log_record *Result = 0;
+  uint32 WriteIndex = Ring->WriteIndex;
+  if (WriteIndex - Ring->ReadIndex < LogRingRecordCount)
+  {
+    Result = Ring->Records + (WriteIndex & (LogRingRecordCount - 1));
+    Result->Timestamp = __rdtsc();
+    Result->FormatId = FormatId;
+    Result->ArgCount = ArgCount;
+  }
+  else
+  {
+    Ring->DroppedCount = Ring->DroppedCount + 1;
+  }
+  return(Result);
+}
+
+inline void
+EndLogRecord(log_ring *Ring)
+{
+  // Le lecteur ne doit pas voir l'index avant le contenu
+  CompletePreviousWritesBeforeFutureWrites;
+  Ring->WriteIndex = Ring->WriteIndex + 1;
+}
+
+/*
+  Ecriture d'un enregistrement de 0  LogMaxArgs arguments
+*/
+inline void
+PushLog(log_ring *Ring, uint32 FormatId)
+{
+  if (BeginLogRecord(Ring, FormatId, 0)) EndLogRecord(Ring);
+}
+
+template <typename A0>
+inline void
+PushLog(log_ring *Ring, uint32 FormatId, A0 Arg0)
+{
+  log_record *Record = BeginLogRecord(Ring, FormatId, 1);
+  if (Record)
+  {
+    Record->Args[0] = LogArg(Arg0);
+    EndLogRecord(Ring);
+  }
+}
+
+template <typename A0, typename A1>
+inline void
+PushLog(log_ring *Ring, uint32 FormatId, A0 Arg0, A1 Arg1)
+{
+  log_record *Record = BeginLogRecord(Ring, FormatId, 2);
+  if (Record)
+  {
+    Record->Args[0] = LogArg(Arg0);
+    Record->Args[1] = LogArg(Arg1);
+    EndLogRecord(Ring);
+  }
+}
+
+template <typename A0, typename A1, typename A2>
+inline void
+PushLog(log_ring *Ring, uint32 FormatId, A0 Arg0, A1 Arg1, A2 Arg2)
+{
+  log_record *Record = BeginLogRecord(Ring, FormatId, 3);
+  if (Record)
+  {
+    Record->Args[0] = LogArg(Arg0);
+    Record->Args[1] = LogArg(Arg1);
+    Record->Args[2] = LogArg(Arg2);
+    EndLogRecord(Ring);
+  }
+}
+
+template <typename A0, typename A1, typename A2, typename A3>
+inline void
+PushLog(log_ring *Ring, uint32 FormatId, A0 Arg0, A1 Arg1, A2 Arg2, A3 Arg3)
+{
+  log_record *Record = BeginLogRecord(Ring, FormatId, 4);
+  if (Record)
+  {
+    Record->Args[0] = LogArg(Arg0);
+    Record->Args[1] = LogArg(Arg1);
+    Record->Args[2] = LogArg(Arg2);
+    Record->Args[3] = LogArg(Arg3);
+    EndLogRecord(Ring);
+  }
+}
+
+template <typename A0, typename A1, typename A2, typename A3, typename A4>
+inline void
+PushLog(log_ring *Ring, uint32 FormatId, A0 Arg0, A1 Arg1, A2 Arg2, A3 Arg3, A4 Arg4)
+{
+  log_record *Record = BeginLogRecord(Ring, FormatId, 5);
+  if (Record)
+  {
+    Record->Args[0] = LogArg(Arg0);
+    Record->Args[1] = LogArg(Arg1);
+    Record->Args[2] = LogArg(Arg2);
+    Record->Args[3] = LogArg(Arg3);
+    Record->Args[4] = LogArg(Arg4);
+    EndLogRecord(Ring);
+  }
+}
+
+template <typename A0, typename A1, typename A2, typename A3, typename A4, typename A5>
+inline void
+PushLog(log_ring *Ring, uint32 FormatId, A0 Arg0, A1 Arg1, A2 Arg2, A3 Arg3, A4 Arg4, A5 Arg5)
+{
+  log_record *Record = BeginLogRecord(Ring, FormatId, 6);
+  if (Record)
+  {
+    Record->Args[0] = LogArg(Arg0);
+    Record->Args[1] = LogArg(Arg1);
+    Record->Args[2] = LogArg(Arg2);
+    Record->Args[3] = LogArg(Arg3);
+    Record->Args[4] = LogArg(Arg4);
+    Record->Args[5] = LogArg(Arg5);
+    EndLogRecord(Ring);
+  }
+}
+
+template <typename A0, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6>
+inline void
+PushLog(log_ring *Ring, uint32 FormatId, A0 Arg0, A1 Arg1, A2 Arg2, A3 Arg3, A4 Arg4, A5 Arg5, A6 Arg6)
+{
+  log_record *Record = BeginLogRecord(Ring, FormatId, 7);
+  if (Record)
+  {
+    Record->Args[0] = LogArg(Arg0);
+    Record->Args[1] = LogArg(Arg1);
+    Record->Args[2] = LogArg(Arg2);
+    Record->Args[3] = LogArg(Arg3);
+    Record->Args[4] = LogArg(Arg4);
+    Record->Args[5] = LogArg(Arg5);
+    Record->Args[6] = LogArg(Arg6);
+    EndLogRecord(Ring);
+  }
+}
+
+/*
+  Ct lecteur
+*/
+
+// Enregistrement le plus ancien pas encore lu, 0 si l'anneau est vide
+inline log_record *
+PeekLogRecord(log_ring *Ring)
+{
+  log_record *Result = 0;
+  uint32 ReadIndex = Ring->ReadIndex;
+  if (ReadIndex != Ring->WriteIndex)
+  {
+    CompletePreviousReadsBeforeFutureReads;
+    Result = Ring->Records + (ReadIndex & (LogRingRecordCount - 1));
+  }
+  return(Result);
+}
+
+// La place de l'enregistrement lu est rendue  l'crivain
+inline void
+ReleaseLogRecord(log_ring *Ring)
+{
+  CompletePreviousWritesBeforeFutureWrites;
+  Ring->ReadIndex = Ring->ReadIndex + 1;
+}
+
+#define LogMaxSpec 32
+
+/**
+ * Texte d'un enregistrement selon son format, sans fin de ligne ajoute
+ * Chaque conversion est formate seule avec son argument, les conversions
+ * sans argument enregistr donnent "?". Renvoie le nombre de caractres
+ * crits, Dest est toujours termine par un zro.
+ **/
+internal uint32
+FormatLogRecord(char *Dest, uint32 DestSize, char *Format, log_record *Record)
+{
+  Assert(DestSize > 0);
+  uint32 Used = 0;
+  uint32 ArgIndex = 0;
+  char *At = Format;
+  while (*At && (Used + 1 < DestSize))
+  {
+    if (*At != '%')
+    {
+      Dest[Used++] = *At++;
+      continue;
+    }
+
+    // Drapeaux, largeur, prcision et taille, jusqu'au caractre de conversion
+    char Spec[LogMaxSpec];
+    uint32 SpecLength = 0;
+    bool32 IsLong = false;
+    Spec[SpecLength++] = *At++;
+    while (*At && strchr("-+ #0123456789.hlLzjtI", *At) && (SpecLength + 2 < LogMaxSpec))
+    {
+      if (*At == 'l' && At[1] == 'l') IsLong = true;
+      Spec[SpecLength++] = *At++;
+    }
+    char Conversion = *At;
+    if (!Conversion) break;
+    ++At;
+    Spec[SpecLength++] = Conversion;
+    Spec[SpecLength] = 0;
+
+    int Written = 0;
+    if (Conversion == '%')
+    {
+      Written = _snprintf_s(Dest + Used, DestSize - Used, _TRUNCATE, "%%");
+    }
+    else if (ArgIndex >= Record->ArgCount)
+    {
+      Written = _snprintf_s(Dest + Used, DestSize - Used, _TRUNCATE, "?");
+    }
+    else
+    {
+      uint64 Arg = Record->Args[ArgIndex++];
+      switch (Conversion)
+      {
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        {
+          real64 Value;
+          memcpy(&Value, &Arg, sizeof(Value));
+          Written = _snprintf_s(Dest + Used, DestSize - Used, _TRUNCATE, Spec, Value);
+        } break;
+        case 's':
+        {
+          char *Value = (char *)Arg;
+          Written = _snprintf_s(Dest + Used, DestSize - Used, _TRUNCATE, Spec, Value ? Value : "(null)");
+        } break;
+        case 'p':
+        {
+          Written = _snprintf_s(Dest + Used, DestSize - Used, _TRUNCATE, Spec, (void *)Arg);
+        } break;
+        default:
+        {
+          // d i u x X o c : 32 bits sauf avec "ll"
+          if (IsLong)
+          {
+            Written = _snprintf_s(Dest + Used, DestSize - Used, _TRUNCATE, Spec, Arg);
+          }
+          else
+          {
+            Written = _snprintf_s(Dest + Used, DestSize - Used, _TRUNCATE, Spec, (uint32)Arg);
+          }
+        } break;
+      }
+    }
+    // Tronqu : _snprintf_s a rempli le reste et renvoie -1
+    if (Written < 0)
+    {
+      Used = DestSize - 1;
+      break;
+    }
+    Used += (uint32)Written;
+  }
+  Dest[Used] = 0;
+  return(Used);
+}
+
+#define FAITMAIN_LOG_H
+#endif
\ No newline at end of file
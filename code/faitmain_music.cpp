@@ -0,0 +1,279 @@
+/*
+  Streaming de musique : ouverture du WAV, dcodage des morceaux en tche de fond
+  et consommation par le mixeur
+*/
+
+#pragma pack(push, 1)
+struct wave_chunk_header
+{
+  uint32 ID;
+  uint32 Size;
+};
+
+struct wave_fmt
+{
+  uint16 FormatTag;
+  uint16 ChannelCount;
+  uint32 SamplesPerSecond;
+  uint32 AvgBytesPerSecond;
+  uint16 BlockAlign;
+  uint16 BitsPerSample;
+};
+#pragma pack(pop)
+
+#define RIFF_CODE(a, b, c, d) (((uint32)(a) << 0) | ((uint32)(b) << 8) | ((uint32)(c) << 16) | ((uint32)(d) << 24))
+
+/**
+ * Ouvre une piste et lit son en-tte, le contenu sera charg au fil de la lecture
+ **/
+internal bool32
+OpenMusicTrack(platform_api *Platform, music_track *Track, char *Filename)
+{
+  bool32 Result = false;
+  *Track = {};
+  Track->File = Platform->OpenFile(Filename);
+  Track->ReadDataFromFile = Platform->ReadDataFromFile;
+  if (Track->File.NoErrors)
+  {
+    uint32 RiffHeader[3];
+    if ((Platform->ReadDataFromFile(&Track->File, 0, sizeof(RiffHeader), RiffHeader) == sizeof(RiffHeader)) &&
+        (RiffHeader[0] == RIFF_CODE('R', 'I', 'F', 'F')) &&
+        (RiffHeader[2] == RIFF_CODE('W', 'A', 'V', 'E')))
+    {
+      // On parcourt les sous-chunks sans lire les donnes
+      bool32 HasFormat = false;
+      uint64 Offset = sizeof(RiffHeader);
+      wave_chunk_header Header;
+      while (Platform->ReadDataFromFile(&Track->File, Offset, sizeof(Header), &Header) == sizeof(Header))
+      {
+        Offset += sizeof(Header);
+        if (Header.ID == RIFF_CODE('f', 'm', 't', ' '))
+        {
+          wave_fmt Format;
+          if (Platform->ReadDataFromFile(&Track->File, Offset, sizeof(Format), &Format) == sizeof(Format))
+          {
+            HasFormat = ((Format.FormatTag == 1) && // PCM uniquement
+                         ((Format.ChannelCount == 1) || (Format.ChannelCount == 2)) &&
+                         ((Format.BitsPerSample == 8) || (Format.BitsPerSample == 16)));
+            Track->SampleRate = Format.SamplesPerSecond;
+            Track->ChannelCount = Format.ChannelCount;
+            Track->BytesPerSample = Format.BitsPerSample / 8;
+          }
+        }
+        else if (Header.ID == RIFF_CODE('d', 'a', 't', 'a'))
+        {
+          if (HasFormat)
+          {
+            Track->DataOffset = Offset;
+            Track->FrameCount = Header.Size / (Track->ChannelCount*Track->BytesPerSample);
+            Result = (Track->FrameCount > 0);
+          }
+          break;
+        }
+        // Les chunks sont aligns sur 2 octets
+        Offset += (Header.Size + 1) & ~1;
+      }
+    }
+  }
+
+  if (Result)
+  {
+    Track->Volume = 0.5f;
+    Track->IsPlaying = true;
+    for (int ChunkIndex = 0; ChunkIndex < MusicChunkCount; ++ChunkIndex)
+    {
+      Track->Chunks[ChunkIndex].Track = Track;
+    }
+  }
+  else if (Track->File.NoErrors)
+  {
+    Platform->CloseFile(&Track->File);
+    Track->File.NoErrors = false;
+  }
+  return(Result);
+}
+
+/**
+ * Dcodage d'un morceau, excut sur un thread de fond
+ * Les donnes brutes sont lues  la fin du morceau puis tendues en stro
+ * 16 bits d'avant en arrire : l'criture ne rattrape jamais la lecture.
+ **/
+internal PLATFORM_WORK_QUEUE_CALLBACK(LoadMusicChunkWork)
+{
+  music_chunk *Chunk = (music_chunk *)Data;
+  music_track *Track = Chunk->Track;
+  Assert(Chunk->State == MusicChunk_Loading);
+
+  uint32 BytesPerFrame = Track->ChannelCount*Track->BytesPerSample;
+  uint32 RawSize = Chunk->FrameCount*BytesPerFrame;
+  uint8 *Raw = (uint8 *)Chunk->Samples + (sizeof(Chunk->Samples) - RawSize);
+  uint64 Offset = Track->DataOffset + Chunk->FirstFrame*BytesPerFrame;
+  uint32 BytesRead = Track->ReadDataFromFile(&Track->File, Offset, RawSize, Raw);
+  if (BytesRead < RawSize)
+  {
+    // Fichier tronqu ou erreur de lecture : du silence plutt que des donnes au hasard
+    memset(Raw + BytesRead, (Track->BytesPerSample == 1) ? 0x80 : 0, RawSize - BytesRead);
+  }
+
+  int16 *Dest = Chunk->Samples;
+  if ((Track->BytesPerSample == 2) && (Track->ChannelCount == 1))
+  {
+    int16 *Source = (int16 *)Raw;
+    for (uint32 FrameIndex = 0; FrameIndex < Chunk->FrameCount; ++FrameIndex)
+    {
+      int16 Value = Source[FrameIndex];
+      *Dest++ = Value;
+      *Dest++ = Value;
+    }
+  }
+  else if (Track->BytesPerSample == 1)
+  {
+    // PCM 8 bits non sign
+    for (uint32 FrameIndex = 0; FrameIndex < Chunk->FrameCount; ++FrameIndex)
+    {
+      int16 Left = (int16)(((int)Raw[0] - 128) << 8);
+      int16 Right = (Track->ChannelCount == 2) ? (int16)(((int)Raw[1] - 128) << 8) : Left;
+      Raw += Track->ChannelCount;
+      *Dest++ = Left;
+      *Dest++ = Right;
+    }
+  }
+  else
+  {
+    // Dj en stro 16 bits, il suffit de ramener les donnes au dbut
+    memmove(Dest, Raw, RawSize);
+  }
+
+  CompletePreviousWritesBeforeFutureWrites;
+  Chunk->State = MusicChunk_Ready;
+}
+
+/**
+ * Confie au thread de fond tous les morceaux libres, dans l'ordre de l'anneau
+ * Appele  chaque image par le thread principal
+ **/
+internal void
+UpdateMusicTrack(platform_api *Platform, platform_work_queue *Queue, music_track *Track)
+{
+  if (!Track->IsPlaying)
+  {
+    // Piste termine : on ferme le fichier ds qu'aucun morceau n'est en cours de lecture
+    if (Track->File.NoErrors)
+    {
+      bool32 IsLoading = false;
+      for (int ChunkIndex = 0; ChunkIndex < MusicChunkCount; ++ChunkIndex)
+      {
+        if (Track->Chunks[ChunkIndex].State == MusicChunk_Loading) IsLoading = true;
+      }
+      if (!IsLoading)
+      {
+        Platform->CloseFile(&Track->File);
+        Track->File.NoErrors = false;
+      }
+    }
+    return;
+  }
+
+  while (!Track->AllFramesScheduled)
+  {
+    music_chunk *Chunk = &Track->Chunks[Track->NextChunkToLoad];
+    if (Chunk->State != MusicChunk_Empty) break;
+
+    uint64 FramesLeft = Track->FrameCount - Track->NextFrameToLoad;
+    Chunk->FirstFrame = Track->NextFrameToLoad;
+    Chunk->FrameCount = (FramesLeft < MusicChunkFrameCount) ? (uint32)FramesLeft : MusicChunkFrameCount;
+    Chunk->IsLast = (Chunk->FrameCount == FramesLeft);
+    Track->NextFrameToLoad += Chunk->FrameCount;
+    if (Chunk->IsLast)
+    {
+      if (Track->IsLooping)
+      {
+        // On enchane sur le dbut sans trou : le morceau suivant repart  0
+        Track->NextFrameToLoad = 0;
+      }
+      else
+      {
+        Track->AllFramesScheduled = true;
+      }
+    }
+    Track->NextChunkToLoad = (Track->NextChunkToLoad + 1) % MusicChunkCount;
+
+    Chunk->State = MusicChunk_Loading;
+    Platform->AddWorkEntry(Queue, LoadMusicChunkWork, Chunk);
+  }
+}
+
+/**
+ * Copie jusqu' FrameCount frames dcodes, morceau aprs morceau
+ * Renvoie le nombre de frames disponibles, moins que demand si le chargeur est en retard
+ **/
+internal uint32
+ReadMusicFrames(music_track *Track, int16 *Dest, uint32 FrameCount)
+{
+  uint32 Copied = 0;
+  while (Track->IsPlaying && (Copied < FrameCount))
+  {
+    music_chunk *Chunk = &Track->Chunks[Track->PlayChunk];
+    if (Chunk->State != MusicChunk_Ready) break;
+    CompletePreviousReadsBeforeFutureReads;
+
+    uint32 Available = Chunk->FrameCount - Track->PlayChunkOffset;
+    uint32 Count = FrameCount - Copied;
+    if (Count > Available) Count = Available;
+    memcpy(Dest + 2*Copied, Chunk->Samples + 2*Track->PlayChunkOffset, Count*2*sizeof(int16));
+    Copied += Count;
+    Track->PlayChunkOffset += Count;
+
+    if (Track->PlayChunkOffset == Chunk->FrameCount)
+    {
+      // Morceau termin : il retourne au chargeur
+      bool32 WasLast = Chunk->IsLast;
+      Track->PlayChunk = (Track->PlayChunk + 1) % MusicChunkCount;
+      Track->PlayChunkOffset = 0;
+      CompletePreviousWritesBeforeFutureWrites;
+      Chunk->State = MusicChunk_Empty;
+      if (WasLast && !Track->IsLooping)
+      {
+        Track->IsPlaying = false;
+      }
+    }
+  }
+  return(Copied);
+}
+
+#define MusicMixBlockFrameCount 128
+// Rapport de frquences maximal accept entre la piste et la sortie
+#define MusicMaxRateRatio 8
+
+/**
+ * Ajoute la piste, rchantillonne  la frquence de sortie, au mix flottant
+ * Le rchantillonneur n'est prpar qu'ici, la frquence de sortie n'tant connue
+ * qu'au moment de remplir le buffer son
+ **/
+internal void
+MixMusicTrack(music_track *Track, real32 *Mix, int FrameCount, int OutputSampleRate)
+{
+  if (!Track->IsPlaying) return;
+  if (Track->Resampler.DestRate != OutputSampleRate)
+  {
+    InitResampler(&Track->Resampler, Track->SampleRate, OutputSampleRate);
+  }
+  Assert(Track->Resampler.SourceRate <= MusicMaxRateRatio*Track->Resampler.DestRate);
+  int16 Staging[2*(MusicMaxRateRatio*MusicMixBlockFrameCount + 1)];
+  for (int FrameIndex = 0; Track->IsPlaying && (FrameIndex < FrameCount); FrameIndex += MusicMixBlockFrameCount)
+  {
+    int BlockFrameCount = FrameCount - FrameIndex;
+    if (BlockFrameCount > MusicMixBlockFrameCount) BlockFrameCount = MusicMixBlockFrameCount;
+
+    int SourceFrameCount = GetResamplerSourceFrameCount(&Track->Resampler, BlockFrameCount);
+    uint32 ReadCount = ReadMusicFrames(Track, Staging, SourceFrameCount);
+    if (ReadCount < (uint32)SourceFrameCount)
+    {
+      // Fin de piste, ou chargeur en retard : on complte avec du silence
+      if (Track->IsPlaying) ++Track->UnderrunCount;
+      memset(Staging + 2*ReadCount, 0, (SourceFrameCount - ReadCount)*2*sizeof(int16));
+    }
+    ResampleStereo(&Track->Resampler, Staging, SourceFrameCount,
+                   Mix + 2*FrameIndex, BlockFrameCount, Track->Volume);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#if !defined(FAITMAIN_MUSIC_H)
+
+/*
+  Lecture en streaming de longues pistes WAV (PCM 8 ou 16 bits, mono ou stro)
+
+  La piste n'est jamais charge en entier : elle est dcoupe en morceaux de
+  MusicChunkFrameCount frames, dcods  l'avance par un thread de fond dans
+  un anneau de MusicChunkCount morceaux. La mmoire d'une piste est donc fixe
+  (environ 290 Ko avec le rchantillonneur) quelle que soit sa dure.
+  Le mixeur consomme les morceaux dans l'ordre puis les rend au chargeur.
+*/
+#include "faitmain_resampler.h"
+
+#define MusicChunkFrameCount 16384 // 64 Ko de stro 16 bits, soit ~340 ms  48 kHz
+#define MusicChunkCount 4
+
+enum music_chunk_state
+{
+  MusicChunk_Empty,   // Libre, peut tre rempli par le chargeur
+  MusicChunk_Loading, // Confi  un thread de fond
+  MusicChunk_Ready,   // Dcod, lisible par le mixeur
+};
+
+struct music_track;
+struct music_chunk
+{
+  uint32 volatile State;
+  music_track *Track;
+  uint64 FirstFrame;  // Position du morceau dans la piste
+  uint32 FrameCount;  // Nombre de frames valides
+  bool32 IsLast;      // Contient la fin de la piste
+  int16 Samples[2*MusicChunkFrameCount]; // Toujours stro 16 bits une fois dcod
+};
+
+struct music_track
+{
+  bool32 IsPlaying;
+  bool32 IsLooping;
+  real32 Volume;
+
+  platform_file_handle File;
+  platform_read_data_from_file *ReadDataFromFile;
+  uint32 SampleRate;
+  uint32 ChannelCount;
+  uint32 BytesPerSample;
+  uint64 DataOffset;
+  uint64 FrameCount;
+
+  // Ct chargeur (thread principal)
+  uint64 NextFrameToLoad;
+  uint32 NextChunkToLoad;
+  bool32 AllFramesScheduled;
+
+  // Ct mixeur
+  uint32 PlayChunk;
+  uint32 PlayChunkOffset;
+  uint32 UnderrunCount;
+  resampler Resampler;
+
+  music_chunk Chunks[MusicChunkCount];
+};
+
+#define FAITMAIN_MUSIC_H
+#endif
\ No newline at end of file
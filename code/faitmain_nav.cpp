@@ -0,0 +1,785 @@
+/*
+  Recherche de chemin hirarchique : graphe abstrait, mise  jour
+  incrmentale, A* sur le graphe et raffinement en tuiles
+*/
+
+#define NavStartNode 0xFFFFFFFE
+#define NavGoalNode 0xFFFFFFFF
+#define NavNoEntry 0xFFFFFFFF
+#define NavNoCost 0xFFFFFFFF
+// A partir de cette longueur une entre a deux transitions, une  chaque bout
+#define NavLongEntranceLength 6
+
+inline bool32
+IsNavTileWalkable(nav_cluster *Cluster, uint32 Tile)
+{
+  bool32 Result = (Cluster->Chunk && (Cluster->Chunk->Tiles[Tile] == NavWalkableTile));
+  return(Result);
+}
+
+inline bool32
+IsNavSlotUsed(nav_cluster *Cluster, uint32 Slot)
+{
+  bool32 Result = ((Slot % NavMaxNodesPerSide) < Cluster->NodeCount[Slot / NavMaxNodesPerSide]);
+  return(Result);
+}
+
+/**
+ * Parcours en largeur dans un cluster depuis la tuile locale Start : la
+ * distance de chaque tuile (NavUnreachable si elle n'est pas atteinte) et,
+ * si Next est fourni, la tuile suivante pour revenir vers Start
+ **/
+internal void
+GetNavClusterDistances(nav_cluster *Cluster, uint32 Start, uint8 *Distance, uint8 *Next)
+{
+  memset(Distance, NavUnreachable, NavClusterTileCount);
+  if (IsNavTileWalkable(Cluster, Start))
+  {
+    uint8 Queue[NavClusterTileCount];
+    uint32 ReadIndex = 0;
+    uint32 WriteIndex = 0;
+    Queue[WriteIndex++] = (uint8)Start;
+    Distance[Start] = 0;
+    if (Next) Next[Start] = (uint8)Start;
+    while (ReadIndex < WriteIndex)
+    {
+      uint32 Tile = Queue[ReadIndex++];
+      uint32 X = Tile % NavClusterDim;
+      uint32 Y = Tile / NavClusterDim;
+      uint32 Neighbors[4];
+      uint32 NeighborCount = 0;
+      if (X > 0) Neighbors[NeighborCount++] = Tile - 1;
+      if (X < NavClusterDim - 1) Neighbors[NeighborCount++] = Tile + 1;
+      if (Y > 0) Neighbors[NeighborCount++] = Tile - NavClusterDim;
+      if (Y < NavClusterDim - 1) Neighbors[NeighborCount++] = Tile + NavClusterDim;
+      for (uint32 NeighborIndex = 0; NeighborIndex < NeighborCount; ++NeighborIndex)
+      {
+        uint32 Neighbor = Neighbors[NeighborIndex];
+        if ((Distance[Neighbor] == NavUnreachable) && IsNavTileWalkable(Cluster, Neighbor))
+        {
+          // Moins de NavClusterTileCount tuiles praticables : la distance tient sur un uint8
+          Distance[Neighbor] = (uint8)(Distance[Tile] + 1);
+          if (Next) Next[Neighbor] = (uint8)Tile;
+          Queue[WriteIndex++] = (uint8)Neighbor;
+        }
+      }
+    }
+  }
+}
+
+// Tuile locale  la position Position de la frontire, du ct Side
+inline uint32
+GetNavBorderTile(uint32 Side, uint32 Position)
+{
+  uint32 Result = 0;
+  switch (Side)
+  {
+    case NavSide_Left: Result = Position*NavClusterDim; break;
+    case NavSide_Right: Result = Position*NavClusterDim + NavClusterDim - 1; break;
+    case NavSide_Bottom: Result = Position; break;
+    case NavSide_Top: Result = (NavClusterDim - 1)*NavClusterDim + Position; break;
+  }
+  return(Result);
+}
+
+/**
+ * Transitions de la frontire entre A et B, B tant  droite de A ou
+ * au-dessus. Les noeuds des deux cts qui se font face sont rcrits.
+ **/
+internal void
+BuildNavBorder(nav_cluster *A, nav_cluster *B, bool32 IsAbove)
+{
+  uint32 SideA = IsAbove ? NavSide_Top : NavSide_Right;
+  uint32 SideB = IsAbove ? NavSide_Bottom : NavSide_Left;
+  uint32 Count = 0;
+  uint32 RunStart = 0;
+  bool32 InRun = false;
+  for (uint32 Position = 0; Position <= NavClusterDim; ++Position)
+  {
+    bool32 IsOpen = ((Position < NavClusterDim) &&
+                     IsNavTileWalkable(A, GetNavBorderTile(SideA, Position)) &&
+                     IsNavTileWalkable(B, GetNavBorderTile(SideB, Position)));
+    if (IsOpen && !InRun)
+    {
+      RunStart = Position;
+      InRun = true;
+    }
+    else if (!IsOpen && InRun)
+    {
+      InRun = false;
+      uint32 Length = Position - RunStart;
+      uint32 Transitions[2];
+      uint32 TransitionCount = 0;
+      if (Length < NavLongEntranceLength)
+      {
+        Transitions[TransitionCount++] = RunStart + Length / 2;
+      }
+      else
+      {
+        Transitions[TransitionCount++] = RunStart;
+        Transitions[TransitionCount++] = Position - 1;
+      }
+      for (uint32 TransitionIndex = 0; TransitionIndex < TransitionCount; ++TransitionIndex)
+      {
+        Assert(Count < NavMaxNodesPerSide);
+        uint32 At = Transitions[TransitionIndex];
+        A->NodeTile[SideA*NavMaxNodesPerSide + Count] = (uint8)GetNavBorderTile(SideA, At);
+        B->NodeTile[SideB*NavMaxNodesPerSide + Count] = (uint8)GetNavBorderTile(SideB, At);
+        ++Count;
+      }
+    }
+  }
+  A->NodeCount[SideA] = (uint8)Count;
+  B->NodeCount[SideB] = (uint8)Count;
+}
+
+// Cots entre tous les noeuds du cluster, un parcours en largeur par noeud
+internal void
+ComputeNavClusterCosts(nav_cluster *Cluster)
+{
+  uint8 Distance[NavClusterTileCount];
+  for (uint32 From = 0; From < NavMaxNodesPerCluster; ++From)
+  {
+    if (IsNavSlotUsed(Cluster, From))
+    {
+      GetNavClusterDistances(Cluster, Cluster->NodeTile[From], Distance, 0);
+      for (uint32 To = 0; To < NavMaxNodesPerCluster; ++To)
+      {
+        Cluster->Cost[From][To] = IsNavSlotUsed(Cluster, To) ? Distance[Cluster->NodeTile[To]] : (uint8)NavUnreachable;
+      }
+    }
+  }
+}
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(NavClusterCostsWork)
+{
+  nav_update_job *Job = (nav_update_job *)Data;
+  for (uint32 Index = Job->First; Index < Job->OnePastLast; ++Index)
+  {
+    ComputeNavClusterCosts(Job->Graph->Clusters + Job->Clusters[Index]);
+  }
+}
+
+/**
+ * Marque le cluster de la tuile (coordonnes absolues) :  appeler aprs
+ * chaque SetTileValue dans la zone couverte, puis UpdateNavGraph
+ **/
+internal void
+InvalidateNavTile(nav_graph *Graph, int32 AbsTileX, int32 AbsTileY)
+{
+  int32 ClusterX = (AbsTileX >> TileChunkShift) - Graph->MinChunkX;
+  int32 ClusterY = (AbsTileY >> TileChunkShift) - Graph->MinChunkY;
+  if ((ClusterX >= 0) && (ClusterX < (int32)Graph->ClusterCountX) &&
+      (ClusterY >= 0) && (ClusterY < (int32)Graph->ClusterCountY))
+  {
+    uint32 ClusterIndex = (uint32)ClusterY*Graph->ClusterCountX + (uint32)ClusterX;
+    nav_cluster *Cluster = Graph->Clusters + ClusterIndex;
+    if (!Cluster->IsDirty)
+    {
+      Cluster->IsDirty = true;
+      Graph->DirtyClusters[Graph->DirtyCount++] = ClusterIndex;
+    }
+  }
+}
+
+/**
+ * Reconstruit les frontires des clusters marqus, puis les cots de ces
+ * clusters et de leurs voisins, dont les noeuds ont pu changer.
+ * L'arne ne sert que pendant l'appel. Les cots sont calculs sur la file
+ * de travail si elle est fournie.
+ **/
+internal void
+UpdateNavGraph(nav_graph *Graph, memory_arena *Arena,
+               platform_api *Platform, platform_work_queue *Queue, uint32 JobCount)
+{
+  if (Graph->DirtyCount)
+  {
+    temporary_memory TempMem = BeginTemporaryMemory(Arena);
+    uint32 *CostClusters = PushArray(Arena, 5*Graph->DirtyCount, uint32);
+    uint32 CostCount = 0;
+
+    // Le chunk a pu tre cr depuis la dernire mise  jour
+    for (uint32 DirtyIndex = 0; DirtyIndex < Graph->DirtyCount; ++DirtyIndex)
+    {
+      uint32 ClusterIndex = Graph->DirtyClusters[DirtyIndex];
+      int32 ClusterX = (int32)(ClusterIndex % Graph->ClusterCountX);
+      int32 ClusterY = (int32)(ClusterIndex / Graph->ClusterCountX);
+      Graph->Clusters[ClusterIndex].Chunk = GetTileChunk(Graph->TileMap, Graph->MinChunkX + ClusterX,
+                                                         Graph->MinChunkY + ClusterY);
+    }
+
+    for (uint32 DirtyIndex = 0; DirtyIndex < Graph->DirtyCount; ++DirtyIndex)
+    {
+      uint32 ClusterIndex = Graph->DirtyClusters[DirtyIndex];
+      uint32 ClusterX = ClusterIndex % Graph->ClusterCountX;
+      uint32 ClusterY = ClusterIndex / Graph->ClusterCountX;
+      nav_cluster *Cluster = Graph->Clusters + ClusterIndex;
+      uint32 Touched[5];
+      uint32 TouchedCount = 0;
+      Touched[TouchedCount++] = ClusterIndex;
+
+      if (ClusterX > 0)
+      {
+        BuildNavBorder(Cluster - 1, Cluster, false);
+        Touched[TouchedCount++] = ClusterIndex - 1;
+      }
+      if (ClusterX + 1 < Graph->ClusterCountX)
+      {
+        BuildNavBorder(Cluster, Cluster + 1, false);
+        Touched[TouchedCount++] = ClusterIndex + 1;
+      }
+      if (ClusterY > 0)
+      {
+        BuildNavBorder(Cluster - Graph->ClusterCountX, Cluster, true);
+        Touched[TouchedCount++] = ClusterIndex - Graph->ClusterCountX;
+      }
+      if (ClusterY + 1 < Graph->ClusterCountY)
+      {
+        BuildNavBorder(Cluster, Cluster + Graph->ClusterCountX, true);
+        Touched[TouchedCount++] = ClusterIndex + Graph->ClusterCountX;
+      }
+
+      for (uint32 TouchedIndex = 0; TouchedIndex < TouchedCount; ++TouchedIndex)
+      {
+        nav_cluster *Neighbor = Graph->Clusters + Touched[TouchedIndex];
+        if (!Neighbor->NeedsCosts)
+        {
+          Neighbor->NeedsCosts = true;
+          CostClusters[CostCount++] = Touched[TouchedIndex];
+        }
+      }
+    }
+
+    if (JobCount < 1) JobCount = 1;
+    if (JobCount > NavMaxJobCount) JobCount = NavMaxJobCount;
+    if (!Queue) JobCount = 1;
+    nav_update_job Jobs[NavMaxJobCount];
+    for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+    {
+      nav_update_job *Job = Jobs + JobIndex;
+      Job->Graph = Graph;
+      Job->Clusters = CostClusters;
+      Job->First = (uint32)(((uint64)CostCount*JobIndex) / JobCount);
+      Job->OnePastLast = (uint32)(((uint64)CostCount*(JobIndex + 1)) / JobCount);
+      if (JobCount > 1)
+      {
+        Platform->AddWorkEntry(Queue, NavClusterCostsWork, Job);
+      }
+      else
+      {
+        NavClusterCostsWork(Queue, Job);
+      }
+    }
+    if (JobCount > 1)
+    {
+      Platform->CompleteAllWork(Queue);
+    }
+
+    for (uint32 CostIndex = 0; CostIndex < CostCount; ++CostIndex)
+    {
+      Graph->Clusters[CostClusters[CostIndex]].NeedsCosts = false;
+    }
+    for (uint32 DirtyIndex = 0; DirtyIndex < Graph->DirtyCount; ++DirtyIndex)
+    {
+      Graph->Clusters[Graph->DirtyClusters[DirtyIndex]].IsDirty = false;
+    }
+    Graph->DirtyCount = 0;
+    EndTemporaryMemory(TempMem);
+  }
+}
+
+/**
+ * Graphe abstrait d'une zone de ClusterCountX x ClusterCountY chunks de la
+ * carte, allou dans l'arne du monde. Tous les clusters partent marqus :
+ * le graphe est construit au premier UpdateNavGraph.
+ **/
+internal void
+InitializeNavGraph(nav_graph *Graph, memory_arena *Arena, tile_map *TileMap,
+                   int32 MinChunkX, int32 MinChunkY, uint32 ClusterCountX, uint32 ClusterCountY)
+{
+  Assert(NavClusterTileCount <= 256);
+  uint32 ClusterCount = ClusterCountX*ClusterCountY;
+  Graph->TileMap = TileMap;
+  Graph->MinChunkX = MinChunkX;
+  Graph->MinChunkY = MinChunkY;
+  Graph->ClusterCountX = ClusterCountX;
+  Graph->ClusterCountY = ClusterCountY;
+  Graph->Clusters = PushArray(Arena, ClusterCount, nav_cluster);
+  Graph->DirtyClusters = PushArray(Arena, ClusterCount, uint32);
+  Graph->DirtyCount = ClusterCount;
+  for (uint32 ClusterIndex = 0; ClusterIndex < ClusterCount; ++ClusterIndex)
+  {
+    nav_cluster *Cluster = Graph->Clusters + ClusterIndex;
+    Cluster->Chunk = 0;
+    Cluster->IsDirty = true;
+    Cluster->NeedsCosts = false;
+    for (int Side = 0; Side < 4; ++Side)
+    {
+      Cluster->NodeCount[Side] = 0;
+    }
+    Graph->DirtyClusters[ClusterIndex] = ClusterIndex;
+  }
+}
+
+/*
+  Etat d'une recherche
+*/
+internal void
+InitializeNavSearch(nav_search *Search, memory_arena *Arena, uint32 TableCapacity)
+{
+  Assert((TableCapacity & (TableCapacity - 1)) == 0);
+  Search->TableCapacity = TableCapacity;
+  Search->TableUsed = 0;
+  Search->Stamp = 0;
+  Search->Table = PushArray(Arena, TableCapacity, nav_search_node);
+  for (uint32 Index = 0; Index < TableCapacity; ++Index)
+  {
+    Search->Table[Index].Stamp = 0;
+  }
+  // Un noeud peut tre pouss  chaque amlioration de son cot
+  Search->HeapCapacity = 2*TableCapacity;
+  Search->HeapCount = 0;
+  Search->Heap = PushArray(Arena, Search->HeapCapacity, nav_heap_entry);
+  Search->Overflowed = false;
+}
+
+inline void
+BeginNavSearch(nav_search *Search)
+{
+  if (++Search->Stamp == 0)
+  {
+    // Les numros ont fait le tour : on efface vraiment la table
+    for (uint32 Index = 0; Index < Search->TableCapacity; ++Index)
+    {
+      Search->Table[Index].Stamp = 0;
+    }
+    Search->Stamp = 1;
+  }
+  Search->TableUsed = 0;
+  Search->HeapCount = 0;
+  Search->Overflowed = false;
+}
+
+/**
+ * Entre de la table pour le noeud, cre au besoin avec un cot infini
+ * Renvoie NavNoEntry si la table est pleine aux 3/4
+ **/
+internal uint32
+GetNavSearchNode(nav_search *Search, uint32 NodeId)
+{
+  uint32 Result = NavNoEntry;
+  uint32 Mask = Search->TableCapacity - 1;
+  uint32 Index = (NodeId*0x9E3779B1) & Mask;
+  for (;;)
+  {
+    nav_search_node *Node = Search->Table + Index;
+    if (Node->Stamp != Search->Stamp)
+    {
+      if (4*(Search->TableUsed + 1) <= 3*Search->TableCapacity)
+      {
+        ++Search->TableUsed;
+        Node->Stamp = Search->Stamp;
+        Node->NodeId = NodeId;
+        Node->Cost = NavNoCost;
+        Node->Parent = NavNoEntry;
+        Node->IsClosed = false;
+        Result = Index;
+      }
+      break;
+    }
+    if (Node->NodeId == NodeId)
+    {
+      Result = Index;
+      break;
+    }
+    Index = (Index + 1) & Mask;
+  }
+  return(Result);
+}
+
+/*
+  Tas binaire des noeuds ouverts. Sur une grille beaucoup de noeuds ont la
+  mme priorit : on sort d'abord celui qui a le plus grand cot, donc le
+  plus proche de l'arrive, ce qui vite d'ouvrir tout un front de noeuds
+  quivalents.
+*/
+inline bool32
+IsNavHeapBefore(nav_heap_entry A, nav_heap_entry B)
+{
+  bool32 Result = ((A.Priority < B.Priority) || ((A.Priority == B.Priority) && (A.Cost > B.Cost)));
+  return(Result);
+}
+
+internal void
+PushNavHeap(nav_search *Search, uint32 Priority, uint32 Cost, uint32 Node)
+{
+  if (Search->HeapCount < Search->HeapCapacity)
+  {
+    nav_heap_entry Entry = {Priority, Cost, Node};
+    uint32 Index = Search->HeapCount++;
+    while (Index > 0)
+    {
+      uint32 ParentIndex = (Index - 1) / 2;
+      if (!IsNavHeapBefore(Entry, Search->Heap[ParentIndex])) break;
+      Search->Heap[Index] = Search->Heap[ParentIndex];
+      Index = ParentIndex;
+    }
+    Search->Heap[Index] = Entry;
+  }
+  else
+  {
+    Search->Overflowed = true;
+  }
+}
+
+internal nav_heap_entry
+PopNavHeap(nav_search *Search)
+{
+  Assert(Search->HeapCount > 0);
+  nav_heap_entry Result = Search->Heap[0];
+  nav_heap_entry Last = Search->Heap[--Search->HeapCount];
+  uint32 Index = 0;
+  for (;;)
+  {
+    uint32 Child = 2*Index + 1;
+    if (Child >= Search->HeapCount) break;
+    if ((Child + 1 < Search->HeapCount) && IsNavHeapBefore(Search->Heap[Child + 1], Search->Heap[Child]))
+    {
+      ++Child;
+    }
+    if (!IsNavHeapBefore(Search->Heap[Child], Last)) break;
+    Search->Heap[Index] = Search->Heap[Child];
+    Index = Child;
+  }
+  if (Search->HeapCount > 0)
+  {
+    Search->Heap[Index] = Last;
+  }
+  return(Result);
+}
+
+/*
+  Recherche d'un chemin
+*/
+struct nav_endpoint
+{
+  uint32 Cluster;
+  uint32 Tile; // Locale
+  int32 X;     // En tuiles depuis l'origine de la zone
+  int32 Y;
+  uint8 Distance[NavClusterTileCount]; // Depuis ce point, dans son cluster
+};
+
+inline bool32
+GetNavEndpoint(nav_graph *Graph, int32 AbsTileX, int32 AbsTileY, nav_endpoint *Endpoint)
+{
+  bool32 Result = false;
+  int32 X = AbsTileX - Graph->MinChunkX*NavClusterDim;
+  int32 Y = AbsTileY - Graph->MinChunkY*NavClusterDim;
+  if ((X >= 0) && (X < (int32)(Graph->ClusterCountX*NavClusterDim)) &&
+      (Y >= 0) && (Y < (int32)(Graph->ClusterCountY*NavClusterDim)))
+  {
+    Endpoint->X = X;
+    Endpoint->Y = Y;
+    Endpoint->Cluster = (uint32)(Y / NavClusterDim)*Graph->ClusterCountX + (uint32)(X / NavClusterDim);
+    Endpoint->Tile = (uint32)(Y % NavClusterDim)*NavClusterDim + (uint32)(X % NavClusterDim);
+    nav_cluster *Cluster = Graph->Clusters + Endpoint->Cluster;
+    if (IsNavTileWalkable(Cluster, Endpoint->Tile))
+    {
+      GetNavClusterDistances(Cluster, Endpoint->Tile, Endpoint->Distance, 0);
+      Result = true;
+    }
+  }
+  return(Result);
+}
+
+// Distance de Manhattan jusqu' l'arrive : jamais plus que le vrai cot
+inline uint32
+GetNavHeuristic(nav_graph *Graph, uint32 NodeId, nav_endpoint *Goal)
+{
+  uint32 Result = 0;
+  if (NodeId < NavStartNode)
+  {
+    uint32 ClusterIndex = NodeId / NavMaxNodesPerCluster;
+    uint32 Tile = Graph->Clusters[ClusterIndex].NodeTile[NodeId % NavMaxNodesPerCluster];
+    int32 X = (int32)((ClusterIndex % Graph->ClusterCountX)*NavClusterDim + Tile % NavClusterDim);
+    int32 Y = (int32)((ClusterIndex / Graph->ClusterCountX)*NavClusterDim + Tile / NavClusterDim);
+    int32 dX = X - Goal->X;
+    int32 dY = Y - Goal->Y;
+    Result = (uint32)(((dX < 0) ? -dX : dX) + ((dY < 0) ? -dY : dY));
+  }
+  return(Result);
+}
+
+inline void
+RelaxNavNode(nav_graph *Graph, nav_search *Search, nav_endpoint *Goal,
+             uint32 NodeId, uint32 Cost, uint32 Parent)
+{
+  uint32 Index = GetNavSearchNode(Search, NodeId);
+  if (Index == NavNoEntry)
+  {
+    Search->Overflowed = true;
+  }
+  else
+  {
+    nav_search_node *Node = Search->Table + Index;
+    if (!Node->IsClosed && (Cost < Node->Cost))
+    {
+      Node->Cost = Cost;
+      Node->Parent = Parent;
+      PushNavHeap(Search, Cost + GetNavHeuristic(Graph, NodeId, Goal), Cost, Index);
+    }
+  }
+}
+
+// Noeud partenaire de l'autre ct de la frontire, NavNoEntry au bord de la zone
+inline uint32
+GetNavPartner(nav_graph *Graph, uint32 ClusterIndex, uint32 Slot)
+{
+  uint32 Result = NavNoEntry;
+  uint32 Side = Slot / NavMaxNodesPerSide;
+  uint32 Rank = Slot % NavMaxNodesPerSide;
+  uint32 ClusterX = ClusterIndex % Graph->ClusterCountX;
+  uint32 ClusterY = ClusterIndex / Graph->ClusterCountX;
+  switch (Side)
+  {
+    case NavSide_Left:
+    {
+      if (ClusterX > 0) Result = (ClusterIndex - 1)*NavMaxNodesPerCluster + NavSide_Right*NavMaxNodesPerSide + Rank;
+    } break;
+    case NavSide_Right:
+    {
+      if (ClusterX + 1 < Graph->ClusterCountX) Result = (ClusterIndex + 1)*NavMaxNodesPerCluster + NavSide_Left*NavMaxNodesPerSide + Rank;
+    } break;
+    case NavSide_Bottom:
+    {
+      if (ClusterY > 0) Result = (ClusterIndex - Graph->ClusterCountX)*NavMaxNodesPerCluster + NavSide_Top*NavMaxNodesPerSide + Rank;
+    } break;
+    case NavSide_Top:
+    {
+      if (ClusterY + 1 < Graph->ClusterCountY) Result = (ClusterIndex + Graph->ClusterCountX)*NavMaxNodesPerCluster + NavSide_Bottom*NavMaxNodesPerSide + Rank;
+    } break;
+  }
+  return(Result);
+}
+
+inline void
+AppendNavTile(nav_graph *Graph, nav_path *Path, uint32 ClusterIndex, uint32 Tile)
+{
+  if (Path->Length < Path->MaxLength)
+  {
+    nav_tile *Dest = Path->Tiles + Path->Length++;
+    Dest->X = (Graph->MinChunkX + (int32)(ClusterIndex % Graph->ClusterCountX))*NavClusterDim + (int32)(Tile % NavClusterDim);
+    Dest->Y = (Graph->MinChunkY + (int32)(ClusterIndex / Graph->ClusterCountX))*NavClusterDim + (int32)(Tile / NavClusterDim);
+  }
+}
+
+// Chemin en tuiles de From  To dans un cluster, From non compris
+internal void
+AppendNavSegment(nav_graph *Graph, nav_path *Path, uint32 ClusterIndex, uint32 From, uint32 To)
+{
+  if (Path->Length < Path->MaxLength)
+  {
+    nav_cluster *Cluster = Graph->Clusters + ClusterIndex;
+    uint8 Distance[NavClusterTileCount];
+    uint8 Next[NavClusterTileCount];
+    // Parcours depuis To : Next mne de n'importe quelle tuile vers To
+    GetNavClusterDistances(Cluster, To, Distance, Next);
+    Assert(Distance[From] != NavUnreachable);
+    uint32 Tile = From;
+    while ((Tile != To) && (Path->Length < Path->MaxLength))
+    {
+      Tile = Next[Tile];
+      AppendNavTile(Graph, Path, ClusterIndex, Tile);
+    }
+  }
+}
+
+/**
+ * Plus court chemin ( peu prs : HPA* passe par les transitions) entre
+ * deux tuiles en coordonnes absolues. Le graphe doit tre  jour.
+ * Renvoie false si une des tuiles n'est pas praticable ou si l'arrive
+ * n'est pas atteinte. Path->Tiles reoit le dpart puis chaque pas, au plus
+ * Path->MaxLength tuiles : le raffinement s'arrte l.
+ **/
+internal bool32
+FindNavPath(nav_graph *Graph, nav_search *Search, int32 StartX, int32 StartY,
+            int32 GoalX, int32 GoalY, nav_path *Path)
+{
+  bool32 Result = false;
+  Path->Length = 0;
+  Path->Cost = NavNoCost;
+
+  nav_endpoint Start;
+  nav_endpoint Goal;
+  if (GetNavEndpoint(Graph, StartX, StartY, &Start) && GetNavEndpoint(Graph, GoalX, GoalY, &Goal))
+  {
+    // Dans le mme cluster, le chemin direct sert de borne  la recherche abstraite
+    uint32 DirectCost = NavNoCost;
+    if ((Start.Cluster == Goal.Cluster) && (Start.Distance[Goal.Tile] != NavUnreachable))
+    {
+      DirectCost = Start.Distance[Goal.Tile];
+    }
+
+    BeginNavSearch(Search);
+    uint32 GoalIndex = NavNoEntry;
+    RelaxNavNode(Graph, Search, &Goal, NavStartNode, 0, NavNoEntry);
+    while (Search->HeapCount > 0)
+    {
+      nav_heap_entry Entry = PopNavHeap(Search);
+      if (Entry.Priority >= DirectCost) break;
+      nav_search_node *Node = Search->Table + Entry.Node;
+      if (Node->IsClosed) continue;
+      Node->IsClosed = true;
+      if (Node->NodeId == NavGoalNode)
+      {
+        GoalIndex = Entry.Node;
+        break;
+      }
+
+      if (Node->NodeId == NavStartNode)
+      {
+        nav_cluster *Cluster = Graph->Clusters + Start.Cluster;
+        for (uint32 Slot = 0; Slot < NavMaxNodesPerCluster; ++Slot)
+        {
+          if (IsNavSlotUsed(Cluster, Slot) && (Start.Distance[Cluster->NodeTile[Slot]] != NavUnreachable))
+          {
+            RelaxNavNode(Graph, Search, &Goal, Start.Cluster*NavMaxNodesPerCluster + Slot,
+                         Start.Distance[Cluster->NodeTile[Slot]], Entry.Node);
+          }
+        }
+      }
+      else
+      {
+        uint32 ClusterIndex = Node->NodeId / NavMaxNodesPerCluster;
+        uint32 Slot = Node->NodeId % NavMaxNodesPerCluster;
+        nav_cluster *Cluster = Graph->Clusters + ClusterIndex;
+        uint32 Cost = Node->Cost;
+        for (uint32 To = 0; To < NavMaxNodesPerCluster; ++To)
+        {
+          uint8 StepCost = Cluster->Cost[Slot][To];
+          if ((To != Slot) && IsNavSlotUsed(Cluster, To) && (StepCost != NavUnreachable))
+          {
+            RelaxNavNode(Graph, Search, &Goal, ClusterIndex*NavMaxNodesPerCluster + To, Cost + StepCost, Entry.Node);
+          }
+        }
+        uint32 Partner = GetNavPartner(Graph, ClusterIndex, Slot);
+        if (Partner != NavNoEntry)
+        {
+          RelaxNavNode(Graph, Search, &Goal, Partner, Cost + 1, Entry.Node);
+        }
+        if ((ClusterIndex == Goal.Cluster) && (Goal.Distance[Cluster->NodeTile[Slot]] != NavUnreachable))
+        {
+          RelaxNavNode(Graph, Search, &Goal, NavGoalNode, Cost + Goal.Distance[Cluster->NodeTile[Slot]], Entry.Node);
+        }
+      }
+    }
+
+    AppendNavTile(Graph, Path, Start.Cluster, Start.Tile);
+    if ((GoalIndex != NavNoEntry) && (Search->Table[GoalIndex].Cost < DirectCost))
+    {
+      Path->Cost = Search->Table[GoalIndex].Cost;
+
+      // On retourne la chane des parents pour la parcourir depuis le dpart
+      uint32 Previous = NavNoEntry;
+      uint32 Current = GoalIndex;
+      while (Current != NavNoEntry)
+      {
+        uint32 Parent = Search->Table[Current].Parent;
+        Search->Table[Current].Parent = Previous;
+        Previous = Current;
+        Current = Parent;
+      }
+
+      uint32 FromCluster = Start.Cluster;
+      uint32 FromTile = Start.Tile;
+      for (uint32 Index = Search->Table[Previous].Parent;
+           (Index != NavNoEntry) && (Path->Length < Path->MaxLength);
+           Index = Search->Table[Index].Parent)
+      {
+        uint32 NodeId = Search->Table[Index].NodeId;
+        uint32 ToCluster = Goal.Cluster;
+        uint32 ToTile = Goal.Tile;
+        if (NodeId != NavGoalNode)
+        {
+          ToCluster = NodeId / NavMaxNodesPerCluster;
+          ToTile = Graph->Clusters[ToCluster].NodeTile[NodeId % NavMaxNodesPerCluster];
+        }
+        if (ToCluster == FromCluster)
+        {
+          AppendNavSegment(Graph, Path, ToCluster, FromTile, ToTile);
+        }
+        else
+        {
+          // Passage d'une transition : un seul pas
+          AppendNavTile(Graph, Path, ToCluster, ToTile);
+        }
+        FromCluster = ToCluster;
+        FromTile = ToTile;
+      }
+      Result = true;
+    }
+    else if (DirectCost != NavNoCost)
+    {
+      Path->Cost = DirectCost;
+      AppendNavSegment(Graph, Path, Start.Cluster, Start.Tile, Goal.Tile);
+      Result = true;
+    }
+    else
+    {
+      Path->Length = 0;
+    }
+  }
+  return(Result);
+}
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(NavQueryWork)
+{
+  nav_query_job *Job = (nav_query_job *)Data;
+  for (uint32 Index = Job->FirstQuery; Index < Job->OnePastLastQuery; ++Index)
+  {
+    nav_query *Query = Job->Queries + Index;
+    Query->Found = FindNavPath(Job->Graph, &Job->Search, Query->StartX, Query->StartY,
+                               Query->GoalX, Query->GoalY, &Query->Path);
+  }
+}
+
+/**
+ * Un lot de requtes, dcoup en JobCount tches sur la file de travail.
+ * Chaque tche a son propre tat de recherche de SearchCapacity noeuds,
+ * pris dans l'arne (mmoire transitoire de l'image).
+ **/
+internal void
+RunNavQueries(nav_graph *Graph, nav_query *Queries, uint32 QueryCount, memory_arena *Arena,
+              uint32 SearchCapacity, platform_api *Platform, platform_work_queue *Queue, uint32 JobCount)
+{
+  Assert(Graph->DirtyCount == 0);
+  if (JobCount < 1) JobCount = 1;
+  if (JobCount > NavMaxJobCount) JobCount = NavMaxJobCount;
+  if (JobCount > QueryCount) JobCount = QueryCount ? QueryCount : 1;
+  if (!Queue) JobCount = 1;
+
+  nav_query_job Jobs[NavMaxJobCount];
+  for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+  {
+    nav_query_job *Job = Jobs + JobIndex;
+    Job->Graph = Graph;
+    InitializeNavSearch(&Job->Search, Arena, SearchCapacity);
+    Job->Queries = Queries;
+    Job->FirstQuery = (uint32)(((uint64)QueryCount*JobIndex) / JobCount);
+    Job->OnePastLastQuery = (uint32)(((uint64)QueryCount*(JobIndex + 1)) / JobCount);
+  }
+
+  if (JobCount > 1)
+  {
+    for (uint32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+    {
+      Platform->AddWorkEntry(Queue, NavQueryWork, Jobs + JobIndex);
+    }
+    Platform->CompleteAllWork(Queue);
+  }
+  else
+  {
+    NavQueryWork(Queue, Jobs);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#if !defined(FAITMAIN_NAV_H)
+
+/*
+  Recherche de chemin hirarchique (HPA*) sur la carte de tuiles
+
+  Les clusters sont les chunks de la carte (TileChunkDim x TileChunkDim
+  tuiles) d'une zone rectangulaire. Sur la frontire entre deux clusters
+  voisins, chaque suite de tuiles praticables des deux cts est une
+  entre : une transition au milieu si elle est courte, une  chaque bout
+  sinon. Une transition donne un noeud de chaque ct, relis par un pas
+  de cot 1. Dans un cluster, les cots entre ses noeuds sont calculs par
+  des parcours en largeur et gards dans une matrice : c'est le graphe
+  abstrait, construit une fois et gard dans la mmoire du jeu.
+
+  Une requte cherche d'abord dans le graphe abstrait (A* avec un tas
+  binaire dans la mmoire transitoire), le dpart et l'arrive tant
+  relis aux noeuds de leur cluster, puis chaque tape est raffine en
+  tuiles  l'intrieur d'un seul cluster.
+
+  Quand une tuile change, seul son cluster est marqu : UpdateNavGraph
+  reconstruit ses frontires et les cots des clusters touchs. Les
+  requtes ne modifient pas le graphe : plusieurs threads peuvent chercher
+  en mme temps, tant que personne ne le met  jour.
+
+  Les dplacements se font vers les 4 voisins, seules les tuiles de valeur
+  NavWalkableTile (le sol) sont praticables.
+*/
+
+#define NavWalkableTile 1
+#define NavClusterDim TileChunkDim
+#define NavClusterTileCount (NavClusterDim*NavClusterDim) // Index de tuile locale sur un uint8
+// Sur 16 tuiles de frontire, des entres spares par un mur donnent 8 transitions au plus
+#define NavMaxNodesPerSide 8
+#define NavMaxNodesPerCluster (4*NavMaxNodesPerSide)
+#define NavUnreachable 0xFF
+#define NavMaxJobCount 8
+
+enum nav_side
+{
+  NavSide_Left,
+  NavSide_Right,
+  NavSide_Bottom, // Vers les Y ngatifs
+  NavSide_Top,
+};
+
+struct nav_cluster
+{
+  tile_chunk *Chunk; // 0 si le chunk n'existe pas : rien n'est praticable
+  bool32 IsDirty;    // Frontires  reconstruire
+  bool32 NeedsCosts; // Matrice  recalculer
+
+  // Le noeud Slot est sur le ct Slot / NavMaxNodesPerSide. Le k-ime
+  // noeud d'un ct a pour partenaire le k-ime du ct en face chez le voisin.
+  uint8 NodeCount[4];
+  uint8 NodeTile[NavMaxNodesPerCluster]; // Tuile locale, Y*NavClusterDim + X
+  uint8 Cost[NavMaxNodesPerCluster][NavMaxNodesPerCluster]; // NavUnreachable si pas de chemin
+};
+
+struct nav_graph
+{
+  tile_map *TileMap;
+  // Zone couverte, en chunks
+  int32 MinChunkX;
+  int32 MinChunkY;
+  uint32 ClusterCountX;
+  uint32 ClusterCountY;
+  nav_cluster *Clusters; // [ClusterCountY][ClusterCountX]
+
+  uint32 DirtyCount;
+  uint32 *DirtyClusters;
+};
+
+struct nav_tile
+{
+  int32 X; // Coordonnes absolues de tuile
+  int32 Y;
+};
+
+struct nav_path
+{
+  uint32 MaxLength;
+  uint32 Length; // Au plus MaxLength : le chemin n'est raffin que jusque-l
+  uint32 Cost;   // Nombre de pas du chemin complet
+  nav_tile *Tiles;
+};
+
+/*
+  Etat d'une recherche, un par thread : la table des noeuds visits (adressage
+  ouvert) et le tas des noeuds ouverts. Une entre de la table ne vaut que
+  pour la recherche dont elle porte le numro, rien n'est effac entre deux
+  recherches.
+*/
+struct nav_search_node
+{
+  uint32 NodeId;
+  uint32 Stamp;
+  uint32 Cost;   // Depuis le dpart
+  uint32 Parent; // Index dans la table
+  bool32 IsClosed;
+};
+
+struct nav_heap_entry
+{
+  uint32 Priority; // Cot + heuristique
+  uint32 Cost;     // A priorit gale, le plus avanc sort d'abord
+  uint32 Node;     // Index dans la table
+};
+
+struct nav_search
+{
+  uint32 TableCapacity; // Puissance de 2
+  uint32 TableUsed;
+  uint32 Stamp;
+  nav_search_node *Table;
+
+  uint32 HeapCapacity;
+  uint32 HeapCount;
+  nav_heap_entry *Heap;
+
+  bool32 Overflowed; // La dernire recherche a manqu de place
+};
+
+struct nav_query
+{
+  int32 StartX;
+  int32 StartY;
+  int32 GoalX;
+  int32 GoalY;
+  bool32 Found;
+  nav_path Path; // Tiles et MaxLength fournis par l'appelant
+};
+
+struct nav_update_job
+{
+  nav_graph *Graph;
+  uint32 *Clusters;
+  uint32 First;
+  uint32 OnePastLast;
+};
+
+struct nav_query_job
+{
+  nav_graph *Graph;
+  nav_search Search;
+  nav_query *Queries;
+  uint32 FirstQuery;
+  uint32 OnePastLastQuery;
+};
+
+#define FAITMAIN_NAV_H
+#endif
\ No newline at end of file
@@ -0,0 +1,238 @@
+/*
+  Particules : mission, mise  jour SSE, retrait des mortes et affichage
+  en un lot de points additifs
+*/
+
+internal void
+InitializeParticleSystem(particle_system *System, memory_arena *Arena, uint32 MaxCount, uint32 Seed)
+{
+  MaxCount = (MaxCount + 7) & ~7;
+  System->MaxCount = MaxCount;
+  System->Count = 0;
+  System->PositionX = PushArray(Arena, MaxCount, real32);
+  System->PositionY = PushArray(Arena, MaxCount, real32);
+  System->VelocityX = PushArray(Arena, MaxCount, real32);
+  System->VelocityY = PushArray(Arena, MaxCount, real32);
+  System->Life = PushArray(Arena, MaxCount, real32);
+  System->LifeDecay = PushArray(Arena, MaxCount, real32);
+  // Les cases libres passent aussi dans la mise  jour, elles doivent rester des nombres
+  memset(System->PositionX, 0, MaxCount*sizeof(real32));
+  memset(System->PositionY, 0, MaxCount*sizeof(real32));
+  memset(System->VelocityX, 0, MaxCount*sizeof(real32));
+  memset(System->VelocityY, 0, MaxCount*sizeof(real32));
+  memset(System->Life, 0, MaxCount*sizeof(real32));
+  memset(System->LifeDecay, 0, MaxCount*sizeof(real32));
+  System->RandomState = Seed ? Seed : 1;
+}
+
+inline uint32
+NextParticleRandom(particle_system *System)
+{
+  uint32 X = System->RandomState;
+  X ^= X << 13;
+  X ^= X >> 17;
+  X ^= X << 5;
+  System->RandomState = X;
+  return(X);
+}
+
+// Dans [0, 1)
+inline real32
+RandomParticleUnilateral(particle_system *System)
+{
+  real32 Result = (real32)(NextParticleRandom(System) >> 8) / (real32)(1 << 24);
+  return(Result);
+}
+
+// Dans [-1, 1)
+inline real32
+RandomParticleBilateral(particle_system *System)
+{
+  real32 Result = 2.0f*RandomParticleUnilateral(System) - 1.0f;
+  return(Result);
+}
+
+/**
+ * Ajout de Count particules  la fin des tableaux
+ * Renvoie le nombre de particules rellement cres, moins si le systme est plein
+ **/
+internal uint32
+EmitParticles(particle_system *System, particle_emitter *Emitter, uint32 Count)
+{
+  uint32 FreeCount = System->MaxCount - System->Count;
+  if (Count > FreeCount) Count = FreeCount;
+
+  real32 LifetimeRange = Emitter->MaxLifetime - Emitter->MinLifetime;
+  for (uint32 Index = System->Count; Index < System->Count + Count; ++Index)
+  {
+    System->PositionX[Index] = Emitter->PositionX;
+    System->PositionY[Index] = Emitter->PositionY;
+    System->VelocityX[Index] = Emitter->VelocityX + Emitter->Spread*RandomParticleBilateral(System);
+    System->VelocityY[Index] = Emitter->VelocityY + Emitter->Spread*RandomParticleBilateral(System);
+    real32 Lifetime = Emitter->MinLifetime + LifetimeRange*RandomParticleUnilateral(System);
+    System->Life[Index] = 1.0f;
+    System->LifeDecay[Index] = 1.0f / Lifetime;
+  }
+  System->Count += Count;
+  return(Count);
+}
+
+// Facteur appliqu  la vitesse  chaque pas : frottement linaire au premier
+// ordre, born pour qu'un grand dt n'inverse pas la vitesse
+inline real32
+GetParticleDragFactor(real32 Drag, real32 dt)
+{
+  real32 Result = 1.0f - Drag*dt;
+  if (Result < 0.0f) Result = 0.0f;
+  return(Result);
+}
+
+/**
+ * Intgration de 8 particules par tour, en deux registres SSE : gravit,
+ * frottement puis vieillissement. Aucune branche, les particules mortes
+ * (Life <= 0) sont retires ensuite par CompactParticles.
+ **/
+internal void
+UpdateParticles(particle_system *System, real32 dt, real32 GravityX, real32 GravityY, real32 Drag)
+{
+  __m128 dtWide = _mm_set1_ps(dt);
+  __m128 DragFactor = _mm_set1_ps(GetParticleDragFactor(Drag, dt));
+  __m128 GravityXdt = _mm_set1_ps(GravityX*dt);
+  __m128 GravityYdt = _mm_set1_ps(GravityY*dt);
+
+  for (uint32 Index = 0; Index < System->Count; Index += 8)
+  {
+    real32 *PositionX = System->PositionX + Index;
+    real32 *PositionY = System->PositionY + Index;
+    real32 *VelocityX = System->VelocityX + Index;
+    real32 *VelocityY = System->VelocityY + Index;
+    real32 *Life = System->Life + Index;
+    real32 *LifeDecay = System->LifeDecay + Index;
+
+    __m128 VXA = _mm_add_ps(_mm_mul_ps(_mm_load_ps(VelocityX), DragFactor), GravityXdt);
+    __m128 VXB = _mm_add_ps(_mm_mul_ps(_mm_load_ps(VelocityX + 4), DragFactor), GravityXdt);
+    __m128 VYA = _mm_add_ps(_mm_mul_ps(_mm_load_ps(VelocityY), DragFactor), GravityYdt);
+    __m128 VYB = _mm_add_ps(_mm_mul_ps(_mm_load_ps(VelocityY + 4), DragFactor), GravityYdt);
+    _mm_store_ps(VelocityX, VXA);
+    _mm_store_ps(VelocityX + 4, VXB);
+    _mm_store_ps(VelocityY, VYA);
+    _mm_store_ps(VelocityY + 4, VYB);
+
+    _mm_store_ps(PositionX, _mm_add_ps(_mm_load_ps(PositionX), _mm_mul_ps(VXA, dtWide)));
+    _mm_store_ps(PositionX + 4, _mm_add_ps(_mm_load_ps(PositionX + 4), _mm_mul_ps(VXB, dtWide)));
+    _mm_store_ps(PositionY, _mm_add_ps(_mm_load_ps(PositionY), _mm_mul_ps(VYA, dtWide)));
+    _mm_store_ps(PositionY + 4, _mm_add_ps(_mm_load_ps(PositionY + 4), _mm_mul_ps(VYB, dtWide)));
+
+    _mm_store_ps(Life, _mm_sub_ps(_mm_load_ps(Life), _mm_mul_ps(_mm_load_ps(LifeDecay), dtWide)));
+    _mm_store_ps(Life + 4, _mm_sub_ps(_mm_load_ps(Life + 4), _mm_mul_ps(_mm_load_ps(LifeDecay + 4), dtWide)));
+  }
+}
+
+// La dernire particule prend la place de celle d'index Index
+inline void
+RemoveParticleAt(particle_system *System, uint32 Index)
+{
+  Assert(Index < System->Count);
+  uint32 Last = --System->Count;
+  System->PositionX[Index] = System->PositionX[Last];
+  System->PositionY[Index] = System->PositionY[Last];
+  System->VelocityX[Index] = System->VelocityX[Last];
+  System->VelocityY[Index] = System->VelocityY[Last];
+  System->Life[Index] = System->Life[Last];
+  System->LifeDecay[Index] = System->LifeDecay[Last];
+}
+
+/**
+ * Retire les particules mortes. On parcourt  l'envers par paquets de 4 :
+ * un paquet sans mort ne cote qu'une comparaison SSE, et la particule
+ * dplace par un retrait a dj t teste.
+ **/
+internal uint32
+CompactParticles(particle_system *System)
+{
+  uint32 RemovedCount = 0;
+  __m128 Zero = _mm_setzero_ps();
+  for (uint32 Block = (System->Count + 3) & ~3; Block > 0;)
+  {
+    Block -= 4;
+    int DeadMask = _mm_movemask_ps(_mm_cmple_ps(_mm_load_ps(System->Life + Block), Zero));
+    if (DeadMask)
+    {
+      for (uint32 Lane = 4; Lane-- > 0;)
+      {
+        // Les voies aprs Count, dans le dernier paquet, ne sont pas des particules
+        if ((DeadMask & (1 << Lane)) && (Block + Lane < System->Count))
+        {
+          RemoveParticleAt(System, Block + Lane);
+          ++RemovedCount;
+        }
+      }
+    }
+  }
+  return(RemovedCount);
+}
+
+#define ParticleSplatBatchCount 1024
+
+/**
+ * Les particules comme des points d'un pixel, mlangs en additif. Les
+ * positions passent  l'cran 4 par 4 en SSE, les points visibles sont
+ * rangs dans un lot sur la pile, dessin d'un appel au noyau du format
+ * quand il est plein.
+ **/
+internal void
+RenderParticles(draw_kernels *Kernels, game_offscreen_buffer *Buffer,
+                particle_system *System, world_view View, draw_color Color)
+{
+  uint32 Offsets[ParticleSplatBatchCount];
+  real32 Intensities[ParticleSplatBatchCount];
+  uint32 BatchCount = 0;
+
+  __m128 CenterX = _mm_set1_ps(View.CenterX);
+  __m128 CenterY = _mm_set1_ps(View.CenterY);
+  __m128 Scale = _mm_set1_ps(View.PixelsPerMeter);
+  __m128 Zero = _mm_setzero_ps();
+  __m128 Width = _mm_set1_ps((real32)Buffer->Width);
+  __m128 Height = _mm_set1_ps((real32)Buffer->Height);
+  uint32 Pitch = (uint32)Buffer->Pitch;
+  uint32 BytesPerPixel = (uint32)Buffer->BytesPerPixel;
+
+  for (uint32 Index = 0; Index < System->Count; Index += 4)
+  {
+    __m128 ScreenX = _mm_add_ps(CenterX, _mm_mul_ps(_mm_load_ps(System->PositionX + Index), Scale));
+    __m128 ScreenY = _mm_sub_ps(CenterY, _mm_mul_ps(_mm_load_ps(System->PositionY + Index), Scale));
+    // Faux pour un NaN : une particule partie  l'infini n'est pas dessine
+    __m128 Inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(ScreenX, Zero), _mm_cmplt_ps(ScreenX, Width)),
+                               _mm_and_ps(_mm_cmpge_ps(ScreenY, Zero), _mm_cmplt_ps(ScreenY, Height)));
+    int Mask = _mm_movemask_ps(Inside);
+    if (Index + 4 > System->Count)
+    {
+      Mask &= (1 << (System->Count - Index)) - 1;
+    }
+    if (Mask)
+    {
+      uint32 X[4];
+      uint32 Y[4];
+      _mm_storeu_si128((__m128i *)X, _mm_cvttps_epi32(ScreenX));
+      _mm_storeu_si128((__m128i *)Y, _mm_cvttps_epi32(ScreenY));
+      if (BatchCount + 4 > ParticleSplatBatchCount)
+      {
+        Kernels->SplatAdditive(Buffer, Offsets, Intensities, BatchCount, Color);
+        BatchCount = 0;
+      }
+      for (uint32 Lane = 0; Lane < 4; ++Lane)
+      {
+        if (Mask & (1 << Lane))
+        {
+          Offsets[BatchCount] = Y[Lane]*Pitch + X[Lane]*BytesPerPixel;
+          Intensities[BatchCount] = System->Life[Index + Lane];
+          ++BatchCount;
+        }
+      }
+    }
+  }
+  if (BatchCount)
+  {
+    Kernels->SplatAdditive(Buffer, Offsets, Intensities, BatchCount, Color);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#if !defined(FAITMAIN_PARTICLE_H)
+
+/*
+  Systme de particules en structure de tableaux (SoA)
+
+  Comme les entits, chaque champ a son tableau et les particules vivantes
+  sont tasses au dbut ([0, Count)). Il n'y a pas de handle : une particule
+  n'est jamais dsigne aprs sa cration, une particule morte est remplace
+  par la dernire et c'est tout. Les tableaux sont pris une fois pour toutes
+  dans la mmoire transitoire et leur taille est un multiple de 8 : la mise
+   jour traite 8 particules par tour (deux registres SSE) sans test de fin.
+
+  Life va de 1  la naissance  0  la mort, au rythme de LifeDecay par
+  seconde (l'inverse de la dure de vie). Elle sert aussi d'intensit 
+  l'affichage : une particule s'teint en vieillissant.
+*/
+
+struct particle_system
+{
+  uint32 MaxCount; // Multiple de 8
+  uint32 Count;
+
+  real32 *PositionX;
+  real32 *PositionY;
+  real32 *VelocityX;
+  real32 *VelocityY;
+  real32 *Life;
+  real32 *LifeDecay;
+
+  uint32 RandomState; // xorshift, jamais nul
+};
+
+// Paramtres d'une mission : la vitesse est tire dans un carr de ct
+// 2*Spread autour de la vitesse de base
+struct particle_emitter
+{
+  real32 PositionX;
+  real32 PositionY;
+  real32 VelocityX;
+  real32 VelocityY;
+  real32 Spread;
+  real32 MinLifetime; // Secondes
+  real32 MaxLifetime;
+};
+
+#define FAITMAIN_PARTICLE_H
+#endif
\ No newline at end of file
@@ -0,0 +1,290 @@
+#if !defined(FAITMAIN_PIXEL_H)
+
+/*
+  Conversions entre les formats de pixels de game_offscreen_buffer
+
+  Le format pivot est PixelFormat_XRGB8888 : toute conversion qui n'a pas
+  de noyau direct passe par lui, par morceaux dans un buffer sur la pile.
+  Les conversions sRGB <-> linaire passent par des tables :
+  - 256 floats pour sRGB 8 bits -> linaire (exact)
+  - 4096 octets pour linaire -> sRGB 8 bits (quantification sur 12 bits,
+    au plus 1 d'erreur sur 255 dans les tons sombres)
+  Ce fichier est partag entre le jeu et la couche plateforme.
+*/
+#include <emmintrin.h> // SSE2, toujours prsent en 64 bits
+#include <string.h>    // memcpy
+
+struct srgb_tables
+{
+  bool32 IsInitialized;
+  real32 SRGB8ToLinear[256];
+  uint8 LinearToSRGB8[4096];
+};
+global_variable srgb_tables GlobalSRGBTables;
+
+inline int
+GetBytesPerPixel(game_pixel_format Format)
+{
+  int Result = 4;
+  switch(Format)
+  {
+    case PixelFormat_RGB565: Result = 2; break;
+    case PixelFormat_RGBA32F: Result = 16; break;
+    default: break;
+  }
+  return(Result);
+}
+
+internal void
+InitializeSRGBTables(srgb_tables *Tables)
+{
+  for(int Index = 0; Index < 256; ++Index)
+  {
+    real32 C = (real32)Index / 255.0f;
+    Tables->SRGB8ToLinear[Index] = (C <= 0.04045f) ? (C / 12.92f) : powf((C + 0.055f) / 1.055f, 2.4f);
+  }
+  for(int Index = 0; Index < 4096; ++Index)
+  {
+    real32 L = (real32)Index / 4095.0f;
+    real32 S = (L <= 0.0031308f) ? (L * 12.92f) : (1.055f*powf(L, 1.0f / 2.4f) - 0.055f);
+    Tables->LinearToSRGB8[Index] = (uint8)(S*255.0f + 0.5f);
+  }
+  Tables->IsInitialized = true;
+}
+
+/*
+  Noyaux de conversion ligne par ligne
+  Les boucles SIMD traitent 4 ou 8 pixels, la fin de ligne est faite en scalaire
+*/
+
+// Echange les canaux rouge et bleu : XRGB8888 <-> RGBA8888
+// AlphaMask permet de forcer l'alpha  0xFF quand l'octet X n'est pas dfini
+internal void
+ConvertRowSwapRedBlue(uint32 *Dest, uint32 *Source, int Count, uint32 AlphaMask)
+{
+  int Index = 0;
+  __m128i MaskAG = _mm_set1_epi32((int)0xFF00FF00);
+  __m128i MaskFF = _mm_set1_epi32(0xFF);
+  __m128i Alpha = _mm_set1_epi32((int)AlphaMask);
+  for(; Index + 4 <= Count; Index += 4)
+  {
+    __m128i P = _mm_loadu_si128((__m128i *)(Source + Index));
+    __m128i R = _mm_or_si128(_mm_and_si128(P, MaskAG), Alpha);
+    R = _mm_or_si128(R, _mm_and_si128(_mm_srli_epi32(P, 16), MaskFF));
+    R = _mm_or_si128(R, _mm_slli_epi32(_mm_and_si128(P, MaskFF), 16));
+    _mm_storeu_si128((__m128i *)(Dest + Index), R);
+  }
+  for(; Index < Count; ++Index)
+  {
+    uint32 P = Source[Index];
+    Dest[Index] = (P & 0xFF00FF00) | AlphaMask | ((P >> 16) & 0xFF) | ((P & 0xFF) << 16);
+  }
+}
+
+inline __m128i
+PackXRGBTo565_4x(__m128i P)
+{
+  __m128i R = _mm_and_si128(_mm_srli_epi32(P, 8), _mm_set1_epi32(0xF800));
+  __m128i G = _mm_and_si128(_mm_srli_epi32(P, 5), _mm_set1_epi32(0x07E0));
+  __m128i B = _mm_and_si128(_mm_srli_epi32(P, 3), _mm_set1_epi32(0x001F));
+  __m128i Result = _mm_or_si128(_mm_or_si128(R, G), B);
+  // _mm_packs_epi32 sature en sign : on tend le signe des 16 bits bas pour garder les bits intacts
+  Result = _mm_srai_epi32(_mm_slli_epi32(Result, 16), 16);
+  return(Result);
+}
+
+internal void
+ConvertRowXRGBTo565(uint16 *Dest, uint32 *Source, int Count)
+{
+  int Index = 0;
+  for(; Index + 8 <= Count; Index += 8)
+  {
+    __m128i Lo = PackXRGBTo565_4x(_mm_loadu_si128((__m128i *)(Source + Index)));
+    __m128i Hi = PackXRGBTo565_4x(_mm_loadu_si128((__m128i *)(Source + Index + 4)));
+    _mm_storeu_si128((__m128i *)(Dest + Index), _mm_packs_epi32(Lo, Hi));
+  }
+  for(; Index < Count; ++Index)
+  {
+    uint32 P = Source[Index];
+    Dest[Index] = (uint16)(((P >> 8) & 0xF800) | ((P >> 5) & 0x07E0) | ((P >> 3) & 0x001F));
+  }
+}
+
+// Les bits de poids fort sont recopis dans les bits bas pour que 0x1F donne bien 0xFF
+inline __m128i
+Unpack565ToXRGB_4x(__m128i P)
+{
+  __m128i R5 = _mm_and_si128(_mm_srli_epi32(P, 11), _mm_set1_epi32(0x1F));
+  __m128i G6 = _mm_and_si128(_mm_srli_epi32(P, 5), _mm_set1_epi32(0x3F));
+  __m128i B5 = _mm_and_si128(P, _mm_set1_epi32(0x1F));
+  __m128i R8 = _mm_or_si128(_mm_slli_epi32(R5, 3), _mm_srli_epi32(R5, 2));
+  __m128i G8 = _mm_or_si128(_mm_slli_epi32(G6, 2), _mm_srli_epi32(G6, 4));
+  __m128i B8 = _mm_or_si128(_mm_slli_epi32(B5, 3), _mm_srli_epi32(B5, 2));
+  __m128i Result = _mm_or_si128(_mm_set1_epi32((int)0xFF000000), _mm_slli_epi32(R8, 16));
+  Result = _mm_or_si128(Result, _mm_or_si128(_mm_slli_epi32(G8, 8), B8));
+  return(Result);
+}
+
+internal void
+ConvertRow565ToXRGB(uint32 *Dest, uint16 *Source, int Count)
+{
+  int Index = 0;
+  __m128i Zero = _mm_setzero_si128();
+  for(; Index + 8 <= Count; Index += 8)
+  {
+    __m128i P = _mm_loadu_si128((__m128i *)(Source + Index));
+    _mm_storeu_si128((__m128i *)(Dest + Index), Unpack565ToXRGB_4x(_mm_unpacklo_epi16(P, Zero)));
+    _mm_storeu_si128((__m128i *)(Dest + Index + 4), Unpack565ToXRGB_4x(_mm_unpackhi_epi16(P, Zero)));
+  }
+  for(; Index < Count; ++Index)
+  {
+    uint32 P = Source[Index];
+    uint32 R5 = (P >> 11) & 0x1F;
+    uint32 G6 = (P >> 5) & 0x3F;
+    uint32 B5 = P & 0x1F;
+    Dest[Index] = (0xFF000000 |
+                   (((R5 << 3) | (R5 >> 2)) << 16) |
+                   (((G6 << 2) | (G6 >> 4)) << 8) |
+                   ((B5 << 3) | (B5 >> 2)));
+  }
+}
+
+// sRGB 8 bits -> linaire : une lecture de table par canal, l'alpha reste linaire
+// RedShift/BlueShift distinguent XRGB8888 (16/0) de RGBA8888 (0/16)
+internal void
+ConvertRowSRGB8ToLinear(real32 *Dest, uint32 *Source, int Count,
+                        int RedShift, int BlueShift, bool32 HasAlpha)
+{
+  if(!GlobalSRGBTables.IsInitialized) InitializeSRGBTables(&GlobalSRGBTables);
+  real32 *Table = GlobalSRGBTables.SRGB8ToLinear;
+  for(int Index = 0; Index < Count; ++Index)
+  {
+    uint32 P = Source[Index];
+    real32 Alpha = HasAlpha ? ((real32)(P >> 24) * (1.0f / 255.0f)) : 1.0f;
+    __m128 Color = _mm_setr_ps(Table[(P >> RedShift) & 0xFF],
+                               Table[(P >> 8) & 0xFF],
+                               Table[(P >> BlueShift) & 0xFF],
+                               Alpha);
+    _mm_storeu_ps(Dest + 4*Index, Color);
+  }
+}
+
+// Linaire -> sRGB 8 bits : bornage et quantification en SIMD, puis lecture de table
+internal void
+ConvertRowLinearToSRGB8(uint32 *Dest, real32 *Source, int Count,
+                        int RedShift, int BlueShift)
+{
+  if(!GlobalSRGBTables.IsInitialized) InitializeSRGBTables(&GlobalSRGBTables);
+  uint8 *Table = GlobalSRGBTables.LinearToSRGB8;
+  __m128 Zero = _mm_setzero_ps();
+  __m128 One = _mm_set1_ps(1.0f);
+  // Les trois couleurs sont quantifies sur 12 bits pour la table, l'alpha directement sur 8 bits
+  __m128 Scale = _mm_setr_ps(4095.0f, 4095.0f, 4095.0f, 255.0f);
+  for(int Index = 0; Index < Count; ++Index)
+  {
+    __m128 Color = _mm_loadu_ps(Source + 4*Index);
+    Color = _mm_min_ps(_mm_max_ps(Color, Zero), One);
+    __m128i Quantized = _mm_cvtps_epi32(_mm_mul_ps(Color, Scale));
+    uint32 Lanes[4];
+    _mm_storeu_si128((__m128i *)Lanes, Quantized);
+    Dest[Index] = ((Lanes[3] << 24) |
+                   ((uint32)Table[Lanes[0]] << RedShift) |
+                   ((uint32)Table[Lanes[1]] << 8) |
+                   ((uint32)Table[Lanes[2]] << BlueShift));
+  }
+}
+
+internal void
+ConvertRowFromXRGB(game_pixel_format DestFormat, void *Dest, uint32 *Source, int Count)
+{
+  switch(DestFormat)
+  {
+    case PixelFormat_XRGB8888: memcpy(Dest, Source, Count*sizeof(uint32)); break;
+    case PixelFormat_RGBA8888: ConvertRowSwapRedBlue((uint32 *)Dest, Source, Count, 0xFF000000); break;
+    case PixelFormat_RGB565: ConvertRowXRGBTo565((uint16 *)Dest, Source, Count); break;
+    case PixelFormat_RGBA32F: ConvertRowSRGB8ToLinear((real32 *)Dest, Source, Count, 16, 0, false); break;
+    default: Assert(!"Format de pixel inconnu");
+  }
+}
+
+internal void
+ConvertRowToXRGB(uint32 *Dest, game_pixel_format SourceFormat, void *Source, int Count)
+{
+  switch(SourceFormat)
+  {
+    case PixelFormat_XRGB8888: memcpy(Dest, Source, Count*sizeof(uint32)); break;
+    case PixelFormat_RGBA8888: ConvertRowSwapRedBlue(Dest, (uint32 *)Source, Count, 0); break;
+    case PixelFormat_RGB565: ConvertRow565ToXRGB(Dest, (uint16 *)Source, Count); break;
+    case PixelFormat_RGBA32F: ConvertRowLinearToSRGB8(Dest, (real32 *)Source, Count, 16, 0); break;
+    default: Assert(!"Format de pixel inconnu");
+  }
+}
+
+/*
+  Conversion d'une ligne de Count pixels entre deux formats quelconques
+*/
+internal void
+ConvertPixelRow(game_pixel_format DestFormat, void *Dest,
+                game_pixel_format SourceFormat, void *Source, int Count)
+{
+  if(SourceFormat == PixelFormat_XRGB8888)
+  {
+    ConvertRowFromXRGB(DestFormat, Dest, (uint32 *)Source, Count);
+  }
+  else if(DestFormat == PixelFormat_XRGB8888)
+  {
+    ConvertRowToXRGB((uint32 *)Dest, SourceFormat, Source, Count);
+  }
+  else if(DestFormat == SourceFormat)
+  {
+    memcpy(Dest, Source, Count*GetBytesPerPixel(SourceFormat));
+  }
+  else if((SourceFormat == PixelFormat_RGBA8888) && (DestFormat == PixelFormat_RGBA32F))
+  {
+    ConvertRowSRGB8ToLinear((real32 *)Dest, (uint32 *)Source, Count, 0, 16, true);
+  }
+  else if((SourceFormat == PixelFormat_RGBA32F) && (DestFormat == PixelFormat_RGBA8888))
+  {
+    ConvertRowLinearToSRGB8((uint32 *)Dest, (real32 *)Source, Count, 0, 16);
+  }
+  else
+  {
+    // Pas de noyau direct : on passe par le format pivot, par morceaux qui restent dans le cache L1
+    uint32 Pivot[256];
+    int PivotCount = ArrayCount(Pivot);
+    uint8 *SourceAt = (uint8 *)Source;
+    uint8 *DestAt = (uint8 *)Dest;
+    int SourceBytesPerPixel = GetBytesPerPixel(SourceFormat);
+    int DestBytesPerPixel = GetBytesPerPixel(DestFormat);
+    for(int Start = 0; Start < Count; Start += PivotCount)
+    {
+      int ChunkCount = Count - Start;
+      if(ChunkCount > PivotCount) ChunkCount = PivotCount;
+      ConvertRowToXRGB(Pivot, SourceFormat, SourceAt, ChunkCount);
+      ConvertRowFromXRGB(DestFormat, DestAt, Pivot, ChunkCount);
+      SourceAt += ChunkCount*SourceBytesPerPixel;
+      DestAt += ChunkCount*DestBytesPerPixel;
+    }
+  }
+}
+
+/*
+  Conversion d'un buffer entier, sur la plus petite des deux surfaces
+*/
+internal void
+ConvertOffscreenBuffer(game_offscreen_buffer *Dest, game_offscreen_buffer *Source)
+{
+  int Width = (Dest->Width < Source->Width) ? Dest->Width : Source->Width;
+  int Height = (Dest->Height < Source->Height) ? Dest->Height : Source->Height;
+  uint8 *SourceRow = (uint8 *)Source->Memory;
+  uint8 *DestRow = (uint8 *)Dest->Memory;
+  for(int Y = 0; Y < Height; ++Y)
+  {
+    ConvertPixelRow(Dest->PixelFormat, DestRow, Source->PixelFormat, SourceRow, Width);
+    SourceRow += Source->Pitch;
+    DestRow += Dest->Pitch;
+  }
+}
+
+#define FAITMAIN_PIXEL_H
+#endif
\ No newline at end of file
@@ -0,0 +1,378 @@
+#if !defined(FAITMAIN_REPLAY_H)
+
+/*
+  Enregistrement des entres : codage par diffrence, blocs compresss, images cls
+
+  Chaque image enregistre (entres et empreinte de l'tat) est code par
+  diffrence avec la prcdente, mot de 32 bits par mot : seuls les mots
+  qui changent sont crits, avec leur position et le OU exclusif avec
+  l'ancienne valeur, sur le moins d'octets possible. D'une image  l'autre
+  il ne change en gnral que la dure de l'image, quelques boutons et les
+  morceaux de l'tat qui ont boug.
+
+  Les images sont regroupes par blocs de ReplayBlockFrameCount,
+  compresss en LZ. Chaque bloc se dcode seul et commence par une image
+  cl : l'tat simul du jeu d'avant sa premire image, d'o la relecture
+  peut repartir sans rejouer le dbut. L'tat bouge peu (les entits, pas
+  la carte ni le graphe de navigation) : seule la premire image cl est
+  l'tat tel quel, les suivantes sont en OU exclusif avec elle et se
+  compressent presque entirement. L'index des images cls est  la fin
+  du fichier.
+
+  Ce fichier ne dpend pas de la plateforme : le fichier est lu et crit
+  par la couche plateforme.
+*/
+#include <string.h> // memcpy, memcmp
+
+/*
+  Format du fichier : en-tte, blocs, puis index des images cls
+  L'en-tte est rcrit  la fermeture avec la place de l'index. Sans
+  index (enregistrement interrompu) le fichier se relit du dbut, sans saut.
+*/
+#define ReplayMagic 0x43524D46 // "FMRC"
+#define ReplayVersion 2
+#define ReplayBlockMagic 0x42524D46 // "FMRB"
+#define ReplayBlockFrameCount 256 // Une image cl toutes les 4 s  60 images par seconde
+
+struct replay_frame
+{
+  game_input Input;
+  game_state_hash StateHash;
+};
+
+#define ReplayFrameWordCount (sizeof(replay_frame) / sizeof(uint32))
+// Au pire chaque mot change : position sur 2 octets et 4 octets de valeur
+#define ReplayMaxFrameDeltaSize (2 + 6*ReplayFrameWordCount)
+#define ReplayMaxBlockSize (ReplayBlockFrameCount*ReplayMaxFrameDeltaSize)
+
+struct replay_file_header
+{
+  uint32 Magic;
+  uint32 Version;
+  // Un fichier crit avec d'autres structures n'est pas relu
+  uint32 InputSize;
+  uint32 StateHashSize;
+  uint64 PermanentStorageSize;
+  // Remplis  la fermeture, IndexOffset  0 si le fichier n'a pas t ferm
+  uint64 IndexOffset;
+  uint32 KeyframeCount;
+  uint32 FrameCount;
+};
+
+struct replay_block_header
+{
+  uint32 Magic;
+  uint32 FirstFrame;
+  uint32 FrameCount;
+  uint32 FramesSize;
+  uint32 FramesCompressedSize;
+  uint32 KeyframeCompressedSize; // 0 : pas d'image cl dans ce bloc
+  // Etat simul avant la premire image du bloc : [FirstByte, FirstByte + Size) de la mmoire permanente
+  uint64 KeyframeFirstByte;
+  uint64 KeyframeSize;
+  // Place dans le fichier du bloc dont l'image cl sert de base au OU exclusif, 0 : tat tel quel
+  uint64 KeyframeBaseOffset;
+  real64 Seconds; // Temps simul avant la premire image du bloc
+};
+
+struct replay_keyframe_entry
+{
+  uint64 BlockOffset;
+  uint32 FirstFrame;
+  uint32 Pad;
+  real64 Seconds;
+};
+
+/*
+  Codage par diffrence
+*/
+
+inline uint8 *
+WriteReplayVarint(uint8 *At, uint32 Value)
+{
+  while (Value >= 0x80)
+  {
+    *At++ = (uint8)(Value | 0x80);
+    Value >>= 7;
+  }
+  *At++ = (uint8)Value;
+  return(At);
+}
+
+// 0 si la valeur dpasse End
+inline uint8 *
+ReadReplayVarint(uint8 *At, uint8 *End, uint32 *Value)
+{
+  uint32 Result = 0;
+  for (uint32 Shift = 0; At && (Shift < 32); Shift += 7)
+  {
+    if (At == End)
+    {
+      At = 0;
+    }
+    else
+    {
+      uint8 Byte = *At++;
+      Result |= (uint32)(Byte & 0x7F) << Shift;
+      if (!(Byte & 0x80)) break;
+    }
+  }
+  *Value = Result;
+  return(At);
+}
+
+/**
+ * Ecrit Frame code par diffrence avec Previous, qui devient Frame
+ * Chaque mot chang : l'cart depuis le mot chang prcdent et le nombre
+ * d'octets du OU exclusif dans un entier variable, puis ces octets.
+ * Renvoie la fin de l'criture, au plus ReplayMaxFrameDeltaSize plus loin.
+ **/
+internal uint8 *
+EncodeReplayFrame(replay_frame *Frame, replay_frame *Previous, uint8 *At)
+{
+  uint32 *Words = (uint32 *)Frame;
+  uint32 *PreviousWords = (uint32 *)Previous;
+  uint32 ChangeCount = 0;
+  for (uint32 WordIndex = 0; WordIndex < ReplayFrameWordCount; ++WordIndex)
+  {
+    if (Words[WordIndex] != PreviousWords[WordIndex]) ++ChangeCount;
+  }
+  At = WriteReplayVarint(At, ChangeCount);
+
+  uint32 NextWord = 0;
+  for (uint32 WordIndex = 0; WordIndex < ReplayFrameWordCount; ++WordIndex)
+  {
+    uint32 Change = Words[WordIndex] ^ PreviousWords[WordIndex];
+    if (Change)
+    {
+      uint32 ByteCount = (Change > 0xFFFFFF) ? 4 : (Change > 0xFFFF) ? 3 : (Change > 0xFF) ? 2 : 1;
+      At = WriteReplayVarint(At, ((WordIndex - NextWord) << 2) | (ByteCount - 1));
+      for (uint32 ByteIndex = 0; ByteIndex < ByteCount; ++ByteIndex)
+      {
+        *At++ = (uint8)(Change >> (8*ByteIndex));
+      }
+      NextWord = WordIndex + 1;
+    }
+  }
+  memcpy(Previous, Frame, sizeof(replay_frame));
+  return(At);
+}
+
+/**
+ * Applique  Frame (l'image prcdente) la diffrence lue en At
+ * Renvoie la fin de la lecture, 0 si les donnes sont invalides.
+ **/
+internal uint8 *
+DecodeReplayFrame(uint8 *At, uint8 *End, replay_frame *Frame)
+{
+  uint32 *Words = (uint32 *)Frame;
+  uint32 ChangeCount = 0;
+  At = ReadReplayVarint(At, End, &ChangeCount);
+  uint32 NextWord = 0;
+  for (uint32 ChangeIndex = 0; At && (ChangeIndex < ChangeCount); ++ChangeIndex)
+  {
+    uint32 Code = 0;
+    At = ReadReplayVarint(At, End, &Code);
+    uint32 WordIndex = NextWord + (Code >> 2);
+    uint32 ByteCount = (Code & 3) + 1;
+    if (!At || (WordIndex >= ReplayFrameWordCount) || ((uint32)(End - At) < ByteCount))
+    {
+      At = 0;
+    }
+    else
+    {
+      uint32 Change = 0;
+      for (uint32 ByteIndex = 0; ByteIndex < ByteCount; ++ByteIndex)
+      {
+        Change |= (uint32)*At++ << (8*ByteIndex);
+      }
+      Words[WordIndex] ^= Change;
+      NextWord = WordIndex + 1;
+    }
+  }
+  return(At);
+}
+
+/**
+ * Dest = Source en OU exclusif avec Base, sur les BaseSize premiers
+ * octets ; au-del Source est recopi. Dest peut tre Source.
+ **/
+internal void
+XorReplayKeyframe(uint8 *Dest, uint8 *Source, uint64 Size, uint8 *Base, uint64 BaseSize)
+{
+  uint64 XorSize = (Size < BaseSize) ? Size : BaseSize;
+  uint64 Byte = 0;
+  for (; Byte + sizeof(uint64) <= XorSize; Byte += sizeof(uint64))
+  {
+    uint64 SourceWord;
+    uint64 BaseWord;
+    memcpy(&SourceWord, Source + Byte, sizeof(uint64));
+    memcpy(&BaseWord, Base + Byte, sizeof(uint64));
+    SourceWord ^= BaseWord;
+    memcpy(Dest + Byte, &SourceWord, sizeof(uint64));
+  }
+  for (; Byte < XorSize; ++Byte)
+  {
+    Dest[Byte] = Source[Byte] ^ Base[Byte];
+  }
+  if (Dest != Source)
+  {
+    memcpy(Dest + XorSize, Source + XorSize, (size_t)(Size - XorSize));
+  }
+}
+
+/*
+  Compression LZ des blocs
+
+  Suite de squences : un octet de tte (nombre de littraux en haut,
+  longueur de la copie moins ReplayLZMinMatch en bas, 15 : la suite dans
+  les octets suivants), les littraux, puis la distance de la copie sur 2
+  octets. La dernire squence n'a que des littraux.
+  Un seul passage, une table de hachage sur 4 octets : rapide plutt que
+  serr, les blocs sont dj petits.
+*/
+#define ReplayLZHashBits 12
+#define ReplayLZMinMatch 4
+#define ReplayLZMaxOffset 0xFFFF
+
+inline uint32
+GetLZMaxSize(uint32 Size)
+{
+  uint32 Result = Size + Size / 255 + 16;
+  return(Result);
+}
+
+inline uint8 *
+WriteLZLength(uint8 *At, uint32 Length)
+{
+  while (Length >= 255)
+  {
+    *At++ = 255;
+    Length -= 255;
+  }
+  *At++ = (uint8)Length;
+  return(At);
+}
+
+// MatchLength  0 : dernire squence
+internal uint8 *
+WriteLZSequence(uint8 *At, uint8 *Literals, uint32 LiteralCount, uint32 Offset, uint32 MatchLength)
+{
+  uint32 MatchCode = MatchLength ? (MatchLength - ReplayLZMinMatch) : 0;
+  *At++ = (uint8)((((LiteralCount < 15) ? LiteralCount : 15) << 4) | ((MatchCode < 15) ? MatchCode : 15));
+  if (LiteralCount >= 15) At = WriteLZLength(At, LiteralCount - 15);
+  memcpy(At, Literals, LiteralCount);
+  At += LiteralCount;
+  if (MatchLength)
+  {
+    *At++ = (uint8)Offset;
+    *At++ = (uint8)(Offset >> 8);
+    if (MatchCode >= 15) At = WriteLZLength(At, MatchCode - 15);
+  }
+  return(At);
+}
+
+/**
+ * Compresse Size octets dans Dest, qui doit contenir GetLZMaxSize(Size) octets
+ * Renvoie la taille compresse.
+ **/
+internal uint32
+CompressLZ(uint8 *Source, uint32 Size, uint8 *Dest)
+{
+  // Position + 1 de la dernire suite de 4 octets vue pour chaque empreinte, 0 : aucune
+  uint32 Table[1 << ReplayLZHashBits] = {};
+  uint8 *At = Dest;
+  uint32 Anchor = 0;
+  uint32 Position = 0;
+  while (Position + ReplayLZMinMatch <= Size)
+  {
+    uint32 Sequence;
+    memcpy(&Sequence, Source + Position, sizeof(Sequence));
+    uint32 Hash = (Sequence*2654435761u) >> (32 - ReplayLZHashBits);
+    uint32 Candidate = Table[Hash];
+    Table[Hash] = Position + 1;
+    if (Candidate && (Position - (Candidate - 1) <= ReplayLZMaxOffset) &&
+        (memcmp(Source + Candidate - 1, Source + Position, ReplayLZMinMatch) == 0))
+    {
+      uint32 Match = Candidate - 1;
+      uint32 Length = ReplayLZMinMatch;
+      while ((Position + Length < Size) && (Source[Match + Length] == Source[Position + Length])) ++Length;
+      At = WriteLZSequence(At, Source + Anchor, Position - Anchor, Position - Match, Length);
+      Position += Length;
+      Anchor = Position;
+    }
+    else
+    {
+      ++Position;
+    }
+  }
+  At = WriteLZSequence(At, Source + Anchor, Size - Anchor, 0, 0);
+  uint32 Result = (uint32)(At - Dest);
+  return(Result);
+}
+
+inline bool32
+ReadLZLength(uint8 **At, uint8 *End, uint32 *Length)
+{
+  bool32 Result = false;
+  while (*At < End)
+  {
+    uint8 Byte = *(*At)++;
+    *Length += Byte;
+    if (Byte != 255)
+    {
+      Result = true;
+      break;
+    }
+  }
+  return(Result);
+}
+
+/**
+ * Dcompresse exactement DestSize octets, false si les donnes sont invalides
+ **/
+internal bool32
+DecompressLZ(uint8 *Source, uint32 Size, uint8 *Dest, uint32 DestSize)
+{
+  uint8 *At = Source;
+  uint8 *End = Source + Size;
+  uint32 Written = 0;
+  bool32 IsValid = (Size > 0);
+  while (IsValid && (At < End))
+  {
+    uint32 Token = *At++;
+    uint32 LiteralCount = Token >> 4;
+    if (LiteralCount == 15) IsValid = ReadLZLength(&At, End, &LiteralCount);
+    IsValid = IsValid && ((uint32)(End - At) >= LiteralCount) && (DestSize - Written >= LiteralCount);
+    if (IsValid)
+    {
+      memcpy(Dest + Written, At, LiteralCount);
+      At += LiteralCount;
+      Written += LiteralCount;
+      if (At == End) break;
+
+      IsValid = ((End - At) >= 2);
+      uint32 Offset = IsValid ? (At[0] | ((uint32)At[1] << 8)) : 0;
+      At += 2;
+      uint32 MatchLength = Token & 15;
+      if (IsValid && (MatchLength == 15)) IsValid = ReadLZLength(&At, End, &MatchLength);
+      MatchLength += ReplayLZMinMatch;
+      IsValid = IsValid && (Offset > 0) && (Offset <= Written) && (DestSize - Written >= MatchLength);
+      if (IsValid)
+      {
+        // La copie peut recouvrir ce qu'elle crit : octet par octet
+        uint8 *Match = Dest + Written - Offset;
+        for (uint32 Index = 0; Index < MatchLength; ++Index)
+        {
+          Dest[Written + Index] = Match[Index];
+        }
+        Written += MatchLength;
+      }
+    }
+  }
+  bool32 Result = IsValid && (Written == DestSize);
+  return(Result);
+}
+
+#define FAITMAIN_REPLAY_H
+#endif
\ No newline at end of file
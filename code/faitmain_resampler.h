@@ -0,0 +1,176 @@
+#if !defined(FAITMAIN_RESAMPLER_H)
+
+/*
+  Rchantillonneur polyphase  sinc fentr (fentre de Kaiser)
+
+  Permet de mixer une source  n'importe quelle frquence vers la frquence
+  de la carte son. La position dans le signal source avance en virgule fixe
+  32.32, ce qui vite toute drive de hauteur quel que soit le rapport.
+  Le filtre est tabul pour ResamplerPhaseCount positions entre deux
+  chantillons, et on interpole linairement entre deux phases voisines.
+  La boucle interne (produit scalaire sur les taps) est en SSE, les deux
+  canaux partageant les mmes coefficients.
+  Ce fichier est partag entre le jeu et la couche plateforme.
+*/
+#include <emmintrin.h>
+
+#define ResamplerTapCount 32 // Puissance de 2, multiple de 4 pour SSE
+#define ResamplerPhaseBits 8
+#define ResamplerPhaseCount (1 << ResamplerPhaseBits)
+#define ResamplerOne (1ULL << 32)
+
+struct resampler
+{
+  int SourceRate;
+  int DestRate;
+  uint64 Increment; // Echantillons source par chantillon destination, en 32.32
+  uint64 Position;  // Fraction de l'chantillon source courant, en 32.32
+  int HistoryPos;
+  // Historique par canal crit deux fois pour toujours lire une fentre contigu
+  real32 History[2][2*ResamplerTapCount];
+  real32 Coefficients[(ResamplerPhaseCount + 1)*ResamplerTapCount];
+};
+
+// Fonction de Bessel modifie d'ordre 0, pour la fentre de Kaiser
+internal real64
+ResamplerBesselI0(real64 X)
+{
+  real64 Result = 1.0;
+  real64 Term = 1.0;
+  for(int K = 1; K < 32; ++K)
+  {
+    real64 Factor = X / (2.0*(real64)K);
+    Term *= Factor*Factor;
+    Result += Term;
+  }
+  return(Result);
+}
+
+internal void
+InitResampler(resampler *Resampler, int SourceRate, int DestRate)
+{
+  Assert((SourceRate > 0) && (DestRate > 0));
+  *Resampler = {};
+  Resampler->SourceRate = SourceRate;
+  Resampler->DestRate = DestRate;
+  Resampler->Increment = ((uint64)SourceRate << 32) / (uint64)DestRate;
+
+  // En sous-chantillonnage on coupe sous la nouvelle frquence de Nyquist
+  // pour viter le repliement, avec une marge pour la bande de transition
+  // A frquences gales la coupure  1 donne un simple retard, sans filtrage
+  real64 Cutoff = (DestRate < SourceRate) ? ((real64)DestRate / (real64)SourceRate) : 1.0;
+  if (SourceRate != DestRate) Cutoff *= 0.91;
+  real64 Beta = 9.0;
+  real64 HalfWidth = (real64)(ResamplerTapCount / 2);
+  real64 InvI0Beta = 1.0 / ResamplerBesselI0(Beta);
+  for(int Phase = 0; Phase <= ResamplerPhaseCount; ++Phase)
+  {
+    real64 Fraction = (real64)Phase / (real64)ResamplerPhaseCount;
+    real64 Taps[ResamplerTapCount];
+    real64 Sum = 0.0;
+    for(int Tap = 0; Tap < ResamplerTapCount; ++Tap)
+    {
+      // Distance entre l'chantillon du tap et l'instant  reconstruire
+      real64 Distance = (real64)(Tap - (ResamplerTapCount / 2 - 1)) - Fraction;
+      real64 X = Cutoff*Distance;
+      real64 Sinc = (X == 0.0) ? 1.0 : (sin(PI32*X) / (PI32*X));
+      real64 W = Distance / HalfWidth;
+      real64 Window = (W*W < 1.0) ? ResamplerBesselI0(Beta*sqrt(1.0 - W*W))*InvI0Beta : 0.0;
+      Taps[Tap] = Sinc*Window;
+      Sum += Taps[Tap];
+    }
+    // Gain unitaire en continu pour chaque phase
+    for(int Tap = 0; Tap < ResamplerTapCount; ++Tap)
+    {
+      Resampler->Coefficients[Phase*ResamplerTapCount + Tap] = (real32)(Taps[Tap] / Sum);
+    }
+  }
+}
+
+/*
+  Nombre exact d'chantillons source consomms pour produire DestFrameCount
+  chantillons : l'appelant doit fournir prcisment ce nombre  ResampleStereo
+*/
+inline int
+GetResamplerSourceFrameCount(resampler *Resampler, int DestFrameCount)
+{
+  int Result = 0;
+  if(DestFrameCount > 0)
+  {
+    Result = (int)((Resampler->Position + (uint64)(DestFrameCount - 1)*Resampler->Increment) >> 32);
+  }
+  return(Result);
+}
+
+inline void
+PushResamplerFrame(resampler *Resampler, real32 Left, real32 Right)
+{
+  int Pos = Resampler->HistoryPos;
+  Resampler->History[0][Pos] = Resampler->History[0][Pos + ResamplerTapCount] = Left;
+  Resampler->History[1][Pos] = Resampler->History[1][Pos + ResamplerTapCount] = Right;
+  Resampler->HistoryPos = (Pos + 1) & (ResamplerTapCount - 1);
+}
+
+inline real32
+HorizontalAdd(__m128 Value)
+{
+  __m128 Shuffled = _mm_shuffle_ps(Value, Value, _MM_SHUFFLE(2, 3, 0, 1));
+  __m128 Sum = _mm_add_ps(Value, Shuffled);
+  Shuffled = _mm_movehl_ps(Shuffled, Sum);
+  Sum = _mm_add_ss(Sum, Shuffled);
+  return(_mm_cvtss_f32(Sum));
+}
+
+/*
+  Rchantillonne une source int16 stro entrelace et l'ajoute au mix
+  Dest (float stro entrelac) avec le volume donn
+*/
+internal void
+ResampleStereo(resampler *Resampler,
+               int16 *Source, int SourceFrameCount,
+               real32 *Dest, int DestFrameCount, real32 Volume)
+{
+  int SourceIndex = 0;
+  real32 SourceScale = 1.0f / 32768.0f;
+  for(int DestIndex = 0; DestIndex < DestFrameCount; ++DestIndex)
+  {
+    while(Resampler->Position >= ResamplerOne)
+    {
+      Assert(SourceIndex < SourceFrameCount);
+      PushResamplerFrame(Resampler,
+                         (real32)Source[2*SourceIndex]*SourceScale,
+                         (real32)Source[2*SourceIndex + 1]*SourceScale);
+      ++SourceIndex;
+      Resampler->Position -= ResamplerOne;
+    }
+
+    uint32 Fraction = (uint32)Resampler->Position;
+    uint32 Phase = Fraction >> (32 - ResamplerPhaseBits);
+    real32 Blend = (real32)(Fraction & ((1 << (32 - ResamplerPhaseBits)) - 1)) *
+                   (1.0f / (real32)(1 << (32 - ResamplerPhaseBits)));
+    real32 *Coefficients0 = Resampler->Coefficients + Phase*ResamplerTapCount;
+    real32 *Coefficients1 = Coefficients0 + ResamplerTapCount;
+    real32 *Left = &Resampler->History[0][Resampler->HistoryPos];
+    real32 *Right = &Resampler->History[1][Resampler->HistoryPos];
+
+    __m128 BlendWide = _mm_set1_ps(Blend);
+    __m128 SumLeft = _mm_setzero_ps();
+    __m128 SumRight = _mm_setzero_ps();
+    for(int Tap = 0; Tap < ResamplerTapCount; Tap += 4)
+    {
+      __m128 C0 = _mm_loadu_ps(Coefficients0 + Tap);
+      __m128 C1 = _mm_loadu_ps(Coefficients1 + Tap);
+      __m128 C = _mm_add_ps(C0, _mm_mul_ps(_mm_sub_ps(C1, C0), BlendWide));
+      SumLeft = _mm_add_ps(SumLeft, _mm_mul_ps(_mm_loadu_ps(Left + Tap), C));
+      SumRight = _mm_add_ps(SumRight, _mm_mul_ps(_mm_loadu_ps(Right + Tap), C));
+    }
+    Dest[2*DestIndex] += Volume*HorizontalAdd(SumLeft);
+    Dest[2*DestIndex + 1] += Volume*HorizontalAdd(SumRight);
+
+    Resampler->Position += Resampler->Increment;
+  }
+  Assert(SourceIndex == SourceFrameCount);
+}
+
+#define FAITMAIN_RESAMPLER_H
+#endif
\ No newline at end of file
@@ -0,0 +1,553 @@
+#if !defined(FAITMAIN_ROLLBACK_H)
+
+/*
+  Session en rseau avec rollback : chaque joueur simule tout le jeu
+
+  Chaque joueur n'envoie que ses entres, compactes dans un net_input. La
+  simulation n'attend pas celles des joueurs distants : elle les prdit
+  (la dernire entre connue est rpte). Quand une entre arrive et
+  diffre de la prdiction avec laquelle l'image a t simule, l'tat
+  d'avant cette image est restaur et les images jusqu' l'image courante
+  sont resimules avec les entres connues.
+
+  L'tat de chaque image est sauvegard dans un anneau de
+  RollbackSnapshotCount copies : seule la partie simule de la mmoire
+  permanente est copie (voir game_memory.SimulatedStateSize), pas les
+  arnes vides ni la mmoire transitoire. Une session ne prend pas plus de
+  RollbackMaxFrames images d'avance sur les entres reues d'un joueur :
+  au-del elle attend, une correction ne remonte jamais plus loin que
+  l'anneau.
+
+  Chaque paquet reprend toutes les entres du joueur que le destinataire
+  n'a pas encore confirmes : un paquet perdu est rattrap par le suivant,
+  sans renvoi. La mme entre donne le mme tat chez tous les joueurs :
+  la simulation est dterministe et chaque image dure FrameSeconds partout.
+
+  Ce fichier ne dpend pas de la plateforme : les sockets sont fournies par
+  la couche plateforme. net_loopback simule un rseau (latence, gigue,
+  pertes) entre des sessions d'un mme processus, pour les tests.
+*/
+#include <string.h> // memcpy
+
+#define RollbackMaxPlayers 4
+#define RollbackMaxFrames 8 // Profondeur maximale d'une correction
+#define RollbackSnapshotCount (RollbackMaxFrames + 1)
+#define RollbackInputHistory 64 // Puissance de 2
+#define RollbackPacketMaxInputs 24
+#define RollbackPacketMagic 0x4E424C52 // "RLBN"
+
+enum net_input_flag
+{
+  NetInput_Connected = 0x1,
+  NetInput_Analog = 0x2,
+};
+
+// Les entres d'un joueur pour une image : un bit par bouton, le stick sur 8 bits
+struct net_input
+{
+  uint16 Buttons;
+  int8 StickX;
+  int8 StickY;
+  uint8 Flags;
+  uint8 Pad[3];
+};
+
+struct rollback_packet_header
+{
+  uint32 Magic;
+  uint8 Player; // Celui qui envoie
+  uint8 PlayerCount;
+  uint8 InputCount;
+  uint8 Pad;
+  uint32 FirstFrame; // Image de la premire entre du paquet
+  // L'envoyeur a reu toutes les entres du destinataire avant cette image
+  uint32 AckFrame;
+};
+
+#define RollbackMaxPacketSize (sizeof(rollback_packet_header) + RollbackPacketMaxInputs*sizeof(net_input))
+
+struct rollback_player
+{
+  // Indexes par Frame & (RollbackInputHistory - 1)
+  net_input Inputs[RollbackInputHistory];
+  // Joueur distant : l'entre prdite avec laquelle chaque image a t simule
+  net_input Predicted[RollbackInputHistory];
+  // Les entres des images avant ConfirmedFrame sont connues
+  uint32 ConfirmedFrame;
+  // Joueur distant : il a reu nos entres des images avant AckedFrame
+  uint32 AckedFrame;
+};
+
+struct rollback_snapshot
+{
+  uint32 Frame;
+  uint64 Size;
+  bool32 IsValid;
+  // Paresseuse si la plateforme n'a que rserv la mmoire : seules les pages copies sont engages
+  memory_arena Arena;
+};
+
+struct rollback_session
+{
+  uint32 PlayerCount;
+  uint32 LocalPlayer;
+  real32 FrameSeconds;
+
+  // Prochaine image  simuler
+  uint32 CurrentFrame;
+  // Premire image simule avec une mauvaise prdiction, CurrentFrame si aucune
+  uint32 RollbackFrame;
+
+  rollback_player Players[RollbackMaxPlayers];
+  rollback_snapshot Snapshots[RollbackSnapshotCount];
+
+  // Statistiques de la session
+  uint32 RollbackCount;
+  uint32 ResimulatedFrameCount;
+  uint32 MaxRollbackDepth;
+  uint32 StallCount;
+  uint32 PacketCount;
+  uint32 RejectedPacketCount;
+};
+
+/*
+  Entres
+*/
+
+inline int8
+QuantizeStick(real32 Value)
+{
+  if (Value > 1.0f) Value = 1.0f;
+  if (Value < -1.0f) Value = -1.0f;
+  int8 Result = (int8)(Value*127.0f + ((Value < 0.0f) ? -0.5f : 0.5f));
+  return(Result);
+}
+
+/**
+ * Entres de toutes les manettes locales d'un joueur runies : les boutons
+ * de l'une ou l'autre, le stick de la premire manette analogique
+ **/
+inline net_input
+EncodeNetInput(game_input *Input)
+{
+  net_input Result = {};
+  for (uint32 ControllerIndex = 0; ControllerIndex < ArrayCount(Input->Controllers); ++ControllerIndex)
+  {
+    game_controller_input *Controller = Input->Controllers + ControllerIndex;
+    if (!Controller->IsConnected) continue;
+
+    Result.Flags = (uint8)(Result.Flags | NetInput_Connected);
+    for (uint32 ButtonIndex = 0; ButtonIndex < ArrayCount(Controller->Buttons); ++ButtonIndex)
+    {
+      if (Controller->Buttons[ButtonIndex].EndedDown) Result.Buttons |= (uint16)(1 << ButtonIndex);
+    }
+    if (Controller->IsAnalog && !(Result.Flags & NetInput_Analog))
+    {
+      Result.Flags = (uint8)(Result.Flags | NetInput_Analog);
+      Result.StickX = QuantizeStick(Controller->StickAverageX);
+      Result.StickY = QuantizeStick(Controller->StickAverageY);
+    }
+  }
+  return(Result);
+}
+
+/**
+ * La manette d'un joueur telle que la voit le jeu
+ * Previous, l'entre de l'image prcdente, donne les transitions.
+ **/
+inline void
+DecodeNetInput(net_input Input, net_input Previous, game_controller_input *Controller)
+{
+  Controller->IsConnected = (Input.Flags & NetInput_Connected) ? true : false;
+  Controller->IsAnalog = (Input.Flags & NetInput_Analog) ? true : false;
+  Controller->StickAverageX = (real32)Input.StickX / 127.0f;
+  Controller->StickAverageY = (real32)Input.StickY / 127.0f;
+  for (uint32 ButtonIndex = 0; ButtonIndex < ArrayCount(Controller->Buttons); ++ButtonIndex)
+  {
+    uint16 Bit = (uint16)(1 << ButtonIndex);
+    Controller->Buttons[ButtonIndex].EndedDown = (Input.Buttons & Bit) ? true : false;
+    Controller->Buttons[ButtonIndex].HalfTransitionCount = ((Input.Buttons ^ Previous.Buttons) & Bit) ? 1 : 0;
+  }
+}
+
+inline bool32
+NetInputsAreEqual(net_input A, net_input B)
+{
+  bool32 Result = ((A.Buttons == B.Buttons) && (A.StickX == B.StickX) &&
+                   (A.StickY == B.StickY) && (A.Flags == B.Flags));
+  return(Result);
+}
+
+/*
+  Session
+*/
+
+/**
+ * SnapshotMemory contient RollbackSnapshotCount blocs de SnapshotSize
+ * octets, ou vaut 0 pour une session qui ne simule pas (joueur de test).
+ * Avec CommitMemory elle n'est que rserve.
+ **/
+internal void
+InitializeRollbackSession(rollback_session *Session, uint32 PlayerCount, uint32 LocalPlayer, real32 FrameSeconds,
+                          void *SnapshotMemory, uint64 SnapshotSize, platform_commit_memory *CommitMemory)
+{
+  Assert((PlayerCount <= RollbackMaxPlayers) && (LocalPlayer < PlayerCount));
+  memset(Session, 0, sizeof(*Session));
+  Session->PlayerCount = PlayerCount;
+  Session->LocalPlayer = LocalPlayer;
+  Session->FrameSeconds = FrameSeconds;
+  if (SnapshotMemory)
+  {
+    for (uint32 SnapshotIndex = 0; SnapshotIndex < RollbackSnapshotCount; ++SnapshotIndex)
+    {
+      uint8 *Base = (uint8 *)SnapshotMemory + SnapshotIndex*SnapshotSize;
+      memory_arena *Arena = &Session->Snapshots[SnapshotIndex].Arena;
+      if (CommitMemory)
+      {
+        InitializeLazyArena(Arena, SnapshotSize, Base, CommitMemory);
+      }
+      else
+      {
+        InitializeArena(Arena, SnapshotSize, Base);
+      }
+    }
+  }
+}
+
+inline bool32
+IsRemotePlayer(rollback_session *Session, uint32 Player)
+{
+  bool32 Result = ((Player < Session->PlayerCount) && (Player != Session->LocalPlayer));
+  return(Result);
+}
+
+// L'entre connue du joueur, sinon la prdiction : la dernire entre connue
+inline net_input
+GetRollbackInput(rollback_session *Session, uint32 Player, uint32 Frame)
+{
+  rollback_player *State = Session->Players + Player;
+  net_input Result = {};
+  if (Frame < State->ConfirmedFrame)
+  {
+    Result = State->Inputs[Frame & (RollbackInputHistory - 1)];
+  }
+  else if (State->ConfirmedFrame > 0)
+  {
+    Result = State->Inputs[(State->ConfirmedFrame - 1) & (RollbackInputHistory - 1)];
+  }
+  return(Result);
+}
+
+/**
+ * Les entres de tous les joueurs pour Frame, joueur p sur la manette p
+ * Les prdictions utilises sont gardes pour tre compares aux vraies.
+ **/
+internal void
+GetRollbackFrameInput(rollback_session *Session, uint32 Frame, game_input *Input)
+{
+  memset(Input, 0, sizeof(*Input));
+  Input->dtForFrame = Session->FrameSeconds;
+  for (uint32 Player = 0; Player < Session->PlayerCount; ++Player)
+  {
+    net_input Current = GetRollbackInput(Session, Player, Frame);
+    net_input Previous = {};
+    if (Frame > 0) Previous = GetRollbackInput(Session, Player, Frame - 1);
+    rollback_player *State = Session->Players + Player;
+    if (Frame >= State->ConfirmedFrame)
+    {
+      State->Predicted[Frame & (RollbackInputHistory - 1)] = Current;
+    }
+    DecodeNetInput(Current, Previous, GetController(Input, Player));
+  }
+}
+
+// Faux tant qu'un joueur distant a RollbackMaxFrames images de retard : il faut l'attendre
+// (sans soustraction : un joueur en avance a ConfirmedFrame > CurrentFrame)
+inline bool32
+CanAdvanceRollbackSession(rollback_session *Session)
+{
+  bool32 Result = true;
+  for (uint32 Player = 0; Player < Session->PlayerCount; ++Player)
+  {
+    if (IsRemotePlayer(Session, Player) &&
+        (Session->Players[Player].ConfirmedFrame + RollbackMaxFrames <= Session->CurrentFrame))
+    {
+      Result = false;
+    }
+  }
+  return(Result);
+}
+
+// L'entre du joueur local pour l'image courante
+inline void
+AddLocalRollbackInput(rollback_session *Session, net_input Input)
+{
+  rollback_player *Local = Session->Players + Session->LocalPlayer;
+  Local->Inputs[Session->CurrentFrame & (RollbackInputHistory - 1)] = Input;
+  Local->ConfirmedFrame = Session->CurrentFrame + 1;
+}
+
+/*
+  Paquets
+*/
+
+/**
+ * Paquet pour un joueur distant : nos entres qu'il n'a pas confirmes,
+ * au plus les RollbackPacketMaxInputs dernires. Renvoie sa taille.
+ **/
+internal uint32
+BuildRollbackPacket(rollback_session *Session, uint32 ToPlayer, uint8 *Packet)
+{
+  Assert(IsRemotePlayer(Session, ToPlayer));
+  rollback_player *Local = Session->Players + Session->LocalPlayer;
+  rollback_player *Remote = Session->Players + ToPlayer;
+  uint32 FirstFrame = Remote->AckedFrame;
+  if (Local->ConfirmedFrame - FirstFrame > RollbackPacketMaxInputs)
+  {
+    FirstFrame = Local->ConfirmedFrame - RollbackPacketMaxInputs;
+  }
+
+  rollback_packet_header Header = {};
+  Header.Magic = RollbackPacketMagic;
+  Header.Player = (uint8)Session->LocalPlayer;
+  Header.PlayerCount = (uint8)Session->PlayerCount;
+  Header.InputCount = (uint8)(Local->ConfirmedFrame - FirstFrame);
+  Header.FirstFrame = FirstFrame;
+  Header.AckFrame = Remote->ConfirmedFrame;
+  memcpy(Packet, &Header, sizeof(Header));
+  net_input *Inputs = (net_input *)(Packet + sizeof(Header));
+  for (uint32 Index = 0; Index < Header.InputCount; ++Index)
+  {
+    Inputs[Index] = Local->Inputs[(FirstFrame + Index) & (RollbackInputHistory - 1)];
+  }
+  uint32 Result = (uint32)(sizeof(Header) + Header.InputCount*sizeof(net_input));
+  return(Result);
+}
+
+/**
+ * Prend les nouvelles entres d'un paquet, dans l'ordre des images. Une
+ * entre qui dment une prdiction dj simule fait reculer RollbackFrame.
+ * Renvoie false pour un paquet qui n'est pas de cette session.
+ **/
+internal bool32
+ReceiveRollbackPacket(rollback_session *Session, uint8 *Packet, uint32 Size)
+{
+  rollback_packet_header Header;
+  bool32 Result = (Size >= sizeof(Header));
+  if (Result)
+  {
+    memcpy(&Header, Packet, sizeof(Header));
+    Result = ((Header.Magic == RollbackPacketMagic) && (Header.PlayerCount == Session->PlayerCount) &&
+              IsRemotePlayer(Session, Header.Player) && (Header.InputCount <= RollbackPacketMaxInputs) &&
+              (Size == sizeof(Header) + Header.InputCount*sizeof(net_input)));
+  }
+
+  if (Result)
+  {
+    rollback_player *Remote = Session->Players + Header.Player;
+    uint32 LocalConfirmedFrame = Session->Players[Session->LocalPlayer].ConfirmedFrame;
+    if ((Header.AckFrame > Remote->AckedFrame) && (Header.AckFrame <= LocalConfirmedFrame))
+    {
+      Remote->AckedFrame = Header.AckFrame;
+    }
+
+    net_input *Inputs = (net_input *)(Packet + sizeof(Header));
+    for (uint32 Index = 0; Index < Header.InputCount; ++Index)
+    {
+      uint32 Frame = Header.FirstFrame + Index;
+      // Dj connue, ou aprs un trou : le prochain paquet reprendra  partir du trou
+      if (Frame < Remote->ConfirmedFrame) continue;
+      if ((Frame > Remote->ConfirmedFrame) ||
+          (Frame >= Session->CurrentFrame + RollbackInputHistory / 2)) break;
+
+      net_input Input;
+      memcpy(&Input, Inputs + Index, sizeof(Input));
+      uint32 Slot = Frame & (RollbackInputHistory - 1);
+      Remote->Inputs[Slot] = Input;
+      if ((Frame < Session->CurrentFrame) && !NetInputsAreEqual(Input, Remote->Predicted[Slot]) &&
+          (Frame < Session->RollbackFrame))
+      {
+        Session->RollbackFrame = Frame;
+      }
+      ++Remote->ConfirmedFrame;
+    }
+    ++Session->PacketCount;
+  }
+  else
+  {
+    ++Session->RejectedPacketCount;
+  }
+  return(Result);
+}
+
+/*
+  Sauvegardes de l'tat et resimulation
+*/
+
+inline void
+SaveRollbackSnapshot(rollback_session *Session, uint32 Frame, game_memory *Memory)
+{
+  rollback_snapshot *Snapshot = Session->Snapshots + (Frame % RollbackSnapshotCount);
+  Snapshot->Arena.Used = 0;
+  void *Dest = PushSize_(&Snapshot->Arena, Memory->SimulatedStateSize, 64);
+  memcpy(Dest, (uint8 *)Memory->PermanentStorage + Memory->SimulatedStateFirstByte,
+         Memory->SimulatedStateSize);
+  Snapshot->Frame = Frame;
+  Snapshot->Size = Memory->SimulatedStateSize;
+  Snapshot->IsValid = true;
+}
+
+// L'tat d'avant Frame, false s'il n'est plus dans l'anneau
+inline bool32
+RestoreRollbackSnapshot(rollback_session *Session, uint32 Frame, game_memory *Memory)
+{
+  rollback_snapshot *Snapshot = Session->Snapshots + (Frame % RollbackSnapshotCount);
+  bool32 Result = (Snapshot->IsValid && (Snapshot->Frame == Frame));
+  if (Result)
+  {
+    memcpy((uint8 *)Memory->PermanentStorage + Memory->SimulatedStateFirstByte,
+           Snapshot->Arena.Base + (Snapshot->Arena.Used - Snapshot->Size), Snapshot->Size);
+    Memory->SimulatedStateSize = Snapshot->Size;
+  }
+  return(Result);
+}
+
+/**
+ * Corrige les images simules avec une mauvaise prdiction : restaure
+ * l'tat d'avant RollbackFrame et resimule jusqu' l'image courante, en
+ * sauvegardant l'tat de chaque image. Renvoie le nombre d'images
+ * resimules.
+ **/
+internal uint32
+ResimulateRollbackFrames(rollback_session *Session, game_memory *Memory, game_simulate_frame *SimulateFrame)
+{
+  uint32 Result = 0;
+  if (Session->RollbackFrame < Session->CurrentFrame)
+  {
+    bool32 Restored = RestoreRollbackSnapshot(Session, Session->RollbackFrame, Memory);
+    Assert(Restored);
+    game_input Input;
+    for (uint32 Frame = Session->RollbackFrame; Frame < Session->CurrentFrame; ++Frame)
+    {
+      GetRollbackFrameInput(Session, Frame, &Input);
+      SimulateFrame(Memory, &Input);
+      if (Frame + 1 < Session->CurrentFrame) SaveRollbackSnapshot(Session, Frame + 1, Memory);
+      ++Result;
+    }
+    ++Session->RollbackCount;
+    Session->ResimulatedFrameCount += Result;
+    if (Result > Session->MaxRollbackDepth) Session->MaxRollbackDepth = Result;
+    Session->RollbackFrame = Session->CurrentFrame;
+  }
+  return(Result);
+}
+
+/**
+ * Dbut de l'image courante : l'tat d'avant est sauvegard et Input reoit
+ * les entres de tous les joueurs, prdites pour les distants. Renvoie
+ * false si la session doit attendre un joueur : l'image n'avance pas.
+ **/
+internal bool32
+BeginRollbackFrame(rollback_session *Session, game_memory *Memory, net_input LocalInput, game_input *Input)
+{
+  bool32 Result = CanAdvanceRollbackSession(Session);
+  if (Result)
+  {
+    AddLocalRollbackInput(Session, LocalInput);
+    SaveRollbackSnapshot(Session, Session->CurrentFrame, Memory);
+    GetRollbackFrameInput(Session, Session->CurrentFrame, Input);
+  }
+  else
+  {
+    ++Session->StallCount;
+  }
+  return(Result);
+}
+
+// Aprs la simulation de l'image commence par BeginRollbackFrame
+inline void
+EndRollbackFrame(rollback_session *Session)
+{
+  ++Session->CurrentFrame;
+  Session->RollbackFrame = Session->CurrentFrame;
+}
+
+/*
+  Rseau simul entre des sessions d'un mme processus
+*/
+
+#define LoopbackMaxPackets 512
+
+struct loopback_packet
+{
+  real64 DeliveryTime;
+  uint32 FromPlayer;
+  uint32 ToPlayer;
+  uint32 Size;
+  uint8 Data[RollbackMaxPacketSize];
+};
+
+struct net_loopback
+{
+  real32 LatencySeconds;
+  real32 JitterSeconds; // Ajoute au hasard  la latence : les paquets arrivent dans le dsordre
+  real32 LossRatio;
+  uint32 Random;
+
+  uint32 PacketCount;
+  loopback_packet Packets[LoopbackMaxPackets];
+
+  uint32 SentCount;
+  uint32 LostCount;
+};
+
+inline real32
+LoopbackRandom01(net_loopback *Loopback)
+{
+  Loopback->Random = Loopback->Random*1664525 + 1013904223;
+  real32 Result = (real32)(Loopback->Random >> 8) / (real32)(1 << 24);
+  return(Result);
+}
+
+internal void
+SendLoopbackPacket(net_loopback *Loopback, uint32 FromPlayer, uint32 ToPlayer,
+                   void *Data, uint32 Size, real64 Now)
+{
+  Assert(Size <= RollbackMaxPacketSize);
+  ++Loopback->SentCount;
+  if ((LoopbackRandom01(Loopback) < Loopback->LossRatio) || (Loopback->PacketCount == LoopbackMaxPackets))
+  {
+    ++Loopback->LostCount;
+  }
+  else
+  {
+    loopback_packet *Packet = Loopback->Packets + Loopback->PacketCount++;
+    Packet->DeliveryTime = Now + Loopback->LatencySeconds + Loopback->JitterSeconds*LoopbackRandom01(Loopback);
+    Packet->FromPlayer = FromPlayer;
+    Packet->ToPlayer = ToPlayer;
+    Packet->Size = Size;
+    memcpy(Packet->Data, Data, Size);
+  }
+}
+
+// Un paquet arriv pour ToPlayer, copi dans Data : renvoie sa taille, 0 si aucun
+internal uint32
+ReceiveLoopbackPacket(net_loopback *Loopback, uint32 ToPlayer, real64 Now, uint8 *Data, uint32 DataSize)
+{
+  uint32 Result = 0;
+  for (uint32 Index = 0; Index < Loopback->PacketCount; ++Index)
+  {
+    loopback_packet *Packet = Loopback->Packets + Index;
+    if ((Packet->ToPlayer == ToPlayer) && (Packet->DeliveryTime <= Now) && (Packet->Size <= DataSize))
+    {
+      memcpy(Data, Packet->Data, Packet->Size);
+      Result = Packet->Size;
+      *Packet = Loopback->Packets[--Loopback->PacketCount];
+      break;
+    }
+  }
+  return(Result);
+}
+
+#define FAITMAIN_ROLLBACK_H
+#endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+/*
+  Scripts : cration et ordonnancement des coroutines, sous un budget par pas
+*/
+
+internal void
+InitializeScriptScheduler(script_scheduler *Scheduler, memory_arena *Arena, uint32 MaxCount, int32 WorkBudget)
+{
+  Scheduler->MaxCount = MaxCount;
+  Scheduler->RunningCount = 0;
+  Scheduler->Scripts = PushArray(Arena, MaxCount, script);
+  Scheduler->Frames = (uint8 *)PushSize(Arena, (uint64)MaxCount*ScriptMaxFrameSize);
+  Scheduler->WorkBudget = WorkBudget;
+  Scheduler->LastWork = 0;
+  Scheduler->LastResumeCount = 0;
+  Scheduler->LastDeferredCount = 0;
+  for (uint32 Index = 0; Index < MaxCount; ++Index)
+  {
+    Scheduler->Scripts[Index].IsRunning = false;
+  }
+}
+
+/**
+ * Nouveau script, repris pour la premire fois au pas StepIndex
+ * Renvoie son cadre, mis  zro, ou 0 si l'ordonnanceur est plein
+ **/
+internal void *
+StartScript(script_scheduler *Scheduler, uint32 Type, uint32 FrameSize, uint64 StepIndex)
+{
+  Assert(FrameSize <= ScriptMaxFrameSize);
+  void *Result = 0;
+  for (uint32 Index = 0; !Result && (Index < Scheduler->MaxCount); ++Index)
+  {
+    script *Script = Scheduler->Scripts + Index;
+    if (!Script->IsRunning)
+    {
+      Script->IsRunning = true;
+      Script->Type = Type;
+      Script->ResumePoint = 0;
+      Script->Pad = 0;
+      Script->WakeStep = StepIndex;
+      Result = Scheduler->Frames + (size_t)Index*ScriptMaxFrameSize;
+      memset(Result, 0, ScriptMaxFrameSize);
+      ++Scheduler->RunningCount;
+    }
+  }
+  return(Result);
+}
+
+// Le script veill qui attend depuis le plus longtemps, MaxCount s'il n'y en a pas
+internal uint32
+GetNextScript(script_scheduler *Scheduler, uint64 StepIndex)
+{
+  uint32 Result = Scheduler->MaxCount;
+  uint64 OldestWakeStep = StepIndex;
+  for (uint32 Index = 0; Index < Scheduler->MaxCount; ++Index)
+  {
+    script *Script = Scheduler->Scripts + Index;
+    if (Script->IsRunning && (Script->WakeStep <= OldestWakeStep) &&
+        ((Result == Scheduler->MaxCount) || (Script->WakeStep < OldestWakeStep)))
+    {
+      Result = Index;
+      OldestWakeStep = Script->WakeStep;
+    }
+  }
+  return(Result);
+}
+
+/**
+ * Un pas : les scripts veills sont repris, le plus anciennement veill
+ * d'abord, jusqu' puisement du budget. Un script repris ne l'est plus
+ * pendant ce pas. Un script qui ne vrifie pas son budget peut le dpasser,
+ * les suivants sont alors reports au pas suivant.
+ **/
+internal void
+RunScripts(script_scheduler *Scheduler, script_function **Functions, uint32 FunctionCount,
+           void *Game, uint64 StepIndex)
+{
+  script_context Context;
+  Context.Scheduler = Scheduler;
+  Context.Game = Game;
+  Context.StepIndex = StepIndex;
+  Context.WorkLeft = Scheduler->WorkBudget;
+
+  uint32 ResumeCount = 0;
+  uint32 Index = GetNextScript(Scheduler, StepIndex);
+  while ((Index < Scheduler->MaxCount) && (Context.WorkLeft > 0))
+  {
+    script *Script = Scheduler->Scripts + Index;
+    Assert(Script->Type < FunctionCount);
+    Context.Script = Script;
+    Context.Frame = Scheduler->Frames + (size_t)Index*ScriptMaxFrameSize;
+    Functions[Script->Type](&Context);
+    if (!Script->IsRunning) --Scheduler->RunningCount;
+    ++ResumeCount;
+    Index = GetNextScript(Scheduler, StepIndex);
+  }
+
+  // Les scripts encore veills sont reports au pas suivant
+  uint32 DeferredCount = 0;
+  for (uint32 ScriptIndex = 0; ScriptIndex < Scheduler->MaxCount; ++ScriptIndex)
+  {
+    script *Script = Scheduler->Scripts + ScriptIndex;
+    if (Script->IsRunning && (Script->WakeStep <= StepIndex)) ++DeferredCount;
+  }
+  Scheduler->LastWork = Scheduler->WorkBudget - Context.WorkLeft;
+  Scheduler->LastResumeCount = ResumeCount;
+  Scheduler->LastDeferredCount = DeferredCount;
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#if !defined(FAITMAIN_SCRIPT_H)
+
+/*
+  Scripts : coroutines sans pile pour les comportements qui durent plusieurs pas
+
+  Un script est une fonction qui reprend l o elle s'tait arrte : son
+  corps est un switch sur le point de reprise, chaque suspension enregistre
+  sa ligne et ressort de la fonction. Le script n'a pas de pile  lui : ce
+  qui doit survivre  une suspension vit dans son cadre, un bloc de
+  ScriptMaxFrameSize octets pris dans l'arne  la cration de l'ordonnanceur.
+  Les variables locales de la fonction sont perdues  chaque suspension, et
+  une variable dclare dans le corps ne doit pas enjamber une suspension.
+
+  A chaque pas de simulation, l'ordonnanceur reprend les scripts veills
+  tant qu'il reste du budget, le plus anciennement veill d'abord : un
+  script report faute de budget passe devant au pas suivant. Le budget est
+  compt en units de travail que les scripts dclarent eux-mmes
+  (SCRIPT_WORK), pas  l'horloge : la simulation doit rester reproductible
+  pour le rollback et la relecture. Un script long vrifie son budget
+  (SCRIPT_CHECK_BUDGET) et finit son travail aux pas suivants.
+
+  Les scripts et leurs cadres ne contiennent pas de pointeurs : ils font
+  partie de l'tat simul, sauvegard et compar octet par octet.
+*/
+
+#define ScriptMaxFrameSize 256
+
+struct script
+{
+  bool32 IsRunning;
+  uint32 Type;        // Index de la fonction du script dans la table passe  RunScripts
+  uint32 ResumePoint; // 0 : dbut du script, sinon la ligne de la dernire suspension
+  uint32 Pad;
+  uint64 WakeStep;    // Pas de simulation  partir duquel le script peut reprendre
+};
+
+struct script_scheduler
+{
+  uint32 MaxCount;
+  uint32 RunningCount;
+  script *Scripts;
+  uint8 *Frames; // Le cadre du script Index est  Frames + Index*ScriptMaxFrameSize
+
+  int32 WorkBudget; // Units de travail par pas
+
+  // Dernier pas, pour l'affichage et les mesures
+  int32 LastWork;
+  uint32 LastResumeCount;
+  uint32 LastDeferredCount;
+};
+
+struct script_context
+{
+  script_scheduler *Scheduler;
+  script *Script;
+  void *Frame;
+  void *Game; // Donn  RunScripts, l'tat du jeu pour les scripts du jeu
+  uint64 StepIndex;
+  int32 WorkLeft;
+};
+
+#define SCRIPT_FUNCTION(name) void name(script_context *Context)
+typedef SCRIPT_FUNCTION(script_function);
+
+/*
+  Corps d'un script, entre SCRIPT_BEGIN et SCRIPT_END. Les points de reprise
+  sont des numros de ligne : deux suspensions ne peuvent pas tre sur la
+  mme ligne (et pas d'Edit and Continue, /ZI, qui rend __LINE__ variable).
+*/
+#define SCRIPT_BEGIN(Context) switch ((Context)->Script->ResumePoint) { case 0:
+#define SCRIPT_END(Context) } (Context)->Script->IsRunning = false
+
+// Rend la main pour StepCount pas, au moins 1 (0 ou ngatif : 1) : le script reprend ici
+#define SCRIPT_WAIT_STEPS(Context, StepCount) \
+  do { \
+    (Context)->Script->WakeStep = (Context)->StepIndex + (((StepCount) > 0) ? (uint64)(StepCount) : 1); \
+    (Context)->Script->ResumePoint = __LINE__; return; case __LINE__:; \
+  } while (0)
+
+// Rend la main jusqu'au prochain pas
+#define SCRIPT_YIELD(Context) SCRIPT_WAIT_STEPS(Context, 1)
+
+// Compte le travail fait depuis la dernire vrification
+#define SCRIPT_WORK(Context, Units) ((Context)->WorkLeft -= (int32)(Units))
+
+// Budget du pas puis : la suite au prochain pas
+#define SCRIPT_CHECK_BUDGET(Context) \
+  do { if ((Context)->WorkLeft <= 0) { SCRIPT_YIELD(Context); } } while (0)
+
+#define FAITMAIN_SCRIPT_H
+#endif
\ No newline at end of file
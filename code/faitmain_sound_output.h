@@ -0,0 +1,186 @@
+#if !defined(FAITMAIN_SOUND_OUTPUT_H)
+
+/*
+  Etage de sortie du son : du mix flottant au buffer circulaire de la carte
+
+  - Conversion flottant -> int16 en SSE, avec saturation et dither TPDF
+    optionnel (somme de deux bruits uniformes, +-1 LSB au plus). Le dither
+    dcorrle l'erreur de quantification du signal : les fondus et les sons
+    trs faibles ne deviennent pas une distorsion audible.
+    Le bruit vient d'un xorshift par voie SSE, qui n'utilise que des
+    dcalages et des xor (pas de multiplication 32 bits en SSE2).
+  - Copie dans un buffer circulaire : une criture qui passe la fin du
+    buffer est coupe en deux rgions (comme le Lock de DirectSound), chacune
+    copie d'un bloc avec memcpy.
+  Les chantillons sont entrelacs (gauche, droite) d'un bout  l'autre :
+  le mixeur produit dj des frames entrelaces.
+  Ce fichier est partag entre le jeu et la couche plateforme.
+*/
+#include <emmintrin.h>
+#include <string.h>
+
+struct sound_dither
+{
+  uint32 State[4]; // Un xorshift par voie SSE, jamais nul
+};
+
+inline void
+InitializeSoundDither(sound_dither *Dither, uint32 Seed)
+{
+  for (int Lane = 0; Lane < 4; ++Lane)
+  {
+    // Graines diffrentes par voie, le xorshift reste bloqu sur 0
+    Seed = Seed*1664525 + 1013904223;
+    Dither->State[Lane] = Seed ? Seed : 1;
+  }
+}
+
+inline uint32
+NextSoundDitherScalar(uint32 *State)
+{
+  uint32 X = *State;
+  X ^= X << 13;
+  X ^= X >> 17;
+  X ^= X << 5;
+  *State = X;
+  return(X);
+}
+
+inline __m128i
+NextSoundDitherWide(__m128i *State)
+{
+  __m128i X = *State;
+  X = _mm_xor_si128(X, _mm_slli_epi32(X, 13));
+  X = _mm_xor_si128(X, _mm_srli_epi32(X, 17));
+  X = _mm_xor_si128(X, _mm_slli_epi32(X, 5));
+  *State = X;
+  return(X);
+}
+
+// 23 bits alatoires comme mantisse d'un flottant dans [1, 2)
+inline __m128
+SoundDitherToUnitWide(__m128i Random)
+{
+  __m128i Bits = _mm_or_si128(_mm_srli_epi32(Random, 9), _mm_set1_epi32(0x3F800000));
+  __m128 Result = _mm_castsi128_ps(Bits);
+  return(Result);
+}
+
+inline real32
+SoundDitherToUnit(uint32 Random)
+{
+  uint32 Bits = (Random >> 9) | 0x3F800000;
+  real32 Result;
+  memcpy(&Result, &Bits, sizeof(Result));
+  return(Result);
+}
+
+/**
+ * Conversion de SampleCount chantillons flottants ([-1, 1]) en int16
+ * DitherAmplitude est en LSB : 1 pour un dither TPDF standard, 0 sans dither
+ * (le rsultat est alors l'arrondi exact, satur)
+ **/
+internal void
+ConvertSamplesToInt16(int16 *Dest, real32 *Source, uint32 SampleCount,
+                      sound_dither *Dither, real32 DitherAmplitude)
+{
+  __m128 Scale = _mm_set1_ps(32767.0f);
+  __m128 Min = _mm_set1_ps(-32768.0f);
+  __m128 Max = _mm_set1_ps(32767.0f);
+  __m128 Amplitude = _mm_set1_ps(DitherAmplitude);
+  // Deux tirages dans [1, 2) : leur diffrence est triangulaire dans (-1, 1)
+  __m128i State = _mm_loadu_si128((__m128i *)Dither->State);
+
+  uint32 Index = 0;
+  for (; Index + 8 <= SampleCount; Index += 8)
+  {
+    __m128 A = _mm_mul_ps(_mm_loadu_ps(Source + Index), Scale);
+    __m128 B = _mm_mul_ps(_mm_loadu_ps(Source + Index + 4), Scale);
+    __m128 NoiseA = _mm_sub_ps(SoundDitherToUnitWide(NextSoundDitherWide(&State)),
+                               SoundDitherToUnitWide(NextSoundDitherWide(&State)));
+    __m128 NoiseB = _mm_sub_ps(SoundDitherToUnitWide(NextSoundDitherWide(&State)),
+                               SoundDitherToUnitWide(NextSoundDitherWide(&State)));
+    A = _mm_add_ps(A, _mm_mul_ps(NoiseA, Amplitude));
+    B = _mm_add_ps(B, _mm_mul_ps(NoiseB, Amplitude));
+    // On borne en flottant : au-del de 2^31 la conversion entire changerait de signe
+    A = _mm_min_ps(_mm_max_ps(A, Min), Max);
+    B = _mm_min_ps(_mm_max_ps(B, Min), Max);
+    _mm_storeu_si128((__m128i *)(Dest + Index),
+                     _mm_packs_epi32(_mm_cvtps_epi32(A), _mm_cvtps_epi32(B)));
+  }
+  _mm_storeu_si128((__m128i *)Dither->State, State);
+
+  // La fin avec la premire voie, arrondi au plus proche comme cvtps
+  for (; Index < SampleCount; ++Index)
+  {
+    real32 Noise = (SoundDitherToUnit(NextSoundDitherScalar(&Dither->State[0])) -
+                    SoundDitherToUnit(NextSoundDitherScalar(&Dither->State[0])));
+    real32 Value = Source[Index]*32767.0f + Noise*DitherAmplitude;
+    if (Value > 32767.0f) Value = 32767.0f;
+    if (Value < -32768.0f) Value = -32768.0f;
+    Dest[Index] = (int16)_mm_cvtss_si32(_mm_set_ss(Value));
+  }
+}
+
+/*
+  Buffer circulaire de sortie : une criture de ByteCount octets  partir de
+  Offset, coupe en deux rgions si elle passe la fin du buffer
+*/
+struct sound_ring_regions
+{
+  void *Region1;
+  uint32 Region1Size;
+  void *Region2;
+  uint32 Region2Size;
+};
+
+inline sound_ring_regions
+GetSoundRingRegions(void *Base, uint32 Size, uint32 Offset, uint32 ByteCount)
+{
+  Assert(Offset < Size);
+  Assert(ByteCount <= Size);
+  sound_ring_regions Result;
+  Result.Region1 = (uint8 *)Base + Offset;
+  Result.Region1Size = ByteCount;
+  Result.Region2 = 0;
+  Result.Region2Size = 0;
+  if (ByteCount > Size - Offset)
+  {
+    Result.Region1Size = Size - Offset;
+    Result.Region2 = Base;
+    Result.Region2Size = ByteCount - Result.Region1Size;
+  }
+  return(Result);
+}
+
+/**
+ * Copie des frames dans les deux rgions, d'un bloc par rgion
+ * Renvoie le nombre de frames crites
+ **/
+internal uint32
+CopyToSoundRing(sound_ring_regions *Regions, int16 *Source, uint32 BytesPerFrame)
+{
+  // Les rgions sont des multiples de la taille d'une frame
+  uint32 Region1Bytes = Regions->Region1Size - (Regions->Region1Size % BytesPerFrame);
+  uint32 Region2Bytes = Regions->Region2Size - (Regions->Region2Size % BytesPerFrame);
+  memcpy(Regions->Region1, Source, Region1Bytes);
+  if (Region2Bytes)
+  {
+    memcpy(Regions->Region2, (uint8 *)Source + Region1Bytes, Region2Bytes);
+  }
+  uint32 Result = (Region1Bytes + Region2Bytes) / BytesPerFrame;
+  return(Result);
+}
+
+inline void
+ClearSoundRing(sound_ring_regions *Regions)
+{
+  memset(Regions->Region1, 0, Regions->Region1Size);
+  if (Regions->Region2Size)
+  {
+    memset(Regions->Region2, 0, Regions->Region2Size);
+  }
+}
+
+#define FAITMAIN_SOUND_OUTPUT_H
+#endif
\ No newline at end of file
@@ -0,0 +1,249 @@
+/*
+  Test de l'tage de sortie du son, sans Win32 : un buffer circulaire en
+  mmoire, rempli et effac  toutes les positions, en particulier  cheval
+  sur la fin du buffer.
+
+  Linux : g++ -msse2 -o sound_output_test ../code/faitmain_sound_output_test.cpp && ./sound_output_test
+  Windows : voir build.bat
+
+  Le programme renvoie le nombre d'erreurs, 0 si tout est bon.
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>   // sinf
+
+#define internal static
+#define global_variable static
+
+typedef int16_t int16;
+typedef int32_t int32;
+typedef int32_t bool32;
+
+typedef uint8_t uint8;
+typedef uint32_t uint32;
+
+typedef float real32;
+
+#define Assert(Expression) if(!(Expression)) {*(int *)0 = 0;}
+
+#include "faitmain_sound_output.h"
+
+#define TestRingFrameCount 64
+#define TestBytesPerFrame ((uint32)(2*sizeof(int16)))
+#define TestRingSize (TestRingFrameCount*TestBytesPerFrame)
+#define TestGuardSize 16
+#define TestFill 0xCD
+
+global_variable uint32 GlobalErrorCount;
+
+internal void
+TestCheck(bool32 Condition, const char *What, uint32 Offset, uint32 FrameCount)
+{
+  if (!Condition)
+  {
+    // On n'affiche que les premires erreurs, le total est renvoy
+    if (GlobalErrorCount < 16)
+    {
+      printf("ERREUR %s (offset %u, %u frames)\n", What, Offset, FrameCount);
+    }
+    ++GlobalErrorCount;
+  }
+}
+
+// Le buffer circulaire est entour de deux zones de garde qui ne doivent pas changer
+internal void
+TestFillRing(uint8 *Memory)
+{
+  memset(Memory, TestFill, TestGuardSize + TestRingSize + TestGuardSize);
+}
+
+internal bool32
+TestGuardsAreIntact(uint8 *Memory)
+{
+  bool32 Result = true;
+  for (uint32 Index = 0; Index < TestGuardSize; ++Index)
+  {
+    if ((Memory[Index] != TestFill) ||
+        (Memory[TestGuardSize + TestRingSize + Index] != TestFill))
+    {
+      Result = false;
+    }
+  }
+  return(Result);
+}
+
+// Frame crite  la position FrameIndex depuis le dbut de l'criture
+internal int16
+TestSample(uint32 FrameIndex, uint32 Channel)
+{
+  int16 Result = (int16)(1000 + 2*FrameIndex + Channel);
+  return(Result);
+}
+
+/**
+ * Toutes les positions de dpart, toutes les longueurs : les rgions couvrent
+ * exactement l'criture, la copie tombe aux bons endroits et rien d'autre
+ * n'est touch
+ **/
+internal void
+TestCopyToSoundRing(void)
+{
+  uint8 Memory[TestGuardSize + TestRingSize + TestGuardSize];
+  uint8 *Base = Memory + TestGuardSize;
+  int16 Source[2*TestRingFrameCount];
+  for (uint32 FrameIndex = 0; FrameIndex < TestRingFrameCount; ++FrameIndex)
+  {
+    Source[2*FrameIndex] = TestSample(FrameIndex, 0);
+    Source[2*FrameIndex + 1] = TestSample(FrameIndex, 1);
+  }
+
+  for (uint32 StartFrame = 0; StartFrame < TestRingFrameCount; ++StartFrame)
+  {
+    for (uint32 FrameCount = 0; FrameCount <= TestRingFrameCount; ++FrameCount)
+    {
+      uint32 Offset = StartFrame*TestBytesPerFrame;
+      uint32 ByteCount = FrameCount*TestBytesPerFrame;
+      TestFillRing(Memory);
+      sound_ring_regions Regions = GetSoundRingRegions(Base, TestRingSize, Offset, ByteCount);
+
+      bool32 Wraps = (StartFrame + FrameCount > TestRingFrameCount);
+      uint32 ExpectedRegion1Size = Wraps ? (TestRingSize - Offset) : ByteCount;
+      TestCheck(Regions.Region1 == Base + Offset, "region 1", Offset, FrameCount);
+      TestCheck(Regions.Region1Size == ExpectedRegion1Size, "taille region 1", Offset, FrameCount);
+      TestCheck(Regions.Region2 == (Wraps ? Base : 0), "region 2", Offset, FrameCount);
+      TestCheck(Regions.Region2Size == ByteCount - ExpectedRegion1Size, "taille region 2", Offset, FrameCount);
+
+      uint32 CopiedCount = CopyToSoundRing(&Regions, Source, TestBytesPerFrame);
+      TestCheck(CopiedCount == FrameCount, "frames copiees", Offset, FrameCount);
+
+      int16 *Ring = (int16 *)Base;
+      for (uint32 RingFrame = 0; RingFrame < TestRingFrameCount; ++RingFrame)
+      {
+        // Position de cette frame dans l'criture, FrameCount ou plus si elle n'est pas crite
+        uint32 FrameIndex = (RingFrame + TestRingFrameCount - StartFrame) % TestRingFrameCount;
+        if (FrameIndex < FrameCount)
+        {
+          TestCheck((Ring[2*RingFrame] == TestSample(FrameIndex, 0)) &&
+                    (Ring[2*RingFrame + 1] == TestSample(FrameIndex, 1)),
+                    "frame copiee", Offset, FrameCount);
+        }
+        else
+        {
+          uint8 *Byte = Base + RingFrame*TestBytesPerFrame;
+          TestCheck((Byte[0] == TestFill) && (Byte[1] == TestFill) &&
+                    (Byte[2] == TestFill) && (Byte[3] == TestFill),
+                    "frame hors ecriture modifiee", Offset, FrameCount);
+        }
+      }
+      TestCheck(TestGuardsAreIntact(Memory), "garde copie", Offset, FrameCount);
+    }
+  }
+}
+
+internal void
+TestClearSoundRing(void)
+{
+  uint8 Memory[TestGuardSize + TestRingSize + TestGuardSize];
+  uint8 *Base = Memory + TestGuardSize;
+  for (uint32 StartFrame = 0; StartFrame < TestRingFrameCount; ++StartFrame)
+  {
+    for (uint32 FrameCount = 0; FrameCount <= TestRingFrameCount; ++FrameCount)
+    {
+      uint32 Offset = StartFrame*TestBytesPerFrame;
+      TestFillRing(Memory);
+      sound_ring_regions Regions = GetSoundRingRegions(Base, TestRingSize, Offset,
+                                                       FrameCount*TestBytesPerFrame);
+      ClearSoundRing(&Regions);
+      for (uint32 RingByte = 0; RingByte < TestRingSize; ++RingByte)
+      {
+        uint32 ByteIndex = (RingByte + TestRingSize - Offset) % TestRingSize;
+        uint8 Expected = (ByteIndex < FrameCount*TestBytesPerFrame) ? 0 : TestFill;
+        TestCheck(Base[RingByte] == Expected, "effacement", Offset, FrameCount);
+      }
+      TestCheck(TestGuardsAreIntact(Memory), "garde effacement", Offset, FrameCount);
+    }
+  }
+}
+
+// Arrondi au plus proche, satur : ce que doit donner la conversion sans dither
+internal int16
+TestExpectedInt16(real32 Sample)
+{
+  real32 Value = Sample*32767.0f;
+  if (Value > 32767.0f) Value = 32767.0f;
+  if (Value < -32768.0f) Value = -32768.0f;
+  int16 Result = (int16)_mm_cvtss_si32(_mm_set_ss(Value));
+  return(Result);
+}
+
+/**
+ * Conversion de toutes les longueurs jusqu' 40 chantillons (boucle SSE et
+ * fin scalaire), avec et sans dither, puis copie dans le buffer circulaire
+ *  cheval sur la fin
+ **/
+internal void
+TestConvertSamplesToInt16(void)
+{
+  real32 Samples[2*TestRingFrameCount];
+  for (uint32 Index = 0; Index < 2*TestRingFrameCount; ++Index)
+  {
+    // Des valeurs qui saturent, des demi-LSB et un signal ordinaire
+    real32 Value = sinf(0.37f*(real32)Index);
+    if ((Index % 7) == 0) Value = 1.5f;
+    if ((Index % 11) == 0) Value = -1.5f;
+    if ((Index % 13) == 0) Value = 0.5f / 32767.0f;
+    Samples[Index] = Value;
+  }
+
+  sound_dither Dither;
+  InitializeSoundDither(&Dither, 1234);
+  for (uint32 SampleCount = 0; SampleCount <= 40; ++SampleCount)
+  {
+    int16 Exact[2*TestRingFrameCount + 1];
+    int16 Dithered[2*TestRingFrameCount + 1];
+    Exact[SampleCount] = 0x5A5A;
+    Dithered[SampleCount] = 0x5A5A;
+    ConvertSamplesToInt16(Exact, Samples, SampleCount, &Dither, 0.0f);
+    ConvertSamplesToInt16(Dithered, Samples, SampleCount, &Dither, 1.0f);
+    for (uint32 Index = 0; Index < SampleCount; ++Index)
+    {
+      int32 Expected = TestExpectedInt16(Samples[Index]);
+      TestCheck(Exact[Index] == Expected, "conversion sans dither", Index, SampleCount);
+      int32 Delta = Dithered[Index] - Expected;
+      TestCheck((Delta >= -1) && (Delta <= 1), "conversion avec dither", Index, SampleCount);
+    }
+    TestCheck((Exact[SampleCount] == 0x5A5A) && (Dithered[SampleCount] == 0x5A5A),
+              "conversion hors des echantillons", SampleCount, SampleCount);
+  }
+
+  // Le chemin complet : conversion puis criture qui passe la fin du buffer
+  uint8 Memory[TestGuardSize + TestRingSize + TestGuardSize];
+  uint8 *Base = Memory + TestGuardSize;
+  TestFillRing(Memory);
+  int16 Converted[2*TestRingFrameCount];
+  uint32 FrameCount = 40;
+  uint32 StartFrame = TestRingFrameCount - 13;
+  ConvertSamplesToInt16(Converted, Samples, 2*FrameCount, &Dither, 0.0f);
+  sound_ring_regions Regions = GetSoundRingRegions(Base, TestRingSize, StartFrame*TestBytesPerFrame,
+                                                   FrameCount*TestBytesPerFrame);
+  CopyToSoundRing(&Regions, Converted, TestBytesPerFrame);
+  int16 *Ring = (int16 *)Base;
+  for (uint32 FrameIndex = 0; FrameIndex < FrameCount; ++FrameIndex)
+  {
+    uint32 RingFrame = (StartFrame + FrameIndex) % TestRingFrameCount;
+    TestCheck((Ring[2*RingFrame] == TestExpectedInt16(Samples[2*FrameIndex])) &&
+              (Ring[2*RingFrame + 1] == TestExpectedInt16(Samples[2*FrameIndex + 1])),
+              "conversion puis copie", StartFrame*TestBytesPerFrame, FrameCount);
+  }
+  TestCheck(TestGuardsAreIntact(Memory), "garde conversion", StartFrame*TestBytesPerFrame, FrameCount);
+}
+
+int
+main(void)
+{
+  TestCopyToSoundRing();
+  TestClearSoundRing();
+  TestConvertSamplesToInt16();
+  printf("faitmain_sound_output : %u erreurs\n", GlobalErrorCount);
+  return((int)GlobalErrorCount);
+}
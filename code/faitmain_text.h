@@ -0,0 +1,309 @@
+#if !defined(FAITMAIN_TEXT_H)
+
+/*
+  Texte de debug dessin dans un game_offscreen_buffer
+
+  La police est une police bitmap 5x7 (ASCII 32  126) range par colonnes,
+  bit 0 en haut, la ligne 8 servant aux jambages. Elle est rastrise une
+  fois pour toutes dans un atlas au format du buffer, agrandie et colore :
+  chaque glyphe a ses pixels prts  copier et un masque de mme taille.
+  Dessiner un glyphe n'est alors qu'un mlange par masque, 16 octets  la
+  fois en SSE, quel que soit le format. L'atlas n'est refait que si le
+  format, l'chelle ou la couleur changent.
+
+  Le texte d'une image est accumul dans un text_batch et dessin d'un coup
+   la fin, pour que des milliers de caractres (tables de profilage,
+  compteurs) cotent bien moins d'une milliseconde.
+  Les glyphes qui sortent du buffer ne sont pas dessins.
+  Ce fichier est partag entre le jeu et la couche plateforme.
+*/
+#include <emmintrin.h>
+#include <stdarg.h>
+#include <stdio.h>  // _vsnprintf_s
+#include "faitmain_pixel.h"
+
+#define DebugFontFirstChar 32
+#define DebugFontCharCount 95
+#define DebugFontColumnCount 5
+#define DebugFontCellWidth 6  // Une colonne d'espacement
+#define DebugFontCellHeight 8
+
+global_variable uint8 DebugFontColumns[DebugFontCharCount][DebugFontColumnCount] =
+{
+  {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, // ' ' ! "
+  {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, // # $ %
+  {0x36, 0x49, 0x56, 0x20, 0x50}, {0x00, 0x08, 0x07, 0x03, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00}, // & ' (
+  {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x2A, 0x1C, 0x7F, 0x1C, 0x2A}, {0x08, 0x08, 0x3E, 0x08, 0x08}, // ) * +
+  {0x00, 0x80, 0x70, 0x30, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x00, 0x60, 0x60, 0x00}, // , - .
+  {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, // / 0 1
+  {0x72, 0x49, 0x49, 0x49, 0x46}, {0x21, 0x41, 0x49, 0x4D, 0x33}, {0x18, 0x14, 0x12, 0x7F, 0x10}, // 2 3 4
+  {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x31}, {0x41, 0x21, 0x11, 0x09, 0x07}, // 5 6 7
+  {0x36, 0x49, 0x49, 0x49, 0x36}, {0x46, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x00, 0x14, 0x00, 0x00}, // 8 9 :
+  {0x00, 0x40, 0x34, 0x00, 0x00}, {0x00, 0x08, 0x14, 0x22, 0x41}, {0x14, 0x14, 0x14, 0x14, 0x14}, // ; < =
+  {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x59, 0x09, 0x06}, {0x3E, 0x41, 0x5D, 0x59, 0x4E}, // > ? @
+  {0x7C, 0x12, 0x11, 0x12, 0x7C}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22}, // A B C
+  {0x7F, 0x41, 0x41, 0x41, 0x3E}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01}, // D E F
+  {0x3E, 0x41, 0x41, 0x51, 0x73}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, // G H I
+  {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40}, // J K L
+  {0x7F, 0x02, 0x1C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E}, // M N O
+  {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, // P Q R
+  {0x26, 0x49, 0x49, 0x49, 0x32}, {0x03, 0x01, 0x7F, 0x01, 0x03}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, // S T U
+  {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63}, // V W X
+  {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x59, 0x49, 0x4D, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x41}, // Y Z [
+  {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x41, 0x7F}, {0x04, 0x02, 0x01, 0x02, 0x04}, // \ ] ^
+  {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x03, 0x07, 0x08, 0x00}, {0x20, 0x54, 0x54, 0x78, 0x40}, // _ ` a
+  {0x7F, 0x28, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x28}, {0x38, 0x44, 0x44, 0x28, 0x7F}, // b c d
+  {0x38, 0x54, 0x54, 0x54, 0x18}, {0x00, 0x08, 0x7E, 0x09, 0x02}, {0x18, 0xA4, 0xA4, 0x9C, 0x78}, // e f g
+  {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x40, 0x3D, 0x00}, // h i j
+  {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x78, 0x04, 0x78}, // k l m
+  {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0xFC, 0x18, 0x24, 0x24, 0x18}, // n o p
+  {0x18, 0x24, 0x24, 0x18, 0xFC}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x24}, // q r s
+  {0x04, 0x04, 0x3F, 0x44, 0x24}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C}, // t u v
+  {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x4C, 0x90, 0x90, 0x90, 0x7C}, // w x y
+  {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x77, 0x00, 0x00}, // z { |
+  {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02},                                 // } ~
+};
+
+struct glyph_atlas
+{
+  // Cl du cache : l'atlas est refait si l'un des trois change
+  bool32 IsValid;
+  game_pixel_format PixelFormat;
+  int Scale;
+  uint32 Color; // XRGB8888
+
+  int MaxScale;
+  int GlyphWidth;  // En pixels, espacement compris
+  int GlyphHeight;
+  int RowBytes;    // Octets utiles d'une ligne de glyphe
+  int RowStride;   // Arrondi  16 octets pour les lectures SSE
+  int GlyphStride; // Octets par glyphe
+  uint8 *Pixels;
+  uint8 *Masks;
+};
+
+struct text_glyph
+{
+  int32 X;
+  int32 Y;
+  uint32 Glyph; // Index dans l'atlas
+};
+
+struct text_batch
+{
+  uint32 MaxCount;
+  uint32 Count;
+  text_glyph *Glyphs;
+};
+
+/**
+ * Rserve la mmoire de l'atlas pour toutes les chelles jusqu' MaxScale
+ * et pour le plus gros format de pixel
+ **/
+internal void
+InitializeGlyphAtlas(glyph_atlas *Atlas, memory_arena *Arena, int MaxScale)
+{
+  Atlas->IsValid = false;
+  Atlas->MaxScale = MaxScale;
+  int MaxRowStride = (DebugFontCellWidth*MaxScale*GetBytesPerPixel(PixelFormat_RGBA32F) + 15) & ~15;
+  uint64 Size = (uint64)MaxRowStride*DebugFontCellHeight*MaxScale*DebugFontCharCount;
+  Atlas->Pixels = (uint8 *)PushSize(Arena, Size);
+  Atlas->Masks = (uint8 *)PushSize(Arena, Size);
+}
+
+inline void
+InitializeTextBatch(text_batch *Batch, memory_arena *Arena, uint32 MaxCount)
+{
+  Batch->MaxCount = MaxCount;
+  Batch->Count = 0;
+  Batch->Glyphs = PushArray(Arena, MaxCount, text_glyph);
+}
+
+/**
+ * Rastrisation de la police dans l'atlas, seulement si la cl a chang
+ **/
+internal void
+PrepareGlyphAtlas(glyph_atlas *Atlas, game_pixel_format PixelFormat, int Scale, uint32 Color)
+{
+  if (Scale < 1) Scale = 1;
+  if (Scale > Atlas->MaxScale) Scale = Atlas->MaxScale;
+  if (Atlas->IsValid && (Atlas->PixelFormat == PixelFormat) &&
+      (Atlas->Scale == Scale) && (Atlas->Color == Color))
+  {
+    return;
+  }
+
+  int BytesPerPixel = GetBytesPerPixel(PixelFormat);
+  Atlas->PixelFormat = PixelFormat;
+  Atlas->Scale = Scale;
+  Atlas->Color = Color;
+  Atlas->GlyphWidth = DebugFontCellWidth*Scale;
+  Atlas->GlyphHeight = DebugFontCellHeight*Scale;
+  Atlas->RowBytes = Atlas->GlyphWidth*BytesPerPixel;
+  Atlas->RowStride = (Atlas->RowBytes + 15) & ~15;
+  Atlas->GlyphStride = Atlas->RowStride*Atlas->GlyphHeight;
+
+  // La couleur une fois convertie au format du buffer
+  uint8 Packed[16];
+  ConvertPixelRow(PixelFormat, Packed, PixelFormat_XRGB8888, &Color, 1);
+
+  for (int Glyph = 0; Glyph < DebugFontCharCount; ++Glyph)
+  {
+    uint8 *PixelRow = Atlas->Pixels + Glyph*Atlas->GlyphStride;
+    uint8 *MaskRow = Atlas->Masks + Glyph*Atlas->GlyphStride;
+    for (int Y = 0; Y < Atlas->GlyphHeight; ++Y)
+    {
+      memset(PixelRow, 0, Atlas->RowStride);
+      memset(MaskRow, 0, Atlas->RowStride);
+      int FontRow = Y / Scale;
+      for (int X = 0; X < Atlas->GlyphWidth; ++X)
+      {
+        int FontColumn = X / Scale;
+        if ((FontColumn < DebugFontColumnCount) &&
+            (DebugFontColumns[Glyph][FontColumn] & (1 << FontRow)))
+        {
+          memcpy(PixelRow + X*BytesPerPixel, Packed, BytesPerPixel);
+          memset(MaskRow + X*BytesPerPixel, 0xFF, BytesPerPixel);
+        }
+      }
+      PixelRow += Atlas->RowStride;
+      MaskRow += Atlas->RowStride;
+    }
+  }
+  Atlas->IsValid = true;
+}
+
+inline uint32
+GetGlyphIndex(char Character)
+{
+  uint32 Result = (uint32)(uint8)Character - DebugFontFirstChar;
+  if (Result >= DebugFontCharCount) Result = '?' - DebugFontFirstChar;
+  return(Result);
+}
+
+/**
+ * Un glyphe : mlange par masque ligne par ligne, 16 octets  la fois
+ * Le glyphe doit tre entirement dans le buffer
+ **/
+internal void
+DrawGlyph(game_offscreen_buffer *Buffer, glyph_atlas *Atlas, int X, int Y, uint32 Glyph)
+{
+  uint8 *DestRow = (uint8 *)Buffer->Memory + Y*Buffer->Pitch + X*Buffer->BytesPerPixel;
+  uint8 *PixelRow = Atlas->Pixels + Glyph*Atlas->GlyphStride;
+  uint8 *MaskRow = Atlas->Masks + Glyph*Atlas->GlyphStride;
+  int WideBytes = Atlas->RowBytes & ~15;
+  for (int Row = 0; Row < Atlas->GlyphHeight; ++Row)
+  {
+    int Byte = 0;
+    for (; Byte < WideBytes; Byte += 16)
+    {
+      __m128i Dest = _mm_loadu_si128((__m128i *)(DestRow + Byte));
+      __m128i Pixels = _mm_load_si128((__m128i *)(PixelRow + Byte));
+      __m128i Mask = _mm_load_si128((__m128i *)(MaskRow + Byte));
+      Dest = _mm_or_si128(_mm_and_si128(Mask, Pixels), _mm_andnot_si128(Mask, Dest));
+      _mm_storeu_si128((__m128i *)(DestRow + Byte), Dest);
+    }
+    for (; Byte < Atlas->RowBytes; ++Byte)
+    {
+      DestRow[Byte] = (uint8)((MaskRow[Byte] & PixelRow[Byte]) | (~MaskRow[Byte] & DestRow[Byte]));
+    }
+    DestRow += Buffer->Pitch;
+    PixelRow += Atlas->RowStride;
+    MaskRow += Atlas->RowStride;
+  }
+}
+
+inline bool32
+IsGlyphInside(game_offscreen_buffer *Buffer, glyph_atlas *Atlas, int X, int Y)
+{
+  bool32 Result = ((X >= 0) && (Y >= 0) &&
+                   (X + Atlas->GlyphWidth <= Buffer->Width) &&
+                   (Y + Atlas->GlyphHeight <= Buffer->Height));
+  return(Result);
+}
+
+/**
+ * Dessin immdiat d'un texte, pour une ligne isole
+ * '\n' revient  la ligne ; renvoie le Y de la ligne suivante
+ **/
+internal int
+DrawDebugText(game_offscreen_buffer *Buffer, glyph_atlas *Atlas, int X, int Y, char *Text)
+{
+  Assert(Atlas->IsValid && (Atlas->PixelFormat == Buffer->PixelFormat));
+  int StartX = X;
+  for (char *At = Text; *At; ++At)
+  {
+    if (*At == '\n')
+    {
+      X = StartX;
+      Y += Atlas->GlyphHeight + Atlas->Scale;
+      continue;
+    }
+    if ((*At != ' ') && IsGlyphInside(Buffer, Atlas, X, Y))
+    {
+      DrawGlyph(Buffer, Atlas, X, Y, GetGlyphIndex(*At));
+    }
+    X += Atlas->GlyphWidth;
+  }
+  return(Y + Atlas->GlyphHeight + Atlas->Scale);
+}
+
+/**
+ * Ajout d'un texte au lot de l'image, dessin plus tard par DrawTextBatch
+ * Les espaces et les glyphes hors du buffer ne sont pas gards.
+ * Renvoie le Y de la ligne suivante
+ **/
+internal int
+PushText(text_batch *Batch, game_offscreen_buffer *Buffer, glyph_atlas *Atlas, int X, int Y, char *Text)
+{
+  int StartX = X;
+  for (char *At = Text; *At; ++At)
+  {
+    if (*At == '\n')
+    {
+      X = StartX;
+      Y += Atlas->GlyphHeight + Atlas->Scale;
+      continue;
+    }
+    if ((*At != ' ') && (Batch->Count < Batch->MaxCount) && IsGlyphInside(Buffer, Atlas, X, Y))
+    {
+      text_glyph *Glyph = Batch->Glyphs + Batch->Count++;
+      Glyph->X = X;
+      Glyph->Y = Y;
+      Glyph->Glyph = GetGlyphIndex(*At);
+    }
+    X += Atlas->GlyphWidth;
+  }
+  return(Y + Atlas->GlyphHeight + Atlas->Scale);
+}
+
+internal int
+PushTextFormat(text_batch *Batch, game_offscreen_buffer *Buffer, glyph_atlas *Atlas, int X, int Y,
+               char *Format, ...)
+{
+  char Text[512];
+  va_list Args;
+  va_start(Args, Format);
+  _vsnprintf_s(Text, sizeof(Text), _TRUNCATE, Format, Args);
+  va_end(Args);
+  int Result = PushText(Batch, Buffer, Atlas, X, Y, Text);
+  return(Result);
+}
+
+/**
+ * Dessin de tout le lot, qui est ensuite vid pour l'image suivante
+ **/
+internal void
+DrawTextBatch(game_offscreen_buffer *Buffer, glyph_atlas *Atlas, text_batch *Batch)
+{
+  Assert(Atlas->IsValid && (Atlas->PixelFormat == Buffer->PixelFormat));
+  for (uint32 Index = 0; Index < Batch->Count; ++Index)
+  {
+    text_glyph *Glyph = Batch->Glyphs + Index;
+    DrawGlyph(Buffer, Atlas, Glyph->X, Glyph->Y, Glyph->Glyph);
+  }
+  Batch->Count = 0;
+}
+
+#define FAITMAIN_TEXT_H
+#endif
\ No newline at end of file
@@ -0,0 +1,197 @@
+/*
+  Carte de tuiles : table de hachage des chunks et positions relatives
+*/
+
+internal void
+InitializeTileMap(tile_map *TileMap, memory_arena *Arena, uint32 HashCapacity, real32 TileSideInMeters)
+{
+  Assert((HashCapacity & (HashCapacity - 1)) == 0);
+  TileMap->TileSideInMeters = TileSideInMeters;
+  TileMap->ChunkSideInMeters = TileSideInMeters*(real32)TileChunkDim;
+  TileMap->HashCapacity = HashCapacity;
+  TileMap->ChunkCapacity = HashCapacity - HashCapacity / 4;
+  TileMap->ChunkCount = 0;
+  TileMap->Slots = PushArray(Arena, HashCapacity, tile_chunk_slot);
+  TileMap->Chunks = PushArray(Arena, TileMap->ChunkCapacity, tile_chunk *);
+  for (uint32 SlotIndex = 0; SlotIndex < HashCapacity; ++SlotIndex)
+  {
+    TileMap->Slots[SlotIndex].Chunk = 0;
+  }
+}
+
+inline uint32
+GetTileChunkHash(int32 ChunkX, int32 ChunkY)
+{
+  // Les chunks voisins doivent tomber loin les uns des autres dans la table
+  uint32 Result = (uint32)ChunkX*0x9E3779B1 + (uint32)ChunkY*0x85EBCA77;
+  Result ^= Result >> 15;
+  Result *= 0x2C1B3C6D;
+  Result ^= Result >> 13;
+  return(Result);
+}
+
+/**
+ * Double la table : les emplacements sont rehachs depuis la liste dense,
+ * l'ancienne table et l'ancienne liste restent perdues dans l'arne
+ **/
+internal void
+GrowTileMap(tile_map *TileMap, memory_arena *Arena)
+{
+  uint32 HashCapacity = 2*TileMap->HashCapacity;
+  uint32 ChunkCapacity = HashCapacity - HashCapacity / 4;
+  tile_chunk_slot *Slots = PushArray(Arena, HashCapacity, tile_chunk_slot);
+  tile_chunk **Chunks = PushArray(Arena, ChunkCapacity, tile_chunk *);
+  for (uint32 SlotIndex = 0; SlotIndex < HashCapacity; ++SlotIndex)
+  {
+    Slots[SlotIndex].Chunk = 0;
+  }
+  uint32 Mask = HashCapacity - 1;
+  for (uint32 ChunkIndex = 0; ChunkIndex < TileMap->ChunkCount; ++ChunkIndex)
+  {
+    tile_chunk *Chunk = TileMap->Chunks[ChunkIndex];
+    uint32 SlotIndex = GetTileChunkHash(Chunk->ChunkX, Chunk->ChunkY) & Mask;
+    while (Slots[SlotIndex].Chunk)
+    {
+      SlotIndex = (SlotIndex + 1) & Mask;
+    }
+    Slots[SlotIndex].ChunkX = Chunk->ChunkX;
+    Slots[SlotIndex].ChunkY = Chunk->ChunkY;
+    Slots[SlotIndex].Chunk = Chunk;
+    Chunks[ChunkIndex] = Chunk;
+  }
+  TileMap->HashCapacity = HashCapacity;
+  TileMap->ChunkCapacity = ChunkCapacity;
+  TileMap->Slots = Slots;
+  TileMap->Chunks = Chunks;
+}
+
+/**
+ * Recherche d'un chunk, cr s'il n'existe pas et si une arne est fournie
+ * Renvoie 0 si le chunk n'existe pas et qu'aucune arne n'est fournie
+ **/
+internal tile_chunk *
+GetTileChunk(tile_map *TileMap, int32 ChunkX, int32 ChunkY, memory_arena *Arena = 0)
+{
+  tile_chunk *Result = 0;
+  uint32 Mask = TileMap->HashCapacity - 1;
+  uint32 SlotIndex = GetTileChunkHash(ChunkX, ChunkY) & Mask;
+  for (;;)
+  {
+    tile_chunk_slot *Slot = TileMap->Slots + SlotIndex;
+    if (!Slot->Chunk)
+    {
+      // Emplacement libre : le chunk n'existe pas
+      if (Arena && (TileMap->ChunkCount == TileMap->ChunkCapacity))
+      {
+        // Table pleine : on la double et on cherche l'emplacement  nouveau
+        GrowTileMap(TileMap, Arena);
+        Mask = TileMap->HashCapacity - 1;
+        SlotIndex = GetTileChunkHash(ChunkX, ChunkY) & Mask;
+        continue;
+      }
+      if (Arena)
+      {
+        tile_chunk *Chunk = PushStruct(Arena, tile_chunk);
+        Chunk->ChunkX = ChunkX;
+        Chunk->ChunkY = ChunkY;
+        for (int TileIndex = 0; TileIndex < TileChunkDim*TileChunkDim; ++TileIndex)
+        {
+          Chunk->Tiles[TileIndex] = 0;
+        }
+        Slot->ChunkX = ChunkX;
+        Slot->ChunkY = ChunkY;
+        Slot->Chunk = Chunk;
+        TileMap->Chunks[TileMap->ChunkCount++] = Chunk;
+        Result = Chunk;
+      }
+      break;
+    }
+    if ((Slot->ChunkX == ChunkX) && (Slot->ChunkY == ChunkY))
+    {
+      Result = Slot->Chunk;
+      break;
+    }
+    SlotIndex = (SlotIndex + 1) & Mask;
+  }
+  return(Result);
+}
+
+/*
+  Accs par coordonnes absolues de tuile : le dcalage arithmtique donne
+  le bon chunk aussi pour les coordonnes ngatives
+*/
+inline uint32
+GetTileValue(tile_map *TileMap, int32 AbsTileX, int32 AbsTileY)
+{
+  uint32 Result = 0;
+  tile_chunk *Chunk = GetTileChunk(TileMap, AbsTileX >> TileChunkShift, AbsTileY >> TileChunkShift);
+  if (Chunk)
+  {
+    Result = Chunk->Tiles[(AbsTileY & TileChunkMask)*TileChunkDim + (AbsTileX & TileChunkMask)];
+  }
+  return(Result);
+}
+
+inline void
+SetTileValue(memory_arena *Arena, tile_map *TileMap, int32 AbsTileX, int32 AbsTileY, uint32 Value)
+{
+  tile_chunk *Chunk = GetTileChunk(TileMap, AbsTileX >> TileChunkShift, AbsTileY >> TileChunkShift, Arena);
+  Assert(Chunk);
+  if (Chunk)
+  {
+    Chunk->Tiles[(AbsTileY & TileChunkMask)*TileChunkDim + (AbsTileX & TileChunkMask)] = Value;
+  }
+}
+
+/*
+  Positions relatives aux chunks
+*/
+inline void
+RecanonicalizeCoord(tile_map *TileMap, int32 *Chunk, real32 *Offset)
+{
+  // Le dcalage peut sortir du chunk de plusieurs chunks aprs un grand dplacement
+  int32 ChunkDelta = (int32)floorf(*Offset / TileMap->ChunkSideInMeters);
+  *Chunk += ChunkDelta;
+  *Offset -= (real32)ChunkDelta*TileMap->ChunkSideInMeters;
+  // Les erreurs d'arrondi peuvent laisser le dcalage juste sur le bord
+  if (*Offset >= TileMap->ChunkSideInMeters)
+  {
+    *Offset = 0.0f;
+    ++*Chunk;
+  }
+  if (*Offset < 0.0f) *Offset = 0.0f;
+}
+
+inline tile_map_position
+OffsetPosition(tile_map *TileMap, tile_map_position Position, real32 dX, real32 dY)
+{
+  tile_map_position Result = Position;
+  Result.OffsetX += dX;
+  Result.OffsetY += dY;
+  RecanonicalizeCoord(TileMap, &Result.ChunkX, &Result.OffsetX);
+  RecanonicalizeCoord(TileMap, &Result.ChunkY, &Result.OffsetY);
+  return(Result);
+}
+
+// Ecart A - B en mtres, prcis tant que les deux positions sont proches
+inline tile_map_difference
+SubtractPositions(tile_map *TileMap, tile_map_position A, tile_map_position B)
+{
+  tile_map_difference Result;
+  Result.dX = (real32)(A.ChunkX - B.ChunkX)*TileMap->ChunkSideInMeters + (A.OffsetX - B.OffsetX);
+  Result.dY = (real32)(A.ChunkY - B.ChunkY)*TileMap->ChunkSideInMeters + (A.OffsetY - B.OffsetY);
+  return(Result);
+}
+
+inline uint32
+GetTileValue(tile_map *TileMap, tile_map_position Position)
+{
+  int32 TileX = (int32)(Position.OffsetX / TileMap->TileSideInMeters);
+  int32 TileY = (int32)(Position.OffsetY / TileMap->TileSideInMeters);
+  if (TileX > TileChunkMask) TileX = TileChunkMask;
+  if (TileY > TileChunkMask) TileY = TileChunkMask;
+  uint32 Result = GetTileValue(TileMap,
+                               Position.ChunkX*TileChunkDim + TileX,
+                               Position.ChunkY*TileChunkDim + TileY);
+  return(Result);
+}
\ No newline at end of file
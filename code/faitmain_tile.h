@@ -0,0 +1,67 @@
+#if !defined(FAITMAIN_TILE_H)
+
+/*
+  Carte de tuiles parse pour les grands mondes
+
+  Le monde est dcoup en morceaux (chunks) de TileChunkDim x TileChunkDim
+  tuiles, crs seulement quand on y crit. Les tuiles d'un chunk sont
+  contigus ligne par ligne (1 Ko, 16 lignes de cache). Les chunks sont
+  retrouvs par une table de hachage  adressage ouvert (sondage linaire)
+  dont les entres contiennent la cl, ce qui vite de drfrencer les
+  chunks pendant la recherche. Une liste dense des chunks sert aux parcours.
+  Quand la table est aux 3/4 pleine, elle double : la table et la liste sont
+  recres dans l'arne, les chunks eux ne bougent pas.
+
+  Les positions sont exprimes par rapport  un chunk (coordonnes entires
+  + dcalage flottant dans le chunk) : les flottants restent petits, donc
+  prcis, aussi loin que l'on aille de l'origine.
+*/
+
+#define TileChunkShift 4
+#define TileChunkDim (1 << TileChunkShift)
+#define TileChunkMask (TileChunkDim - 1)
+
+struct tile_chunk
+{
+  int32 ChunkX;
+  int32 ChunkY;
+  uint32 Tiles[TileChunkDim*TileChunkDim]; // Tiles[Y*TileChunkDim + X]
+};
+
+struct tile_chunk_slot
+{
+  int32 ChunkX;
+  int32 ChunkY;
+  tile_chunk *Chunk; // 0 si l'emplacement est libre
+};
+
+struct tile_map
+{
+  real32 TileSideInMeters;
+  real32 ChunkSideInMeters;
+
+  uint32 HashCapacity;  // Puissance de 2, double quand la table est pleine
+  uint32 ChunkCapacity; // Les 3/4 de la table au plus, pour garder des sondages courts
+  uint32 ChunkCount;
+  tile_chunk_slot *Slots;
+  tile_chunk **Chunks;  // Dans l'ordre de cration
+};
+
+// Position dans le monde relative  un chunk
+struct tile_map_position
+{
+  int32 ChunkX;
+  int32 ChunkY;
+  // Dcalage dans le chunk en mtres, dans [0, ChunkSideInMeters)
+  real32 OffsetX;
+  real32 OffsetY;
+};
+
+struct tile_map_difference
+{
+  real32 dX;
+  real32 dY;
+};
+
+#define FAITMAIN_TILE_H
+#endif
\ No newline at end of file
@@ -27,12 +27,21 @@ typedef double real64;
 
 // Implmentation du coeur du jeu indpendemment de la plateforme
 #include "faitmain.h"
+#include "faitmain_pixel.h"
+#include "faitmain_sound_output.h"
+#include "faitmain_log.h"
+#include "faitmain_rollback.h"
+#include "faitmain_capture.h"
+#include "faitmain_replay.h"
 
 // Includes spcifiques  la plateforme
+#include <winsock2.h> // Avant Windows.h, qui inclurait l'ancien winsock.h
 #include <Windows.h>
 #include <Xinput.h> // Pour la gestion des entres (manette...)
 #include <dsound.h> // Pour jouer du son avec DirectSound
+#include <psapi.h>  // GetProcessMemoryInfo, pour l'ensemble de travail
 #include <stdio.h>
+#include <stdlib.h> // atoi
 
 #include "win32_faitmain.h"
 
@@ -40,9 +49,25 @@ typedef double real64;
 global_variable bool32 GlobalRunning = true;
 global_variable bool32 GlobalPause = false;
 global_variable win32_offscreen_buffer GlobalBackBuffer;
+// Buffer dans lequel dessine le jeu, converti vers GlobalBackBuffer avant affichage
+// s'il n'est pas au format XRGB8888 (sinon ce sont les mmes)
+global_variable win32_offscreen_buffer GlobalRenderBuffer;
+// Fraction de la taille de la fentre  laquelle le jeu dessine
+#define MinRenderScale 0.5f
+global_variable real32 GlobalRenderScale = 1.0f;
+global_variable win32_upscaler GlobalUpscaler;
+global_variable win32_resolution_controller GlobalResolutionController;
+global_variable win32_frame_pipeline GlobalFramePipeline;
+// Statistiques de l'image prcdente, dessines par-dessus l'image affiche
+global_variable glyph_atlas GlobalDebugFont;
+global_variable char GlobalOverlayText[128];
+global_variable bool32 GlobalShowOverlay; // -overlay ou F1, la ligne n'est formate que si elle est affiche
 global_variable LPDIRECTSOUNDBUFFER GlobalSecondaryBuffer;
 global_variable int64 GlobalPerfCountFrequency;
 
+#include "win32_faitmain_log.cpp"
+#include "win32_faitmain_replay.cpp"
+
 // Permet de renvoyer les dimensions actuelles de la fentre
 internal win32_window_dimension
 Win32GetWindowDimension(HWND Window) {
@@ -60,6 +85,7 @@ struct win32_game_code
 {
   HMODULE GameCodeDLL;
   game_update_and_render *UpdateAndRender;
+  game_simulate_frame *SimulateFrame;
   game_get_sound_samples *GetSoundSamples;
   bool32 IsValid;
 };
@@ -73,13 +99,16 @@ Win32LoadGameCode(void)
   {
     Result.UpdateAndRender = (game_update_and_render*)
       GetProcAddress(Result.GameCodeDLL, "GameUpdateAndRender");
+    Result.SimulateFrame = (game_simulate_frame*)
+      GetProcAddress(Result.GameCodeDLL, "GameSimulateFrame");
     Result.GetSoundSamples = (game_get_sound_samples*)
       GetProcAddress(Result.GameCodeDLL, "GameGetSoundSamples");
-    Result.IsValid = (Result.UpdateAndRender && Result.GetSoundSamples);
+    Result.IsValid = (Result.UpdateAndRender && Result.SimulateFrame && Result.GetSoundSamples);
   }
   if(!Result.IsValid)
   {
     Result.UpdateAndRender = GameUpdateAndRenderStub;
+    Result.SimulateFrame = GameSimulateFrameStub;
     Result.GetSoundSamples = GameGetSoundSamplesStub;
   }
   return(Result);
@@ -125,7 +154,7 @@ Win32LoadXInput(void) {
   }
   else
   {
-    OutputDebugStringA("Cannot load xinput1_4.dll or xinput1_3.dll\n");
+    WIN32_LOG(LogFormat_XInputMissing);
   }
 }
 
@@ -133,6 +162,7 @@ Win32LoadXInput(void) {
  * Implmentation des fonctions spcifiques  la plateforme
  * dclares dans faitmain.h
  **/
+#if FAITMAIN_INTERNAL
 DEBUG_PLATFORM_FREE_FILE_MEMORY(DEBUGPlatformFreeFileMemory)
 {
   if(Memory)
@@ -208,6 +238,207 @@ DEBUG_PLATEFORM_WRITE_ENTIRE_FILE(DEBUGPlatformWriteEntireFile)
   }
   return(Result);
 }
+#endif
+
+#if FAITMAIN_INTERNAL
+#include "win32_faitmain_timeline.cpp"
+#else
+#define TIMELINE_BEGIN(Name)
+#define TIMELINE_END(Name)
+#define TIMELINE_INSTANT(Name)
+#define TIMELINE_COUNTER(Name, Value)
+#endif
+
+/**
+ * Lecture de fichiers par morceaux, utilisable depuis plusieurs threads  la fois :
+ * chaque lecture prcise sa position, il n'y a pas de curseur de fichier partag
+ **/
+PLATFORM_OPEN_FILE(Win32OpenFile)
+{
+  platform_file_handle Result = {};
+  HANDLE FileHandle = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, 0,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+  if (FileHandle != INVALID_HANDLE_VALUE)
+  {
+    LARGE_INTEGER FileSize;
+    if (GetFileSizeEx(FileHandle, &FileSize))
+    {
+      Result.NoErrors = true;
+      Result.Size = FileSize.QuadPart;
+      Result.Platform = FileHandle;
+    }
+    else
+    {
+      CloseHandle(FileHandle);
+    }
+  }
+  return(Result);
+}
+
+PLATFORM_READ_DATA_FROM_FILE(Win32ReadDataFromFile)
+{
+  uint32 Result = 0;
+  if (Handle->NoErrors)
+  {
+    OVERLAPPED Overlapped = {};
+    Overlapped.Offset = (DWORD)(Offset & 0xFFFFFFFF);
+    Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+    DWORD BytesRead;
+    if (ReadFile((HANDLE)Handle->Platform, Dest, Size, &BytesRead, &Overlapped))
+    {
+      Result = BytesRead;
+    }
+  }
+  return(Result);
+}
+
+PLATFORM_CLOSE_FILE(Win32CloseFile)
+{
+  if (Handle->Platform)
+  {
+    CloseHandle((HANDLE)Handle->Platform);
+    Handle->Platform = 0;
+  }
+}
+
+/**
+ * File de travail : le thread principal ajoute des entres, les threads de fond
+ * se les partagent. Un seul producteur, plusieurs consommateurs.
+ **/
+PLATFORM_ADD_WORK_ENTRY(Win32AddWorkEntry)
+{
+  uint32 NewNextEntryToWrite = (Queue->NextEntryToWrite + 1) % ArrayCount(Queue->Entries);
+  Assert(NewNextEntryToWrite != Queue->NextEntryToRead);
+  platform_work_queue_entry *Entry = Queue->Entries + Queue->NextEntryToWrite;
+  Entry->Callback = Callback;
+  Entry->Data = Data;
+  ++Queue->CompletionGoal;
+  CompletePreviousWritesBeforeFutureWrites;
+  Queue->NextEntryToWrite = NewNextEntryToWrite;
+  ReleaseSemaphore(Queue->SemaphoreHandle, 1, 0);
+}
+
+// Renvoie vrai si le thread peut dormir, aucune entre n'tant disponible
+internal bool32
+Win32DoNextWorkQueueEntry(platform_work_queue *Queue)
+{
+  bool32 WeShouldSleep = false;
+  uint32 OriginalNextEntryToRead = Queue->NextEntryToRead;
+  uint32 NewNextEntryToRead = (OriginalNextEntryToRead + 1) % ArrayCount(Queue->Entries);
+  if (OriginalNextEntryToRead != Queue->NextEntryToWrite)
+  {
+    if (AtomicCompareExchangeUInt32(&Queue->NextEntryToRead, NewNextEntryToRead,
+                                    OriginalNextEntryToRead) == OriginalNextEntryToRead)
+    {
+      platform_work_queue_entry Entry = Queue->Entries[OriginalNextEntryToRead];
+      TIMELINE_BEGIN(Timeline_Work);
+      Entry.Callback(Queue, Entry.Data);
+      TIMELINE_END(Timeline_Work);
+      AtomicIncrementUInt32(&Queue->CompletionCount);
+    }
+  }
+  else
+  {
+    WeShouldSleep = true;
+  }
+  return(WeShouldSleep);
+}
+
+// Le thread appelant participe au travail jusqu' ce que la file soit vide
+PLATFORM_COMPLETE_ALL_WORK(Win32CompleteAllWork)
+{
+  while (Queue->CompletionGoal != Queue->CompletionCount)
+  {
+    Win32DoNextWorkQueueEntry(Queue);
+  }
+  Queue->CompletionGoal = 0;
+  Queue->CompletionCount = 0;
+}
+
+DWORD WINAPI
+Win32WorkQueueThreadProc(LPVOID lpParameter)
+{
+  platform_work_queue *Queue = (platform_work_queue *)lpParameter;
+  for (;;)
+  {
+    if (Win32DoNextWorkQueueEntry(Queue))
+    {
+      WaitForSingleObjectEx(Queue->SemaphoreHandle, INFINITE, FALSE);
+    }
+  }
+}
+
+internal void
+Win32MakeQueue(platform_work_queue *Queue, uint32 ThreadCount)
+{
+  Queue->CompletionGoal = 0;
+  Queue->CompletionCount = 0;
+  Queue->NextEntryToWrite = 0;
+  Queue->NextEntryToRead = 0;
+
+  uint32 InitialCount = 0;
+  Queue->SemaphoreHandle = CreateSemaphoreExA(0, InitialCount, ThreadCount, 0, 0, SEMAPHORE_ALL_ACCESS);
+  for (uint32 ThreadIndex = 0; ThreadIndex < ThreadCount; ++ThreadIndex)
+  {
+    DWORD ThreadID;
+    HANDLE ThreadHandle = CreateThread(0, 0, Win32WorkQueueThreadProc, Queue, 0, &ThreadID);
+    CloseHandle(ThreadHandle);
+  }
+}
+
+// Engage des pages d'une plage rserve, sans effet sur celles dj engages
+internal PLATFORM_COMMIT_MEMORY(Win32CommitMemory)
+{
+  bool32 Result = true;
+  if (Size)
+  {
+    Result = (VirtualAlloc(Memory, (SIZE_T)Size, MEM_COMMIT, PAGE_READWRITE) != 0);
+  }
+  return(Result);
+}
+
+/**
+ * Octets engags dans une plage rserve d'un seul VirtualAlloc
+ **/
+internal uint64
+Win32GetCommittedSize(void *Base, uint64 Size)
+{
+  uint64 Result = 0;
+  uint8 *At = (uint8 *)Base;
+  uint8 *End = At + Size;
+  while (At < End)
+  {
+    MEMORY_BASIC_INFORMATION Info;
+    if (!VirtualQuery(At, &Info, sizeof(Info))) break;
+    uint8 *RegionEnd = (uint8 *)Info.BaseAddress + Info.RegionSize;
+    if (RegionEnd > End) RegionEnd = End;
+    if (Info.State == MEM_COMMIT) Result += (uint64)(RegionEnd - At);
+    At = RegionEnd;
+  }
+  return(Result);
+}
+
+internal PROCESS_MEMORY_COUNTERS_EX
+Win32GetProcessMemory(void)
+{
+  PROCESS_MEMORY_COUNTERS_EX Result = {};
+  Result.cb = sizeof(Result);
+  GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS *)&Result, sizeof(Result));
+  return(Result);
+}
+
+internal platform_api
+Win32GetPlatformAPI(void)
+{
+  platform_api Result = {};
+  Result.AddWorkEntry = Win32AddWorkEntry;
+  Result.CompleteAllWork = Win32CompleteAllWork;
+  Result.OpenFile = Win32OpenFile;
+  Result.ReadDataFromFile = Win32ReadDataFromFile;
+  Result.CloseFile = Win32CloseFile;
+  Result.CommitMemory = Win32CommitMemory;
+  return(Result);
+}
 
 // On effectue de mme pour les fonctions de DirectSound avec des stubs
 // de fonctions si la dll n'a pas pu tre charge
@@ -262,17 +493,17 @@ Win32InitDSound(HWND Window, uint32 SamplesPerSecond, uint32 BufferSize)
           HRESULT Error = PrimaryBuffer->SetFormat(&WaveFormat);
           if (SUCCEEDED(Error))
           {
-            OutputDebugStringA("Primary Buffer format was set.\n");
+            WIN32_LOG(LogFormat_PrimaryBufferSet);
           }
           else
           {
-            OutputDebugStringA("Primary Buffer format was NOT set.\n");
+            WIN32_LOG(LogFormat_PrimaryBufferNotSet);
           }
         }
       }
       else
       {
-        OutputDebugStringA("Cannot set DirectSound Cooperative Level\n");
+        WIN32_LOG(LogFormat_CooperativeLevelFailed);
       }
       // Cration d'un buffer secondaire qui va contenir les sons
       // Astuce pout initialiser tous ses membres  0
@@ -285,17 +516,17 @@ Win32InitDSound(HWND Window, uint32 SamplesPerSecond, uint32 BufferSize)
       HRESULT Error = DirectSound->CreateSoundBuffer(&BufferDescription, &GlobalSecondaryBuffer, 0);
       if (SUCCEEDED(Error))
       {
-        OutputDebugStringA("Secondary Buffer created successfully.\n");
+        WIN32_LOG(LogFormat_SecondaryBufferCreated);
       }
     }
     else
     {
-      OutputDebugStringA("Cannot call DirectSoundCreate\n");
+      WIN32_LOG(LogFormat_DirectSoundCreateFailed);
     }
   }
   else
   {
-    OutputDebugStringA("Cannot load dsound.dll\n");
+    WIN32_LOG(LogFormat_DirectSoundMissing);
   }
 }
 
@@ -304,7 +535,8 @@ Win32InitDSound(HWND Window, uint32 SamplesPerSecond, uint32 BufferSize)
  * DIB: Device Independent Bitmap
  **/
 internal void
-Win32ResizeDIBSection(win32_offscreen_buffer *Buffer, int Width, int Height)
+Win32ResizeDIBSection(win32_offscreen_buffer *Buffer, int Width, int Height,
+                      game_pixel_format PixelFormat)
 {
   if (Buffer->Memory)
   {
@@ -314,7 +546,8 @@ Win32ResizeDIBSection(win32_offscreen_buffer *Buffer, int Width, int Height)
 
   Buffer->Width = Width;
   Buffer->Height = Height;
-  Buffer->BytesPerPixel = 4;
+  Buffer->PixelFormat = PixelFormat;
+  Buffer->BytesPerPixel = GetBytesPerPixel(PixelFormat);
 
   Buffer->Info.bmiHeader.biSize = sizeof(Buffer->Info.bmiHeader);
   Buffer->Info.bmiHeader.biWidth = Buffer->Width;
@@ -322,7 +555,7 @@ Win32ResizeDIBSection(win32_offscreen_buffer *Buffer, int Width, int Height)
   Buffer->Info.bmiHeader.biHeight = -Buffer->Height;
   Buffer->Info.bmiHeader.biPlanes = 1;
   Buffer->Info.bmiHeader.biBitCount = 32;
-  Buffer->Info.bmiHeader.biCompression = BI_RGB;
+  Buffer->Info.bmiHeader.biCompression = BI_RGB; // GDI ne sait afficher que XRGB8888
 
   int BitmapMemorySize = (Buffer->Width * Buffer->Height) * Buffer->BytesPerPixel;
   // MEM_COMMIT rserve automatiquement la mmoire en thorie
@@ -334,6 +567,473 @@ Win32ResizeDIBSection(win32_offscreen_buffer *Buffer, int Width, int Height)
   Buffer->Pitch = Width * Buffer->BytesPerPixel;
 }
 
+/**
+ * Vue du buffer plateforme telle que la voit le moteur de jeu
+ **/
+inline game_offscreen_buffer
+Win32GetGameBuffer(win32_offscreen_buffer *Buffer)
+{
+  game_offscreen_buffer Result = {};
+  Result.Memory = Buffer->Memory;
+  Result.Width = Buffer->Width;
+  Result.Height = Buffer->Height;
+  Result.BytesPerPixel = Buffer->BytesPerPixel;
+  Result.Pitch = Buffer->Pitch;
+  Result.PixelFormat = Buffer->PixelFormat;
+  return(Result);
+}
+
+/**
+ * Statistiques en bas  gauche de l'image affiche (toujours en XRGB8888)
+ * L'atlas est prpar au dmarrage, il est ensuite en lecture seule et peut
+ * servir au thread de prsentation
+ **/
+internal void
+Win32DrawDebugOverlay(win32_offscreen_buffer *Buffer, char *Text)
+{
+  if (GlobalDebugFont.IsValid && Text[0])
+  {
+    game_offscreen_buffer Target = Win32GetGameBuffer(Buffer);
+    DrawDebugText(&Target, &GlobalDebugFont, 8, Target.Height - 8 - GlobalDebugFont.GlyphHeight, Text);
+  }
+}
+
+/**
+ * Format dans lequel le jeu dessine, choisi en ligne de commande :
+ * -rgb565, -rgba8 ou -linear, XRGB8888 par dfaut
+ **/
+internal game_pixel_format
+Win32GetRequestedPixelFormat(LPSTR CommandLine)
+{
+  game_pixel_format Result = PixelFormat_XRGB8888;
+  if (strstr(CommandLine, "-rgb565")) Result = PixelFormat_RGB565;
+  else if (strstr(CommandLine, "-rgba8")) Result = PixelFormat_RGBA8888;
+  else if (strstr(CommandLine, "-linear")) Result = PixelFormat_RGBA32F;
+  return(Result);
+}
+
+/**
+ * Frquence de sortie de la carte son, choisie en ligne de commande (-rate=44100)
+ * Le jeu rchantillonne ses sources vers cette frquence
+ **/
+internal int
+Win32GetRequestedSampleRate(LPSTR CommandLine)
+{
+  int Result = 48000;
+  char *Option = strstr(CommandLine, "-rate=");
+  if (Option)
+  {
+    int Rate = atoi(Option + 6);
+    if ((Rate >= 8000) && (Rate <= 192000)) Result = Rate;
+  }
+  return(Result);
+}
+
+/**
+ * Frquence d'affichage choisie en ligne de commande (-hz=144)
+ * La simulation du jeu garde son propre pas fixe, quelle que soit cette frquence
+ **/
+internal int
+Win32GetRequestedRefreshHz(LPSTR CommandLine, int DefaultHz)
+{
+  int Result = DefaultHz;
+  char *Option = strstr(CommandLine, "-hz=");
+  if (Option)
+  {
+    int Hz = atoi(Option + 4);
+    if ((Hz >= 15) && (Hz <= 240)) Result = Hz;
+  }
+  return(Result);
+}
+
+/**
+ * Mise  l'chelle du buffer de rendu vers le backbuffer affich
+ * Le jeu peut dessiner dans un buffer plus petit que la fentre (GlobalRenderScale),
+ * on l'agrandit ici au lieu de laisser StretchDIBits le faire.
+ * Le bilinaire est en virgule fixe : les poids sont sur 7 bits pour que
+ * (B - A) * Poids tienne dans un int16 sign et que SSE2 traite 8 canaux d'un coup.
+ **/
+internal void
+Win32ResizeUpscaler(win32_upscaler *Scaler, int MaxWidth)
+{
+  if (Scaler->Memory)
+  {
+    VirtualFree(Scaler->Memory, 0, MEM_RELEASE);
+  }
+
+  // SourceX + NearestX + WeightX (4 int16) + 2 lignes de cache + 1 ligne de mlange
+  SIZE_T BytesPerColumn = 2*sizeof(int32) + 4*sizeof(int16) + 3*sizeof(uint32);
+  Scaler->Memory = VirtualAlloc(0, MaxWidth*BytesPerColumn,
+                                MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  uint8 *At = (uint8 *)Scaler->Memory;
+  Scaler->RowCache[0] = (uint32 *)At; At += MaxWidth*sizeof(uint32);
+  Scaler->RowCache[1] = (uint32 *)At; At += MaxWidth*sizeof(uint32);
+  Scaler->BlendRow = (uint32 *)At; At += MaxWidth*sizeof(uint32);
+  Scaler->SourceX = (int32 *)At; At += MaxWidth*sizeof(int32);
+  Scaler->NearestX = (int32 *)At; At += MaxWidth*sizeof(int32);
+  Scaler->WeightX = (int16 *)At;
+
+  Scaler->MaxWidth = MaxWidth;
+  Scaler->SourceWidth = 0; // Force le recalcul des tables
+}
+
+internal void
+Win32PrepareUpscaler(win32_upscaler *Scaler,
+                     int SourceWidth, int SourceHeight,
+                     int DestWidth, int DestHeight)
+{
+  Assert(DestWidth <= Scaler->MaxWidth);
+  Assert((SourceWidth >= 2) && (SourceHeight >= 2));
+  if ((Scaler->SourceWidth != SourceWidth) || (Scaler->SourceHeight != SourceHeight) ||
+      (Scaler->DestWidth != DestWidth) || (Scaler->DestHeight != DestHeight))
+  {
+    Scaler->SourceWidth = SourceWidth;
+    Scaler->SourceHeight = SourceHeight;
+    Scaler->DestWidth = DestWidth;
+    Scaler->DestHeight = DestHeight;
+    Scaler->IsDouble = ((DestWidth == 2*SourceWidth) && (DestHeight == 2*SourceHeight));
+
+    // On chantillonne au centre des pixels
+    real32 StepX = (real32)SourceWidth / (real32)DestWidth;
+    for (int X = 0; X < DestWidth; ++X)
+    {
+      real32 SourceXReal32 = ((real32)X + 0.5f)*StepX - 0.5f;
+      if (SourceXReal32 < 0.0f) SourceXReal32 = 0.0f;
+      int X0 = (int)SourceXReal32;
+      int16 Weight = (int16)((SourceXReal32 - (real32)X0)*128.0f + 0.5f);
+      Scaler->NearestX[X] = (Weight >= 64) ? X0 + 1 : X0;
+      if (X0 >= SourceWidth - 1)
+      {
+        X0 = SourceWidth - 2;
+        Weight = 128;
+        Scaler->NearestX[X] = SourceWidth - 1;
+      }
+      Scaler->SourceX[X] = X0;
+      for (int Lane = 0; Lane < 4; ++Lane)
+      {
+        Scaler->WeightX[4*X + Lane] = Weight;
+      }
+    }
+  }
+  // Le contenu du buffer change  chaque image
+  Scaler->RowCacheY[0] = -1;
+  Scaler->RowCacheY[1] = -1;
+}
+
+// Ligne source au format XRGB8888, convertie dans le cache si le jeu dessine dans un autre format
+internal uint32 *
+Win32GetUpscalerSourceRow(win32_upscaler *Scaler, game_offscreen_buffer *Source, int Y)
+{
+  uint8 *Row = (uint8 *)Source->Memory + Y*Source->Pitch;
+  uint32 *Result = (uint32 *)Row;
+  if (Source->PixelFormat != PixelFormat_XRGB8888)
+  {
+    int Slot = Y & 1;
+    if (Scaler->RowCacheY[Slot] != Y)
+    {
+      ConvertPixelRow(PixelFormat_XRGB8888, Scaler->RowCache[Slot],
+                      Source->PixelFormat, Row, Source->Width);
+      Scaler->RowCacheY[Slot] = Y;
+    }
+    Result = Scaler->RowCache[Slot];
+  }
+  return(Result);
+}
+
+inline uint32
+Win32LerpPixel(uint32 A, uint32 B, int Weight)
+{
+  uint32 Result = 0;
+  for (int Shift = 0; Shift < 32; Shift += 8)
+  {
+    int CA = (A >> Shift) & 0xFF;
+    int CB = (B >> Shift) & 0xFF;
+    Result |= (uint32)(CA + (((CB - CA)*Weight) >> 7)) << Shift;
+  }
+  return(Result);
+}
+
+// Interpolation verticale entre deux lignes, 4 pixels par itration
+internal void
+Win32BlendRows(uint32 *Dest, uint32 *Row0, uint32 *Row1, int Count, int16 Weight)
+{
+  __m128i Zero = _mm_setzero_si128();
+  __m128i W = _mm_set1_epi16(Weight);
+  int X = 0;
+  for (; X + 4 <= Count; X += 4)
+  {
+    __m128i A = _mm_loadu_si128((__m128i *)(Row0 + X));
+    __m128i B = _mm_loadu_si128((__m128i *)(Row1 + X));
+    __m128i ALo = _mm_unpacklo_epi8(A, Zero);
+    __m128i AHi = _mm_unpackhi_epi8(A, Zero);
+    __m128i BLo = _mm_unpacklo_epi8(B, Zero);
+    __m128i BHi = _mm_unpackhi_epi8(B, Zero);
+    __m128i Lo = _mm_add_epi16(ALo, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(BLo, ALo), W), 7));
+    __m128i Hi = _mm_add_epi16(AHi, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(BHi, AHi), W), 7));
+    _mm_storeu_si128((__m128i *)(Dest + X), _mm_packus_epi16(Lo, Hi));
+  }
+  for (; X < Count; ++X)
+  {
+    Dest[X] = Win32LerpPixel(Row0[X], Row1[X], Weight);
+  }
+}
+
+// Interpolation horizontale : un chargement 64 bits ramne les deux voisins d'un coup
+internal void
+Win32ScaleRowBilinear(uint32 *Dest, uint32 *Source, win32_upscaler *Scaler)
+{
+  __m128i Zero = _mm_setzero_si128();
+  int X = 0;
+  for (; X + 2 <= Scaler->DestWidth; X += 2)
+  {
+    __m128i PairA = _mm_loadl_epi64((__m128i *)(Source + Scaler->SourceX[X]));
+    __m128i PairB = _mm_loadl_epi64((__m128i *)(Source + Scaler->SourceX[X + 1]));
+    __m128i A16 = _mm_unpacklo_epi8(PairA, Zero);
+    __m128i B16 = _mm_unpacklo_epi8(PairB, Zero);
+    __m128i Left = _mm_unpacklo_epi64(A16, B16);
+    __m128i Right = _mm_unpackhi_epi64(A16, B16);
+    __m128i W = _mm_loadu_si128((__m128i *)(Scaler->WeightX + 4*X));
+    __m128i Result = _mm_add_epi16(Left, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(Right, Left), W), 7));
+    _mm_storel_epi64((__m128i *)(Dest + X), _mm_packus_epi16(Result, Result));
+  }
+  for (; X < Scaler->DestWidth; ++X)
+  {
+    int X0 = Scaler->SourceX[X];
+    Dest[X] = Win32LerpPixel(Source[X0], Source[X0 + 1], Scaler->WeightX[4*X]);
+  }
+}
+
+internal void
+Win32UpscaleBuffer(win32_upscaler *Scaler, win32_offscreen_buffer *Dest,
+                   game_offscreen_buffer *Source)
+{
+  Win32PrepareUpscaler(Scaler, Source->Width, Source->Height, Dest->Width, Dest->Height);
+  uint8 *DestRow = (uint8 *)Dest->Memory;
+  if (Scaler->IsDouble)
+  {
+    // Chaque pixel est dupliqu en SIMD, puis chaque ligne est recopie en dessous
+    for (int Y = 0; Y < Source->Height; ++Y)
+    {
+      uint32 *SourcePixel = Win32GetUpscalerSourceRow(Scaler, Source, Y);
+      uint32 *DestPixel = (uint32 *)DestRow;
+      int X = 0;
+      for (; X + 4 <= Source->Width; X += 4)
+      {
+        __m128i P = _mm_loadu_si128((__m128i *)(SourcePixel + X));
+        _mm_storeu_si128((__m128i *)(DestPixel + 2*X), _mm_unpacklo_epi32(P, P));
+        _mm_storeu_si128((__m128i *)(DestPixel + 2*X + 4), _mm_unpackhi_epi32(P, P));
+      }
+      for (; X < Source->Width; ++X)
+      {
+        DestPixel[2*X] = DestPixel[2*X + 1] = SourcePixel[X];
+      }
+      memcpy(DestRow + Dest->Pitch, DestRow, Dest->Width*sizeof(uint32));
+      DestRow += 2*Dest->Pitch;
+    }
+  }
+  else if (Scaler->Filter == UpscaleFilter_Nearest)
+  {
+    int LastSourceY = -1;
+    for (int Y = 0; Y < Dest->Height; ++Y)
+    {
+      int SourceY = (Y*Source->Height) / Dest->Height;
+      if (SourceY == LastSourceY)
+      {
+        // Mme ligne source que la prcdente : une simple copie
+        memcpy(DestRow, DestRow - Dest->Pitch, Dest->Width*sizeof(uint32));
+      }
+      else
+      {
+        uint32 *SourcePixel = Win32GetUpscalerSourceRow(Scaler, Source, SourceY);
+        uint32 *DestPixel = (uint32 *)DestRow;
+        for (int X = 0; X < Dest->Width; ++X)
+        {
+          DestPixel[X] = SourcePixel[Scaler->NearestX[X]];
+        }
+      }
+      LastSourceY = SourceY;
+      DestRow += Dest->Pitch;
+    }
+  }
+  else
+  {
+    real32 StepY = (real32)Source->Height / (real32)Dest->Height;
+    for (int Y = 0; Y < Dest->Height; ++Y)
+    {
+      real32 SourceYReal32 = ((real32)Y + 0.5f)*StepY - 0.5f;
+      if (SourceYReal32 < 0.0f) SourceYReal32 = 0.0f;
+      int Y0 = (int)SourceYReal32;
+      int16 Weight = (int16)((SourceYReal32 - (real32)Y0)*128.0f + 0.5f);
+      if (Y0 >= Source->Height - 1)
+      {
+        Y0 = Source->Height - 2;
+        Weight = 128;
+      }
+
+      uint32 *Row = Win32GetUpscalerSourceRow(Scaler, Source, Y0);
+      if (Weight == 128)
+      {
+        Row = Win32GetUpscalerSourceRow(Scaler, Source, Y0 + 1);
+      }
+      else if (Weight != 0)
+      {
+        uint32 *NextRow = Win32GetUpscalerSourceRow(Scaler, Source, Y0 + 1);
+        Win32BlendRows(Scaler->BlendRow, Row, NextRow, Source->Width, Weight);
+        Row = Scaler->BlendRow;
+      }
+      Win32ScaleRowBilinear((uint32 *)DestRow, Row, Scaler);
+      DestRow += Dest->Pitch;
+    }
+  }
+}
+
+/**
+ * Passage du buffer de rendu du jeu au buffer affich : simple conversion
+ * de format  taille gale, agrandissement sinon
+ **/
+internal void
+Win32ResolveRenderBuffer(win32_upscaler *Upscaler, win32_offscreen_buffer *Display,
+                         game_offscreen_buffer *Buffer)
+{
+  if ((Buffer->Width == Display->Width) &&
+      (Buffer->Height == Display->Height))
+  {
+    // Conversion depuis le format de rendu du jeu vers celui de GDI
+    game_offscreen_buffer DisplayBuffer = Win32GetGameBuffer(Display);
+    ConvertOffscreenBuffer(&DisplayBuffer, Buffer);
+  }
+  else
+  {
+    Win32UpscaleBuffer(Upscaler, Display, Buffer);
+  }
+}
+
+/**
+ * Attend que le thread de prsentation ait rendu tous les slots
+ * Le thread du jeu ne doit dtenir aucun slot  ce moment l
+ **/
+internal void
+Win32FlushFramePipeline(win32_frame_pipeline *Pipeline)
+{
+  for (uint32 SlotIndex = 0; SlotIndex < Pipeline->SlotCount; ++SlotIndex)
+  {
+    WaitForSingleObjectEx(Pipeline->FreeSlotSemaphore, INFINITE, FALSE);
+  }
+  ReleaseSemaphore(Pipeline->FreeSlotSemaphore, Pipeline->SlotCount, 0);
+}
+
+internal void
+Win32ResizeFramePipeline(win32_frame_pipeline *Pipeline, int Width, int Height,
+                         game_pixel_format RenderPixelFormat)
+{
+  Win32FlushFramePipeline(Pipeline);
+  Pipeline->LastPresented = 0;
+  for (uint32 SlotIndex = 0; SlotIndex < Pipeline->SlotCount; ++SlotIndex)
+  {
+    win32_frame_slot *Slot = Pipeline->Slots + SlotIndex;
+    Win32ResizeDIBSection(&Slot->DisplayBuffer, Width, Height, PixelFormat_XRGB8888);
+    Win32ResizeDIBSection(&Slot->RenderBuffer, Width, Height, RenderPixelFormat);
+  }
+}
+
+/**
+ * (Re)cre le backbuffer, le buffer de rendu et le scaler  la taille de la fentre
+ **/
+internal void
+Win32ResizeOutput(int Width, int Height, game_pixel_format RenderPixelFormat)
+{
+  if (GlobalFramePipeline.IsEnabled)
+  {
+    // Le thread de prsentation utilise l'upscaler : on attend qu'il ait fini
+    Win32ResizeFramePipeline(&GlobalFramePipeline, Width, Height, RenderPixelFormat);
+  }
+  Win32ResizeDIBSection(&GlobalBackBuffer, Width, Height, PixelFormat_XRGB8888);
+  Win32ResizeDIBSection(&GlobalRenderBuffer, Width, Height, RenderPixelFormat);
+  Win32ResizeUpscaler(&GlobalUpscaler, Width);
+}
+
+/**
+ * Taille de rendu pour une chelle donne, borne  [50%, 100%] de la sortie
+ **/
+internal win32_window_dimension
+Win32GetRenderDimension(win32_offscreen_buffer *Output, real32 RenderScale)
+{
+  if (RenderScale < MinRenderScale) RenderScale = MinRenderScale;
+  if (RenderScale > 1.0f) RenderScale = 1.0f;
+  win32_window_dimension Result;
+  Result.Width = (int)((real32)Output->Width*RenderScale + 0.5f);
+  Result.Height = (int)((real32)Output->Height*RenderScale + 0.5f);
+  if (Result.Width < 2) Result.Width = 2;
+  if (Result.Height < 2) Result.Height = 2;
+  return(Result);
+}
+
+/**
+ * Ajuste GlobalRenderScale en fonction du temps de calcul mesur de l'image
+ * Le nombre de pixels varie comme le carr de l'chelle : pour baisser on vise
+ * directement le seuil haut, pour monter on avance par petits pas.
+ * Chaque dcision est logue pour pouvoir suivre le comportement du rgulateur.
+ **/
+internal void
+Win32UpdateResolutionController(win32_resolution_controller *Controller,
+                                real32 WorkSeconds, real32 TargetSecondsPerFrame)
+{
+  ++Controller->FrameIndex;
+  if (WorkSeconds > TargetSecondsPerFrame)
+  {
+    ++Controller->MissedFrameCount;
+  }
+  if (Controller->SmoothedWorkSeconds == 0.0f)
+  {
+    Controller->SmoothedWorkSeconds = WorkSeconds;
+  }
+  Controller->SmoothedWorkSeconds += 0.1f*(WorkSeconds - Controller->SmoothedWorkSeconds);
+
+  if (!Controller->IsEnabled) return;
+
+  real32 BudgetRatio = Controller->SmoothedWorkSeconds / TargetSecondsPerFrame;
+  // Une image rate compte tout de suite, sans attendre que la moyenne monte
+  bool32 IsOver = ((BudgetRatio > Controller->UpperBudgetRatio) || (WorkSeconds > TargetSecondsPerFrame));
+  bool32 IsUnder = (BudgetRatio < Controller->LowerBudgetRatio);
+  Controller->FramesOverBudget = IsOver ? Controller->FramesOverBudget + 1 : 0;
+  Controller->FramesUnderBudget = IsUnder ? Controller->FramesUnderBudget + 1 : 0;
+
+  if (Controller->CooldownFrames > 0)
+  {
+    --Controller->CooldownFrames;
+    return;
+  }
+
+  real32 OldScale = GlobalRenderScale;
+  real32 NewScale = OldScale;
+  win32_log_format Reason = LogFormat_Count;
+  if ((Controller->FramesOverBudget >= 3) && (OldScale > MinRenderScale))
+  {
+    NewScale = OldScale * sqrtf(Controller->UpperBudgetRatio / BudgetRatio);
+    if (NewScale > OldScale - 0.05f) NewScale = OldScale - 0.05f;
+    Reason = LogFormat_ResolutionOverBudget;
+  }
+  else if ((Controller->FramesUnderBudget >= 30) && (OldScale < 1.0f))
+  {
+    NewScale = OldScale + 0.05f;
+    Reason = LogFormat_ResolutionUnderBudget;
+  }
+
+  if (Reason != LogFormat_Count)
+  {
+    if (NewScale < MinRenderScale) NewScale = MinRenderScale;
+    if (NewScale > 1.0f) NewScale = 1.0f;
+    GlobalRenderScale = NewScale;
+    Controller->FramesOverBudget = 0;
+    Controller->FramesUnderBudget = 0;
+    Controller->CooldownFrames = 15;
+
+    WIN32_LOG(Reason, Controller->FrameIndex,
+              1000.0f*Controller->SmoothedWorkSeconds, 100.0f*BudgetRatio,
+              Controller->MissedFrameCount, OldScale, NewScale);
+  }
+}
+
 /**
  * Ici au dbut on passait ClientRect par rfrence avec un pointeur (*ClientRect)
  * cependant comme la structure est petite le passer par valeur est suffisant
@@ -368,7 +1068,7 @@ Win32MainWindowCallback(HWND Window,
   {
     case WM_SIZE:
       {
-        OutputDebugStringA("WM_SIZE\n");
+        WIN32_LOG(LogFormat_Resize);
       }
       break;
     case WM_DESTROY:
@@ -377,19 +1077,19 @@ Win32MainWindowCallback(HWND Window,
         // Va permettre de sortir de la boucle infinie en dessous
         // Mais finalement on va grer a avec une variable globale pour le moment
         GlobalRunning = false;
-        OutputDebugStringA("WM_DESTROY\n");
+        WIN32_LOG(LogFormat_Destroy);
       }
       break;
     case WM_CLOSE:
       {
         // DestroyWindow(Window);
         GlobalRunning = false;
-        OutputDebugStringA("WM_CLOSE\n");
+        WIN32_LOG(LogFormat_Close);
       }
       break;
     case WM_ACTIVATEAPP:
       {
-        OutputDebugStringA("WM_ACTIVATEAPP\n");
+        WIN32_LOG(LogFormat_ActivateApp);
       }
       break;
     case WM_SYSKEYDOWN:
@@ -405,10 +1105,17 @@ Win32MainWindowCallback(HWND Window,
         PAINTSTRUCT Paint;
         HDC DeviceContext = BeginPaint(Window, &Paint);
         win32_window_dimension Dimension = Win32GetWindowDimension(Window);
-        Win32DisplayBufferInWindow(&GlobalBackBuffer,
+        // En mode pipeline on raffiche la dernire image prsente, sans
+        // croiser un affichage du thread de prsentation
+        bool32 IsPipelined = GlobalFramePipeline.IsEnabled;
+        if (IsPipelined) EnterCriticalSection(&GlobalFramePipeline.PresentLock);
+        win32_offscreen_buffer *Buffer = GlobalFramePipeline.LastPresented;
+        if (!Buffer) Buffer = &GlobalBackBuffer;
+        Win32DisplayBufferInWindow(Buffer,
                                    DeviceContext,
                                    Dimension.Width,
                                    Dimension.Height);
+        if (IsPipelined) LeaveCriticalSection(&GlobalFramePipeline.PresentLock);
         EndPaint(Window, &Paint);
       }
       break;
@@ -425,30 +1132,21 @@ Win32MainWindowCallback(HWND Window,
 internal void
 Win32ClearSoundBuffer(win32_sound_output *SoundOutput)
 {
-  VOID *Region1;
+  sound_ring_regions Regions;
   DWORD Region1Size;
-  VOID *Region2;
   DWORD Region2Size;
 
   if (SUCCEEDED(GlobalSecondaryBuffer->Lock(0, SoundOutput->SecondaryBufferSize,
-                                            &Region1, &Region1Size,
-                                            &Region2, &Region2Size,
+                                            &Regions.Region1, &Region1Size,
+                                            &Regions.Region2, &Region2Size,
                                             0)))
   {
-    uint8 *DestSample = (uint8*)Region1;
-    for (DWORD ByteIndex = 0; ByteIndex < Region1Size; ++ByteIndex)
-    {
-      *DestSample++ = 0;
-    }
-
-    DestSample = (uint8*)Region2;
-    for (DWORD ByteIndex = 0; ByteIndex < Region2Size; ++ByteIndex)
-    {
-      *DestSample++ = 0;
-    }
+    Regions.Region1Size = Region1Size;
+    Regions.Region2Size = Region2Size;
+    ClearSoundRing(&Regions);
 
     // Unlocking the buffer
-    GlobalSecondaryBuffer->Unlock(Region1, Region1Size, Region2, Region2Size);
+    GlobalSecondaryBuffer->Unlock(Regions.Region1, Region1Size, Regions.Region2, Region2Size);
   }
 }
 
@@ -457,37 +1155,23 @@ Win32FillSoundBuffer(win32_sound_output *SoundOutput,
                      DWORD ByteToLock, DWORD BytesToWrite,
                      game_sound_output_buffer *SourceBuffer)
 {
-  VOID *Region1;
+  sound_ring_regions Regions;
   DWORD Region1Size;
-  VOID *Region2;
   DWORD Region2Size;
 
+  // DirectSound coupe lui-mme l'criture en deux rgions au bout du buffer circulaire
   if (SUCCEEDED(GlobalSecondaryBuffer->Lock(ByteToLock, BytesToWrite,
-                                            &Region1, &Region1Size,
-                                            &Region2, &Region2Size,
+                                            &Regions.Region1, &Region1Size,
+                                            &Regions.Region2, &Region2Size,
                                             0)))
   {
+    Regions.Region1Size = Region1Size;
+    Regions.Region2Size = Region2Size;
+    SoundOutput->RunningSampleIndex += CopyToSoundRing(&Regions, SourceBuffer->Samples,
+                                                       SoundOutput->BytesPerSample);
 
-    // il faut bien avoir Region1Size et Region2Size valides
-    DWORD Region1SampleCount = Region1Size / SoundOutput->BytesPerSample;
-    int16 *DestSample = (int16*)Region1;
-    int16 *SourceSample = SourceBuffer->Samples;
-    for (DWORD SampleIndex = 0; SampleIndex < Region1SampleCount; ++SampleIndex)
-    {
-      *DestSample++ = *SourceSample++;
-      *DestSample++ = *SourceSample++;
-      ++SoundOutput->RunningSampleIndex;
-    }
-    DWORD Region2SampleCount = Region2Size / SoundOutput->BytesPerSample;
-    DestSample = (int16*)Region2;
-    for (DWORD SampleIndex = 0; SampleIndex < Region2SampleCount; ++SampleIndex)
-    {
-      *DestSample++ = *SourceSample++;
-      *DestSample++ = *SourceSample++;
-      ++SoundOutput->RunningSampleIndex;
-    }
     // Unlocking the buffer
-    GlobalSecondaryBuffer->Unlock(Region1, Region1Size, Region2, Region2Size);
+    GlobalSecondaryBuffer->Unlock(Regions.Region1, Region1Size, Regions.Region2, Region2Size);
   }
 }
 
@@ -530,6 +1214,99 @@ Win32ProcessXInputStickValue(SHORT Value, SHORT DeadZoneThreshold)
   return(Result);
 }              
 
+/**
+ * Conversion de l'tat d'une manette XInput : stick, croix directionnelle et boutons
+ **/
+internal void
+Win32ProcessXInputGamepad(XINPUT_GAMEPAD *Pad,
+                          game_controller_input *OldController,
+                          game_controller_input *NewController)
+{
+  // Stick
+  NewController->IsAnalog = true;
+  NewController->StickAverageX = Win32ProcessXInputStickValue(
+    Pad->sThumbLX, XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE);
+  NewController->StickAverageY = Win32ProcessXInputStickValue(
+    Pad->sThumbLY, XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE);
+
+  // DPAD, que l'on peut traiter comme le stick
+  bool32 Up = (Pad->wButtons & XINPUT_GAMEPAD_DPAD_UP);
+  bool32 Down = (Pad->wButtons & XINPUT_GAMEPAD_DPAD_DOWN);
+  bool32 Left = (Pad->wButtons & XINPUT_GAMEPAD_DPAD_LEFT);
+  bool32 Right = (Pad->wButtons & XINPUT_GAMEPAD_DPAD_RIGHT);
+
+  if (Up) NewController->StickAverageY = 1.0f;
+  if (Down) NewController->StickAverageY = -1.0f;
+  if (Left) NewController->StickAverageX = -1.0f;
+  if (Right) NewController->StickAverageX = 1.0f;
+
+  // Si un bouton est press au lieu du stick on dit qu'on n'est pas analogue, sinon si le stick est utilis on prvient
+  if(Up || Down || Left || Right) NewController->IsAnalog = false;
+  if(NewController->StickAverageX != 0.0f || NewController->StickAverageY != 0.0f) NewController->IsAnalog = true;
+
+  // Si on veut considrer le stick comme un bouton
+  real32 Threshold = 0.5f;
+  WORD VirtualLeft = NewController->StickAverageX < -Threshold ? 1 : 0;
+  WORD VirtualRight = NewController->StickAverageX > Threshold ? 1 : 0;
+  WORD VirtualUp = NewController->StickAverageY < -Threshold ? 1 : 0;
+  WORD VirtualDown = NewController->StickAverageY > Threshold ? 1 : 0;
+  Win32ProcessXInputDigitalButton(
+    VirtualLeft, &OldController->MoveLeft, 1,
+    &NewController->MoveLeft);
+  Win32ProcessXInputDigitalButton(
+    VirtualRight, &OldController->MoveRight, 1,
+    &NewController->MoveRight);
+  Win32ProcessXInputDigitalButton(
+    VirtualUp, &OldController->MoveUp, 1,
+    &NewController->MoveUp);
+  Win32ProcessXInputDigitalButton(
+    VirtualDown, &OldController->MoveDown, 1,
+    &NewController->MoveDown);
+
+  // Boutons
+  Win32ProcessXInputDigitalButton(
+    Pad->wButtons, &OldController->A,
+    XINPUT_GAMEPAD_A, &NewController->A);
+  Win32ProcessXInputDigitalButton(
+    Pad->wButtons, &OldController->B,
+    XINPUT_GAMEPAD_B, &NewController->B);
+  Win32ProcessXInputDigitalButton(
+    Pad->wButtons, &OldController->X,
+    XINPUT_GAMEPAD_X, &NewController->X);
+  Win32ProcessXInputDigitalButton(
+    Pad->wButtons, &OldController->Y,
+    XINPUT_GAMEPAD_Y, &NewController->Y);
+  Win32ProcessXInputDigitalButton(
+    Pad->wButtons, &OldController->LeftShoulder,
+    XINPUT_GAMEPAD_LEFT_SHOULDER, &NewController->LeftShoulder);
+  Win32ProcessXInputDigitalButton(
+    Pad->wButtons, &OldController->RightShoulder,
+    XINPUT_GAMEPAD_RIGHT_SHOULDER, &NewController->RightShoulder);
+  Win32ProcessXInputDigitalButton(
+    Pad->wButtons, &OldController->Back,
+    XINPUT_GAMEPAD_BACK, &NewController->Back);
+  Win32ProcessXInputDigitalButton(
+    Pad->wButtons, &OldController->Start,
+    XINPUT_GAMEPAD_START, &NewController->Start);
+}
+
+inline LARGE_INTEGER
+Win32GetWallClock(void)
+{
+  LARGE_INTEGER Result;
+  QueryPerformanceCounter(&Result);
+  return(Result);
+}
+
+inline real32
+Win32GetSecondsElapsed(LARGE_INTEGER Start, LARGE_INTEGER End)
+{
+  real32 Result = ((real32)(End.QuadPart - Start.QuadPart) / (real32)GlobalPerfCountFrequency);
+  return(Result);
+}
+
+#include "win32_faitmain_capture.cpp"
+
 /**
  * Traitement des messages Windows, clavier inclus
  **/
@@ -614,6 +1391,50 @@ Win32ProcessPendingMessages(game_controller_input *KeyboardController)
             {
               if(IsDown) GlobalPause = !GlobalPause;
             }
+            else if (VKCode == VK_F1)
+            {
+              if(IsDown) GlobalShowOverlay = !GlobalShowOverlay;
+            }
+            else if (VKCode == VK_F2)
+            {
+              // Un rglage manuel coupe la rgulation automatique
+              GlobalResolutionController.IsEnabled = false;
+              if(IsDown) GlobalRenderScale -= 0.1f;
+              if(GlobalRenderScale < MinRenderScale) GlobalRenderScale = MinRenderScale;
+            }
+            else if (VKCode == VK_F3)
+            {
+              GlobalResolutionController.IsEnabled = false;
+              if(IsDown) GlobalRenderScale += 0.1f;
+              if(GlobalRenderScale > 1.0f) GlobalRenderScale = 1.0f;
+            }
+            else if (VKCode == VK_F6)
+            {
+              if(IsDown) GlobalResolutionController.IsEnabled = !GlobalResolutionController.IsEnabled;
+            }
+            else if (VKCode == VK_F7)
+            {
+              // Export de la timeline des dernires images
+              if(IsDown) GlobalTimeline.ExportRequested = true;
+            }
+            else if (VKCode == VK_F8)
+            {
+              // Capture de l'image suivante dans un fichier .qoi
+              if(IsDown) GlobalCapture.ScreenshotRequested = true;
+            }
+            else if (VKCode == VK_F9)
+            {
+              // Dbut ou fin de l'enregistrement vido
+              if(IsDown) GlobalCapture.ToggleRequested = true;
+            }
+            else if (VKCode == VK_F5)
+            {
+              if(IsDown)
+              {
+                GlobalUpscaler.Filter = (GlobalUpscaler.Filter == UpscaleFilter_Bilinear) ?
+                  UpscaleFilter_Nearest : UpscaleFilter_Bilinear;
+              }
+            }
 #endif
           }
           // Comme on capture les touches il faut grer nous mme le Alt-F4 pour quitter
@@ -635,21 +1456,84 @@ Win32ProcessPendingMessages(game_controller_input *KeyboardController)
   }
 }
 
-inline LARGE_INTEGER
-Win32GetWallClock(void)
+/**
+ * Thread de prsentation : prend les slots dans l'ordre, les convertit
+ * ou les agrandit, les affiche puis les rend au jeu
+ **/
+DWORD WINAPI
+Win32PresentThreadProc(LPVOID lpParameter)
 {
-  LARGE_INTEGER Result;
-  QueryPerformanceCounter(&Result);
-  return(Result);
+  win32_frame_pipeline *Pipeline = (win32_frame_pipeline *)lpParameter;
+  for (;;)
+  {
+    WaitForSingleObjectEx(Pipeline->ReadySlotSemaphore, INFINITE, FALSE);
+    win32_frame_slot *Slot = Pipeline->Slots + Pipeline->NextSlotToPresent;
+    Pipeline->NextSlotToPresent = (Pipeline->NextSlotToPresent + 1) % Pipeline->SlotCount;
+
+    TIMELINE_BEGIN(Timeline_Present);
+    if (!Slot->RenderIsDirect)
+    {
+      Win32ResolveRenderBuffer(Pipeline->Upscaler, &Slot->DisplayBuffer, &Slot->Buffer);
+    }
+    Win32DrawDebugOverlay(&Slot->DisplayBuffer, Slot->OverlayText);
+    // La file de haute priorit appartient au thread du jeu : copie sur ce thread
+    Win32CaptureFrame(&GlobalCapture, &Slot->DisplayBuffer, 0, 0, 0);
+    EnterCriticalSection(&Pipeline->PresentLock);
+    if (Pipeline->DeviceContext)
+    {
+      Win32DisplayBufferInWindow(&Slot->DisplayBuffer, Pipeline->DeviceContext,
+                                 Slot->WindowWidth, Slot->WindowHeight);
+    }
+    Pipeline->LastPresented = &Slot->DisplayBuffer;
+    LeaveCriticalSection(&Pipeline->PresentLock);
+    TIMELINE_END(Timeline_Present);
+
+    real32 LatencySeconds = Win32GetSecondsElapsed(Slot->FrameStartCounter, Win32GetWallClock());
+    Pipeline->LastLatencySeconds = LatencySeconds;
+    Pipeline->LatencySecondsSum += LatencySeconds;
+    CompletePreviousWritesBeforeFutureWrites;
+    ++Pipeline->PresentedCount;
+    ReleaseSemaphore(Pipeline->FreeSlotSemaphore, 1, 0);
+  }
 }
 
-inline real32
-Win32GetSecondsElapsed(LARGE_INTEGER Start, LARGE_INTEGER End)
+internal void
+Win32InitFramePipeline(win32_frame_pipeline *Pipeline, uint32 SlotCount,
+                       win32_upscaler *Upscaler, HDC DeviceContext)
 {
-  real32 Result = ((real32)(End.QuadPart - Start.QuadPart) / (real32)GlobalPerfCountFrequency);
+  Assert((SlotCount >= 2) && (SlotCount <= FramePipelineMaxSlotCount));
+  Pipeline->IsEnabled = true;
+  Pipeline->SlotCount = SlotCount;
+  Pipeline->Upscaler = Upscaler;
+  Pipeline->DeviceContext = DeviceContext;
+  InitializeCriticalSection(&Pipeline->PresentLock);
+  Pipeline->FreeSlotSemaphore = CreateSemaphoreExA(0, SlotCount, SlotCount, 0, 0, SEMAPHORE_ALL_ACCESS);
+  Pipeline->ReadySlotSemaphore = CreateSemaphoreExA(0, 0, SlotCount, 0, 0, SEMAPHORE_ALL_ACCESS);
+
+  DWORD ThreadID;
+  HANDLE ThreadHandle = CreateThread(0, 0, Win32PresentThreadProc, Pipeline, 0, &ThreadID);
+  CloseHandle(ThreadHandle);
+}
+
+// Attend un slot libre pour dessiner l'image suivante
+internal win32_frame_slot *
+Win32BeginPipelinedFrame(win32_frame_pipeline *Pipeline)
+{
+  WaitForSingleObjectEx(Pipeline->FreeSlotSemaphore, INFINITE, FALSE);
+  win32_frame_slot *Result = Pipeline->Slots + Pipeline->NextSlotToWrite;
+  Pipeline->NextSlotToWrite = (Pipeline->NextSlotToWrite + 1) % Pipeline->SlotCount;
   return(Result);
 }
 
+// Confie le slot au thread de prsentation, sans attendre l'affichage
+internal void
+Win32SubmitPipelinedFrame(win32_frame_pipeline *Pipeline, win32_frame_slot *Slot)
+{
+  Assert(Slot == Pipeline->Slots + (Pipeline->NextSlotToWrite + Pipeline->SlotCount - 1) % Pipeline->SlotCount);
+  CompletePreviousWritesBeforeFutureWrites;
+  ReleaseSemaphore(Pipeline->ReadySlotSemaphore, 1, 0);
+}
+
 internal void
 Win32DebugDrawVertical(win32_offscreen_buffer *BackBuffer,
                        int X, int Top, int Bottom, uint32 Color)
@@ -734,11 +1618,16 @@ Win32DebugSyncDisplay(win32_offscreen_buffer *BackBuffer,
     }
     Assert(ThisMarker->FlipPlayCursor < SoundOutput->SecondaryBufferSize);
     Win32DrawSoundBuffer(BackBuffer, SoundOutput, C, PadX, Top, Bottom, ThisMarker->FlipPlayCursor, PlayColor);
-    Win32DrawSoundBuffer(BackBuffer, SoundOutput, C, PadX, Top, Bottom, ThisMarker->FlipPlayCursor + 480*SoundOutput->BytesPerSample, PlayWindowColor);
+    Win32DrawSoundBuffer(BackBuffer, SoundOutput, C, PadX, Top, Bottom, ThisMarker->FlipPlayCursor + (SoundOutput->SamplesPerSecond / 100)*SoundOutput->BytesPerSample, PlayWindowColor);
     Win32DrawSoundBuffer(BackBuffer, SoundOutput, C, PadX, Top, Bottom, ThisMarker->FlipWriteCursor, WriteColor);
   }
 }
 
+#include "win32_faitmain_net.cpp"
+#if FAITMAIN_INTERNAL
+#include "win32_faitmain_bench.cpp"
+#endif
+
 /**
  * Main du programme qui va initialiser la fentre et grer la boucle principale :
  * attente des messages, gestion de la manette et du clavier, dessin...
@@ -756,6 +1645,20 @@ WinMain(HINSTANCE Instance,
   LARGE_INTEGER PerfCountFrequencyResult;
   QueryPerformanceFrequency(&PerfCountFrequencyResult);
   GlobalPerfCountFrequency = PerfCountFrequencyResult.QuadPart;
+  // Dure de dmarrage, jusqu' la fin de la premire image
+  LARGE_INTEGER StartupCounter = Win32GetWallClock();
+
+#if FAITMAIN_INTERNAL
+  // Mode de mesure des performances : on lance les benchmarks et on quitte
+  if (strstr(CommandLine, "-bench"))
+  {
+    int BenchResult = Win32RunBenchmarks(CommandLine);
+    return(BenchResult);
+  }
+  Win32InitTimeline(&GlobalTimeline);
+#endif
+  // Les messages de la plateforme sont crits par un thread de fond
+  Win32StartLogger(&GlobalLogger, "faitmain.log", LogFormats, LogFormat_Count);
 
   // On dfinit la granularit du scheduler de Windows  1ms pour permettre le calcul du timing
   // Pour que la fonction Sleep() soit plus performante (plus granulaire)
@@ -769,7 +1672,17 @@ WinMain(HINSTANCE Instance,
   // initialisation par dfaut, ANSI version de WNDCLASSA
   WNDCLASSA WindowClass = {};
 
-  Win32ResizeDIBSection(&GlobalBackBuffer, 800, 600);
+  // Le buffer affich est toujours en XRGB8888, le jeu peut dessiner dans un autre format
+  // et  une rsolution plus faible. Ils suivent ensuite la taille de la fentre.
+  game_pixel_format RenderPixelFormat = Win32GetRequestedPixelFormat(CommandLine);
+  Win32ResizeOutput(800, 600, RenderPixelFormat);
+  Win32GetRequestedCapture(&GlobalCapture, CommandLine);
+
+  // La rsolution de rendu est rgule automatiquement, sauf avec -fixedres
+  GlobalResolutionController.IsEnabled = !strstr(CommandLine, "-fixedres");
+  GlobalShowOverlay = (strstr(CommandLine, "-overlay") != 0);
+  GlobalResolutionController.LowerBudgetRatio = 0.6f;
+  GlobalResolutionController.UpperBudgetRatio = 0.9f;
 
   // On ne configure que les membres que l'on veut
   // indique que l'on veut rafraichir la fentre entire lors d'un resize (horizontal et vertical)
@@ -783,7 +1696,8 @@ WinMain(HINSTANCE Instance,
   // TODO: Demander  Windows la vraie valeur
 #define MonitorRefreshHz 60
 #define GameUpdateHz (MonitorRefreshHz / 2)
-  real32 TargetSecondsPerFrame = 1.0f / (real32)GameUpdateHz;
+  int RefreshHz = Win32GetRequestedRefreshHz(CommandLine, GameUpdateHz);
+  real32 TargetSecondsPerFrame = 1.0f / (real32)RefreshHz;
 
   // Ouverture de la fentre
   if (RegisterClassA(&WindowClass))
@@ -807,16 +1721,39 @@ WinMain(HINSTANCE Instance,
       // et s'en servir indfiniment car on ne le partage pas
       HDC DeviceContext = GetDC(Window);
 
+      // Police de debug pour les statistiques affiches sur l'image
+      {
+        memory_arena FontArena;
+        uint64 FontArenaSize = Kilobytes(256);
+        void *FontMemory = VirtualAlloc(0, (SIZE_T)FontArenaSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+        if (FontMemory)
+        {
+          InitializeArena(&FontArena, FontArenaSize, FontMemory);
+          InitializeGlyphAtlas(&GlobalDebugFont, &FontArena, 1);
+          PrepareGlyphAtlas(&GlobalDebugFont, PixelFormat_XRGB8888, 1, 0x00FFFF00);
+        }
+      }
+
+      // Avec -pipeline l'affichage se fait sur un thread  part (triple buffering,
+      // ou double avec -pipeline=2) pendant que le jeu calcule l'image suivante
+      if (strstr(CommandLine, "-pipeline"))
+      {
+        uint32 SlotCount = strstr(CommandLine, "-pipeline=2") ? 2 : 3;
+        Win32InitFramePipeline(&GlobalFramePipeline, SlotCount, &GlobalUpscaler, DeviceContext);
+        Win32ResizeFramePipeline(&GlobalFramePipeline, GlobalBackBuffer.Width, GlobalBackBuffer.Height,
+                                 RenderPixelFormat);
+      }
+
       // Initialisation de DirectSound et test de son
       // Pour le moment on a un buffer d'une seconde, on verra si a suffit plus tard
       win32_sound_output SoundOutput = {};
-      SoundOutput.SamplesPerSecond = 48000;
+      SoundOutput.SamplesPerSecond = Win32GetRequestedSampleRate(CommandLine);
       SoundOutput.ToneVolume = 6000;
       SoundOutput.RunningSampleIndex = 0;
       SoundOutput.BytesPerSample = sizeof(uint16) * 2;
       SoundOutput.SecondaryBufferSize = SoundOutput.SamplesPerSecond * SoundOutput.BytesPerSample;
-      SoundOutput.LatencySampleCount = 3 * (SoundOutput.SamplesPerSecond / GameUpdateHz); // On aimerait 60 comme le nb img/s, 2* pour prendre de l'avance
-      SoundOutput.SafetyBytes = (SoundOutput.SamplesPerSecond * SoundOutput.BytesPerSample / GameUpdateHz) / 3;
+      SoundOutput.LatencySampleCount = 3 * (SoundOutput.SamplesPerSecond / RefreshHz); // On aimerait 60 comme le nb img/s, 2* pour prendre de l'avance
+      SoundOutput.SafetyBytes = (SoundOutput.SamplesPerSecond * SoundOutput.BytesPerSample / RefreshHz) / 3;
 
       Win32InitDSound(Window, SoundOutput.SamplesPerSecond, SoundOutput.SecondaryBufferSize);
       // Premir remplissage du buffer pour le son
@@ -835,22 +1772,55 @@ WinMain(HINSTANCE Instance,
                                             PAGE_READWRITE);
 
 
+      // Un enregistrement n'est relu  l'identique que si les pointeurs de l'tat sont les mmes,
+      // et une session en rseau copie l'tat d'un joueur  l'autre avec ses pointeurs
+      char ReplayFilename[ReplayMaxFilename];
+      win32_replay_mode ReplayMode = Win32GetRequestedReplay(CommandLine, ReplayFilename,
+                                                             sizeof(ReplayFilename));
+      bool32 IsNetRequested = (strstr(CommandLine, "-net=") != 0);
 #if FAITMAIN_INTERNAL
-      LPVOID BaseAddress = 0;
+      LPVOID BaseAddress = ((ReplayMode != ReplayMode_None) || IsNetRequested) ? (LPVOID)Terabytes(2) : 0;
 #else
       LPVOID BaseAddress = (LPVOID)Terabytes(2);
 #endif
 
       // On alloue la mmoire utilise par le moteur du jeu en une fois
+      // Avec -lazycommit elle est seulement rserve, le jeu n'engage que ce que ses arnes utilisent
       game_memory GameMemory = {};
       GameMemory.PermanentStorageSize = Megabytes(64);
       GameMemory.TransientStorageSize = Gigabytes(1);
+      GameMemory.IsCommittedOnDemand = (strstr(CommandLine, "-lazycommit") != 0);
       uint64 TotalSize = GameMemory.PermanentStorageSize + GameMemory.TransientStorageSize;
+      DWORD AllocationType = GameMemory.IsCommittedOnDemand ? MEM_RESERVE : (MEM_RESERVE|MEM_COMMIT);
+      // Les deux mmoires sont contigus : on alloue le total, pas seulement la permanente
+      LARGE_INTEGER AllocationCounter = Win32GetWallClock();
       GameMemory.PermanentStorage = VirtualAlloc(BaseAddress,
-                                                 (SIZE_T)GameMemory.PermanentStorageSize,
-                                                 MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+                                                 (SIZE_T)TotalSize,
+                                                 AllocationType, PAGE_READWRITE);
+      real32 AllocationSeconds = Win32GetSecondsElapsed(AllocationCounter, Win32GetWallClock());
       GameMemory.TransientStorage = ((uint8 *)GameMemory.PermanentStorage + 
                                       GameMemory.PermanentStorageSize);
+#if FAITMAIN_INTERNAL
+      GameMemory.DEBUGPlatformFreeFileMemory = DEBUGPlatformFreeFileMemory;
+      GameMemory.DEBUGPlatformReadEntireFile = DEBUGPlatformReadEntireFile;
+      GameMemory.DEBUGPlatformWriteEntireFile = DEBUGPlatformWriteEntireFile;
+#endif
+
+      // File de basse priorit pour les chargements en tche de fond (musique...)
+      platform_work_queue LowPriorityQueue = {};
+      Win32MakeQueue(&LowPriorityQueue, 2);
+      GameMemory.LowPriorityQueue = &LowPriorityQueue;
+
+      // File de haute priorit pour dcouper le travail d'une image : un thread par
+      // processeur en plus du thread principal, qui participe aussi
+      SYSTEM_INFO SystemInfo;
+      GetSystemInfo(&SystemInfo);
+      uint32 HighPriorityThreadCount = (SystemInfo.dwNumberOfProcessors > 1) ?
+        (uint32)(SystemInfo.dwNumberOfProcessors - 1) : 1;
+      platform_work_queue HighPriorityQueue = {};
+      Win32MakeQueue(&HighPriorityQueue, HighPriorityThreadCount);
+      GameMemory.HighPriorityQueue = &HighPriorityQueue;
+      GameMemory.PlatformAPI = Win32GetPlatformAPI();
       /*
       GameMemory.TransientStorage = VirtualAlloc(0,
                                                  GameMemory.TransientStorageSize,
@@ -864,8 +1834,32 @@ WinMain(HINSTANCE Instance,
         game_input *NewInput = &Input[0];
         game_input *OldInput = &Input[1];
 
+        // En rseau le jeu reoit les entres de tous les joueurs, pas celles des manettes locales.
+        // Il est initialis par une image vide, la mme chez tous les joueurs et pour
+        // l'enregistrement comme pour sa relecture.
+        game_input NetFrameInput = {};
+        if (IsNetRequested || (ReplayMode != ReplayMode_None))
+        {
+          Game.SimulateFrame(&GameMemory, &NetFrameInput);
+        }
+        if (IsNetRequested)
+        {
+          Win32BeginNetSession(&GlobalNet, CommandLine, &GameMemory, TargetSecondsPerFrame);
+        }
+        if (ReplayMode != ReplayMode_None)
+        {
+          GameMemory.IsStateHashRequested = Win32BeginReplay(&GlobalReplay, ReplayMode, ReplayFilename, &GameMemory);
+          real32 SeekMinutes = Win32GetRequestedSeek(CommandLine);
+          if (GameMemory.IsStateHashRequested && (ReplayMode == ReplayMode_Replay) && (SeekMinutes > 0.0f))
+          {
+            Win32SeekReplay(&GlobalReplay, &GameMemory, Game.SimulateFrame, 60.0*SeekMinutes);
+          }
+        }
+
         // Gestion du timing
         LARGE_INTEGER LastCounter = Win32GetWallClock();
+        // Dure relle de l'image prcdente, donne au jeu qui simule  pas fixe
+        real32 LastFrameSeconds = TargetSecondsPerFrame;
         LARGE_INTEGER FlipWallClock = Win32GetWallClock();
 
         // Pour le debug de la syncro audio
@@ -878,6 +1872,7 @@ WinMain(HINSTANCE Instance,
 
         // rdtsc ne sert que pour le profiling, ne peut pas servir au timing
         uint64 LastCycleCount = __rdtsc();
+        bool32 StartupReported = false;
 
         // boucle infinie pour traiter tous les messages et tout passer au moteur de jeu
         while (GlobalRunning)
@@ -920,76 +1915,11 @@ WinMain(HINSTANCE Instance,
               NewController->IsConnected = true;
               XINPUT_GAMEPAD *Pad = &ControllerState.Gamepad;
 
-              // Stick
-              NewController->IsAnalog = true;
-              NewController->StickAverageX = Win32ProcessXInputStickValue(
-                Pad->sThumbLX, XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE);
-              NewController->StickAverageY = Win32ProcessXInputStickValue(
-                Pad->sThumbLY, XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE);
-
-              // DPAD, que l'on peut traiter comme le stick
-              bool32 Up = (Pad->wButtons & XINPUT_GAMEPAD_DPAD_UP);
-              bool32 Down = (Pad->wButtons & XINPUT_GAMEPAD_DPAD_DOWN);
-              bool32 Left = (Pad->wButtons & XINPUT_GAMEPAD_DPAD_LEFT);
-              bool32 Right = (Pad->wButtons & XINPUT_GAMEPAD_DPAD_RIGHT);
-
-              if (Up) NewController->StickAverageY = 1.0f;
-              if (Down) NewController->StickAverageY = -1.0f;
-              if (Left) NewController->StickAverageX = -1.0f;
-              if (Right) NewController->StickAverageX = 1.0f;
-
-              // Si un bouton est press au lieu du stick on dit qu'on n'est pas analogue, sinon si le stick est utilis on prvient
-              if(Up || Down || Left || Right) NewController->IsAnalog = false;
-              if(NewController->StickAverageX != 0.0f || NewController->StickAverageY != 0.0f) NewController->IsAnalog = true;
-
-              // Si on veut considrer le stick comme un bouton
-              real32 Threshold = 0.5f;
-              WORD VirtualLeft = NewController->StickAverageX < -Threshold ? 1 : 0;
-              WORD VirtualRight = NewController->StickAverageX > Threshold ? 1 : 0;
-              WORD VirtualUp = NewController->StickAverageY < -Threshold ? 1 : 0;
-              WORD VirtualDown = NewController->StickAverageY > Threshold ? 1 : 0;
-              Win32ProcessXInputDigitalButton(
-                VirtualLeft, &OldController->MoveLeft, 1,
-                &NewController->MoveLeft);
-              Win32ProcessXInputDigitalButton(
-                VirtualRight, &OldController->MoveRight, 1,
-                &NewController->MoveRight);
-              Win32ProcessXInputDigitalButton(
-                VirtualUp, &OldController->MoveUp, 1,
-                &NewController->MoveUp);
-              Win32ProcessXInputDigitalButton(
-                VirtualDown, &OldController->MoveDown, 1,
-                &NewController->MoveDown);
-
-              // Boutons
-              Win32ProcessXInputDigitalButton(
-                Pad->wButtons, &OldController->A,
-                XINPUT_GAMEPAD_A, &NewController->A);
-              Win32ProcessXInputDigitalButton(
-                Pad->wButtons, &OldController->B,
-                XINPUT_GAMEPAD_B, &NewController->B);
-              Win32ProcessXInputDigitalButton(
-                Pad->wButtons, &OldController->X,
-                XINPUT_GAMEPAD_X, &NewController->X);
-              Win32ProcessXInputDigitalButton(
-                Pad->wButtons, &OldController->Y,
-                XINPUT_GAMEPAD_Y, &NewController->Y);
-              Win32ProcessXInputDigitalButton(
-                Pad->wButtons, &OldController->LeftShoulder,
-                XINPUT_GAMEPAD_LEFT_SHOULDER, &NewController->LeftShoulder);
-              Win32ProcessXInputDigitalButton(
-                Pad->wButtons, &OldController->RightShoulder,
-                XINPUT_GAMEPAD_RIGHT_SHOULDER, &NewController->RightShoulder);
-              Win32ProcessXInputDigitalButton(
-                Pad->wButtons, &OldController->Back,
-                XINPUT_GAMEPAD_BACK, &NewController->Back);
-              Win32ProcessXInputDigitalButton(
-                Pad->wButtons, &OldController->Start,
-                XINPUT_GAMEPAD_START, &NewController->Start);
+              Win32ProcessXInputGamepad(Pad, OldController, NewController);
 
               // Vibration de la manette
               XINPUT_VIBRATION Vibration;
-              if (Left)
+              if (Pad->wButtons & XINPUT_GAMEPAD_DPAD_LEFT)
               {
                 Vibration.wLeftMotorSpeed = 60000;
                 Vibration.wRightMotorSpeed = 60000;
@@ -1011,16 +1941,68 @@ WinMain(HINSTANCE Instance,
           // Gestion de la pause
           if(!GlobalPause)
           {
+            TIMELINE_BEGIN(Timeline_Frame);
+            LARGE_INTEGER FrameStartCounter = LastCounter;
+
+            // Le backbuffer suit la taille de la fentre (sauf si elle est rduite)
+            win32_window_dimension Dimension = Win32GetWindowDimension(Window);
+            if (((Dimension.Width != GlobalBackBuffer.Width) ||
+                 (Dimension.Height != GlobalBackBuffer.Height)) &&
+                (Dimension.Width >= 16) && (Dimension.Height >= 16))
+            {
+              Win32ResizeOutput(Dimension.Width, Dimension.Height, RenderPixelFormat);
+            }
+
             // Passage du back buffer pour dessiner
-            game_offscreen_buffer Buffer = {};
-            Buffer.Memory = GlobalBackBuffer.Memory;
-            Buffer.Width = GlobalBackBuffer.Width;
-            Buffer.Height = GlobalBackBuffer.Height;
-            Buffer.Pitch = GlobalBackBuffer.Pitch;
+            // Si rien n'est  convertir ni  agrandir le jeu dessine directement dans le backbuffer
+            win32_window_dimension RenderDimension = Win32GetRenderDimension(&GlobalBackBuffer,
+                                                                             GlobalRenderScale);
+            bool32 RenderIsDirect = ((RenderPixelFormat == PixelFormat_XRGB8888) &&
+                                     (RenderDimension.Width == GlobalBackBuffer.Width) &&
+                                     (RenderDimension.Height == GlobalBackBuffer.Height));
+            win32_offscreen_buffer *RenderTarget = RenderIsDirect ? &GlobalBackBuffer : &GlobalRenderBuffer;
+            win32_frame_slot *Slot = 0;
+            if (GlobalFramePipeline.IsEnabled)
+            {
+              // Bloque seulement si le thread de prsentation a toutes les images en retard
+              Slot = Win32BeginPipelinedFrame(&GlobalFramePipeline);
+              RenderTarget = RenderIsDirect ? &Slot->DisplayBuffer : &Slot->RenderBuffer;
+            }
+            game_offscreen_buffer Buffer = Win32GetGameBuffer(RenderTarget);
+            Buffer.Width = RenderDimension.Width;
+            Buffer.Height = RenderDimension.Height;
 
             // On demande au moteur de jeu de gnrer les graphismes et le son
-            Game.UpdateAndRender(&GameMemory, NewInput, &Buffer);
+            NewInput->dtForFrame = LastFrameSeconds;
+            if (GlobalReplay.Mode == ReplayMode_Replay)
+            {
+              // Fin de l'enregistrement : cette dernire image n'est plus compare
+              if (!Win32ReplayInput(&GlobalReplay, NewInput))
+              {
+                Win32EndReplay(&GlobalReplay);
+                GlobalRunning = false;
+              }
+            }
+            game_input *FrameInput = NewInput;
+            if (GlobalNet.Mode != NetMode_None)
+            {
+              FrameInput = &NetFrameInput;
+              Win32BeginNetFrame(&GlobalNet, &Game, &GameMemory, NewInput, FrameInput);
+            }
+            TIMELINE_COUNTER(Timeline_RenderScale, 100.0f*GlobalRenderScale + 0.5f);
+            TIMELINE_BEGIN(Timeline_Update);
+            Game.UpdateAndRender(&GameMemory, FrameInput, &Buffer);
+            TIMELINE_END(Timeline_Update);
+            if (GlobalNet.Mode != NetMode_None)
+            {
+              Win32EndNetFrame(&GlobalNet);
+            }
+            if (GlobalReplay.Mode != ReplayMode_None)
+            {
+              Win32EndReplayFrame(&GlobalReplay, FrameInput, &GameMemory);
+            }
 
+            TIMELINE_BEGIN(Timeline_AudioFill);
             LARGE_INTEGER AudioWallClock = Win32GetWallClock();
             real32 FromBeginToAudioSeconds = Win32GetSecondsElapsed(FlipWallClock, AudioWallClock);
 
@@ -1061,7 +2043,7 @@ WinMain(HINSTANCE Instance,
                                   % SoundOutput.SecondaryBufferSize;
             
               DWORD ExpectedSoundBytesPerFrame = (SoundOutput.SamplesPerSecond * SoundOutput.BytesPerSample) /
-                                                  GameUpdateHz;
+                                                  RefreshHz;
               real32 SecondsLeftUntilFlip = (TargetSecondsPerFrame - FromBeginToAudioSeconds);
               DWORD ExpectedBytesUntilFlip = (DWORD)((SecondsLeftUntilFlip/TargetSecondsPerFrame)*(real32)ExpectedSoundBytesPerFrame);
               DWORD ExpectedFrameBoundaryByte = PlayCursor + ExpectedSoundBytesPerFrame;
@@ -1124,30 +2106,34 @@ WinMain(HINSTANCE Instance,
                                     (real32)SoundOutput.SamplesPerSecond);
 
               // Une sortie debug pour vrifier le son
-              char TextBuffer[256];
-              _snprintf_s(
-                TextBuffer,
-                sizeof(TextBuffer),
-                "BTL:%u TC:%u BTW:%u - PC:%u WC:%u DELTA:%u (%fs)\n",
-                ByteToLock, TargetCursor,
-                BytesToWrite, PlayCursor, WriteCursor,
-                AudioLatencyBytes, AudioLatencySeconds);
-              OutputDebugStringA(TextBuffer);
+              WIN32_LOG(LogFormat_AudioCursors, ByteToLock, TargetCursor, BytesToWrite,
+                        PlayCursor, WriteCursor, AudioLatencyBytes, AudioLatencySeconds);
   #endif
               Win32FillSoundBuffer(&SoundOutput, ByteToLock, BytesToWrite, &SoundBuffer);
+
+              TIMELINE_COUNTER(Timeline_PlayCursor, PlayCursor);
+              TIMELINE_COUNTER(Timeline_WriteCursor, WriteCursor);
+              TIMELINE_COUNTER(Timeline_ByteToLock, ByteToLock);
+              TIMELINE_COUNTER(Timeline_TargetCursor, TargetCursor);
+              TIMELINE_COUNTER(Timeline_BytesToWrite, BytesToWrite);
             }
             else
             {
               SoundIsValid = false;
             }
+            TIMELINE_END(Timeline_AudioFill);
 
             // Timing entre les images pour assurer un FPS constant
             LARGE_INTEGER WorkCounter = Win32GetWallClock();
             real32 WorkSecondsElapsed = Win32GetSecondsElapsed(LastCounter, WorkCounter);
+            // La rsolution de la prochaine image dpend du temps de calcul de celle-ci
+            Win32UpdateResolutionController(&GlobalResolutionController,
+                                            WorkSecondsElapsed, TargetSecondsPerFrame);
           
             real32 SecondsElapsedForFrame = WorkSecondsElapsed;
             if (SecondsElapsedForFrame < TargetSecondsPerFrame)
             {
+              TIMELINE_BEGIN(Timeline_Sleep);
               if (SleepIsGranular)
               {
                 DWORD SleepMS = (DWORD)(1000.0f * (TargetSecondsPerFrame - SecondsElapsedForFrame));
@@ -1165,31 +2151,59 @@ WinMain(HINSTANCE Instance,
                 SecondsElapsedForFrame = Win32GetSecondsElapsed(LastCounter,
                                                                 Win32GetWallClock());
               }
+              TIMELINE_END(Timeline_Sleep);
             }
             else
             {
-              // Problme de timing, qu'il faudra logguer
+              // Problme de timing : compt et pris en charge par le rgulateur de rsolution
+              TIMELINE_INSTANT(Timeline_MissedFrame);
             }
 
             // Remplacement du compteur d'images pour le timing
             LARGE_INTEGER EndCounter = Win32GetWallClock();
-            real32 MSPerFrame = 1000.0f * Win32GetSecondsElapsed(LastCounter, EndCounter);
+            LastFrameSeconds = Win32GetSecondsElapsed(LastCounter, EndCounter);
+            real32 MSPerFrame = 1000.0f * LastFrameSeconds;
             LastCounter = EndCounter;
 
             // On doit alors crire dans la fentre  chaque fois que l'on veut rendre
-            // On en fera une fonction propre
-            win32_window_dimension Dimension = Win32GetWindowDimension(Window);
+            real32 LatencySeconds = 0.0f;
+            if (Slot)
+            {
+              // Le thread de prsentation affiche cette image pendant que l'on calcule la suivante
+              // (pas d'affichage de la syncro audio dans ce mode)
+              Slot->Buffer = Buffer;
+              Slot->RenderIsDirect = RenderIsDirect;
+              Slot->WindowWidth = Dimension.Width;
+              Slot->WindowHeight = Dimension.Height;
+              Slot->FrameStartCounter = FrameStartCounter;
+              memcpy(Slot->OverlayText, GlobalOverlayText, sizeof(Slot->OverlayText));
+              Win32SubmitPipelinedFrame(&GlobalFramePipeline, Slot);
+              LatencySeconds = GlobalFramePipeline.LastLatencySeconds;
+            }
+            else
+            {
+              TIMELINE_BEGIN(Timeline_Present);
+              if (!RenderIsDirect)
+              {
+                Win32ResolveRenderBuffer(&GlobalUpscaler, &GlobalBackBuffer, &Buffer);
+              }
+              Win32DrawDebugOverlay(&GlobalBackBuffer, GlobalOverlayText);
   #if FAITMAIN_INTERNAL
-            Win32DebugSyncDisplay(
-              &GlobalBackBuffer,
-              ArrayCount(DebugTimeMarkers),
-              DebugTimeMarkers,
-              DebugTimeMarkerIndex - 1, // Faux  l'index 0 mais ce n'est pas grave pour le moment
-              &SoundOutput,
-              TargetSecondsPerFrame);
+              Win32DebugSyncDisplay(
+                &GlobalBackBuffer,
+                ArrayCount(DebugTimeMarkers),
+                DebugTimeMarkers,
+                DebugTimeMarkerIndex - 1, // Faux  l'index 0 mais ce n'est pas grave pour le moment
+                &SoundOutput,
+                TargetSecondsPerFrame);
   #endif
-            Win32DisplayBufferInWindow(&GlobalBackBuffer, DeviceContext,
-                                       Dimension.Width, Dimension.Height);
+              Win32CaptureFrame(&GlobalCapture, &GlobalBackBuffer, &GameMemory.PlatformAPI,
+                                &HighPriorityQueue, HighPriorityThreadCount + 1);
+              Win32DisplayBufferInWindow(&GlobalBackBuffer, DeviceContext,
+                                         Dimension.Width, Dimension.Height);
+              TIMELINE_END(Timeline_Present);
+              LatencySeconds = Win32GetSecondsElapsed(FrameStartCounter, Win32GetWallClock());
+            }
           
             // PROBLEME avec ce RealeaseDC,  vrifier
             // ReleaseDC(Window, DeviceContext);
@@ -1207,6 +2221,8 @@ WinMain(HINSTANCE Instance,
                 win32_debug_time_marker *Marker = &DebugTimeMarkers[DebugTimeMarkerIndex];
                 Marker->FlipPlayCursor = PlayCursor;
                 Marker->FlipWriteCursor = WriteCursor;
+                TIMELINE_COUNTER(Timeline_FlipPlayCursor, PlayCursor);
+                TIMELINE_COUNTER(Timeline_FlipWriteCursor, WriteCursor);
               }
             }
             ++DebugTimeMarkerIndex;
@@ -1224,39 +2240,83 @@ WinMain(HINSTANCE Instance,
     #if 1
             real32 FPS = 0.0f; //(real32)PerfCountFrequency / (real32)CounterElapsed;
             real32 MCPF = (real32)CyclesElapsed / 1000000.0f;
-  
-            char FPSBuffer[256];
-            _snprintf_s(
-              FPSBuffer,
-              sizeof(FPSBuffer),
-              "%0.2f ms/f, %0.2f f/s, %0.2f Mc/f\n",
-              MSPerFrame,
-              FPS,
-              MCPF);
-            OutputDebugStringA(FPSBuffer);
+
+            // Affiche par-dessus l'image suivante
+            if (GlobalShowOverlay)
+            {
+              _snprintf_s(
+                GlobalOverlayText,
+                sizeof(GlobalOverlayText),
+                _TRUNCATE,
+                "%0.2f ms/f, %0.2f f/s, %0.2f Mc/f, %0.2f ms lat\n",
+                MSPerFrame,
+                FPS,
+                MCPF,
+                1000.0f*LatencySeconds); // Dbut de l'image jusqu' l'affichage (prcdente en mode pipeline)
+            }
+            else
+            {
+              GlobalOverlayText[0] = 0;
+            }
+            WIN32_LOG(LogFormat_FrameTime, MSPerFrame, FPS, MCPF, 1000.0f*LatencySeconds);
+            if (!StartupReported)
+            {
+              PROCESS_MEMORY_COUNTERS_EX ProcessMemory = Win32GetProcessMemory();
+              WIN32_LOG(LogFormat_GameMemoryStartup,
+                        GameMemory.IsCommittedOnDemand ? "engagement a la demande" : "tout engage",
+                        Win32GetCommittedSize(GameMemory.PermanentStorage, TotalSize) / 1024, TotalSize / 1024,
+                        1000.0f*AllocationSeconds, 1000.0f*Win32GetSecondsElapsed(StartupCounter, Win32GetWallClock()),
+                        (uint64)ProcessMemory.WorkingSetSize / 1024, (uint64)ProcessMemory.PrivateUsage / 1024);
+              StartupReported = true;
+            }
     #endif
+            TIMELINE_END(Timeline_Frame);
           } // Fin GlobalPause
+
+  #if FAITMAIN_INTERNAL
+          if (GlobalTimeline.ExportRequested)
+          {
+            Win32WriteTimeline(&GlobalTimeline, "timeline.json");
+            GlobalTimeline.ExportRequested = false;
+          }
+  #endif
           
           // Gestion des entres
           game_input *Temp = NewInput;
           NewInput = OldInput;
           OldInput = Temp;
         }
+
+        Win32EndReplay(&GlobalReplay);
+        Win32EndNetSession(&GlobalNet);
+        // Le thread de prsentation peut encore capturer les images en attente
+        if (GlobalFramePipeline.IsEnabled)
+        {
+          for (uint32 SlotIndex = 0; SlotIndex < GlobalFramePipeline.SlotCount; ++SlotIndex)
+          {
+            WaitForSingleObjectEx(GlobalFramePipeline.FreeSlotSemaphore, INFINITE, FALSE);
+          }
+        }
+        Win32EndCapture(&GlobalCapture);
+        PROCESS_MEMORY_COUNTERS_EX ProcessMemory = Win32GetProcessMemory();
+        WIN32_LOG(LogFormat_GameMemoryEnd, Win32GetCommittedSize(GameMemory.PermanentStorage, TotalSize) / 1024,
+                  TotalSize / 1024, (uint64)ProcessMemory.PeakWorkingSetSize / 1024);
       }
       else
       {
-        OutputDebugStringA("Error: Memory not allocated\n");
+        WIN32_LOG(LogFormat_MemoryNotAllocated);
       }
     }
     else
     {
-      OutputDebugStringA("Error: CreateWindowEx\n");
+      WIN32_LOG(LogFormat_CreateWindowFailed);
     }
   }
   else
   {
-    OutputDebugStringA("Error: RegisterClass\n");
+    WIN32_LOG(LogFormat_RegisterClassFailed);
   }
 
+  Win32StopLogger(&GlobalLogger);
   return(0);
 };
\ No newline at end of file
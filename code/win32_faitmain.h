@@ -8,6 +8,93 @@ struct win32_offscreen_buffer {
   int Height;
   int BytesPerPixel;
   int Pitch; // Pitch reprsente la taille d'une ligne en octets
+  game_pixel_format PixelFormat;
+};
+
+// Filtres possibles pour agrandir le buffer de rendu jusqu'au backbuffer
+enum win32_upscale_filter
+{
+  UpscaleFilter_Bilinear,
+  UpscaleFilter_Nearest,
+};
+
+// Etat de la mise  l'chelle du buffer de rendu vers le backbuffer
+// Les tables par colonne ne sont recalcules que si les dimensions changent
+struct win32_upscaler
+{
+  win32_upscale_filter Filter;
+  int MaxWidth;
+  int SourceWidth;
+  int SourceHeight;
+  int DestWidth;
+  int DestHeight;
+  bool32 IsDouble; // Rapport exactement 2 : simple duplication des pixels
+
+  int32 *SourceX;  // Premire colonne source de chaque colonne destination
+  int32 *NearestX; // Colonne source la plus proche
+  int16 *WeightX;  // Poids bilinaire sur 7 bits, rpt sur les 4 canaux
+  uint32 *RowCache[2]; // Lignes source converties en XRGB8888 si besoin
+  int RowCacheY[2];
+  uint32 *BlendRow; // Rsultat de l'interpolation verticale
+  void *Memory;
+};
+
+// Rgulation de la rsolution de rendu pour tenir le budget de temps par image
+// Hystrsis : seuils haut et bas distincts, raction rapide  la baisse,
+// lente  la hausse, et une priode d'attente aprs chaque changement
+struct win32_resolution_controller
+{
+  bool32 IsEnabled;
+  real32 SmoothedWorkSeconds; // Moyenne glissante du temps de calcul
+  real32 LowerBudgetRatio;    // En dessous on peut monter la rsolution
+  real32 UpperBudgetRatio;    // Au dessus on la baisse
+  int FramesOverBudget;
+  int FramesUnderBudget;
+  int CooldownFrames;
+  uint32 FrameIndex;
+  uint32 MissedFrameCount;
+};
+
+// Une image en cours dans le pipeline : dessine par le jeu puis affiche
+struct win32_frame_slot
+{
+  win32_offscreen_buffer RenderBuffer;  // Format et taille de rendu du jeu
+  win32_offscreen_buffer DisplayBuffer; // XRGB8888  la taille de la fentre
+  game_offscreen_buffer Buffer;         // Zone effectivement dessine par le jeu
+  bool32 RenderIsDirect;                // Le jeu a dessin directement dans DisplayBuffer
+  int WindowWidth;
+  int WindowHeight;
+  LARGE_INTEGER FrameStartCounter;      // Dbut de l'image, pour mesurer la latence
+  char OverlayText[128];                // Copie de la ligne de statistiques  afficher
+};
+
+/*
+  Pipeline d'images : un thread de prsentation convertit et affiche l'image N
+  pendant que le thread du jeu calcule l'image N+1. Les slots tournent dans
+  l'ordre, deux smaphores comptent les slots libres et ceux  afficher.
+*/
+#define FramePipelineMaxSlotCount 3
+struct win32_frame_pipeline
+{
+  bool32 IsEnabled;
+  uint32 SlotCount;
+  win32_frame_slot Slots[FramePipelineMaxSlotCount];
+  win32_upscaler *Upscaler;
+  HDC DeviceContext; // 0 en mode sans fentre (benchmarks)
+
+  HANDLE FreeSlotSemaphore;
+  HANDLE ReadySlotSemaphore;
+  uint32 NextSlotToWrite;   // Ct jeu
+  uint32 NextSlotToPresent; // Ct prsentation
+
+  // Le thread de prsentation et WM_PAINT dessinent dans le mme DC (CS_OWNDC)
+  CRITICAL_SECTION PresentLock;
+
+  // Ecrits par le thread de prsentation
+  win32_offscreen_buffer * volatile LastPresented;
+  uint32 volatile PresentedCount;
+  real32 volatile LastLatencySeconds;
+  real64 LatencySecondsSum;
 };
 
 // Struct qui reprsente des dimensions
@@ -30,6 +117,25 @@ struct win32_sound_output
   real32 tSine;
 };
 
+// File de travail partage par les threads de fond
+struct platform_work_queue_entry
+{
+  platform_work_queue_callback *Callback;
+  void *Data;
+};
+
+struct platform_work_queue
+{
+  uint32 volatile CompletionGoal;
+  uint32 volatile CompletionCount;
+
+  uint32 volatile NextEntryToWrite;
+  uint32 volatile NextEntryToRead;
+  HANDLE SemaphoreHandle;
+
+  platform_work_queue_entry Entries[256];
+};
+
 struct win32_debug_time_marker
 {
   DWORD OutputPlayCursor;
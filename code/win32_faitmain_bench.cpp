@@ -0,0 +1,4076 @@
+/*
+  Benchmarks des noyaux de calcul, lancs avec l'option -bench (builds internes seulement)
+  Chaque mesure part dans la sortie de debug et le rapport complet est crit dans bench.out
+*/
+#include <stdarg.h>
+#include "faitmain_resampler.h"
+// Le jeu entier, pour les mesures qui le font tourner (rollback) : ses sous-systmes viennent avec
+#include "faitmain.cpp"
+
+struct win32_bench_report
+{
+  char *Text;
+  uint32 Size;
+  uint32 Used;
+};
+
+struct win32_bench_timer
+{
+  LARGE_INTEGER StartCounter;
+  uint64 StartCycles;
+};
+
+struct win32_bench_timing
+{
+  real32 Seconds;
+  uint64 Cycles;
+};
+
+internal void
+Win32BenchPrint(win32_bench_report *Report, char *Format, ...)
+{
+  char Line[512];
+  va_list Args;
+  va_start(Args, Format);
+  _vsnprintf_s(Line, sizeof(Line), _TRUNCATE, Format, Args);
+  va_end(Args);
+  OutputDebugStringA(Line);
+
+  uint32 Length = (uint32)strlen(Line);
+  if (Report->Used + Length <= Report->Size)
+  {
+    memcpy(Report->Text + Report->Used, Line, Length);
+    Report->Used += Length;
+  }
+}
+
+inline win32_bench_timer
+Win32BenchBegin(void)
+{
+  win32_bench_timer Result;
+  Result.StartCounter = Win32GetWallClock();
+  Result.StartCycles = __rdtsc();
+  return(Result);
+}
+
+inline win32_bench_timing
+Win32BenchEnd(win32_bench_timer Timer)
+{
+  win32_bench_timing Result;
+  Result.Cycles = __rdtsc() - Timer.StartCycles;
+  Result.Seconds = Win32GetSecondsElapsed(Timer.StartCounter, Win32GetWallClock());
+  return(Result);
+}
+
+inline game_offscreen_buffer
+Win32BenchMakeBuffer(void *Memory, int Width, int Height, game_pixel_format PixelFormat)
+{
+  game_offscreen_buffer Result = {};
+  Result.Memory = Memory;
+  Result.Width = Width;
+  Result.Height = Height;
+  Result.PixelFormat = PixelFormat;
+  Result.BytesPerPixel = GetBytesPerPixel(PixelFormat);
+  Result.Pitch = Width * Result.BytesPerPixel;
+  return(Result);
+}
+
+/**
+ * File de travail des mesures multi-threads, cre une seule fois pour tout
+ * le mode -bench, avec un thread par processeur en plus du thread principal
+ **/
+internal platform_work_queue *
+Win32BenchGetWorkQueue(uint32 *ThreadCount)
+{
+  local_persist platform_work_queue Queue = {};
+  local_persist uint32 QueueThreadCount = 0;
+  if (!QueueThreadCount)
+  {
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+    QueueThreadCount = (SystemInfo.dwNumberOfProcessors > 1) ? (uint32)(SystemInfo.dwNumberOfProcessors - 1) : 1;
+    Win32MakeQueue(&Queue, QueueThreadCount);
+  }
+  *ThreadCount = QueueThreadCount;
+  return(&Queue);
+}
+
+global_variable char *DebugPixelFormatNames[PixelFormat_Count] =
+{
+  "XRGB8888",
+  "RGBA8888",
+  "RGB565",
+  "RGBA32F",
+};
+
+/**
+ * Dbit de chaque paire de formats de pixels sur une image 1080p
+ **/
+internal void
+Win32BenchPixelConversions(win32_bench_report *Report)
+{
+  int Width = 1920;
+  int Height = 1080;
+  int Iterations = 20;
+  SIZE_T MaxBufferSize = Width * Height * GetBytesPerPixel(PixelFormat_RGBA32F);
+  void *PatternMemory = VirtualAlloc(0, MaxBufferSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  void *SourceMemory = VirtualAlloc(0, MaxBufferSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  void *DestMemory = VirtualAlloc(0, MaxBufferSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (PatternMemory && SourceMemory && DestMemory)
+  {
+    // Motif de dpart en XRGB8888, converti ensuite dans chaque format source
+    game_offscreen_buffer Pattern = Win32BenchMakeBuffer(PatternMemory, Width, Height,
+                                                         PixelFormat_XRGB8888);
+    uint32 *Pixel = (uint32 *)PatternMemory;
+    for (int Y = 0; Y < Height; ++Y)
+    {
+      for (int X = 0; X < Width; ++X)
+      {
+        *Pixel++ = (uint32)(X*0x00010203 + Y*0x00030201);
+      }
+    }
+
+    Win32BenchPrint(Report, "\n-- Conversions de pixels %dx%d --\n", Width, Height);
+    for (int SourceIndex = 0; SourceIndex < PixelFormat_Count; ++SourceIndex)
+    {
+      for (int DestIndex = 0; DestIndex < PixelFormat_Count; ++DestIndex)
+      {
+        if (SourceIndex == DestIndex) continue;
+
+        game_offscreen_buffer Source = Win32BenchMakeBuffer(SourceMemory, Width, Height,
+                                                            (game_pixel_format)SourceIndex);
+        game_offscreen_buffer Dest = Win32BenchMakeBuffer(DestMemory, Width, Height,
+                                                          (game_pixel_format)DestIndex);
+        ConvertOffscreenBuffer(&Source, &Pattern);
+        // Un premier passage pour chauffer les caches et initialiser les tables
+        ConvertOffscreenBuffer(&Dest, &Source);
+
+        win32_bench_timer Timer = Win32BenchBegin();
+        for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+        {
+          ConvertOffscreenBuffer(&Dest, &Source);
+        }
+        win32_bench_timing Timing = Win32BenchEnd(Timer);
+
+        real32 PixelCount = (real32)Width * (real32)Height * (real32)Iterations;
+        Win32BenchPrint(Report, "%-8s -> %-8s : %6.2f cy/px %8.1f Mpx/s\n",
+                        DebugPixelFormatNames[SourceIndex],
+                        DebugPixelFormatNames[DestIndex],
+                        (real32)Timing.Cycles / PixelCount,
+                        PixelCount / (1000000.0f * Timing.Seconds));
+      }
+    }
+  }
+  if (PatternMemory) VirtualFree(PatternMemory, 0, MEM_RELEASE);
+  if (SourceMemory) VirtualFree(SourceMemory, 0, MEM_RELEASE);
+  if (DestMemory) VirtualFree(DestMemory, 0, MEM_RELEASE);
+}
+
+/*
+  Versions gnriques des noyaux de dessin, avec le format et le mode tests
+   chaque pixel : la rfrence de vitesse et de rsultat des templates
+*/
+internal void
+Win32BenchRenderGradientGeneric(game_offscreen_buffer *Buffer, int XOffset, int YOffset)
+{
+  uint8 *Row = (uint8 *)Buffer->Memory;
+  for (int Y = 0; Y < Buffer->Height; ++Y)
+  {
+    uint8 *Pixel = Row;
+    for (int X = 0; X < Buffer->Width; ++X)
+    {
+      uint8 Blue = (uint8)(X + XOffset);
+      uint8 Green = (uint8)(Y + YOffset);
+      uint8 Red = (uint8)(X + Y);
+      switch (Buffer->PixelFormat)
+      {
+        case PixelFormat_XRGB8888: *(uint32 *)Pixel = pixel_traits<PixelFormat_XRGB8888>::FromBytes(Red, Green, Blue); break;
+        case PixelFormat_RGBA8888: *(uint32 *)Pixel = pixel_traits<PixelFormat_RGBA8888>::FromBytes(Red, Green, Blue); break;
+        case PixelFormat_RGB565: *(uint16 *)Pixel = pixel_traits<PixelFormat_RGB565>::FromBytes(Red, Green, Blue); break;
+        case PixelFormat_RGBA32F: *(pixel_rgba32f *)Pixel = pixel_traits<PixelFormat_RGBA32F>::FromBytes(Red, Green, Blue); break;
+        default: break;
+      }
+      Pixel += Buffer->BytesPerPixel;
+    }
+    Row += Buffer->Pitch;
+  }
+}
+
+internal void
+Win32BenchFillRectangleGeneric(game_offscreen_buffer *Buffer, int MinX, int MinY, int MaxX, int MaxY,
+                               draw_color Color, blend_mode Mode)
+{
+  if (MinX < 0) MinX = 0;
+  if (MinY < 0) MinY = 0;
+  if (MaxX > Buffer->Width) MaxX = Buffer->Width;
+  if (MaxY > Buffer->Height) MaxY = Buffer->Height;
+  uint8 *Row = (uint8 *)Buffer->Memory + MinY*Buffer->Pitch;
+  for (int Y = MinY; Y < MaxY; ++Y)
+  {
+    uint8 *Pixel = Row + MinX*Buffer->BytesPerPixel;
+    for (int X = MinX; X < MaxX; ++X)
+    {
+      draw_channels Source = {};
+      draw_channels Dest = {};
+      real32 Max = 255.0f;
+      switch (Buffer->PixelFormat)
+      {
+        case PixelFormat_XRGB8888:
+          Source = pixel_traits<PixelFormat_XRGB8888>::FromColor(Color);
+          Dest = pixel_traits<PixelFormat_XRGB8888>::Unpack(*(uint32 *)Pixel);
+          break;
+        case PixelFormat_RGBA8888:
+          Source = pixel_traits<PixelFormat_RGBA8888>::FromColor(Color);
+          Dest = pixel_traits<PixelFormat_RGBA8888>::Unpack(*(uint32 *)Pixel);
+          break;
+        case PixelFormat_RGB565:
+          Source = pixel_traits<PixelFormat_RGB565>::FromColor(Color);
+          Dest = pixel_traits<PixelFormat_RGB565>::Unpack(*(uint16 *)Pixel);
+          break;
+        case PixelFormat_RGBA32F:
+          Source = pixel_traits<PixelFormat_RGBA32F>::FromColor(Color);
+          Dest = pixel_traits<PixelFormat_RGBA32F>::Unpack(*(pixel_rgba32f *)Pixel);
+          Max = 1.0f;
+          break;
+        default: break;
+      }
+      switch (Mode)
+      {
+        case BlendMode_Replace:
+          Dest = Source;
+          break;
+        case BlendMode_Alpha:
+          Dest.R += (Source.R - Dest.R)*Source.A;
+          Dest.G += (Source.G - Dest.G)*Source.A;
+          Dest.B += (Source.B - Dest.B)*Source.A;
+          break;
+        case BlendMode_Additive:
+          Dest.R += Source.R*Source.A;
+          Dest.G += Source.G*Source.A;
+          Dest.B += Source.B*Source.A;
+          if (Dest.R > Max) Dest.R = Max;
+          if (Dest.G > Max) Dest.G = Max;
+          if (Dest.B > Max) Dest.B = Max;
+          break;
+        default: break;
+      }
+      switch (Buffer->PixelFormat)
+      {
+        case PixelFormat_XRGB8888: *(uint32 *)Pixel = pixel_traits<PixelFormat_XRGB8888>::Pack(Dest); break;
+        case PixelFormat_RGBA8888: *(uint32 *)Pixel = pixel_traits<PixelFormat_RGBA8888>::Pack(Dest); break;
+        case PixelFormat_RGB565: *(uint16 *)Pixel = pixel_traits<PixelFormat_RGB565>::Pack(Dest); break;
+        case PixelFormat_RGBA32F: *(pixel_rgba32f *)Pixel = pixel_traits<PixelFormat_RGBA32F>::Pack(Dest); break;
+        default: break;
+      }
+      Pixel += Buffer->BytesPerPixel;
+    }
+    Row += Buffer->Pitch;
+  }
+}
+
+global_variable char *DebugBlendModeNames[BlendMode_Count] =
+{
+  "remplace",
+  "alpha",
+  "additif",
+};
+
+/**
+ * Noyaux de dessin spcialiss contre les boucles gnriques sur une image
+ * 1080p : le gradient plein cran puis un grand rectangle dans chaque mode.
+ * Les deux versions doivent donner exactement les mmes pixels.
+ **/
+internal void
+Win32BenchDrawKernels(win32_bench_report *Report)
+{
+  int Width = 1920;
+  int Height = 1080;
+  int Iterations = 10;
+  SIZE_T MaxBufferSize = Width * Height * GetBytesPerPixel(PixelFormat_RGBA32F);
+  void *SpecializedMemory = VirtualAlloc(0, MaxBufferSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  void *GenericMemory = VirtualAlloc(0, MaxBufferSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (SpecializedMemory && GenericMemory)
+  {
+    Win32BenchPrint(Report, "\n-- Noyaux de dessin %dx%d (template / generique) --\n", Width, Height);
+    draw_color Color = {0.8f, 0.4f, 0.2f, 0.5f};
+    real32 PixelCount = (real32)Width * (real32)Height * (real32)Iterations;
+    for (int FormatIndex = 0; FormatIndex < PixelFormat_Count; ++FormatIndex)
+    {
+      game_pixel_format Format = (game_pixel_format)FormatIndex;
+      game_offscreen_buffer Specialized = Win32BenchMakeBuffer(SpecializedMemory, Width, Height, Format);
+      game_offscreen_buffer Generic = Win32BenchMakeBuffer(GenericMemory, Width, Height, Format);
+      draw_kernels *Kernels = GetDrawKernels(&Specialized);
+      SIZE_T BufferSize = (SIZE_T)Specialized.Pitch*Height;
+
+      win32_bench_timer Timer = Win32BenchBegin();
+      for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+      {
+        Kernels->RenderGradient(&Specialized, Iteration, 2*Iteration);
+      }
+      win32_bench_timing SpecializedTiming = Win32BenchEnd(Timer);
+      Timer = Win32BenchBegin();
+      for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+      {
+        Win32BenchRenderGradientGeneric(&Generic, Iteration, 2*Iteration);
+      }
+      win32_bench_timing GenericTiming = Win32BenchEnd(Timer);
+      bool32 Same = (memcmp(SpecializedMemory, GenericMemory, BufferSize) == 0);
+      Win32BenchPrint(Report, "%-8s gradient : %6.2f / %6.2f cy/px (x%4.2f) %s\n",
+                      DebugPixelFormatNames[FormatIndex],
+                      (real32)SpecializedTiming.Cycles / PixelCount, (real32)GenericTiming.Cycles / PixelCount,
+                      (real32)GenericTiming.Cycles / (real32)SpecializedTiming.Cycles,
+                      Same ? "OK" : "ECHEC");
+
+      for (int ModeIndex = 0; ModeIndex < BlendMode_Count; ++ModeIndex)
+      {
+        blend_mode Mode = (blend_mode)ModeIndex;
+        // Le rectangle dpasse du buffer pour passer par le dcoupage
+        int MinX = -32, MinY = -32, MaxX = Width + 32, MaxY = Height + 32;
+        Timer = Win32BenchBegin();
+        for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+        {
+          DrawRectangle(Kernels, &Specialized, MinX, MinY, MaxX, MaxY, Color, Mode);
+        }
+        SpecializedTiming = Win32BenchEnd(Timer);
+        Timer = Win32BenchBegin();
+        for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+        {
+          Win32BenchFillRectangleGeneric(&Generic, MinX, MinY, MaxX, MaxY, Color, Mode);
+        }
+        GenericTiming = Win32BenchEnd(Timer);
+        Same = (memcmp(SpecializedMemory, GenericMemory, BufferSize) == 0);
+        Win32BenchPrint(Report, "%-8s %-8s : %6.2f / %6.2f cy/px (x%4.2f) %s\n",
+                        DebugPixelFormatNames[FormatIndex], DebugBlendModeNames[ModeIndex],
+                        (real32)SpecializedTiming.Cycles / PixelCount, (real32)GenericTiming.Cycles / PixelCount,
+                        (real32)GenericTiming.Cycles / (real32)SpecializedTiming.Cycles,
+                        Same ? "OK" : "ECHEC");
+      }
+    }
+  }
+  if (SpecializedMemory) VirtualFree(SpecializedMemory, 0, MEM_RELEASE);
+  if (GenericMemory) VirtualFree(GenericMemory, 0, MEM_RELEASE);
+}
+
+// Une ligne de table de profilage, tous les caractres imprimables y passent
+inline char
+Win32BenchTextChar(int LineIndex, int Char, int Phase)
+{
+  char Result = (char)(33 + (LineIndex*7 + Char + Phase) % 94);
+  return(Result);
+}
+
+/**
+ * Texte de debug : 5000 caractres par image (50 lignes de 100) dans
+ * chaque format,  l'chelle 1 et 2. Le rsultat est compar  un dessin
+ * pixel par pixel directement depuis la police.
+ **/
+internal void
+Win32BenchText(win32_bench_report *Report)
+{
+  int Width = 1920;
+  int Height = 1080;
+  int Iterations = 20;
+  SIZE_T MaxBufferSize = Width * Height * GetBytesPerPixel(PixelFormat_RGBA32F);
+  uint64 ArenaSize = Megabytes(2);
+  void *TextMemory = VirtualAlloc(0, MaxBufferSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  void *ReferenceMemory = VirtualAlloc(0, MaxBufferSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  void *ArenaMemory = VirtualAlloc(0, (SIZE_T)ArenaSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (TextMemory && ReferenceMemory && ArenaMemory)
+  {
+    Win32BenchPrint(Report, "\n-- Texte de debug (5000 caracteres par image) --\n");
+    memory_arena Arena;
+    InitializeArena(&Arena, ArenaSize, ArenaMemory);
+    glyph_atlas Atlas;
+    InitializeGlyphAtlas(&Atlas, &Arena, 2);
+    text_batch Batch;
+    InitializeTextBatch(&Batch, &Arena, 8192);
+    uint32 Color = 0x00FFC040;
+
+    int LineCount = 50;
+    int LineLength = 100;
+    char Line[128];
+    for (int ScaleIndex = 1; ScaleIndex <= 2; ++ScaleIndex)
+    {
+      for (int FormatIndex = 0; FormatIndex < PixelFormat_Count; ++FormatIndex)
+      {
+        game_pixel_format Format = (game_pixel_format)FormatIndex;
+        game_offscreen_buffer Buffer = Win32BenchMakeBuffer(TextMemory, Width, Height, Format);
+        game_offscreen_buffer Reference = Win32BenchMakeBuffer(ReferenceMemory, Width, Height, Format);
+        SIZE_T BufferSize = (SIZE_T)Buffer.Pitch*Height;
+        memset(TextMemory, 0x40, BufferSize);
+        memset(ReferenceMemory, 0x40, BufferSize);
+
+        win32_bench_timer Timer = Win32BenchBegin();
+        PrepareGlyphAtlas(&Atlas, Format, ScaleIndex, Color);
+        win32_bench_timing PrepareTiming = Win32BenchEnd(Timer);
+
+        uint32 GlyphCount = 0;
+        Timer = Win32BenchBegin();
+        for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+        {
+          int Y = 4;
+          for (int LineIndex = 0; LineIndex < LineCount; ++LineIndex)
+          {
+            for (int Char = 0; Char < LineLength; ++Char)
+            {
+              Line[Char] = Win32BenchTextChar(LineIndex, Char, Iteration);
+            }
+            Line[LineLength] = 0;
+            Y = PushText(&Batch, &Buffer, &Atlas, 4, Y, Line);
+          }
+          GlyphCount = Batch.Count;
+          DrawTextBatch(&Buffer, &Atlas, &Batch);
+        }
+        win32_bench_timing DrawTiming = Win32BenchEnd(Timer);
+
+        // Vrification sur une image seule, compare  un dessin pixel par pixel
+        // directement depuis les colonnes de la police
+        memset(TextMemory, 0x40, BufferSize);
+        int Y = 4;
+        for (int LineIndex = 0; LineIndex < LineCount; ++LineIndex)
+        {
+          for (int Char = 0; Char < LineLength; ++Char)
+          {
+            Line[Char] = Win32BenchTextChar(LineIndex, Char, 0);
+          }
+          Line[LineLength] = 0;
+          Y = PushText(&Batch, &Buffer, &Atlas, 4, Y, Line);
+        }
+        DrawTextBatch(&Buffer, &Atlas, &Batch);
+
+        uint8 Packed[16];
+        ConvertPixelRow(Format, Packed, PixelFormat_XRGB8888, &Color, 1);
+        int Scale = Atlas.Scale;
+        Y = 4;
+        for (int LineIndex = 0; LineIndex < LineCount; ++LineIndex)
+        {
+          for (int Char = 0; Char < LineLength; ++Char)
+          {
+            uint32 Glyph = GetGlyphIndex(Win32BenchTextChar(LineIndex, Char, 0));
+            int GlyphX = 4 + Char*Atlas.GlyphWidth;
+            if (!IsGlyphInside(&Reference, &Atlas, GlyphX, Y)) continue;
+            for (int PixelY = 0; PixelY < Atlas.GlyphHeight; ++PixelY)
+            {
+              for (int PixelX = 0; PixelX < Atlas.GlyphWidth; ++PixelX)
+              {
+                int Column = PixelX / Scale;
+                if ((Column < DebugFontColumnCount) && (DebugFontColumns[Glyph][Column] & (1 << (PixelY / Scale))))
+                {
+                  memcpy((uint8 *)ReferenceMemory + (Y + PixelY)*Reference.Pitch +
+                         (GlyphX + PixelX)*Reference.BytesPerPixel, Packed, Reference.BytesPerPixel);
+                }
+              }
+            }
+          }
+          Y += Atlas.GlyphHeight + Atlas.Scale;
+        }
+        bool32 Same = (memcmp(TextMemory, ReferenceMemory, BufferSize) == 0);
+
+        real32 FrameCount = (real32)Iterations;
+        Win32BenchPrint(Report, "%-8s x%d : %7.3f ms/image (%5.1f ns/car, %u car), atlas %6.3f ms, %s\n",
+                        DebugPixelFormatNames[FormatIndex], ScaleIndex,
+                        1000.0f*DrawTiming.Seconds / FrameCount,
+                        1e9f*DrawTiming.Seconds / (FrameCount*(real32)GlyphCount), GlyphCount,
+                        1000.0f*PrepareTiming.Seconds, Same ? "OK" : "ECHEC");
+      }
+    }
+  }
+  if (TextMemory) VirtualFree(TextMemory, 0, MEM_RELEASE);
+  if (ReferenceMemory) VirtualFree(ReferenceMemory, 0, MEM_RELEASE);
+  if (ArenaMemory) VirtualFree(ArenaMemory, 0, MEM_RELEASE);
+}
+
+/**
+ * Cot de l'agrandissement du buffer de rendu vers une sortie 1080p
+ **/
+internal void
+Win32BenchUpscaler(win32_bench_report *Report)
+{
+  int Width = 1920;
+  int Height = 1080;
+  int Iterations = 20;
+  win32_offscreen_buffer Dest = {};
+  Win32ResizeDIBSection(&Dest, Width, Height, PixelFormat_XRGB8888);
+  void *SourceMemory = VirtualAlloc(0, Width*Height*sizeof(uint32), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  win32_upscaler Scaler = {};
+  Win32ResizeUpscaler(&Scaler, Width);
+  if (Dest.Memory && SourceMemory && Scaler.Memory)
+  {
+    Win32BenchPrint(Report, "\n-- Mise a l'echelle vers %dx%d --\n", Width, Height);
+    real32 Scales[] = {0.5f, 0.75f, 0.9f};
+    for (int ScaleIndex = 0; ScaleIndex < ArrayCount(Scales); ++ScaleIndex)
+    {
+      for (int FilterIndex = 0; FilterIndex < 2; ++FilterIndex)
+      {
+        win32_window_dimension RenderDimension = Win32GetRenderDimension(&Dest, Scales[ScaleIndex]);
+        game_offscreen_buffer Source = Win32BenchMakeBuffer(SourceMemory,
+                                                            RenderDimension.Width,
+                                                            RenderDimension.Height,
+                                                            PixelFormat_XRGB8888);
+        Scaler.Filter = (win32_upscale_filter)FilterIndex;
+        Win32UpscaleBuffer(&Scaler, &Dest, &Source);
+
+        win32_bench_timer Timer = Win32BenchBegin();
+        for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+        {
+          Win32UpscaleBuffer(&Scaler, &Dest, &Source);
+        }
+        win32_bench_timing Timing = Win32BenchEnd(Timer);
+
+        Win32BenchPrint(Report, "%4dx%-4d %-8s : %6.3f ms/image %6.2f cy/px\n",
+                        Source.Width, Source.Height,
+                        Scaler.IsDouble ? "double" : (FilterIndex ? "nearest" : "bilinear"),
+                        1000.0f * Timing.Seconds / (real32)Iterations,
+                        (real32)Timing.Cycles / ((real32)Width * (real32)Height * (real32)Iterations));
+      }
+    }
+  }
+  if (SourceMemory) VirtualFree(SourceMemory, 0, MEM_RELEASE);
+  if (Scaler.Memory) VirtualFree(Scaler.Memory, 0, MEM_RELEASE);
+  if (Dest.Memory) VirtualFree(Dest.Memory, 0, MEM_RELEASE);
+}
+
+/**
+ * THD+N : on retire la sinusode de rfrence ajuste par moindres carrs
+ * (sur un nombre entier de priodes sin et cos sont orthogonaux) et on compare
+ * l'nergie du rsidu  celle du signal
+ **/
+internal real64
+Win32BenchMeasureTHDN(real32 *Samples, int FrameCount, real64 Frequency, real64 SampleRate)
+{
+  real64 SinSum = 0.0;
+  real64 CosSum = 0.0;
+  real64 Mean = 0.0;
+  for (int Index = 0; Index < FrameCount; ++Index)
+  {
+    real64 T = 2.0*PI32*Frequency*(real64)Index / SampleRate;
+    SinSum += Samples[2*Index]*sin(T);
+    CosSum += Samples[2*Index]*cos(T);
+    Mean += Samples[2*Index];
+  }
+  real64 A = 2.0*SinSum / (real64)FrameCount;
+  real64 B = 2.0*CosSum / (real64)FrameCount;
+  Mean /= (real64)FrameCount;
+
+  real64 SignalEnergy = 0.0;
+  real64 ResidualEnergy = 0.0;
+  for (int Index = 0; Index < FrameCount; ++Index)
+  {
+    real64 T = 2.0*PI32*Frequency*(real64)Index / SampleRate;
+    real64 Fit = A*sin(T) + B*cos(T);
+    real64 Residual = Samples[2*Index] - Fit - Mean;
+    SignalEnergy += Fit*Fit;
+    ResidualEnergy += Residual*Residual;
+  }
+  real64 Result = 10.0*log10(ResidualEnergy / SignalEnergy);
+  return(Result);
+}
+
+/**
+ * Qualit et dbit du rchantillonneur sur une seconde de sinusode  -6 dB
+ * Le plancher est celui de la quantification 16 bits de la source (environ -92 dB)
+ **/
+internal void
+Win32BenchResampler(win32_bench_report *Report)
+{
+  int Rates[][2] = {{44100, 48000}, {48000, 44100}, {22050, 48000}, {32000, 44100}, {96000, 48000}};
+  real64 Frequencies[] = {1000.0, 10000.0};
+  int MaxFrameCount = 192000 + 1024;
+  resampler *Resampler = (resampler *)VirtualAlloc(0, sizeof(resampler), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  int16 *Source = (int16 *)VirtualAlloc(0, 2*MaxFrameCount*sizeof(int16), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  real32 *Dest = (real32 *)VirtualAlloc(0, 2*MaxFrameCount*sizeof(real32), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (Resampler && Source && Dest)
+  {
+    Win32BenchPrint(Report, "\n-- Reechantillonnage (%d taps, %d phases) --\n",
+                    ResamplerTapCount, ResamplerPhaseCount);
+    for (int RateIndex = 0; RateIndex < ArrayCount(Rates); ++RateIndex)
+    {
+      for (int FrequencyIndex = 0; FrequencyIndex < ArrayCount(Frequencies); ++FrequencyIndex)
+      {
+        int SourceRate = Rates[RateIndex][0];
+        int DestRate = Rates[RateIndex][1];
+        real64 Frequency = Frequencies[FrequencyIndex];
+        InitResampler(Resampler, SourceRate, DestRate);
+
+        // On ignore le dbut, le temps que l'historique du filtre se remplisse
+        int WarmupFrameCount = 4*ResamplerTapCount;
+        int DestFrameCount = WarmupFrameCount + DestRate;
+        int SourceFrameCount = GetResamplerSourceFrameCount(Resampler, DestFrameCount);
+        Assert(SourceFrameCount <= MaxFrameCount);
+        for (int Index = 0; Index < SourceFrameCount; ++Index)
+        {
+          real64 Value = 16383.0*sin(2.0*PI32*Frequency*(real64)Index / (real64)SourceRate);
+          Source[2*Index] = Source[2*Index + 1] = (int16)floor(Value + 0.5);
+        }
+        memset(Dest, 0, 2*DestFrameCount*sizeof(real32));
+
+        win32_bench_timer Timer = Win32BenchBegin();
+        ResampleStereo(Resampler, Source, SourceFrameCount, Dest, DestFrameCount, 1.0f);
+        win32_bench_timing Timing = Win32BenchEnd(Timer);
+
+        real64 THDN = Win32BenchMeasureTHDN(Dest + 2*WarmupFrameCount, DestRate,
+                                            Frequency, (real64)DestRate);
+        Win32BenchPrint(Report, "%6d -> %6d %5.0f Hz : THD+N %6.1f dB %7.1f Mframes/s %6.1f cy/frame\n",
+                        SourceRate, DestRate, Frequency, THDN,
+                        (real32)DestFrameCount / (1000000.0f * Timing.Seconds),
+                        (real32)Timing.Cycles / (real32)DestFrameCount);
+      }
+    }
+  }
+  if (Resampler) VirtualFree(Resampler, 0, MEM_RELEASE);
+  if (Source) VirtualFree(Source, 0, MEM_RELEASE);
+  if (Dest) VirtualFree(Dest, 0, MEM_RELEASE);
+}
+
+/**
+ * Etage de sortie du son : conversion SSE compare  un arrondi scalaire,
+ * effet du dither sur un signal plus petit qu'un LSB, puis critures de
+ * tailles irrgulires dans un faux buffer circulaire compares  la copie
+ * chantillon par chantillon d'avant
+ **/
+internal void
+Win32BenchSoundOutput(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n-- Sortie du son --\n");
+  uint32 SampleCount = 2*48000;
+  uint32 RingFrameCount = 4800;
+  uint32 RingSize = RingFrameCount*2*sizeof(int16);
+  uint32 GuardSize = 64;
+  real32 *Mix = (real32 *)VirtualAlloc(0, SampleCount*sizeof(real32), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  int16 *Converted = (int16 *)VirtualAlloc(0, SampleCount*sizeof(int16), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  uint8 *Ring = (uint8 *)VirtualAlloc(0, RingSize + 2*GuardSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  uint8 *Reference = (uint8 *)VirtualAlloc(0, RingSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (Mix && Converted && Ring && Reference)
+  {
+    // Valeurs au hasard dans [-1.5, 1.5] pour tester aussi la saturation, et quelques extrmes
+    uint32 Random = 1;
+    for (uint32 Index = 0; Index < SampleCount; ++Index)
+    {
+      Random = Random*1664525 + 1013904223;
+      Mix[Index] = ((real32)(Random >> 8) / (real32)(1 << 24) - 0.5f)*3.0f;
+    }
+    Mix[0] = 1e20f;
+    Mix[1] = -1e20f;
+    Mix[2] = 1.0f;
+    Mix[3] = -1.0f;
+
+    // Sans dither : l'arrondi exact satur, y compris sur la fin non multiple de 8
+    sound_dither Dither;
+    InitializeSoundDither(&Dither, 1);
+    uint32 OddCount = SampleCount - 5;
+    ConvertSamplesToInt16(Converted, Mix, OddCount, &Dither, 0.0f);
+    uint32 ConversionErrors = 0;
+    for (uint32 Index = 0; Index < OddCount; ++Index)
+    {
+      real32 Value = Mix[Index]*32767.0f;
+      if (Value > 32767.0f) Value = 32767.0f;
+      if (Value < -32768.0f) Value = -32768.0f;
+      int16 Expected = (int16)_mm_cvtss_si32(_mm_set_ss(Value));
+      if (Converted[Index] != Expected) ++ConversionErrors;
+    }
+
+    int Iterations = 100;
+    win32_bench_timer Timer = Win32BenchBegin();
+    for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+    {
+      ConvertSamplesToInt16(Converted, Mix, SampleCount, &Dither, 1.0f);
+    }
+    win32_bench_timing ConvertTiming = Win32BenchEnd(Timer);
+
+    // Un quart de LSB : arrondi  0 sans dither, la moyenne doit rester 0.25 avec
+    real32 QuarterLSB = 0.25f / 32767.0f;
+    for (uint32 Index = 0; Index < SampleCount; ++Index)
+    {
+      Mix[Index] = QuarterLSB;
+    }
+    ConvertSamplesToInt16(Converted, Mix, SampleCount, &Dither, 1.0f);
+    int64 Sum = 0;
+    int MinValue = 0, MaxValue = 0;
+    for (uint32 Index = 0; Index < SampleCount; ++Index)
+    {
+      Sum += Converted[Index];
+      if (Converted[Index] < MinValue) MinValue = Converted[Index];
+      if (Converted[Index] > MaxValue) MaxValue = Converted[Index];
+    }
+    real32 Mean = (real32)Sum / (real32)SampleCount;
+    bool32 DitherIsOk = ((Mean > 0.2f) && (Mean < 0.3f) && (MinValue >= -1) && (MaxValue <= 2));
+    Win32BenchPrint(Report, "conversion   : %s (%u ecarts) %7.1f Mech/s, dither %s (moyenne %.3f LSB, [%d, %d])\n",
+                    ConversionErrors ? "ECHEC" : "OK", ConversionErrors,
+                    (real32)SampleCount*(real32)Iterations / (1000000.0f*ConvertTiming.Seconds),
+                    DitherIsOk ? "OK" : "ECHEC", Mean, MinValue, MaxValue);
+
+    // Faux buffer circulaire entour de zones de garde qui ne doivent pas bouger
+    for (uint32 Index = 0; Index < SampleCount; ++Index)
+    {
+      Converted[Index] = (int16)(Index*7);
+    }
+    uint8 *RingBase = Ring + GuardSize;
+    memset(Ring, 0xAB, RingSize + 2*GuardSize);
+    memset(Reference, 0xAB, RingSize);
+    uint32 BytesPerFrame = 2*sizeof(int16);
+    uint32 Offset = 0;
+    uint32 RingErrors = 0;
+    uint32 WrapCount = 0;
+    for (int Write = 0; Write < 1000; ++Write)
+    {
+      Random = Random*1664525 + 1013904223;
+      uint32 FrameCount = (Random >> 8) % RingFrameCount;
+      sound_ring_regions Regions = GetSoundRingRegions(RingBase, RingSize, Offset, FrameCount*BytesPerFrame);
+      if (Regions.Region2Size) ++WrapCount;
+      uint32 Written = CopyToSoundRing(&Regions, Converted, BytesPerFrame);
+      if (Written != FrameCount) ++RingErrors;
+
+      int16 *Source = Converted;
+      for (uint32 Frame = 0; Frame < FrameCount; ++Frame)
+      {
+        int16 *Dest = (int16 *)(Reference + ((Offset + Frame*BytesPerFrame) % RingSize));
+        *Dest++ = *Source++;
+        *Dest++ = *Source++;
+      }
+      Offset = (Offset + FrameCount*BytesPerFrame) % RingSize;
+    }
+    if (memcmp(RingBase, Reference, RingSize) != 0) ++RingErrors;
+    for (uint32 Index = 0; Index < GuardSize; ++Index)
+    {
+      if ((Ring[Index] != 0xAB) || (RingBase[RingSize + Index] != 0xAB)) ++RingErrors;
+    }
+
+    // Dbit : remplissage complet du buffer, coup au milieu
+    Iterations = 2000;
+    Timer = Win32BenchBegin();
+    for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+    {
+      sound_ring_regions Regions = GetSoundRingRegions(RingBase, RingSize, RingSize / 2, RingSize);
+      CopyToSoundRing(&Regions, Converted, BytesPerFrame);
+    }
+    win32_bench_timing CopyTiming = Win32BenchEnd(Timer);
+    Timer = Win32BenchBegin();
+    for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+    {
+      sound_ring_regions Regions = GetSoundRingRegions(RingBase, RingSize, RingSize / 2, RingSize);
+      int16 *Source = Converted;
+      int16 *Dest = (int16 *)Regions.Region1;
+      for (uint32 Frame = 0; Frame < Regions.Region1Size / BytesPerFrame; ++Frame)
+      {
+        *Dest++ = *Source++;
+        *Dest++ = *Source++;
+      }
+      Dest = (int16 *)Regions.Region2;
+      for (uint32 Frame = 0; Frame < Regions.Region2Size / BytesPerFrame; ++Frame)
+      {
+        *Dest++ = *Source++;
+        *Dest++ = *Source++;
+      }
+    }
+    win32_bench_timing LoopTiming = Win32BenchEnd(Timer);
+    real32 FramesWritten = (real32)RingFrameCount*(real32)Iterations;
+    Win32BenchPrint(Report, "anneau       : %s (%u erreurs, %u ecritures coupees) memcpy %7.1f Mframes/s, "
+                    "boucle %7.1f Mframes/s\n",
+                    RingErrors ? "ECHEC" : "OK", RingErrors, WrapCount,
+                    FramesWritten / (1000000.0f*CopyTiming.Seconds),
+                    FramesWritten / (1000000.0f*LoopTiming.Seconds));
+  }
+  if (Mix) VirtualFree(Mix, 0, MEM_RELEASE);
+  if (Converted) VirtualFree(Converted, 0, MEM_RELEASE);
+  if (Ring) VirtualFree(Ring, 0, MEM_RELEASE);
+  if (Reference) VirtualFree(Reference, 0, MEM_RELEASE);
+}
+
+/**
+ * Lecture en streaming : on crit une rampe connue dans un WAV puis on la relit
+ * par paquets de tailles irrgulires, en vrifiant chaque frame. Un trou ou un
+ * doublon  la jonction de deux morceaux, ou au rebouclage, est donc dtect.
+ **/
+inline int16
+Win32BenchMusicRamp(uint32 FrameIndex, int Channel)
+{
+  int16 Result = (int16)((FrameIndex * 7 + (uint32)Channel * 12345) & 0xFFFF);
+  return(Result);
+}
+
+internal uint32
+Win32BenchCheckMusic(music_track *Track, platform_work_queue *Queue, platform_api *Platform,
+                     uint32 FrameCount, uint32 FramesToRead)
+{
+  uint32 ErrorCount = 0;
+  int16 Frames[2*1021];
+  uint32 FrameIndex = 0;
+  uint32 PieceSize = 1;
+  while (FrameIndex < FramesToRead)
+  {
+    UpdateMusicTrack(Platform, Queue, Track);
+    // Tailles premires entre elles et la taille des morceaux
+    PieceSize = (PieceSize * 37 + 11) % ArrayCount(Frames) / 2 + 1;
+    if (PieceSize > FramesToRead - FrameIndex) PieceSize = FramesToRead - FrameIndex;
+    uint32 ReadCount = ReadMusicFrames(Track, Frames, PieceSize);
+    for (uint32 Index = 0; Index < ReadCount; ++Index)
+    {
+      uint32 Expected = (FrameIndex + Index) % FrameCount;
+      if ((Frames[2*Index] != Win32BenchMusicRamp(Expected, 0)) ||
+          (Frames[2*Index + 1] != Win32BenchMusicRamp(Expected, 1)))
+      {
+        ++ErrorCount;
+      }
+    }
+    FrameIndex += ReadCount;
+    if (ReadCount < PieceSize)
+    {
+      if (!Track->IsPlaying) break;
+      // Le chargeur est en retard : ce qui serait un sous-dbit en jeu
+      Platform->CompleteAllWork(Queue);
+    }
+  }
+  ErrorCount += FramesToRead - FrameIndex;
+  return(ErrorCount);
+}
+
+internal void
+Win32BenchMusicStreaming(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n== Streaming musique ==\n");
+
+  // Pas un multiple de la taille des morceaux, pour tester le dernier morceau partiel
+  uint32 FrameCount = 5*MusicChunkFrameCount + 777;
+  uint32 DataSize = FrameCount*2*sizeof(int16);
+  uint32 FileSize = 12 + sizeof(wave_chunk_header) + sizeof(wave_fmt) + sizeof(wave_chunk_header) + DataSize;
+  uint8 *File = (uint8 *)VirtualAlloc(0, FileSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  music_track *Track = (music_track *)VirtualAlloc(0, sizeof(music_track), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (File && Track)
+  {
+    uint32 *Riff = (uint32 *)File;
+    Riff[0] = RIFF_CODE('R', 'I', 'F', 'F');
+    Riff[1] = FileSize - 8;
+    Riff[2] = RIFF_CODE('W', 'A', 'V', 'E');
+    wave_chunk_header *FormatHeader = (wave_chunk_header *)(Riff + 3);
+    FormatHeader->ID = RIFF_CODE('f', 'm', 't', ' ');
+    FormatHeader->Size = sizeof(wave_fmt);
+    wave_fmt *Format = (wave_fmt *)(FormatHeader + 1);
+    Format->FormatTag = 1;
+    Format->ChannelCount = 2;
+    Format->SamplesPerSecond = 44100;
+    Format->BlockAlign = 2*sizeof(int16);
+    Format->AvgBytesPerSecond = Format->SamplesPerSecond*Format->BlockAlign;
+    Format->BitsPerSample = 16;
+    wave_chunk_header *DataHeader = (wave_chunk_header *)(Format + 1);
+    DataHeader->ID = RIFF_CODE('d', 'a', 't', 'a');
+    DataHeader->Size = DataSize;
+    int16 *Samples = (int16 *)(DataHeader + 1);
+    for (uint32 FrameIndex = 0; FrameIndex < FrameCount; ++FrameIndex)
+    {
+      Samples[2*FrameIndex] = Win32BenchMusicRamp(FrameIndex, 0);
+      Samples[2*FrameIndex + 1] = Win32BenchMusicRamp(FrameIndex, 1);
+    }
+
+    char *Filename = "bench_music.wav";
+    if (DEBUGPlatformWriteEntireFile(Filename, FileSize, File))
+    {
+      platform_api Platform = Win32GetPlatformAPI();
+      uint32 ThreadCount;
+      platform_work_queue *Queue = Win32BenchGetWorkQueue(&ThreadCount);
+
+      // Lecture simple : jusqu' la fin de la piste, qui doit s'arrter d'elle-mme
+      if (OpenMusicTrack(&Platform, Track, Filename))
+      {
+        win32_bench_timer Timer = Win32BenchBegin();
+        uint32 ErrorCount = Win32BenchCheckMusic(Track, Queue, &Platform, FrameCount, FrameCount);
+        win32_bench_timing Timing = Win32BenchEnd(Timer);
+        bool32 Stopped = !Track->IsPlaying;
+        Platform.CompleteAllWork(Queue);
+        UpdateMusicTrack(&Platform, Queue, Track);
+        Win32BenchPrint(Report, "lecture      : %s (%u erreurs, arret %s) %7.1f Mframes/s\n",
+                        (ErrorCount || !Stopped) ? "ECHEC" : "OK", ErrorCount, Stopped ? "ok" : "manquant",
+                        (real32)FrameCount / (1000000.0f * Timing.Seconds));
+      }
+      else
+      {
+        Win32BenchPrint(Report, "lecture      : ECHEC (ouverture)\n");
+      }
+
+      // En boucle : trois passages, la jonction fin/dbut ne doit pas se voir
+      if (OpenMusicTrack(&Platform, Track, Filename))
+      {
+        Track->IsLooping = true;
+        uint32 ErrorCount = Win32BenchCheckMusic(Track, Queue, &Platform, FrameCount, 3*FrameCount);
+        Win32BenchPrint(Report, "en boucle    : %s (%u erreurs)\n", ErrorCount ? "ECHEC" : "OK", ErrorCount);
+        Track->IsPlaying = false;
+        Platform.CompleteAllWork(Queue);
+        UpdateMusicTrack(&Platform, Queue, Track);
+      }
+      Win32BenchPrint(Report, "memoire      : %u octets par piste, %u octets de fichier\n",
+                      (uint32)sizeof(music_track), FileSize);
+    }
+  }
+  if (File) VirtualFree(File, 0, MEM_RELEASE);
+  if (Track) VirtualFree(Track, 0, MEM_RELEASE);
+}
+
+/**
+ * Image synthtique pour simuler le travail du jeu (un dgrad, comme le jeu)
+ **/
+internal void
+Win32BenchRenderFrame(game_offscreen_buffer *Buffer, int FrameIndex)
+{
+  uint8 *Row = (uint8 *)Buffer->Memory;
+  for (int Y = 0; Y < Buffer->Height; ++Y)
+  {
+    uint32 *Pixel = (uint32 *)Row;
+    for (int X = 0; X < Buffer->Width; ++X)
+    {
+      uint8 Blue = (uint8)(X + FrameIndex);
+      uint8 Green = (uint8)(Y + 2*FrameIndex);
+      *Pixel++ = ((Green << 8) | Blue);
+    }
+    Row += Buffer->Pitch;
+  }
+}
+
+/**
+ * Pipeline d'images sans fentre : la prsentation se limite  l'agrandissement
+ * vers 1080p. On compare la dure d'une image et la latence (dbut de l'image
+ * jusqu' la fin de sa prsentation) en srie et avec 2 ou 3 slots.
+ **/
+internal void
+Win32BenchFramePipeline(win32_bench_report *Report)
+{
+  int Width = 1920;
+  int Height = 1080;
+  int FrameCount = 120;
+  real32 RenderScale = 0.75f;
+  Win32BenchPrint(Report, "\n== Pipeline d'images (%dx%d, rendu a %.0f%%) ==\n",
+                  Width, Height, 100.0f*RenderScale);
+
+  // Le thread de prsentation survit au benchmark, le pipeline ne doit pas tre sur la pile
+  local_persist win32_frame_pipeline Pipelines[2];
+  local_persist win32_upscaler Scaler;
+  if (!Scaler.Memory) Win32ResizeUpscaler(&Scaler, Width);
+
+  // Rfrence en srie : rendu puis prsentation sur le mme thread
+  {
+    win32_offscreen_buffer Display = {};
+    win32_offscreen_buffer Render = {};
+    Win32ResizeDIBSection(&Display, Width, Height, PixelFormat_XRGB8888);
+    Win32ResizeDIBSection(&Render, Width, Height, PixelFormat_XRGB8888);
+    if (Display.Memory && Render.Memory && Scaler.Memory)
+    {
+      win32_window_dimension RenderDimension = Win32GetRenderDimension(&Display, RenderScale);
+      real64 LatencySecondsSum = 0.0;
+      win32_bench_timer Timer = Win32BenchBegin();
+      for (int FrameIndex = 0; FrameIndex < FrameCount; ++FrameIndex)
+      {
+        LARGE_INTEGER FrameStart = Win32GetWallClock();
+        game_offscreen_buffer Buffer = Win32GetGameBuffer(&Render);
+        Buffer.Width = RenderDimension.Width;
+        Buffer.Height = RenderDimension.Height;
+        Win32BenchRenderFrame(&Buffer, FrameIndex);
+        Win32ResolveRenderBuffer(&Scaler, &Display, &Buffer);
+        LatencySecondsSum += Win32GetSecondsElapsed(FrameStart, Win32GetWallClock());
+      }
+      win32_bench_timing Timing = Win32BenchEnd(Timer);
+      Win32BenchPrint(Report, "serie        : %6.3f ms/image, latence %6.3f ms\n",
+                      1000.0f*Timing.Seconds / (real32)FrameCount,
+                      (real32)(1000.0*LatencySecondsSum / (real64)FrameCount));
+    }
+    if (Display.Memory) VirtualFree(Display.Memory, 0, MEM_RELEASE);
+    if (Render.Memory) VirtualFree(Render.Memory, 0, MEM_RELEASE);
+  }
+
+  for (uint32 PipelineIndex = 0; PipelineIndex < ArrayCount(Pipelines); ++PipelineIndex)
+  {
+    win32_frame_pipeline *Pipeline = Pipelines + PipelineIndex;
+    if (!Pipeline->IsEnabled)
+    {
+      Win32InitFramePipeline(Pipeline, 2 + PipelineIndex, &Scaler, 0);
+      Win32ResizeFramePipeline(Pipeline, Width, Height, PixelFormat_XRGB8888);
+    }
+    Pipeline->LatencySecondsSum = 0.0;
+    uint32 FirstPresented = Pipeline->PresentedCount;
+
+    win32_window_dimension RenderDimension = Win32GetRenderDimension(&Pipeline->Slots[0].DisplayBuffer,
+                                                                     RenderScale);
+    win32_bench_timer Timer = Win32BenchBegin();
+    for (int FrameIndex = 0; FrameIndex < FrameCount; ++FrameIndex)
+    {
+      LARGE_INTEGER FrameStart = Win32GetWallClock();
+      win32_frame_slot *Slot = Win32BeginPipelinedFrame(Pipeline);
+      game_offscreen_buffer Buffer = Win32GetGameBuffer(&Slot->RenderBuffer);
+      Buffer.Width = RenderDimension.Width;
+      Buffer.Height = RenderDimension.Height;
+      Win32BenchRenderFrame(&Buffer, FrameIndex);
+
+      Slot->Buffer = Buffer;
+      Slot->RenderIsDirect = false;
+      Slot->FrameStartCounter = FrameStart;
+      Win32SubmitPipelinedFrame(Pipeline, Slot);
+    }
+    Win32FlushFramePipeline(Pipeline);
+    win32_bench_timing Timing = Win32BenchEnd(Timer);
+
+    uint32 PresentedCount = Pipeline->PresentedCount - FirstPresented;
+    Win32BenchPrint(Report, "pipeline x%u  : %6.3f ms/image, latence %6.3f ms (%u images)\n",
+                    Pipeline->SlotCount,
+                    1000.0f*Timing.Seconds / (real32)FrameCount,
+                    (real32)(1000.0*Pipeline->LatencySecondsSum / (real64)PresentedCount),
+                    PresentedCount);
+  }
+}
+
+/**
+ * Carte de tuiles : cration paresseuse, recherches alatoires et squentielles,
+ * parcours de tous les chunks, sur plusieurs millions de tuiles
+ **/
+internal void
+Win32BenchTileMap(win32_bench_report *Report)
+{
+  int32 Side = 2048; // 4M tuiles, 16384 chunks
+  uint32 TileCount = (uint32)(Side*Side);
+  uint64 ArenaSize = Megabytes(32);
+  void *ArenaMemory = VirtualAlloc(0, (SIZE_T)ArenaSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (!ArenaMemory) return;
+
+  Win32BenchPrint(Report, "\n== Carte de tuiles (%dx%d tuiles) ==\n", Side, Side);
+  memory_arena Arena;
+  InitializeArena(&Arena, ArenaSize, ArenaMemory);
+  tile_map TileMap;
+  InitializeTileMap(&TileMap, &Arena, 1 << 15, 1.4f);
+
+  // Le monde est centr sur l'origine pour passer par les coordonnes ngatives
+  int32 MinTile = -Side / 2;
+  win32_bench_timer Timer = Win32BenchBegin();
+  for (int32 TileY = MinTile; TileY < MinTile + Side; ++TileY)
+  {
+    for (int32 TileX = MinTile; TileX < MinTile + Side; ++TileX)
+    {
+      SetTileValue(&Arena, &TileMap, TileX, TileY, (uint32)(TileX ^ TileY) & 0xFF);
+    }
+  }
+  win32_bench_timing Timing = Win32BenchEnd(Timer);
+  Win32BenchPrint(Report, "creation      : %7.2f ns/tuile (%u chunks, %.1f Mo)\n",
+                  1e9f*Timing.Seconds / (real32)TileCount, TileMap.ChunkCount,
+                  (real32)Arena.Used / (1024.0f*1024.0f));
+
+  uint32 Errors = 0;
+  Timer = Win32BenchBegin();
+  for (int32 TileY = MinTile; TileY < MinTile + Side; ++TileY)
+  {
+    for (int32 TileX = MinTile; TileX < MinTile + Side; ++TileX)
+    {
+      if (GetTileValue(&TileMap, TileX, TileY) != ((uint32)(TileX ^ TileY) & 0xFF)) ++Errors;
+    }
+  }
+  Timing = Win32BenchEnd(Timer);
+  Win32BenchPrint(Report, "lecture seq.  : %7.2f ns/tuile (%u erreurs)\n",
+                  1e9f*Timing.Seconds / (real32)TileCount, Errors);
+
+  // Gnrateur congruentiel : accs dans toute la carte, dfauts de cache compris
+  uint32 Random = 12345;
+  uint32 Sum = 0;
+  Timer = Win32BenchBegin();
+  for (uint32 Index = 0; Index < TileCount; ++Index)
+  {
+    Random = Random*1664525 + 1013904223;
+    int32 TileX = MinTile + (int32)((Random >> 8) & (uint32)(Side - 1));
+    int32 TileY = MinTile + (int32)((Random >> 20) & (uint32)(Side - 1));
+    Sum += GetTileValue(&TileMap, TileX, TileY);
+  }
+  Timing = Win32BenchEnd(Timer);
+  Win32BenchPrint(Report, "lecture alea. : %7.2f ns/tuile\n", 1e9f*Timing.Seconds / (real32)TileCount);
+
+  // Recherche de chunks absents (hors de la carte), le pire cas du sondage
+  Timer = Win32BenchBegin();
+  for (uint32 Index = 0; Index < TileCount; ++Index)
+  {
+    Random = Random*1664525 + 1013904223;
+    Sum += GetTileValue(&TileMap, Side + (int32)(Random >> 8), Side + (int32)(Random >> 20));
+  }
+  Timing = Win32BenchEnd(Timer);
+  Win32BenchPrint(Report, "chunk absent  : %7.2f ns/tuile\n", 1e9f*Timing.Seconds / (real32)TileCount);
+
+  Timer = Win32BenchBegin();
+  for (uint32 ChunkIndex = 0; ChunkIndex < TileMap.ChunkCount; ++ChunkIndex)
+  {
+    tile_chunk *Chunk = TileMap.Chunks[ChunkIndex];
+    for (int TileIndex = 0; TileIndex < TileChunkDim*TileChunkDim; ++TileIndex)
+    {
+      Sum += Chunk->Tiles[TileIndex];
+    }
+  }
+  Timing = Win32BenchEnd(Timer);
+  Win32BenchPrint(Report, "parcours      : %7.2f ns/tuile (somme %u)\n",
+                  1e9f*Timing.Seconds / (real32)TileCount, Sum);
+
+  // Prcision loin de l'origine : 1000 pas d'un millimtre  un million de mtres
+  tile_map_position Position = {};
+  Position = OffsetPosition(&TileMap, Position, 1000000.0f, 0.0f);
+  tile_map_position Start = Position;
+  real32 AbsoluteX = 1000000.0f;
+  for (int Step = 0; Step < 1000; ++Step)
+  {
+    Position = OffsetPosition(&TileMap, Position, 0.001f, 0.0f);
+    AbsoluteX += 0.001f;
+  }
+  Win32BenchPrint(Report, "precision     : relatif %.4f m, flottant absolu %.4f m (attendu 1 m)\n",
+                  SubtractPositions(&TileMap, Position, Start).dX, AbsoluteX - 1000000.0f);
+
+  // Croissance : une table de 16 emplacements remplie jusqu' 4096 chunks,
+  // dans l'arne rutilise (la premire carte n'est plus lue)
+  InitializeArena(&Arena, ArenaSize, ArenaMemory);
+  InitializeTileMap(&TileMap, &Arena, 16, 1.4f);
+  int32 GrowSide = 64;
+  Timer = Win32BenchBegin();
+  for (int32 ChunkY = -GrowSide / 2; ChunkY < GrowSide / 2; ++ChunkY)
+  {
+    for (int32 ChunkX = -GrowSide / 2; ChunkX < GrowSide / 2; ++ChunkX)
+    {
+      SetTileValue(&Arena, &TileMap, ChunkX*TileChunkDim, ChunkY*TileChunkDim, (uint32)(ChunkX ^ ChunkY) & 0xFF);
+    }
+  }
+  Timing = Win32BenchEnd(Timer);
+  Errors = 0;
+  for (int32 ChunkY = -GrowSide / 2; ChunkY < GrowSide / 2; ++ChunkY)
+  {
+    for (int32 ChunkX = -GrowSide / 2; ChunkX < GrowSide / 2; ++ChunkX)
+    {
+      if (GetTileValue(&TileMap, ChunkX*TileChunkDim, ChunkY*TileChunkDim) != ((uint32)(ChunkX ^ ChunkY) & 0xFF)) ++Errors;
+    }
+  }
+  Win32BenchPrint(Report, "croissance    : %7.2f ns/chunk (%u chunks, table de %u, %u erreurs)\n",
+                  1e9f*Timing.Seconds / (real32)(GrowSide*GrowSide), TileMap.ChunkCount,
+                  TileMap.HashCapacity, Errors);
+
+  VirtualFree(ArenaMemory, 0, MEM_RELEASE);
+}
+
+/**
+ * Rfrence scalaire de UpdateEntities, pour la vrifier et mesurer le gain SSE
+ **/
+internal void
+Win32BenchUpdateEntitiesScalar(entity_storage *Storage, real32 dt,
+                               real32 MinX, real32 MinY, real32 MaxX, real32 MaxY)
+{
+  for (uint32 Index = 0; Index < Storage->Count; ++Index)
+  {
+    if (Storage->Flags[Index] & EntityFlag_Moving)
+    {
+      real32 PX = Storage->PositionX[Index] + Storage->VelocityX[Index]*dt;
+      real32 PY = Storage->PositionY[Index] + Storage->VelocityY[Index]*dt;
+      if ((PX < MinX) || (PX > MaxX)) Storage->VelocityX[Index] = -Storage->VelocityX[Index];
+      if ((PY < MinY) || (PY > MaxY)) Storage->VelocityY[Index] = -Storage->VelocityY[Index];
+      Storage->PositionX[Index] = (PX < MinX) ? MinX : ((PX > MaxX) ? MaxX : PX);
+      Storage->PositionY[Index] = (PY < MinY) ? MinY : ((PY > MaxY) ? MaxY : PY);
+    }
+  }
+}
+
+/**
+ * Entits : mise  jour SSE et scalaire, suppression de 10% des entits
+ * puis vrification des handles,  10k, 100k et 1M entits
+ **/
+internal void
+Win32BenchEntities(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n== Entites (SoA) ==\n");
+  uint32 Counts[] = {10000, 100000, 1000000};
+  uint64 ArenaSize = Megabytes(64);
+  void *ArenaMemory = VirtualAlloc(0, (SIZE_T)ArenaSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (!ArenaMemory) return;
+
+  real32 dt = 1.0f / 60.0f;
+  real32 MinX = -100.0f, MinY = -50.0f, MaxX = 100.0f, MaxY = 50.0f;
+  for (int CountIndex = 0; CountIndex < ArrayCount(Counts); ++CountIndex)
+  {
+    uint32 Count = Counts[CountIndex];
+    memory_arena Arena;
+    InitializeArena(&Arena, ArenaSize, ArenaMemory);
+    entity_storage Storage;
+    InitializeEntityStorage(&Storage, &Arena, Count);
+    entity_handle *Handles = PushArray(&Arena, Count, entity_handle);
+    real32 *SavedX = PushArray(&Arena, Storage.MaxCount, real32);
+    real32 *SavedVX = PushArray(&Arena, Storage.MaxCount, real32);
+
+    uint32 Random = 1;
+    for (uint32 Index = 0; Index < Count; ++Index)
+    {
+      Random = Random*1664525 + 1013904223;
+      real32 X = ((real32)(Random >> 8) / (real32)(1 << 24))*(MaxX - MinX) + MinX;
+      real32 VX = ((real32)(Random & 0xFF) - 127.5f)*0.5f;
+      Random = Random*1664525 + 1013904223;
+      real32 Y = ((real32)(Random >> 8) / (real32)(1 << 24))*(MaxY - MinY) + MinY;
+      real32 VY = ((real32)(Random & 0xFF) - 127.5f)*0.5f;
+      // Une entit sur 8 est immobile
+      Handles[Index] = AddEntity(&Storage, X, Y, VX, VY, (Index & 7) ? EntityFlag_Moving : 0);
+    }
+
+    // Vrification : un pas SSE et un pas scalaire depuis le mme tat
+    memcpy(SavedX, Storage.PositionX, Count*sizeof(real32));
+    memcpy(SavedVX, Storage.VelocityX, Count*sizeof(real32));
+    Win32BenchUpdateEntitiesScalar(&Storage, 3.0f*dt, MinX, MinY, MaxX, MaxY);
+    real32 *ScalarX = PushArray(&Arena, Count, real32);
+    memcpy(ScalarX, Storage.PositionX, Count*sizeof(real32));
+    memcpy(Storage.PositionX, SavedX, Count*sizeof(real32));
+    memcpy(Storage.VelocityX, SavedVX, Count*sizeof(real32));
+    UpdateEntities(&Storage, 3.0f*dt, MinX, MinY, MaxX, MaxY);
+    uint32 Mismatches = 0;
+    for (uint32 Index = 0; Index < Count; ++Index)
+    {
+      if (ScalarX[Index] != Storage.PositionX[Index]) ++Mismatches;
+    }
+
+    int Iterations = (Count >= 1000000) ? 20 : 200;
+    win32_bench_timer Timer = Win32BenchBegin();
+    for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+    {
+      UpdateEntities(&Storage, dt, MinX, MinY, MaxX, MaxY);
+    }
+    win32_bench_timing Simd = Win32BenchEnd(Timer);
+    Timer = Win32BenchBegin();
+    for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+    {
+      Win32BenchUpdateEntitiesScalar(&Storage, dt, MinX, MinY, MaxX, MaxY);
+    }
+    win32_bench_timing Scalar = Win32BenchEnd(Timer);
+
+    // Une entit sur 10 meurt, puis on vrifie tous les handles
+    for (uint32 Index = 0; Index < Count; Index += 10)
+    {
+      Storage.Flags[GetEntityIndex(&Storage, Handles[Index])] |= EntityFlag_Dead;
+    }
+    Timer = Win32BenchBegin();
+    uint32 Removed = CompactEntities(&Storage);
+    win32_bench_timing Compact = Win32BenchEnd(Timer);
+    uint32 HandleErrors = 0;
+    for (uint32 Index = 0; Index < Count; ++Index)
+    {
+      int32 EntityIndex = GetEntityIndex(&Storage, Handles[Index]);
+      bool32 ShouldBeDead = ((Index % 10) == 0);
+      if (ShouldBeDead != (EntityIndex < 0)) ++HandleErrors;
+      else if ((EntityIndex >= 0) && (Storage.SlotOfEntity[EntityIndex] != Handles[Index].Slot)) ++HandleErrors;
+    }
+
+    real32 FrameCount = (real32)Iterations;
+    Win32BenchPrint(Report, "%8u : SSE %7.3f ms/image (%5.2f ns/ent) scalaire %7.3f ms/image, "
+                    "compactage %6.3f ms (%u retirees), ecarts %u, handles %s\n",
+                    Count,
+                    1000.0f*Simd.Seconds / FrameCount, 1e9f*Simd.Seconds / (FrameCount*(real32)Count),
+                    1000.0f*Scalar.Seconds / FrameCount,
+                    1000.0f*Compact.Seconds, Removed, Mismatches,
+                    HandleErrors ? "ECHEC" : "OK");
+  }
+  VirtualFree(ArenaMemory, 0, MEM_RELEASE);
+}
+
+/**
+ * Grille spatiale : construction sur un thread et sur la file de travail,
+ * requtes de voisinage et recherche de paires,  densit constante (une
+ * entit par m) pour 10k, 100k et 1M entits. Les rsultats sont compars
+ *  une recherche exhaustive.
+ **/
+internal void
+Win32BenchSpatialGrid(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n== Grille spatiale ==\n");
+  uint32 Counts[] = {10000, 100000, 1000000};
+  uint64 ArenaSize = Megabytes(160);
+  void *ArenaMemory = VirtualAlloc(0, (SIZE_T)ArenaSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (!ArenaMemory) return;
+
+  platform_api Platform = Win32GetPlatformAPI();
+  uint32 ThreadCount;
+  platform_work_queue *Queue = Win32BenchGetWorkQueue(&ThreadCount);
+
+  real32 Distance = 0.5f;
+  for (int CountIndex = 0; CountIndex < ArrayCount(Counts); ++CountIndex)
+  {
+    uint32 Count = Counts[CountIndex];
+    real32 Side = sqrtf((real32)Count);
+    memory_arena Arena;
+    InitializeArena(&Arena, ArenaSize, ArenaMemory);
+    real32 *X = PushArray(&Arena, Count, real32);
+    real32 *Y = PushArray(&Arena, Count, real32);
+    uint32 Random = 1;
+    for (uint32 Index = 0; Index < Count; ++Index)
+    {
+      Random = Random*1664525 + 1013904223;
+      X[Index] = ((real32)(Random >> 8) / (real32)(1 << 24) - 0.5f)*Side;
+      Random = Random*1664525 + 1013904223;
+      Y[Index] = ((real32)(Random >> 8) / (real32)(1 << 24) - 0.5f)*Side;
+    }
+
+    int Iterations = (Count >= 1000000) ? 5 : 50;
+    spatial_grid Single;
+    temporary_memory SingleMemory = BeginTemporaryMemory(&Arena);
+    win32_bench_timer Timer = Win32BenchBegin();
+    for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+    {
+      EndTemporaryMemory(SingleMemory);
+      BuildSpatialGrid(&Single, &Arena, X, Y, Count, Distance, &Platform, 0, 1);
+    }
+    win32_bench_timing SingleTiming = Win32BenchEnd(Timer);
+
+    spatial_grid Multi;
+    temporary_memory MultiMemory = BeginTemporaryMemory(&Arena);
+    Timer = Win32BenchBegin();
+    for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+    {
+      EndTemporaryMemory(MultiMemory);
+      BuildSpatialGrid(&Multi, &Arena, X, Y, Count, Distance, &Platform, Queue, SpatialGridMaxJobCount);
+    }
+    win32_bench_timing MultiTiming = Win32BenchEnd(Timer);
+
+    // Le dcoupage en tches ne doit pas changer l'ordre des entits
+    uint32 OrderErrors = 0;
+    for (uint32 Index = 0; Index < Count; ++Index)
+    {
+      if (Single.EntityIndices[Index] != Multi.EntityIndices[Index]) ++OrderErrors;
+    }
+
+    // Requtes autour de chaque entit, compares  une recherche exhaustive pour quelques-unes
+    uint32 Neighbours[256];
+    uint32 TotalFound = 0;
+    Timer = Win32BenchBegin();
+    for (uint32 Index = 0; Index < Count; ++Index)
+    {
+      TotalFound += QuerySpatialGridRadius(&Multi, X[Index], Y[Index], Distance, Neighbours, ArrayCount(Neighbours));
+    }
+    win32_bench_timing QueryTiming = Win32BenchEnd(Timer);
+
+    uint32 QueryErrors = 0;
+    real32 DistanceSq = Distance*Distance;
+    for (uint32 Query = 0; Query < 256; ++Query)
+    {
+      uint32 Index = (uint32)(((uint64)Query*Count) / 256);
+      uint32 Found = QuerySpatialGridRadius(&Multi, X[Index], Y[Index], Distance, Neighbours, ArrayCount(Neighbours));
+      uint32 Expected = 0;
+      for (uint32 Other = 0; Other < Count; ++Other)
+      {
+        real32 dX = X[Other] - X[Index];
+        real32 dY = Y[Other] - Y[Index];
+        if (dX*dX + dY*dY <= DistanceSq) ++Expected;
+      }
+      if (Found != Expected) ++QueryErrors;
+    }
+
+    uint32 MaxPairs = 4*Count;
+    spatial_pair *Pairs = PushArray(&Arena, MaxPairs, spatial_pair);
+    Timer = Win32BenchBegin();
+    uint32 PairCount = FindSpatialGridPairs(&Multi, 0, Count, Distance, Pairs, MaxPairs);
+    win32_bench_timing PairTiming = Win32BenchEnd(Timer);
+
+    // Nombre de paires exhaustif, seulement pour la petite scne
+    char PairCheck[32] = "-";
+    if (Count <= 10000)
+    {
+      uint32 ExpectedPairs = 0;
+      for (uint32 A = 0; A < Count; ++A)
+      {
+        for (uint32 B = A + 1; B < Count; ++B)
+        {
+          real32 dX = X[B] - X[A];
+          real32 dY = Y[B] - Y[A];
+          if (dX*dX + dY*dY <= DistanceSq) ++ExpectedPairs;
+        }
+      }
+      _snprintf_s(PairCheck, sizeof(PairCheck), _TRUNCATE, "%s", (ExpectedPairs == PairCount) ? "OK" : "ECHEC");
+    }
+
+    real32 FrameCount = (real32)Iterations;
+    Win32BenchPrint(Report, "%8u : construction %7.3f ms (1 thread) %7.3f ms (%u threads), ordre %s, "
+                    "requetes %5.1f ns/ent (%4.2f voisins, %s), paires %u en %7.3f ms (%s)\n",
+                    Count,
+                    1000.0f*SingleTiming.Seconds / FrameCount,
+                    1000.0f*MultiTiming.Seconds / FrameCount, ThreadCount + 1,
+                    OrderErrors ? "ECHEC" : "OK",
+                    1e9f*QueryTiming.Seconds / (real32)Count, (real32)TotalFound / (real32)Count,
+                    QueryErrors ? "ECHEC" : "OK",
+                    PairCount, 1000.0f*PairTiming.Seconds, PairCheck);
+  }
+  VirtualFree(ArenaMemory, 0, MEM_RELEASE);
+}
+
+/**
+ * Rfrence scalaire de UpdateParticles, dans le mme ordre d'oprations
+ **/
+internal void
+Win32BenchUpdateParticlesScalar(particle_system *System, real32 dt, real32 GravityX, real32 GravityY, real32 Drag)
+{
+  real32 DragFactor = GetParticleDragFactor(Drag, dt);
+  real32 GravityXdt = GravityX*dt;
+  real32 GravityYdt = GravityY*dt;
+  for (uint32 Index = 0; Index < System->Count; ++Index)
+  {
+    System->VelocityX[Index] = System->VelocityX[Index]*DragFactor + GravityXdt;
+    System->VelocityY[Index] = System->VelocityY[Index]*DragFactor + GravityYdt;
+    System->PositionX[Index] = System->PositionX[Index] + System->VelocityX[Index]*dt;
+    System->PositionY[Index] = System->PositionY[Index] + System->VelocityY[Index]*dt;
+    System->Life[Index] = System->Life[Index] - System->LifeDecay[Index]*dt;
+  }
+}
+
+/**
+ * Particules : mise  jour SSE et scalaire, retrait de 10% de mortes, et
+ * affichage additif dans chaque format, vrifi contre des rectangles
+ * additifs d'un pixel, pour 100k et 1M particules
+ **/
+internal void
+Win32BenchParticles(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n== Particules ==\n");
+  uint32 Counts[] = {100000, 1000000};
+  int Width = 1280;
+  int Height = 720;
+  uint64 ArenaSize = Megabytes(64);
+  SIZE_T BufferSize = Width * Height * GetBytesPerPixel(PixelFormat_RGBA32F);
+  void *ArenaMemory = VirtualAlloc(0, (SIZE_T)ArenaSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  void *SplatMemory = VirtualAlloc(0, BufferSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  void *ReferenceMemory = VirtualAlloc(0, BufferSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (ArenaMemory && SplatMemory && ReferenceMemory)
+  {
+    real32 dt = 1.0f / 60.0f;
+    real32 GravityY = -9.81f;
+    real32 Drag = 0.5f;
+    draw_color Color = {1.0f, 0.6f, 0.2f, 0.5f};
+    world_view View = {0.5f*(real32)Width, 0.5f*(real32)Height, 20.0f};
+    for (int CountIndex = 0; CountIndex < ArrayCount(Counts); ++CountIndex)
+    {
+      uint32 Count = Counts[CountIndex];
+      memory_arena Arena;
+      InitializeArena(&Arena, ArenaSize, ArenaMemory);
+      particle_system System;
+      InitializeParticleSystem(&System, &Arena, Count, 1234);
+      real32 *SavedX = PushArray(&Arena, System.MaxCount, real32);
+      real32 *SavedVX = PushArray(&Arena, System.MaxCount, real32);
+      real32 *SavedLife = PushArray(&Arena, System.MaxCount, real32);
+      real32 *ScalarX = PushArray(&Arena, System.MaxCount, real32);
+
+      // Des dures de vie longues : personne ne meurt pendant la mesure
+      particle_emitter Emitter = {};
+      Emitter.PositionY = -10.0f;
+      Emitter.VelocityY = 12.0f;
+      Emitter.Spread = 10.0f;
+      Emitter.MinLifetime = 100.0f;
+      Emitter.MaxLifetime = 200.0f;
+      EmitParticles(&System, &Emitter, Count);
+      for (int Step = 0; Step < 30; ++Step)
+      {
+        UpdateParticles(&System, dt, 0.0f, GravityY, Drag);
+      }
+
+      // Vrification : un pas SSE et un pas scalaire depuis le mme tat
+      memcpy(SavedX, System.PositionX, Count*sizeof(real32));
+      memcpy(SavedVX, System.VelocityX, Count*sizeof(real32));
+      memcpy(SavedLife, System.Life, Count*sizeof(real32));
+      Win32BenchUpdateParticlesScalar(&System, dt, 0.0f, GravityY, Drag);
+      memcpy(ScalarX, System.PositionX, Count*sizeof(real32));
+      real32 ScalarLife = System.Life[Count - 1];
+      memcpy(System.PositionX, SavedX, Count*sizeof(real32));
+      memcpy(System.VelocityX, SavedVX, Count*sizeof(real32));
+      memcpy(System.Life, SavedLife, Count*sizeof(real32));
+      UpdateParticles(&System, dt, 0.0f, GravityY, Drag);
+      uint32 Mismatches = (ScalarLife != System.Life[Count - 1]) ? 1 : 0;
+      for (uint32 Index = 0; Index < Count; ++Index)
+      {
+        if (ScalarX[Index] != System.PositionX[Index]) ++Mismatches;
+      }
+
+      int Iterations = 20;
+      win32_bench_timer Timer = Win32BenchBegin();
+      for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+      {
+        UpdateParticles(&System, dt, 0.0f, GravityY, Drag);
+      }
+      win32_bench_timing Simd = Win32BenchEnd(Timer);
+      Timer = Win32BenchBegin();
+      for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+      {
+        Win32BenchUpdateParticlesScalar(&System, dt, 0.0f, GravityY, Drag);
+      }
+      win32_bench_timing Scalar = Win32BenchEnd(Timer);
+
+      // Affichage dans chaque format, avant de tuer qui que ce soit
+      for (int FormatIndex = 0; FormatIndex < PixelFormat_Count; ++FormatIndex)
+      {
+        game_pixel_format Format = (game_pixel_format)FormatIndex;
+        game_offscreen_buffer Buffer = Win32BenchMakeBuffer(SplatMemory, Width, Height, Format);
+        game_offscreen_buffer Reference = Win32BenchMakeBuffer(ReferenceMemory, Width, Height, Format);
+        draw_kernels *Kernels = GetDrawKernels(&Buffer);
+        memset(SplatMemory, 0, BufferSize);
+        Timer = Win32BenchBegin();
+        RenderParticles(Kernels, &Buffer, &System, View, Color);
+        win32_bench_timing Splat = Win32BenchEnd(Timer);
+
+        // Rfrence : un rectangle additif d'un pixel par particule visible
+        memset(ReferenceMemory, 0, BufferSize);
+        uint32 Visible = 0;
+        for (uint32 Index = 0; Index < System.Count; ++Index)
+        {
+          real32 ScreenX = View.CenterX + System.PositionX[Index]*View.PixelsPerMeter;
+          real32 ScreenY = View.CenterY - System.PositionY[Index]*View.PixelsPerMeter;
+          if ((ScreenX >= 0.0f) && (ScreenX < (real32)Width) && (ScreenY >= 0.0f) && (ScreenY < (real32)Height))
+          {
+            draw_color PointColor = Color;
+            PointColor.A = Color.A*System.Life[Index];
+            int X = (int)ScreenX;
+            int Y = (int)ScreenY;
+            Kernels->FillRectangle[BlendMode_Additive][0](&Reference, X, Y, X + 1, Y + 1, PointColor);
+            ++Visible;
+          }
+        }
+        bool32 Matches = (memcmp(SplatMemory, ReferenceMemory, Height*Buffer.Pitch) == 0);
+        Win32BenchPrint(Report, "%8u %-8s : affichage %7.3f ms (%u visibles), %s\n",
+                        Count, DebugPixelFormatNames[FormatIndex],
+                        1000.0f*Splat.Seconds, Visible, Matches ? "OK" : "ECHEC");
+      }
+
+      // Une particule sur 10 meurt
+      for (uint32 Index = 0; Index < System.Count; Index += 10)
+      {
+        System.Life[Index] = -1.0f;
+      }
+      uint32 ExpectedCount = System.Count - (System.Count + 9) / 10;
+      Timer = Win32BenchBegin();
+      uint32 Removed = CompactParticles(&System);
+      win32_bench_timing Compact = Win32BenchEnd(Timer);
+      uint32 DeadLeft = 0;
+      for (uint32 Index = 0; Index < System.Count; ++Index)
+      {
+        if (System.Life[Index] <= 0.0f) ++DeadLeft;
+      }
+
+      real32 FrameCount = (real32)Iterations;
+      Win32BenchPrint(Report, "%8u : SSE %7.3f ms/image (%5.2f ns/part) scalaire %7.3f ms/image, ecarts %u, "
+                      "retrait %6.3f ms (%u retirees), %s\n",
+                      Count,
+                      1000.0f*Simd.Seconds / FrameCount, 1e9f*Simd.Seconds / (FrameCount*(real32)Count),
+                      1000.0f*Scalar.Seconds / FrameCount, Mismatches,
+                      1000.0f*Compact.Seconds, Removed,
+                      ((System.Count == ExpectedCount) && !DeadLeft) ? "OK" : "ECHEC");
+    }
+  }
+  if (ArenaMemory) VirtualFree(ArenaMemory, 0, MEM_RELEASE);
+  if (SplatMemory) VirtualFree(SplatMemory, 0, MEM_RELEASE);
+  if (ReferenceMemory) VirtualFree(ReferenceMemory, 0, MEM_RELEASE);
+}
+
+/**
+ * Eclairage de rfrence, sans tuiles : chaque lumire parcourt tout son
+ * rectangle (avec plus de marge que BinLights) dans un buffer de lumire
+ * plein cran, dans l'ordre des lumires. Seuls les formats 8 bits sRGB
+ * 32 bits sont pris en charge.
+ **/
+internal void
+Win32BenchLightingReference(game_offscreen_buffer *Buffer, point_light *Lights, uint32 LightCount,
+                            world_view View, light_ambient Ambient, memory_arena *Arena)
+{
+  temporary_memory ReferenceMemory = BeginTemporaryMemory(Arena);
+  int Width = Buffer->Width;
+  int Height = Buffer->Height;
+  // Largeur multiple de 4 : chaque ligne reste aligne pour ResolveLightRowSRGB8
+  int Stride = (Width + 3) & ~3;
+  real32 *LightR = PushArray(Arena, Stride*Height, real32);
+  real32 *LightG = PushArray(Arena, Stride*Height, real32);
+  real32 *LightB = PushArray(Arena, Stride*Height, real32);
+  for (int Index = 0; Index < Stride*Height; ++Index)
+  {
+    LightR[Index] = Ambient.R;
+    LightG[Index] = Ambient.G;
+    LightB[Index] = Ambient.B;
+  }
+
+  for (uint32 LightIndex = 0; LightIndex < LightCount; ++LightIndex)
+  {
+    point_light *Light = Lights + LightIndex;
+    real32 ScreenX = View.CenterX + Light->X*View.PixelsPerMeter;
+    real32 ScreenY = View.CenterY - Light->Y*View.PixelsPerMeter;
+    real32 ScreenRadius = Light->Radius*View.PixelsPerMeter;
+    real32 InvRadiusSq = 1.0f / (ScreenRadius*ScreenRadius);
+    int MinX = (int)floorf(ScreenX - ScreenRadius) - 4;
+    int MinY = (int)floorf(ScreenY - ScreenRadius) - 4;
+    int MaxX = (int)ceilf(ScreenX + ScreenRadius) + 4;
+    int MaxY = (int)ceilf(ScreenY + ScreenRadius) + 4;
+    if (MinX < 0) MinX = 0;
+    if (MinY < 0) MinY = 0;
+    if (MaxX > Width) MaxX = Width;
+    if (MaxY > Height) MaxY = Height;
+    for (int Y = MinY; Y < MaxY; ++Y)
+    {
+      real32 dY = ((real32)Y + 0.5f) - ScreenY;
+      real32 dYSq = dY*dY;
+      for (int X = MinX; X < MaxX; ++X)
+      {
+        real32 dX = ((real32)X + 0.5f) - ScreenX;
+        real32 Falloff = 1.0f - (dX*dX + dYSq)*InvRadiusSq;
+        if (Falloff < 0.0f) Falloff = 0.0f;
+        Falloff = Falloff*Falloff;
+        int Index = Y*Stride + X;
+        LightR[Index] += Falloff*Light->R;
+        LightG[Index] += Falloff*Light->G;
+        LightB[Index] += Falloff*Light->B;
+      }
+    }
+  }
+
+  uint8 *Row = (uint8 *)Buffer->Memory;
+  for (int Y = 0; Y < Height; ++Y)
+  {
+    if (Buffer->PixelFormat == PixelFormat_RGBA8888)
+    {
+      ResolveLightRowSRGB8<0, 16>((uint32 *)Row, LightR + Y*Stride, LightG + Y*Stride, LightB + Y*Stride, Width);
+    }
+    else
+    {
+      ResolveLightRowSRGB8<16, 0>((uint32 *)Row, LightR + Y*Stride, LightG + Y*Stride, LightB + Y*Stride, Width);
+    }
+    Row += Buffer->Pitch;
+  }
+  EndTemporaryMemory(ReferenceMemory);
+}
+
+/**
+ * Eclairage 2D en 1920x1080 : 100, 1000 et 4000 lumires de 24  96 pixels
+ * de rayon, tri par tuile seul puis passe complte sur un thread et sur la
+ * file de travail, dans chaque format. Les formats 32 bits sRGB sont
+ * compars  la rfrence sans tuiles, au bit prs.
+ **/
+internal void
+Win32BenchLighting(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n== Eclairage ==\n");
+  uint32 Counts[] = {100, 1000, 4000};
+  int Width = 1920;
+  int Height = 1080;
+  uint64 ArenaSize = Megabytes(64);
+  SIZE_T BufferSize = Width * Height * GetBytesPerPixel(PixelFormat_RGBA32F);
+  void *ArenaMemory = VirtualAlloc(0, (SIZE_T)ArenaSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  void *SceneMemory = VirtualAlloc(0, BufferSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  void *LitMemory = VirtualAlloc(0, BufferSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  void *ReferenceMemory = VirtualAlloc(0, BufferSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (ArenaMemory && SceneMemory && LitMemory && ReferenceMemory)
+  {
+    platform_api Platform = Win32GetPlatformAPI();
+    uint32 ThreadCount;
+    platform_work_queue *Queue = Win32BenchGetWorkQueue(&ThreadCount);
+    // Un mtre par pixel, Y vers le haut depuis le bas de l'cran
+    world_view View = {0.0f, (real32)Height, 1.0f};
+    light_ambient Ambient = {0.1f, 0.1f, 0.12f};
+    real32 FrameSeconds = 1.0f / 60.0f;
+
+    for (int CountIndex = 0; CountIndex < ArrayCount(Counts); ++CountIndex)
+    {
+      uint32 Count = Counts[CountIndex];
+      memory_arena Arena;
+      InitializeArena(&Arena, ArenaSize, ArenaMemory);
+      point_light *Lights = PushArray(&Arena, Count, point_light);
+      uint32 Random = 1;
+      for (uint32 Index = 0; Index < Count; ++Index)
+      {
+        point_light *Light = Lights + Index;
+        Random = Random*1664525 + 1013904223;
+        Light->X = (real32)(Random >> 8) / (real32)(1 << 24)*(real32)Width;
+        Random = Random*1664525 + 1013904223;
+        Light->Y = (real32)(Random >> 8) / (real32)(1 << 24)*(real32)Height;
+        Random = Random*1664525 + 1013904223;
+        Light->Radius = 24.0f + (real32)(Random >> 8) / (real32)(1 << 24)*72.0f;
+        Random = Random*1664525 + 1013904223;
+        Light->R = (real32)((Random >> 8) & 0xFF) / 170.0f;
+        Light->G = (real32)((Random >> 16) & 0xFF) / 170.0f;
+        Light->B = (real32)((Random >> 24) & 0xFF) / 170.0f;
+      }
+
+      // Tri seul, et nombre moyen de lumires par tuile
+      int Iterations = 20;
+      game_offscreen_buffer Scene = Win32BenchMakeBuffer(SceneMemory, Width, Height, PixelFormat_XRGB8888);
+      light_bins Bins;
+      temporary_memory BinMemory = BeginTemporaryMemory(&Arena);
+      win32_bench_timer Timer = Win32BenchBegin();
+      for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+      {
+        EndTemporaryMemory(BinMemory);
+        BinLights(&Bins, &Arena, &Scene, Lights, Count, View);
+      }
+      win32_bench_timing Binning = Win32BenchEnd(Timer);
+      real32 LightsPerTile = (real32)Bins.TileStart[Bins.TileCountX*Bins.TileCountY] /
+        (real32)(Bins.TileCountX*Bins.TileCountY);
+      EndTemporaryMemory(BinMemory);
+      Win32BenchPrint(Report, "%5u lumieres : tri %6.3f ms, %5.1f lumieres par tuile de %u px\n",
+                      Count, 1000.0f*Binning.Seconds / (real32)Iterations, LightsPerTile, LightTileDim);
+
+      for (int FormatIndex = 0; FormatIndex < PixelFormat_Count; ++FormatIndex)
+      {
+        game_pixel_format Format = (game_pixel_format)FormatIndex;
+        Scene = Win32BenchMakeBuffer(SceneMemory, Width, Height, Format);
+        game_offscreen_buffer Lit = Win32BenchMakeBuffer(LitMemory, Width, Height, Format);
+        game_offscreen_buffer Reference = Win32BenchMakeBuffer(ReferenceMemory, Width, Height, Format);
+        draw_kernels *Kernels = GetDrawKernels(&Scene);
+        Kernels->RenderGradient(&Scene, 0, 0);
+        SIZE_T SceneSize = (SIZE_T)Height*Scene.Pitch;
+
+        // Mesures sur la mme image, assombrie  chaque passe : le cot n'en dpend pas
+        Iterations = 5;
+        memcpy(LitMemory, SceneMemory, SceneSize);
+        Timer = Win32BenchBegin();
+        for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+        {
+          RenderLighting(&Lit, Lights, Count, View, Ambient, &Arena, &Platform, 0, 1);
+        }
+        win32_bench_timing Single = Win32BenchEnd(Timer);
+        memcpy(LitMemory, SceneMemory, SceneSize);
+        Timer = Win32BenchBegin();
+        for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+        {
+          RenderLighting(&Lit, Lights, Count, View, Ambient, &Arena, &Platform, Queue, LightingMaxJobCount);
+        }
+        win32_bench_timing Multi = Win32BenchEnd(Timer);
+
+        char *Status = "-";
+        if ((Format == PixelFormat_XRGB8888) || (Format == PixelFormat_RGBA8888))
+        {
+          memcpy(LitMemory, SceneMemory, SceneSize);
+          RenderLighting(&Lit, Lights, Count, View, Ambient, &Arena, &Platform, Queue, LightingMaxJobCount);
+          memcpy(ReferenceMemory, SceneMemory, SceneSize);
+          Win32BenchLightingReference(&Reference, Lights, Count, View, Ambient, &Arena);
+          Status = (memcmp(LitMemory, ReferenceMemory, SceneSize) == 0) ? "OK" : "ECHEC";
+        }
+
+        real32 MultiSeconds = Multi.Seconds / (real32)Iterations;
+        Win32BenchPrint(Report, "%5u lumieres %-8s : 1 thread %7.3f ms, %u threads %7.3f ms "
+                        "(%5.1f%% d'une image a 60 Hz), %s\n",
+                        Count, DebugPixelFormatNames[FormatIndex],
+                        1000.0f*Single.Seconds / (real32)Iterations, ThreadCount, 1000.0f*MultiSeconds,
+                        100.0f*MultiSeconds / FrameSeconds, Status);
+      }
+    }
+  }
+  if (ArenaMemory) VirtualFree(ArenaMemory, 0, MEM_RELEASE);
+  if (SceneMemory) VirtualFree(SceneMemory, 0, MEM_RELEASE);
+  if (LitMemory) VirtualFree(LitMemory, 0, MEM_RELEASE);
+  if (ReferenceMemory) VirtualFree(ReferenceMemory, 0, MEM_RELEASE);
+}
+
+/**
+ * Cot exact d'un chemin par un parcours en largeur de toute la carte
+ * dans une fentre de Window x Window tuiles centre sur le dpart
+ * Renvoie NavNoCost si l'arrive n'est pas atteinte dans la fentre
+ **/
+internal uint32
+Win32BenchNavExactCost(tile_map *TileMap, int32 StartX, int32 StartY, int32 GoalX, int32 GoalY,
+                       int32 Window, uint32 *Distance, uint32 *Queue)
+{
+  int32 MinX = StartX - Window / 2;
+  int32 MinY = StartY - Window / 2;
+  for (int32 Index = 0; Index < Window*Window; ++Index)
+  {
+    Distance[Index] = NavNoCost;
+  }
+  uint32 Result = NavNoCost;
+  uint32 ReadIndex = 0;
+  uint32 WriteIndex = 0;
+  Distance[(StartY - MinY)*Window + (StartX - MinX)] = 0;
+  Queue[WriteIndex++] = (uint32)((StartY - MinY)*Window + (StartX - MinX));
+  while (ReadIndex < WriteIndex)
+  {
+    uint32 Cell = Queue[ReadIndex++];
+    int32 X = (int32)(Cell % (uint32)Window);
+    int32 Y = (int32)(Cell / (uint32)Window);
+    if ((X + MinX == GoalX) && (Y + MinY == GoalY))
+    {
+      Result = Distance[Cell];
+      break;
+    }
+    int32 NeighborX[4] = {X - 1, X + 1, X, X};
+    int32 NeighborY[4] = {Y, Y, Y - 1, Y + 1};
+    for (int NeighborIndex = 0; NeighborIndex < 4; ++NeighborIndex)
+    {
+      int32 NX = NeighborX[NeighborIndex];
+      int32 NY = NeighborY[NeighborIndex];
+      if ((NX >= 0) && (NX < Window) && (NY >= 0) && (NY < Window))
+      {
+        uint32 Neighbor = (uint32)(NY*Window + NX);
+        if ((Distance[Neighbor] == NavNoCost) &&
+            (GetTileValue(TileMap, NX + MinX, NY + MinY) == NavWalkableTile))
+        {
+          Distance[Neighbor] = Distance[Cell] + 1;
+          Queue[WriteIndex++] = Neighbor;
+        }
+      }
+    }
+  }
+  return(Result);
+}
+
+// Le chemin part du dpart, arrive  l'arrive, et chaque pas va sur une tuile praticable voisine
+internal bool32
+Win32BenchCheckNavPath(tile_map *TileMap, nav_query *Query)
+{
+  nav_path *Path = &Query->Path;
+  bool32 Result = ((Path->Length == Path->Cost + 1) &&
+                   (Path->Tiles[0].X == Query->StartX) && (Path->Tiles[0].Y == Query->StartY) &&
+                   (Path->Tiles[Path->Length - 1].X == Query->GoalX) &&
+                   (Path->Tiles[Path->Length - 1].Y == Query->GoalY));
+  for (uint32 Index = 1; Result && (Index < Path->Length); ++Index)
+  {
+    nav_tile A = Path->Tiles[Index - 1];
+    nav_tile B = Path->Tiles[Index];
+    int32 Step = abs(A.X - B.X) + abs(A.Y - B.Y);
+    Result = ((Step == 1) && (GetTileValue(TileMap, B.X, B.Y) == NavWalkableTile));
+  }
+  return(Result);
+}
+
+// Deux graphes de la mme carte ont les mmes noeuds et les mmes cots
+internal uint32
+Win32BenchCompareNavGraphs(nav_graph *A, nav_graph *B)
+{
+  uint32 Differences = 0;
+  for (uint32 ClusterIndex = 0; ClusterIndex < A->ClusterCountX*A->ClusterCountY; ++ClusterIndex)
+  {
+    nav_cluster *ClusterA = A->Clusters + ClusterIndex;
+    nav_cluster *ClusterB = B->Clusters + ClusterIndex;
+    bool32 Same = (memcmp(ClusterA->NodeCount, ClusterB->NodeCount, sizeof(ClusterA->NodeCount)) == 0);
+    for (uint32 From = 0; Same && (From < NavMaxNodesPerCluster); ++From)
+    {
+      if (IsNavSlotUsed(ClusterA, From))
+      {
+        Same = (ClusterA->NodeTile[From] == ClusterB->NodeTile[From]);
+        for (uint32 To = 0; Same && (To < NavMaxNodesPerCluster); ++To)
+        {
+          if (IsNavSlotUsed(ClusterA, To)) Same = (ClusterA->Cost[From][To] == ClusterB->Cost[From][To]);
+        }
+      }
+    }
+    if (!Same) ++Differences;
+  }
+  return(Differences);
+}
+
+inline void
+Win32BenchRandomNavTile(tile_map *TileMap, uint32 *Random, int32 MinX, int32 MinY, int32 Range,
+                        int32 *TileX, int32 *TileY)
+{
+  do
+  {
+    *Random = *Random*1664525 + 1013904223;
+    *TileX = MinX + (int32)((*Random >> 8) % (uint32)Range);
+    *Random = *Random*1664525 + 1013904223;
+    *TileY = MinY + (int32)((*Random >> 8) % (uint32)Range);
+  } while (GetTileValue(TileMap, *TileX, *TileY) != NavWalkableTile);
+}
+
+/**
+ * Recherche de chemin sur une carte de 4096x4096 tuiles seme de murs :
+ * construction du graphe abstrait, mise  jour aprs quelques tuiles
+ * changes (compare  une reconstruction complte), puis dbit de requtes
+ * courtes (des agents) et longues, sur un thread et sur la file de travail.
+ * Les chemins courts sont vrifis et compars au plus court chemin exact.
+ **/
+internal void
+Win32BenchNav(win32_bench_report *Report)
+{
+  int32 Side = 4096;
+  int32 ChunkSide = Side / TileChunkDim;
+  Win32BenchPrint(Report, "\n== Recherche de chemin HPA* (%dx%d tuiles) ==\n", Side, Side);
+  uint64 ArenaSize = Megabytes(512);
+  void *ArenaMemory = VirtualAlloc(0, (SIZE_T)ArenaSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (!ArenaMemory) return;
+
+  platform_api Platform = Win32GetPlatformAPI();
+  uint32 ThreadCount;
+  platform_work_queue *Queue = Win32BenchGetWorkQueue(&ThreadCount);
+
+  memory_arena Arena;
+  InitializeArena(&Arena, ArenaSize, ArenaMemory);
+  tile_map TileMap;
+  InitializeTileMap(&TileMap, &Arena, 1 << 17, 1.4f);
+  for (int32 ChunkY = 0; ChunkY < ChunkSide; ++ChunkY)
+  {
+    for (int32 ChunkX = 0; ChunkX < ChunkSide; ++ChunkX)
+    {
+      tile_chunk *Chunk = GetTileChunk(&TileMap, ChunkX, ChunkY, &Arena);
+      for (int TileIndex = 0; TileIndex < TileChunkDim*TileChunkDim; ++TileIndex)
+      {
+        Chunk->Tiles[TileIndex] = NavWalkableTile;
+      }
+    }
+  }
+  // Des murs droits de 4  35 tuiles
+  uint32 Random = 77;
+  for (int WallIndex = 0; WallIndex < 60000; ++WallIndex)
+  {
+    Random = Random*1664525 + 1013904223;
+    int32 X = (int32)((Random >> 8) % (uint32)Side);
+    Random = Random*1664525 + 1013904223;
+    int32 Y = (int32)((Random >> 8) % (uint32)Side);
+    int32 Length = 4 + (int32)((Random >> 4) & 31);
+    bool32 IsVertical = (Random & 1);
+    for (int32 Step = 0; Step < Length; ++Step)
+    {
+      int32 TileX = IsVertical ? X : X + Step;
+      int32 TileY = IsVertical ? Y + Step : Y;
+      if ((TileX < Side) && (TileY < Side)) SetTileValue(&Arena, &TileMap, TileX, TileY, 2);
+    }
+  }
+
+  nav_graph Graph;
+  InitializeNavGraph(&Graph, &Arena, &TileMap, 0, 0, (uint32)ChunkSide, (uint32)ChunkSide);
+  win32_bench_timer Timer = Win32BenchBegin();
+  UpdateNavGraph(&Graph, &Arena, &Platform, 0, 1);
+  win32_bench_timing SingleBuild = Win32BenchEnd(Timer);
+  // Mme construction sur la file de travail, dans un second graphe qui sert de rfrence
+  temporary_memory ReferenceMemory = BeginTemporaryMemory(&Arena);
+  nav_graph Reference;
+  InitializeNavGraph(&Reference, &Arena, &TileMap, 0, 0, (uint32)ChunkSide, (uint32)ChunkSide);
+  Timer = Win32BenchBegin();
+  UpdateNavGraph(&Reference, &Arena, &Platform, Queue, NavMaxJobCount);
+  win32_bench_timing MultiBuild = Win32BenchEnd(Timer);
+  uint32 NodeCount = 0;
+  for (uint32 ClusterIndex = 0; ClusterIndex < Graph.ClusterCountX*Graph.ClusterCountY; ++ClusterIndex)
+  {
+    for (int SideIndex = 0; SideIndex < 4; ++SideIndex)
+    {
+      NodeCount += Graph.Clusters[ClusterIndex].NodeCount[SideIndex];
+    }
+  }
+  Win32BenchPrint(Report, "graphe    : %u clusters, %u noeuds, %7.1f ms (1 thread) %7.1f ms (%u threads), %s\n",
+                  Graph.ClusterCountX*Graph.ClusterCountY, NodeCount,
+                  1000.0f*SingleBuild.Seconds, 1000.0f*MultiBuild.Seconds, ThreadCount + 1,
+                  Win32BenchCompareNavGraphs(&Graph, &Reference) ? "ECHEC" : "OK");
+  EndTemporaryMemory(ReferenceMemory);
+
+  // 200 tuiles changent : mise  jour incrmentale, puis reconstruction complte de la rfrence
+  for (int ChangeIndex = 0; ChangeIndex < 200; ++ChangeIndex)
+  {
+    Random = Random*1664525 + 1013904223;
+    int32 X = (int32)((Random >> 8) % (uint32)Side);
+    Random = Random*1664525 + 1013904223;
+    int32 Y = (int32)((Random >> 8) % (uint32)Side);
+    uint32 Value = (GetTileValue(&TileMap, X, Y) == NavWalkableTile) ? 2 : NavWalkableTile;
+    SetTileValue(&Arena, &TileMap, X, Y, Value);
+    InvalidateNavTile(&Graph, X, Y);
+  }
+  uint32 DirtyCount = Graph.DirtyCount;
+  Timer = Win32BenchBegin();
+  UpdateNavGraph(&Graph, &Arena, &Platform, 0, 1);
+  win32_bench_timing Update = Win32BenchEnd(Timer);
+  ReferenceMemory = BeginTemporaryMemory(&Arena);
+  InitializeNavGraph(&Reference, &Arena, &TileMap, 0, 0, (uint32)ChunkSide, (uint32)ChunkSide);
+  UpdateNavGraph(&Reference, &Arena, &Platform, Queue, NavMaxJobCount);
+  Win32BenchPrint(Report, "mise a jour : %u clusters marques en %.3f ms, identique a une reconstruction : %s\n",
+                  DirtyCount, 1000.0f*Update.Seconds,
+                  Win32BenchCompareNavGraphs(&Graph, &Reference) ? "ECHEC" : "OK");
+  EndTemporaryMemory(ReferenceMemory);
+
+  // Requtes courtes (un agent va  moins de 48 tuiles) et longues (n'importe o sur la carte)
+  uint32 QueryCounts[] = {20000, 400};
+  int32 Ranges[] = {48, Side};
+  char *Names[] = {"courtes", "longues"};
+  for (int SetIndex = 0; SetIndex < ArrayCount(QueryCounts); ++SetIndex)
+  {
+    temporary_memory QueryMemory = BeginTemporaryMemory(&Arena);
+    uint32 QueryCount = QueryCounts[SetIndex];
+    int32 Range = Ranges[SetIndex];
+    // Chemin complet pour les requtes courtes, seulement le dbut pour les longues
+    uint32 MaxLength = (Range < Side) ? 512 : 32;
+    nav_query *Queries = PushArray(&Arena, QueryCount, nav_query);
+    nav_tile *Tiles = PushArray(&Arena, QueryCount*MaxLength, nav_tile);
+    for (uint32 QueryIndex = 0; QueryIndex < QueryCount; ++QueryIndex)
+    {
+      nav_query *Query = Queries + QueryIndex;
+      if (Range < Side)
+      {
+        Win32BenchRandomNavTile(&TileMap, &Random, Range, Range, Side - 2*Range, &Query->StartX, &Query->StartY);
+        Win32BenchRandomNavTile(&TileMap, &Random, Query->StartX - Range / 2, Query->StartY - Range / 2, Range,
+                                &Query->GoalX, &Query->GoalY);
+      }
+      else
+      {
+        Win32BenchRandomNavTile(&TileMap, &Random, 0, 0, Side, &Query->StartX, &Query->StartY);
+        Win32BenchRandomNavTile(&TileMap, &Random, 0, 0, Side, &Query->GoalX, &Query->GoalY);
+      }
+      Query->Path.MaxLength = MaxLength;
+      Query->Path.Tiles = Tiles + QueryIndex*MaxLength;
+    }
+
+    // Une requte longue peut visiter une bonne partie des noeuds de la carte
+    uint32 SearchCapacity = (Range < Side) ? (1 << 14) : (1 << 18);
+    Timer = Win32BenchBegin();
+    RunNavQueries(&Graph, Queries, QueryCount, &Arena, SearchCapacity, &Platform, 0, 1);
+    win32_bench_timing Single = Win32BenchEnd(Timer);
+    Timer = Win32BenchBegin();
+    RunNavQueries(&Graph, Queries, QueryCount, &Arena, SearchCapacity, &Platform, Queue, NavMaxJobCount);
+    win32_bench_timing Multi = Win32BenchEnd(Timer);
+
+    uint32 FoundCount = 0;
+    uint32 Invalid = 0;
+    uint32 Checked = 0;
+    uint32 Missed = 0;
+    uint64 ExactTotal = 0;
+    uint64 FoundTotal = 0;
+    if (Range < Side)
+    {
+      int32 Window = 4*Range;
+      uint32 *Distance = PushArray(&Arena, Window*Window, uint32);
+      uint32 *BFSQueue = PushArray(&Arena, Window*Window, uint32);
+      for (uint32 QueryIndex = 0; QueryIndex < QueryCount; ++QueryIndex)
+      {
+        nav_query *Query = Queries + QueryIndex;
+        if (Query->Found && !Win32BenchCheckNavPath(&TileMap, Query)) ++Invalid;
+        if (QueryIndex < 1000)
+        {
+          uint32 Exact = Win32BenchNavExactCost(&TileMap, Query->StartX, Query->StartY,
+                                                Query->GoalX, Query->GoalY, Window, Distance, BFSQueue);
+          if (Exact != NavNoCost)
+          {
+            ++Checked;
+            if (Query->Found)
+            {
+              ExactTotal += Exact;
+              FoundTotal += Query->Path.Cost;
+            }
+            else
+            {
+              ++Missed;
+            }
+          }
+        }
+      }
+    }
+    for (uint32 QueryIndex = 0; QueryIndex < QueryCount; ++QueryIndex)
+    {
+      if (Queries[QueryIndex].Found) ++FoundCount;
+    }
+
+    Win32BenchPrint(Report, "%-7s : %8.0f req/s (1 thread) %8.0f req/s (%u threads), %u/%u trouvees",
+                    Names[SetIndex], (real32)QueryCount / Single.Seconds, (real32)QueryCount / Multi.Seconds,
+                    ThreadCount + 1, FoundCount, QueryCount);
+    if (Range < Side)
+    {
+      Win32BenchPrint(Report, ", chemins %s, %u comparees au chemin exact : %u manquees, +%.1f%% de longueur",
+                      Invalid ? "ECHEC" : "OK", Checked, Missed,
+                      ExactTotal ? 100.0f*(real32)(FoundTotal - ExactTotal) / (real32)ExactTotal : 0.0f);
+    }
+    Win32BenchPrint(Report, "\n");
+    EndTemporaryMemory(QueryMemory);
+  }
+
+  VirtualFree(ArenaMemory, 0, MEM_RELEASE);
+}
+
+enum win32_bench_log_format
+{
+  BenchLogFormat_FrameTime,
+  BenchLogFormat_Sequence,
+
+  BenchLogFormat_Count,
+};
+
+global_variable char *BenchLogFormats[BenchLogFormat_Count] =
+{
+  "%0.2f ms/f, %0.2f f/s, %0.2f Mc/f, %0.2f ms lat",
+  "T%u #%u",
+};
+
+#define BenchLogThreadCount 4
+#define BenchLogThreadRecords 100000
+
+struct win32_bench_log_thread
+{
+  win32_logger *Logger;
+  uint32 Index;
+  uint32 Pushed;
+  uint32 Dropped;
+};
+
+DWORD WINAPI
+Win32BenchLogThreadProc(LPVOID Parameter)
+{
+  win32_bench_log_thread *Thread = (win32_bench_log_thread *)Parameter;
+  log_ring *Ring = Win32AddLogRing(Thread->Logger);
+  if (Ring)
+  {
+    for (uint32 Sequence = 0; Sequence < BenchLogThreadRecords; ++Sequence)
+    {
+      PushLog(Ring, BenchLogFormat_Sequence, Thread->Index, Sequence);
+      // Une rafale par "image" d'un quart d'anneau, sans jamais attendre le vidage
+      if ((Sequence % (LogRingRecordCount / 4)) == (LogRingRecordCount / 4 - 1))
+      {
+        SetEvent(Thread->Logger->WakeEvent);
+        Sleep(1);
+      }
+    }
+    Thread->Pushed = BenchLogThreadRecords;
+    Thread->Dropped = Ring->DroppedCount;
+  }
+  return(0);
+}
+
+// Le thread de vidage a tout lu dans l'anneau
+internal void
+Win32BenchWaitLogDrained(win32_logger *Logger, log_ring *Ring)
+{
+  SetEvent(Logger->WakeEvent);
+  while (Ring->ReadIndex != Ring->WriteIndex)
+  {
+    Sleep(1);
+  }
+}
+
+/**
+ * Une conversion du format, formate par FormatLogRecord depuis un
+ * enregistrement, compare au mme format pass en entier  _snprintf_s
+ **/
+internal uint32
+Win32BenchCheckLogText(win32_bench_report *Report, log_ring *Ring, char *Format, char *Expected)
+{
+  uint32 Result = 0;
+  char Text[LogMaxLineText];
+  log_record *Record = PeekLogRecord(Ring);
+  if (Record)
+  {
+    FormatLogRecord(Text, sizeof(Text), Format, Record);
+    ReleaseLogRecord(Ring);
+    if (strcmp(Text, Expected) != 0)
+    {
+      Win32BenchPrint(Report, "ECHEC \"%s\" : \"%s\" au lieu de \"%s\"\n", Format, Text, Expected);
+      Result = 1;
+    }
+  }
+  else
+  {
+    Result = 1;
+  }
+  return(Result);
+}
+
+/**
+ * Journal binaire : texte identique  _snprintf_s, cot d'un appel sur le
+ * thread qui journalise compar  _snprintf_s + OutputDebugStringA, et
+ * plusieurs threads qui journalisent pendant le vidage : rien de perdu sans
+ * tre compt, et l'ordre de chaque thread gard dans le fichier.
+ **/
+internal void
+Win32BenchLogger(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n== Journal ==\n");
+
+  // Texte des enregistrements, dans un anneau que personne d'autre ne lit
+  log_ring *CheckRing = (log_ring *)VirtualAlloc(0, sizeof(log_ring), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (CheckRing)
+  {
+    uint32 Failures = 0;
+    char Expected[LogMaxLineText];
+
+    char *Format = LogFormats[LogFormat_ResolutionOverBudget];
+    PushLog(CheckRing, 0, 1234u, 12.345f, 87.5f, 3u, 0.9f, 0.85f);
+    _snprintf_s(Expected, sizeof(Expected), _TRUNCATE, Format, 1234u, 12.345f, 87.5f, 3u, 0.9f, 0.85f);
+    Failures += Win32BenchCheckLogText(Report, CheckRing, Format, Expected);
+
+    Format = LogFormats[LogFormat_AudioCursors];
+    PushLog(CheckRing, 0, 7u, 48000u, 19200u, 4096u, 8192u, 4096u, 0.0213f);
+    _snprintf_s(Expected, sizeof(Expected), _TRUNCATE, Format, 7u, 48000u, 19200u, 4096u, 8192u, 4096u, 0.0213f);
+    Failures += Win32BenchCheckLogText(Report, CheckRing, Format, Expected);
+
+    Format = "%d %5d %-5d| %x %08X %llu %lld %c %%";
+    PushLog(CheckRing, 0, -42, 7, 7, 0xBEEFu, 0xBEEFu, (uint64)1 << 40, (int64)-5);
+    _snprintf_s(Expected, sizeof(Expected), _TRUNCATE, "%d %5d %-5d| %x %08X %llu %lld ? %%",
+                -42, 7, 7, 0xBEEFu, 0xBEEFu, (uint64)1 << 40, (int64)-5);
+    Failures += Win32BenchCheckLogText(Report, CheckRing, Format, Expected);
+
+    Format = "%s / %10s / %.3e / %g / %c";
+    PushLog(CheckRing, 0, "texte", "droite", 12345.678, 0.0001, 'A');
+    _snprintf_s(Expected, sizeof(Expected), _TRUNCATE, Format, "texte", "droite", 12345.678, 0.0001, 'A');
+    Failures += Win32BenchCheckLogText(Report, CheckRing, Format, Expected);
+
+    Win32BenchPrint(Report, "texte des enregistrements : %s\n", Failures ? "ECHEC" : "OK");
+    VirtualFree(CheckRing, 0, MEM_RELEASE);
+  }
+
+  win32_logger Logger = {};
+  if (Win32StartLogger(&Logger, "bench_log.txt", BenchLogFormats, BenchLogFormat_Count))
+  {
+    log_ring *Ring = Win32AddLogRing(&Logger);
+    if (Ring)
+    {
+      // Par rafales de la moiti de l'anneau, vid entre deux rafales : rien n'est perdu
+      uint32 Bursts = 64;
+      uint32 BurstCount = LogRingRecordCount / 2;
+      real32 PushSeconds = 0.0f;
+      uint64 PushCycles = 0;
+      real32 MSPerFrame = 16.67f;
+      for (uint32 Burst = 0; Burst < Bursts; ++Burst)
+      {
+        Win32BenchWaitLogDrained(&Logger, Ring);
+        win32_bench_timer Timer = Win32BenchBegin();
+        for (uint32 Index = 0; Index < BurstCount; ++Index)
+        {
+          PushLog(Ring, BenchLogFormat_FrameTime, MSPerFrame, 1000.0f / MSPerFrame, 3.5f, 1.25f);
+        }
+        win32_bench_timing Timing = Win32BenchEnd(Timer);
+        PushSeconds += Timing.Seconds;
+        PushCycles += Timing.Cycles;
+      }
+      Win32BenchWaitLogDrained(&Logger, Ring);
+      uint32 PushCount = Bursts*BurstCount;
+      real32 PushNanoseconds = 1.0e9f*PushSeconds / (real32)PushCount;
+
+      // Ancien chemin : format et envoy  la sortie de debug sur le thread mme
+      uint32 DebugCount = 2000;
+      char Line[256];
+      win32_bench_timer Timer = Win32BenchBegin();
+      for (uint32 Index = 0; Index < DebugCount; ++Index)
+      {
+        _snprintf_s(Line, sizeof(Line), _TRUNCATE, "%0.2f ms/f, %0.2f f/s, %0.2f Mc/f, %0.2f ms lat\n",
+                    MSPerFrame, 1000.0f / MSPerFrame, 3.5f, 1.25f);
+        OutputDebugStringA(Line);
+      }
+      win32_bench_timing Debug = Win32BenchEnd(Timer);
+      real32 DebugNanoseconds = 1.0e9f*Debug.Seconds / (real32)DebugCount;
+
+      Win32BenchPrint(Report, "PushLog : %6.1f ns/appel (%5.1f cycles), objectif 50 ns : %s, %u perdus\n",
+                      PushNanoseconds, (real32)PushCycles / (real32)PushCount,
+                      (PushNanoseconds < 50.0f) ? "OK" : "ECHEC", Ring->DroppedCount);
+      Win32BenchPrint(Report, "_snprintf_s + OutputDebugStringA : %8.1f ns/appel (%s), x%.0f\n",
+                      DebugNanoseconds, IsDebuggerPresent() ? "debogueur attache" : "sans debogueur",
+                      DebugNanoseconds / PushNanoseconds);
+    }
+
+    // Plusieurs threads en mme temps que le vidage
+    win32_bench_log_thread Threads[BenchLogThreadCount] = {};
+    HANDLE Handles[BenchLogThreadCount];
+    uint32 ThreadCount = 0;
+    uint64 WrittenCount = Logger.WrittenCount;
+    for (uint32 Index = 0; Index < BenchLogThreadCount; ++Index)
+    {
+      Threads[Index].Logger = &Logger;
+      Threads[Index].Index = Index;
+      DWORD ThreadID;
+      Handles[ThreadCount] = CreateThread(0, 0, Win32BenchLogThreadProc, Threads + Index, 0, &ThreadID);
+      if (Handles[ThreadCount]) ++ThreadCount;
+    }
+    WaitForMultipleObjects(ThreadCount, Handles, TRUE, INFINITE);
+    for (uint32 Index = 0; Index < ThreadCount; ++Index)
+    {
+      CloseHandle(Handles[Index]);
+    }
+    Win32StopLogger(&Logger);
+    WrittenCount = Logger.WrittenCount - WrittenCount;
+    // Plus personne n'crit : les anneaux du bench sont rendus
+    for (uint32 RingIndex = 0; RingIndex < Logger.RingCount; ++RingIndex)
+    {
+      if (Logger.Rings[RingIndex]) VirtualFree(Logger.Rings[RingIndex], 0, MEM_RELEASE);
+    }
+
+    // Relecture : chaque thread dans l'ordre, le compte gal  ce qui n'a pas t perdu
+    uint32 Expected = 0;
+    uint32 Dropped = 0;
+    for (uint32 Index = 0; Index < BenchLogThreadCount; ++Index)
+    {
+      Expected += Threads[Index].Pushed - Threads[Index].Dropped;
+      Dropped += Threads[Index].Dropped;
+    }
+    uint32 Found = 0;
+    uint32 OutOfOrder = 0;
+    uint32 TimeReversals = 0;
+    uint32 NextSequence[BenchLogThreadCount] = {};
+    debug_read_file_result File = DEBUGPlatformReadEntireFile("bench_log.txt");
+    if (File.Contents)
+    {
+      char *At = (char *)File.Contents;
+      char *End = At + File.ContentsSize;
+      real64 LastMilliseconds = 0.0;
+      while (At < End)
+      {
+        char *LineEnd = At;
+        while ((LineEnd < End) && (*LineEnd != '\n')) ++LineEnd;
+        // "%10.3f [%5u] T%u #%u"
+        char *Message = At;
+        while ((Message + 1 < LineEnd) && !((Message[0] == ']') && (Message[1] == ' '))) ++Message;
+        Message += 2;
+        if ((Message < LineEnd) && (*Message == 'T'))
+        {
+          real64 Milliseconds = strtod(At, 0);
+          char *Next;
+          uint32 ThreadIndex = (uint32)strtoul(Message + 1, &Next, 10);
+          uint32 Sequence = (uint32)strtoul(Next + 2, 0, 10);
+          if ((ThreadIndex < BenchLogThreadCount) && (Sequence >= NextSequence[ThreadIndex]))
+          {
+            NextSequence[ThreadIndex] = Sequence + 1;
+          }
+          else
+          {
+            ++OutOfOrder;
+          }
+          if (Milliseconds < LastMilliseconds) ++TimeReversals;
+          LastMilliseconds = Milliseconds;
+          ++Found;
+        }
+        At = LineEnd + 1;
+      }
+      DEBUGPlatformFreeFileMemory(File.Contents);
+    }
+    Win32BenchPrint(Report, "%u threads : %u ecrits, %u perdus comptes, %u relus, %u hors ordre, "
+                    "%u retours en arriere du temps entre deux vidages : %s\n",
+                    ThreadCount, Expected, Dropped, Found, OutOfOrder, TimeReversals,
+                    ((Found == Expected) && (WrittenCount >= Expected) && !OutOfOrder) ? "OK" : "ECHEC");
+  }
+  else
+  {
+    Win32BenchPrint(Report, "bench_log.txt : ECHEC a l'ouverture\n");
+  }
+}
+
+/**
+ * Mmoire du jeu engage d'un coup ou  la demande (-lazycommit) : dure de
+ * l'allocation et des initialisations de faitmain.cpp, octets engags,
+ * engagement du processus et ensemble de travail ajouts. Puis le cot d'un
+ * PushSize_ dans une arne paresseuse, engagements compris.
+ **/
+internal void
+Win32BenchGameMemory(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n== Memoire du jeu ==\n");
+  uint64 PermanentSize = Megabytes(64);
+  uint64 TransientSize = Gigabytes(1);
+  uint64 TotalSize = PermanentSize + TransientSize;
+  for (int IsLazy = 0; IsLazy < 2; ++IsLazy)
+  {
+    PROCESS_MEMORY_COUNTERS_EX Before = Win32GetProcessMemory();
+    win32_bench_timer Timer = Win32BenchBegin();
+    uint8 *Memory = (uint8 *)VirtualAlloc(0, (SIZE_T)TotalSize, IsLazy ? MEM_RESERVE : (MEM_RESERVE|MEM_COMMIT),
+                                          PAGE_READWRITE);
+    win32_bench_timing Allocation = Win32BenchEnd(Timer);
+    if (Memory)
+    {
+      // Les mmes initialisations que la premire image du jeu
+      Timer = Win32BenchBegin();
+      memory_arena World;
+      memory_arena Tran;
+      if (IsLazy)
+      {
+        InitializeLazyArena(&World, PermanentSize, Memory, Win32CommitMemory);
+        InitializeLazyArena(&Tran, TransientSize, Memory + PermanentSize, Win32CommitMemory);
+      }
+      else
+      {
+        InitializeArena(&World, PermanentSize, Memory);
+        InitializeArena(&Tran, TransientSize, Memory + PermanentSize);
+      }
+      tile_map *TileMap = PushStruct(&World, tile_map);
+      InitializeTileMap(TileMap, &World, 4096, 1.4f);
+      for (int32 TileY = -9; TileY < 9; ++TileY)
+      {
+        for (int32 TileX = -16; TileX < 16; ++TileX)
+        {
+          bool32 IsWall = ((TileX == -16) || (TileX == 15) || (TileY == -9) || (TileY == 8));
+          SetTileValue(&World, TileMap, TileX, TileY, IsWall ? 2 : 1);
+        }
+      }
+      entity_storage *Entities = PushStruct(&World, entity_storage);
+      InitializeEntityStorage(Entities, &World, 65536);
+      text_batch *Text = PushStruct(&Tran, text_batch);
+      InitializeTextBatch(Text, &Tran, 8192);
+      particle_system *Particles = PushStruct(&Tran, particle_system);
+      InitializeParticleSystem(Particles, &Tran, 1 << 20, 0x5EED);
+      win32_bench_timing Startup = Win32BenchEnd(Timer);
+
+      PROCESS_MEMORY_COUNTERS_EX After = Win32GetProcessMemory();
+      uint64 Committed = Win32GetCommittedSize(Memory, TotalSize);
+      Win32BenchPrint(Report, "%-14s : allocation %8.3f ms, initialisation %7.3f ms, %8llu Ko engages "
+                      "sur %llu Ko (%llu Ko utilises), engagement +%8lld Ko, ensemble de travail +%7lld Ko\n",
+                      IsLazy ? "a la demande" : "tout engage",
+                      1000.0f*Allocation.Seconds, 1000.0f*Startup.Seconds, Committed / 1024, TotalSize / 1024,
+                      (World.Used + Tran.Used) / 1024,
+                      ((int64)After.PrivateUsage - (int64)Before.PrivateUsage) / 1024,
+                      ((int64)After.WorkingSetSize - (int64)Before.WorkingSetSize) / 1024);
+      VirtualFree(Memory, 0, MEM_RELEASE);
+    }
+  }
+
+  // Petits PushSize_ qui remplissent une arne de 256 Mo, engage d'un coup ou  la demande
+  uint64 ArenaSize = Megabytes(256);
+  uint64 ItemSize = 64;
+  uint32 PushCount = (uint32)(ArenaSize / ItemSize);
+  real32 PushNanoseconds[2] = {};
+  for (int IsLazy = 0; IsLazy < 2; ++IsLazy)
+  {
+    uint8 *Memory = (uint8 *)VirtualAlloc(0, (SIZE_T)ArenaSize, IsLazy ? MEM_RESERVE : (MEM_RESERVE|MEM_COMMIT),
+                                          PAGE_READWRITE);
+    if (Memory)
+    {
+      memory_arena Arena;
+      if (IsLazy)
+      {
+        InitializeLazyArena(&Arena, ArenaSize, Memory, Win32CommitMemory);
+      }
+      else
+      {
+        InitializeArena(&Arena, ArenaSize, Memory);
+      }
+      // Chaque lment est crit : les pages sont touches dans les deux cas
+      win32_bench_timer Timer = Win32BenchBegin();
+      for (uint32 Index = 0; Index < PushCount; ++Index)
+      {
+        uint32 *Item = (uint32 *)PushSize(&Arena, ItemSize);
+        *Item = Index;
+      }
+      win32_bench_timing Timing = Win32BenchEnd(Timer);
+      PushNanoseconds[IsLazy] = 1.0e9f*Timing.Seconds / (real32)PushCount;
+      VirtualFree(Memory, 0, MEM_RELEASE);
+    }
+  }
+  Win32BenchPrint(Report, "PushSize_ de %llu octets : %6.2f ns tout engage, %6.2f ns a la demande "
+                  "(un engagement par %llu Ko)\n",
+                  ItemSize, PushNanoseconds[0], PushNanoseconds[1], (uint64)ArenaCommitGranularity / 1024);
+}
+
+/**
+ * Empreinte de l'tat : dbit de HashMemory sur 64 Mo, dure de
+ * HashGameState sur la file de travail (objectif : quelques ms), rsultat
+ * indpendant du nombre de tches, un bit chang n'importe o retrouv dans
+ * le bon morceau, et avalanche (la moiti des bits changent en moyenne).
+ **/
+internal void
+Win32BenchStateHash(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n== Empreinte de l'etat ==\n");
+  uint64 Size = Megabytes(64);
+  uint8 *Memory = (uint8 *)VirtualAlloc(0, (SIZE_T)Size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (Memory)
+  {
+    uint32 Random = 1;
+    for (uint64 Index = 0; Index < Size / sizeof(uint32); ++Index)
+    {
+      Random = Random*1664525 + 1013904223;
+      ((uint32 *)Memory)[Index] = Random;
+    }
+    platform_api Platform = Win32GetPlatformAPI();
+    uint32 ThreadCount;
+    platform_work_queue *Queue = Win32BenchGetWorkQueue(&ThreadCount);
+
+    int Iterations = 5;
+    uint64 Single = 0;
+    win32_bench_timer Timer = Win32BenchBegin();
+    for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+    {
+      Single ^= HashMemory(Memory, Size, Iteration);
+    }
+    win32_bench_timing SingleTiming = Win32BenchEnd(Timer);
+    real32 SingleSeconds = SingleTiming.Seconds / (real32)Iterations;
+    Win32BenchPrint(Report, "HashMemory 64 Mo, 1 thread : %7.3f ms, %5.2f Go/s, %4.2f cycles/octet (%016llx)\n",
+                    1000.0f*SingleSeconds, (real32)Size / (SingleSeconds*1.0e9f),
+                    (real32)SingleTiming.Cycles / ((real32)Iterations*(real32)Size), Single);
+
+    game_state_hash Hash;
+    game_state_hash OneJob;
+    Timer = Win32BenchBegin();
+    for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+    {
+      HashGameState(&Hash, Memory, 0, Size, &Platform, Queue, StateHashMaxJobCount);
+    }
+    win32_bench_timing MultiTiming = Win32BenchEnd(Timer);
+    real32 MultiSeconds = MultiTiming.Seconds / (real32)Iterations;
+    HashGameState(&OneJob, Memory, 0, Size, &Platform, 0, 1);
+    Win32BenchPrint(Report, "HashGameState 64 Mo, %u threads : %7.3f ms, %5.2f Go/s, 1 tache identique : %s\n",
+                    ThreadCount, 1000.0f*MultiSeconds, (real32)Size / (MultiSeconds*1.0e9f),
+                    (memcmp(&Hash, &OneJob, sizeof(Hash)) == 0) ? "OK" : "ECHEC");
+
+    // Un bit chang : l'empreinte change et le morceau trouv contient l'octet
+    uint32 Flips = 200;
+    uint32 Missed = 0;
+    uint32 Misplaced = 0;
+    uint64 FirstByte = 4096;
+    uint64 StateSize = Megabytes(8) + 123;
+    game_state_hash Reference;
+    HashGameState(&Reference, Memory, FirstByte, StateSize, &Platform, Queue, StateHashMaxJobCount);
+    for (uint32 Flip = 0; Flip < Flips; ++Flip)
+    {
+      Random = Random*1664525 + 1013904223;
+      uint64 Offset = FirstByte + ((uint64)Random*StateSize >> 32);
+      uint8 Bit = (uint8)(1 << (Flip & 7));
+      Memory[Offset] ^= Bit;
+      HashGameState(&Hash, Memory, FirstByte, StateSize, &Platform, Queue, StateHashMaxJobCount);
+      Memory[Offset] ^= Bit;
+      if (Hash.Total == Reference.Total)
+      {
+        ++Missed;
+      }
+      else
+      {
+        uint32 Range = FirstDifferentStateRange(&Hash, &Reference);
+        uint64 RangeStart = FirstByte + Range*Hash.RangeSize;
+        if ((Offset < RangeStart) || (Offset >= RangeStart + Hash.RangeSize)) ++Misplaced;
+      }
+    }
+    Win32BenchPrint(Report, "%u bits changes sur %llu octets : %u non vus, %u mal places : %s\n",
+                    Flips, StateSize, Missed, Misplaced, (Missed || Misplaced) ? "ECHEC" : "OK");
+
+    // Avalanche sur une bande : chaque bit d'entre change en moyenne 32 bits de sortie
+    uint64 Base = HashMemory(Memory, 64, 0);
+    uint32 ChangedBits = 0;
+    for (uint32 Bit = 0; Bit < 64*8; ++Bit)
+    {
+      Memory[Bit / 8] ^= (uint8)(1 << (Bit & 7));
+      uint64 Changed = Base ^ HashMemory(Memory, 64, 0);
+      Memory[Bit / 8] ^= (uint8)(1 << (Bit & 7));
+      for (; Changed; Changed &= Changed - 1) ++ChangedBits;
+    }
+    real32 Average = (real32)ChangedBits / (64.0f*8.0f);
+    Win32BenchPrint(Report, "avalanche : %5.2f bits de sortie changes par bit d'entree (32 attendus) : %s\n",
+                    Average, ((Average > 30.0f) && (Average < 34.0f)) ? "OK" : "ECHEC");
+    VirtualFree(Memory, 0, MEM_RELEASE);
+  }
+}
+
+/*
+  Rollback : des parties compltes du jeu dans le mme processus
+*/
+
+#define BenchRollbackPlayerCount 3
+#define BenchRollbackFrameCount 600
+
+// Mmoire d'une partie comme dans WinMain (-lazycommit), initialise par une image vide
+internal bool32
+Win32BenchStartGame(game_memory *Memory)
+{
+  memset(Memory, 0, sizeof(*Memory));
+  Memory->PermanentStorageSize = Megabytes(64);
+  Memory->TransientStorageSize = Gigabytes(1);
+  Memory->IsCommittedOnDemand = true;
+  Memory->PermanentStorage = VirtualAlloc(0, (SIZE_T)(Memory->PermanentStorageSize + Memory->TransientStorageSize),
+                                          MEM_RESERVE, PAGE_READWRITE);
+  bool32 Result = (Memory->PermanentStorage != 0);
+  if (Result)
+  {
+    Memory->TransientStorage = (uint8 *)Memory->PermanentStorage + Memory->PermanentStorageSize;
+    Memory->DEBUGPlatformFreeFileMemory = DEBUGPlatformFreeFileMemory;
+    Memory->DEBUGPlatformReadEntireFile = DEBUGPlatformReadEntireFile;
+    Memory->DEBUGPlatformWriteEntireFile = DEBUGPlatformWriteEntireFile;
+    uint32 ThreadCount;
+    Memory->HighPriorityQueue = Win32BenchGetWorkQueue(&ThreadCount);
+    Memory->LowPriorityQueue = Memory->HighPriorityQueue;
+    Memory->PlatformAPI = Win32GetPlatformAPI();
+    game_input Empty = {};
+    GameSimulateFrame(Memory, &Empty);
+  }
+  return(Result);
+}
+
+// Chaque joueur change d'entre  son propre rythme, parfois avec le stick
+internal net_input
+Win32BenchRollbackInput(uint32 Player, uint32 Frame)
+{
+  net_input Result = {};
+  Result.Flags = NetInput_Connected;
+  uint32 Random = (Frame / (5 + 4*Player))*2654435761u + (Player + 1)*40503u;
+  Random ^= Random >> 13;
+  Random *= 1664525;
+  Random ^= Random >> 16;
+  if (Random & 0x100)
+  {
+    Result.Flags = NetInput_Connected | NetInput_Analog;
+    Result.StickX = (int8)((int32)((Random >> 8) & 0xFF) - 128);
+    Result.StickY = (int8)((int32)((Random >> 16) & 0xFF) - 128);
+  }
+  else
+  {
+    Result.Buttons = (uint16)(1 << ((Random >> 20) % 4));
+  }
+  return(Result);
+}
+
+// L'tat simul de deux parties, champ par champ : les pointeurs diffrent d'une partie  l'autre
+internal bool32
+Win32BenchSameGameState(game_memory *A, game_memory *B)
+{
+  game_state *StateA = (game_state *)A->PermanentStorage;
+  game_state *StateB = (game_state *)B->PermanentStorage;
+  entity_storage *EntitiesA = &StateA->Entities;
+  entity_storage *EntitiesB = &StateB->Entities;
+  size_t Size = EntitiesA->Count*sizeof(real32);
+  bool32 Result = ((StateA->ToneHz == StateB->ToneHz) && (StateA->BlueOffset == StateB->BlueOffset) &&
+                   (StateA->GreenOffset == StateB->GreenOffset) &&
+                   (StateA->SimulationStepIndex == StateB->SimulationStepIndex) &&
+                   (StateA->SimulationAccumulator == StateB->SimulationAccumulator) &&
+                   (EntitiesA->Count == EntitiesB->Count) &&
+                   (memcmp(EntitiesA->PositionX, EntitiesB->PositionX, Size) == 0) &&
+                   (memcmp(EntitiesA->PositionY, EntitiesB->PositionY, Size) == 0) &&
+                   (memcmp(EntitiesA->VelocityX, EntitiesB->VelocityX, Size) == 0) &&
+                   (memcmp(EntitiesA->VelocityY, EntitiesB->VelocityY, Size) == 0));
+  // Les scripts : o chacun en est, et son cadre
+  script_scheduler *ScriptsA = &StateA->Scripts;
+  script_scheduler *ScriptsB = &StateB->Scripts;
+  Result = (Result && (ScriptsA->RunningCount == ScriptsB->RunningCount) &&
+            (StateA->AgentGoalX == StateB->AgentGoalX) && (StateA->AgentGoalY == StateB->AgentGoalY) &&
+            (memcmp(ScriptsA->Scripts, ScriptsB->Scripts, ScriptsA->MaxCount*sizeof(script)) == 0) &&
+            (memcmp(ScriptsA->Frames, ScriptsB->Frames, (size_t)ScriptsA->MaxCount*ScriptMaxFrameSize) == 0));
+  return(Result);
+}
+
+/**
+ * Une partie en rseau : BenchRollbackPlayerCount sessions relies par
+ * Loopback, sur une horloge simule d'une image par tour. Le joueur Player
+ * ne commence qu'au tour StartTicks[Player]. Renvoie true si toutes les
+ * parties ont simul BenchRollbackFrameCount images avec toutes les entres
+ * confirmes avant la limite de tours.
+ **/
+internal bool32
+Win32BenchRunRollbackMatch(rollback_session *Sessions, game_memory *Games, net_loopback *Loopback,
+                           uint8 *SnapshotMemory, uint64 SnapshotSize, uint32 *StartTicks, uint32 *TickCount)
+{
+  real32 FrameSeconds = 1.0f / 60.0f;
+  uint32 PlayerCount = BenchRollbackPlayerCount;
+  uint32 MaxTicks = 4*BenchRollbackFrameCount;
+  for (uint32 Player = 0; Player < PlayerCount; ++Player)
+  {
+    InitializeRollbackSession(Sessions + Player, PlayerCount, Player, FrameSeconds,
+                              SnapshotMemory + Player*RollbackSnapshotCount*SnapshotSize, SnapshotSize,
+                              Win32CommitMemory);
+    if (StartTicks[Player] + 4*BenchRollbackFrameCount > MaxTicks)
+    {
+      MaxTicks = StartTicks[Player] + 4*BenchRollbackFrameCount;
+    }
+  }
+
+  // Chaque tour, chaque joueur reoit, corrige, simule une image s'il le peut et envoie
+  uint32 Tick = 0;
+  bool32 IsSettled = false;
+  for (; !IsSettled && (Tick < MaxTicks); ++Tick)
+  {
+    real64 Now = (real64)Tick*FrameSeconds;
+    IsSettled = true;
+    for (uint32 Player = 0; Player < PlayerCount; ++Player)
+    {
+      rollback_session *Session = Sessions + Player;
+      game_memory *Memory = Games + Player;
+      if (Tick < StartTicks[Player])
+      {
+        // Pas encore lance : les paquets des autres l'attendent
+        IsSettled = false;
+        continue;
+      }
+      uint8 Packet[RollbackMaxPacketSize];
+      uint32 Size;
+      while ((Size = ReceiveLoopbackPacket(Loopback, Player, Now, Packet, sizeof(Packet))) != 0)
+      {
+        ReceiveRollbackPacket(Session, Packet, Size);
+      }
+      ResimulateRollbackFrames(Session, Memory, GameSimulateFrame);
+
+      game_input Input;
+      if ((Session->CurrentFrame < BenchRollbackFrameCount) &&
+          BeginRollbackFrame(Session, Memory, Win32BenchRollbackInput(Player, Session->CurrentFrame), &Input))
+      {
+        GameSimulateFrame(Memory, &Input);
+        EndRollbackFrame(Session);
+      }
+
+      for (uint32 ToPlayer = 0; ToPlayer < PlayerCount; ++ToPlayer)
+      {
+        if (ToPlayer == Player) continue;
+        Size = BuildRollbackPacket(Session, ToPlayer, Packet);
+        SendLoopbackPacket(Loopback, Player, ToPlayer, Packet, Size, Now);
+        if (Session->Players[ToPlayer].ConfirmedFrame < BenchRollbackFrameCount) IsSettled = false;
+      }
+      if (Session->CurrentFrame < BenchRollbackFrameCount) IsSettled = false;
+    }
+  }
+  *TickCount = Tick;
+  return(IsSettled);
+}
+
+/**
+ * Rollback : BenchRollbackPlayerCount parties relies par net_loopback
+ * (latence, gigue et pertes). A la fin toutes doivent avoir l'tat d'une
+ * partie de rfrence simule directement avec les vraies entres. Puis les
+ * cots d'une sauvegarde, d'une restauration, d'une image resimule et d'une
+ * image normale (rendu 1280x720 compris), et la profondeur de rollback qui
+ * tient dans le budget d'une image  60 Hz. Enfin une partie sans latence
+ * o les joueurs dmarrent  des tours diffrents : celui qui dmarre tt
+ * prend de l'avance et les autres doivent quand mme avancer.
+ **/
+internal void
+Win32BenchRollback(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n== Rollback ==\n");
+  real32 FrameSeconds = 1.0f / 60.0f;
+  uint32 PlayerCount = BenchRollbackPlayerCount;
+  game_memory Games[BenchRollbackPlayerCount + 1];
+  rollback_session *Sessions = (rollback_session *)VirtualAlloc(0, PlayerCount*sizeof(rollback_session),
+                                                                 MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  net_loopback *Loopback = (net_loopback *)VirtualAlloc(0, sizeof(net_loopback),
+                                                        MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  uint64 SnapshotSize = Megabytes(64);
+  uint8 *SnapshotMemory = (uint8 *)VirtualAlloc(0, (SIZE_T)(PlayerCount*RollbackSnapshotCount*SnapshotSize),
+                                                MEM_RESERVE, PAGE_READWRITE);
+  bool32 IsStarted = (Sessions && Loopback && SnapshotMemory);
+  for (uint32 GameIndex = 0; GameIndex <= PlayerCount; ++GameIndex)
+  {
+    if (!Win32BenchStartGame(Games + GameIndex)) IsStarted = false;
+  }
+
+  if (IsStarted)
+  {
+    Loopback->LatencySeconds = 0.08f;
+    Loopback->JitterSeconds = 0.04f;
+    Loopback->LossRatio = 0.1f;
+    Loopback->Random = 1;
+    uint32 StartTicks[BenchRollbackPlayerCount] = {};
+    uint32 Tick;
+    win32_bench_timer Timer = Win32BenchBegin();
+    bool32 IsSettled = Win32BenchRunRollbackMatch(Sessions, Games, Loopback, SnapshotMemory, SnapshotSize,
+                                                  StartTicks, &Tick);
+    win32_bench_timing RunTiming = Win32BenchEnd(Timer);
+
+    // La partie de rfrence reoit directement les vraies entres
+    game_memory *Reference = Games + PlayerCount;
+    for (uint32 Frame = 0; Frame < BenchRollbackFrameCount; ++Frame)
+    {
+      game_input Input = {};
+      Input.dtForFrame = FrameSeconds;
+      for (uint32 Player = 0; Player < PlayerCount; ++Player)
+      {
+        net_input Previous = {};
+        if (Frame > 0) Previous = Win32BenchRollbackInput(Player, Frame - 1);
+        DecodeNetInput(Win32BenchRollbackInput(Player, Frame), Previous, GetController(&Input, Player));
+      }
+      GameSimulateFrame(Reference, &Input);
+    }
+
+    Win32BenchPrint(Report, "%u joueurs, %u images, latence %.0f ms + gigue %.0f ms, %.0f%% de pertes : "
+                    "%u tours, %.1f ms en tout, %u paquets envoyes, %u perdus\n",
+                    PlayerCount, BenchRollbackFrameCount, 1000.0f*Loopback->LatencySeconds,
+                    1000.0f*Loopback->JitterSeconds, 100.0f*Loopback->LossRatio, Tick,
+                    1000.0f*RunTiming.Seconds, Loopback->SentCount, Loopback->LostCount);
+    for (uint32 Player = 0; Player < PlayerCount; ++Player)
+    {
+      rollback_session *Session = Sessions + Player;
+      bool32 IsSame = Win32BenchSameGameState(Games + Player, Reference);
+      Win32BenchPrint(Report, "joueur %u : %4u rollbacks, %5u images resimulees (au plus %u d'un coup), "
+                      "%3u attentes, etat identique a la reference : %s\n",
+                      Player, Session->RollbackCount, Session->ResimulatedFrameCount, Session->MaxRollbackDepth,
+                      Session->StallCount, (IsSettled && IsSame) ? "OK" : "ECHEC");
+    }
+
+    // Cots sur la partie du joueur 0, une fois ses sauvegardes engages
+    rollback_session *Session = Sessions;
+    game_memory *Memory = Games;
+    int Iterations = 100;
+    Timer = Win32BenchBegin();
+    for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+    {
+      SaveRollbackSnapshot(Session, Session->CurrentFrame, Memory);
+    }
+    real32 SaveSeconds = Win32BenchEnd(Timer).Seconds / (real32)Iterations;
+    Timer = Win32BenchBegin();
+    for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+    {
+      RestoreRollbackSnapshot(Session, Session->CurrentFrame, Memory);
+    }
+    real32 RestoreSeconds = Win32BenchEnd(Timer).Seconds / (real32)Iterations;
+
+    int FrameIterations = 60;
+    game_input Input = {};
+    Input.dtForFrame = FrameSeconds;
+    Timer = Win32BenchBegin();
+    for (int Iteration = 0; Iteration < FrameIterations; ++Iteration)
+    {
+      GameSimulateFrame(Memory, &Input);
+    }
+    real32 SimulateSeconds = Win32BenchEnd(Timer).Seconds / (real32)FrameIterations;
+
+    int Width = 1280;
+    int Height = 720;
+    game_offscreen_buffer Buffer = {};
+    Buffer.Memory = VirtualAlloc(0, (SIZE_T)(Width*Height*GetBytesPerPixel(PixelFormat_XRGB8888)),
+                                 MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    real32 RenderSeconds = 0.0f;
+    if (Buffer.Memory)
+    {
+      Buffer.Width = Width;
+      Buffer.Height = Height;
+      Buffer.PixelFormat = PixelFormat_XRGB8888;
+      Buffer.BytesPerPixel = GetBytesPerPixel(PixelFormat_XRGB8888);
+      Buffer.Pitch = Width*Buffer.BytesPerPixel;
+      Timer = Win32BenchBegin();
+      for (int Iteration = 0; Iteration < FrameIterations; ++Iteration)
+      {
+        GameUpdateAndRender(Memory, &Input, &Buffer);
+      }
+      RenderSeconds = Win32BenchEnd(Timer).Seconds / (real32)FrameIterations;
+      VirtualFree(Buffer.Memory, 0, MEM_RELEASE);
+    }
+
+    // Une image normale sauvegarde puis met  jour et dessine ; un rollback de
+    // N images restaure une fois puis sauvegarde et simule N fois
+    real32 NormalSeconds = RenderSeconds + SaveSeconds;
+    real32 LeftSeconds = FrameSeconds - NormalSeconds - RestoreSeconds;
+    real32 ResimulateSeconds = SimulateSeconds + SaveSeconds;
+    uint32 MaxDepth = (LeftSeconds > 0.0f) ? (uint32)(LeftSeconds / ResimulateSeconds) : 0;
+    Win32BenchPrint(Report, "etat simule %llu Ko : sauvegarde %6.3f ms, restauration %6.3f ms\n",
+                    Memory->SimulatedStateSize / 1024, 1000.0f*SaveSeconds, 1000.0f*RestoreSeconds);
+    Win32BenchPrint(Report, "image simulee %6.3f ms, image normale (rendu %dx%d compris) %6.3f ms\n",
+                    1000.0f*SimulateSeconds, Width, Height, 1000.0f*NormalSeconds);
+    Win32BenchPrint(Report, "budget %.2f ms : rollback de %u images au plus (%.3f ms par image resimulee), "
+                    "RollbackMaxFrames = %u : %s\n",
+                    1000.0f*FrameSeconds, MaxDepth, 1000.0f*ResimulateSeconds, RollbackMaxFrames,
+                    (MaxDepth >= RollbackMaxFrames) ? "OK" : "trop profond pour cette machine");
+
+    // Dpart dcal sans latence : le joueur 0 a RollbackMaxFrames images
+    // d'avance sur les entres des autres ds leur dmarrage
+    bool32 IsRestarted = true;
+    for (uint32 Player = 0; Player < PlayerCount; ++Player)
+    {
+      VirtualFree(Games[Player].PermanentStorage, 0, MEM_RELEASE);
+      if (!Win32BenchStartGame(Games + Player)) IsRestarted = false;
+      StartTicks[Player] = 20*Player;
+    }
+    if (IsRestarted)
+    {
+      memset(Loopback, 0, sizeof(*Loopback));
+      Loopback->Random = 1;
+      IsSettled = Win32BenchRunRollbackMatch(Sessions, Games, Loopback, SnapshotMemory, SnapshotSize,
+                                             StartTicks, &Tick);
+      bool32 IsSame = true;
+      uint32 StallCount = 0;
+      for (uint32 Player = 0; Player < PlayerCount; ++Player)
+      {
+        if (!Win32BenchSameGameState(Games + Player, Reference)) IsSame = false;
+        StallCount += Sessions[Player].StallCount;
+      }
+      Win32BenchPrint(Report, "depart decale (joueur N au tour %u*N), sans latence : %u tours, %u attentes, "
+                      "etats identiques a la reference : %s\n",
+                      StartTicks[1], Tick, StallCount, (IsSettled && IsSame) ? "OK" : "ECHEC");
+    }
+  }
+
+  for (uint32 GameIndex = 0; GameIndex <= PlayerCount; ++GameIndex)
+  {
+    if (Games[GameIndex].PermanentStorage) VirtualFree(Games[GameIndex].PermanentStorage, 0, MEM_RELEASE);
+  }
+  if (SnapshotMemory) VirtualFree(SnapshotMemory, 0, MEM_RELEASE);
+  if (Loopback) VirtualFree(Loopback, 0, MEM_RELEASE);
+  if (Sessions) VirtualFree(Sessions, 0, MEM_RELEASE);
+}
+
+/*
+  Enregistrement des entres
+*/
+#define BenchReplayFrameCount (60*60)
+
+// Mme effet que Win32CommitMemory,  une autre adresse : celle d'une autre excution
+internal PLATFORM_COMMIT_MEMORY(Win32BenchCommitMemory)
+{
+  bool32 Result = Win32CommitMemory(Memory, Size);
+  return(Result);
+}
+
+internal void
+Win32BenchReplay(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n== Enregistrement des entrees ==\n");
+  char *Filename = "bench_replay.fmr";
+  real32 FrameSeconds = 1.0f / 60.0f;
+  uint32 ThreadCount;
+  platform_work_queue *Queue = Win32BenchGetWorkQueue(&ThreadCount);
+  platform_api Platform = Win32GetPlatformAPI();
+  game_memory Game = {};
+  win32_replay Replay = {};
+  int Width = 320;
+  int Height = 180;
+  void *BufferMemory = VirtualAlloc(0, (SIZE_T)(Width*Height*GetBytesPerPixel(PixelFormat_XRGB8888)),
+                                    MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  replay_frame *Recorded = (replay_frame *)VirtualAlloc(0, BenchReplayFrameCount*sizeof(replay_frame),
+                                                        MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (BufferMemory && Recorded && Win32BenchStartGame(&Game))
+  {
+    game_offscreen_buffer Buffer = Win32BenchMakeBuffer(BufferMemory, Width, Height, PixelFormat_XRGB8888);
+    game_memory *Memory = &Game;
+    Memory->IsStateHashRequested = true;
+
+    // Une minute de jeu : trois joueurs, dure d'image mesure comme dans WinMain ( 2% prs)
+    real64 RecordSecondsSum = 0.0;
+    real32 RecordSecondsMax = 0.0f;
+    bool32 IsRecording = Win32BeginReplay(&Replay, ReplayMode_Record, Filename, Memory);
+    uint32 Random = 1;
+    for (uint32 Frame = 0; IsRecording && (Frame < BenchReplayFrameCount); ++Frame)
+    {
+      game_input Input = {};
+      Random = Random*1664525 + 1013904223;
+      Input.dtForFrame = FrameSeconds*(0.98f + 0.04f*(real32)(Random >> 8) / (real32)(1 << 24));
+      for (uint32 Player = 0; Player < BenchRollbackPlayerCount; ++Player)
+      {
+        net_input Previous = {};
+        if (Frame > 0) Previous = Win32BenchRollbackInput(Player, Frame - 1);
+        DecodeNetInput(Win32BenchRollbackInput(Player, Frame), Previous, GetController(&Input, Player));
+      }
+      GameUpdateAndRender(Memory, &Input, &Buffer);
+      memset(Recorded + Frame, 0, sizeof(replay_frame));
+      Recorded[Frame].Input = Input;
+      Recorded[Frame].StateHash = Memory->StateHash;
+
+      win32_bench_timer Timer = Win32BenchBegin();
+      Win32EndReplayFrame(&Replay, &Input, Memory);
+      real32 Seconds = Win32BenchEnd(Timer).Seconds;
+      RecordSecondsSum += Seconds;
+      if (Seconds > RecordSecondsMax) RecordSecondsMax = Seconds;
+    }
+    Win32EndReplay(&Replay);
+
+    uint64 RawSize = sizeof(replay_file_header) + (uint64)BenchReplayFrameCount*sizeof(replay_frame);
+    real64 HourRatio = 3600.0 / Replay.Seconds;
+    Win32BenchPrint(Report, "%u images (%.1f s) : %llu Ko, %.1f Mo par heure (brut : %.1f Mo par heure, %u octets "
+                    "par image), %u images cles %llu Ko\n",
+                    Replay.FrameIndex, Replay.Seconds, Replay.FileSize / 1024,
+                    HourRatio*(real64)Replay.FileSize / (1024.0*1024.0), HourRatio*(real64)RawSize / (1024.0*1024.0),
+                    (uint32)sizeof(replay_frame), Replay.KeyframeCount, Replay.KeyframeBytes / 1024);
+    Win32BenchPrint(Report, "enregistrement : %.3f ms par image en moyenne, %.3f ms au plus (image cle de %llu Ko)\n",
+                    1000.0*RecordSecondsSum / (real64)BenchReplayFrameCount, 1000.0f*RecordSecondsMax,
+                    Memory->SimulatedStateSize / 1024);
+
+    // Relecture du dbut  la fin : chaque image identique  celle enregistre
+    uint32 SameCount = 0;
+    if (Win32BeginReplay(&Replay, ReplayMode_Replay, Filename, Memory))
+    {
+      win32_bench_timer Timer = Win32BenchBegin();
+      game_input Input;
+      for (uint32 Frame = 0; (Frame < BenchReplayFrameCount) && Win32ReplayInput(&Replay, &Input); ++Frame)
+      {
+        if (memcmp(&Replay.Frame, Recorded + Frame, sizeof(replay_frame)) == 0) ++SameCount;
+      }
+      real32 DecodeSeconds = Win32BenchEnd(Timer).Seconds;
+      bool32 IsAtEnd = !Win32ReplayInput(&Replay, &Input);
+      Win32BenchPrint(Report, "relecture : %u images sur %u identiques, fin du fichier %s, %.3f ms : %s\n",
+                      SameCount, BenchReplayFrameCount, IsAtEnd ? "vue" : "manquee", 1000.0f*DecodeSeconds,
+                      ((SameCount == BenchReplayFrameCount) && IsAtEnd) ? "OK" : "ECHEC");
+
+      // Sauts en avant et en arrire dans la mme partie (ses pointeurs sont ceux de l'enregistrement) :
+      // l'tat obtenu a l'empreinte enregistre  cette image. La partie engage sa mmoire
+      // comme une autre excution : l'arne du monde doit le faire encore aprs chaque saut
+      game_state *GameState = (game_state *)Memory->PermanentStorage;
+      GameState->WorldArena.CommitMemory = Win32BenchCommitMemory;
+      real64 Targets[] = {45.0, 10.0, 59.0, 30.5, 0.5, 20.0};
+      real32 SeekSecondsSum = 0.0f;
+      real32 SeekSecondsMax = 0.0f;
+      uint32 SeekSameCount = 0;
+      uint32 SeekArenaCount = 0;
+      for (int TargetIndex = 0; TargetIndex < ArrayCount(Targets); ++TargetIndex)
+      {
+        Timer = Win32BenchBegin();
+        bool32 IsSought = Win32SeekReplay(&Replay, Memory, GameSimulateFrame, Targets[TargetIndex]);
+        real32 Seconds = Win32BenchEnd(Timer).Seconds;
+        SeekSecondsSum += Seconds;
+        if (Seconds > SeekSecondsMax) SeekSecondsMax = Seconds;
+        uint32 Frame = Replay.FrameIndex;
+        if (IsSought && (Frame > 0) && (Frame <= BenchReplayFrameCount))
+        {
+          game_state_hash *Expected = &Recorded[Frame - 1].StateHash;
+          game_state_hash Hash;
+          HashGameState(&Hash, Memory->PermanentStorage, Expected->FirstByte, Expected->Size,
+                        &Platform, Queue, StateHashMaxJobCount);
+          if (Hash.Total == Expected->Total) ++SeekSameCount;
+        }
+        if ((GameState->WorldArena.CommitMemory == Win32BenchCommitMemory) &&
+            (GameState->WorldArena.CommittedSize >= GameState->WorldArena.Used))
+        {
+          ++SeekArenaCount;
+        }
+      }
+      Win32BenchPrint(Report, "sauts : %.2f ms en moyenne, %.2f ms au plus (image cle toutes les %u images), "
+                      "%u etats sur %u identiques a l'enregistrement, %u arenes de cette execution : %s\n",
+                      1000.0f*SeekSecondsSum / (real32)ArrayCount(Targets), 1000.0f*SeekSecondsMax,
+                      ReplayBlockFrameCount, SeekSameCount, (uint32)ArrayCount(Targets), SeekArenaCount,
+                      ((SeekSameCount == ArrayCount(Targets)) && (SeekArenaCount == ArrayCount(Targets))) ?
+                      "OK" : "ECHEC");
+      Win32EndReplay(&Replay);
+    }
+    DeleteFileA(Filename);
+  }
+  if (Game.PermanentStorage) VirtualFree(Game.PermanentStorage, 0, MEM_RELEASE);
+  if (Recorded) VirtualFree(Recorded, 0, MEM_RELEASE);
+  if (BufferMemory) VirtualFree(BufferMemory, 0, MEM_RELEASE);
+}
+
+/*
+  Capture
+*/
+#define BenchCaptureFrameCount 90
+#define BenchCaptureCheckedFrameCount 3
+
+// Dcodeur QOI de rfrence, pour relire les images captures
+internal bool32
+Win32BenchDecodeQOI(uint8 *Data, uint32 Size, uint32 *Pixels, int Width, int Height)
+{
+  bool32 Result = false;
+  if ((Size >= QOIHeaderSize + QOIEndMarkerSize) && (memcmp(Data, "qoif", 4) == 0) &&
+      (((uint32)Data[4] << 24 | (uint32)Data[5] << 16 | (uint32)Data[6] << 8 | Data[7]) == (uint32)Width) &&
+      (((uint32)Data[8] << 24 | (uint32)Data[9] << 16 | (uint32)Data[10] << 8 | Data[11]) == (uint32)Height))
+  {
+    uint8 *At = Data + QOIHeaderSize;
+    uint8 *End = Data + Size - QOIEndMarkerSize;
+    uint8 Index[64][3] = {};
+    int32 R = 0, G = 0, B = 0;
+    uint32 Run = 0;
+    size_t PixelCount = (size_t)Width*Height;
+    size_t PixelIndex = 0;
+    for (; (PixelIndex < PixelCount) && ((At < End) || Run); ++PixelIndex)
+    {
+      if (Run)
+      {
+        --Run;
+      }
+      else
+      {
+        uint8 Op = *At++;
+        if (Op == QOIOpRGB)
+        {
+          R = At[0];
+          G = At[1];
+          B = At[2];
+          At += 3;
+        }
+        else if ((Op & 0xC0) == QOIOpIndex)
+        {
+          R = Index[Op][0];
+          G = Index[Op][1];
+          B = Index[Op][2];
+        }
+        else if ((Op & 0xC0) == QOIOpDiff)
+        {
+          R = (R + ((Op >> 4) & 3) - 2) & 0xFF;
+          G = (G + ((Op >> 2) & 3) - 2) & 0xFF;
+          B = (B + (Op & 3) - 2) & 0xFF;
+        }
+        else if ((Op & 0xC0) == QOIOpLuma)
+        {
+          int32 dG = (Op & 0x3F) - 32;
+          int32 dRG = (*At >> 4) - 8;
+          int32 dBG = (*At & 0x0F) - 8;
+          ++At;
+          R = (R + dG + dRG) & 0xFF;
+          G = (G + dG) & 0xFF;
+          B = (B + dG + dBG) & 0xFF;
+        }
+        else
+        {
+          Run = Op & 0x3F;
+        }
+        uint32 Hash = (uint32)(R*3 + G*5 + B*7 + 255*11) & 63;
+        Index[Hash][0] = (uint8)R;
+        Index[Hash][1] = (uint8)G;
+        Index[Hash][2] = (uint8)B;
+      }
+      Pixels[PixelIndex] = ((uint32)R << 16) | ((uint32)G << 8) | (uint32)B;
+    }
+    Result = (PixelIndex == PixelCount) && (At == End) && !Run;
+  }
+  return(Result);
+}
+
+internal bool32
+Win32BenchSameCapturedPixels(uint32 *A, uint32 *B, size_t PixelCount)
+{
+  bool32 Result = true;
+  for (size_t PixelIndex = 0; Result && (PixelIndex < PixelCount); ++PixelIndex)
+  {
+    Result = ((A[PixelIndex] ^ B[PixelIndex]) & 0x00FFFFFF) == 0;
+  }
+  return(Result);
+}
+
+internal void
+Win32BenchCapture(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n== Capture ==\n");
+  int Width = 1920;
+  int Height = 1080;
+  size_t PixelCount = (size_t)Width*Height;
+  real32 FrameSeconds = 1.0f / 30.0f;
+  uint32 ThreadCount;
+  platform_work_queue *Queue = Win32BenchGetWorkQueue(&ThreadCount);
+  platform_api Platform = Win32GetPlatformAPI();
+
+  win32_offscreen_buffer Buffer = {};
+  Win32ResizeDIBSection(&Buffer, Width, Height, PixelFormat_XRGB8888);
+  uint32 *Pixels = (uint32 *)VirtualAlloc(0, (1 + BenchCaptureCheckedFrameCount)*PixelCount*sizeof(uint32),
+                                          MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  uint8 *Encoded = (uint8 *)VirtualAlloc(0, (SIZE_T)GetQOIMaxSize(Width, Height), MEM_RESERVE|MEM_COMMIT,
+                                         PAGE_READWRITE);
+  game_memory Game = {};
+  if (Buffer.Memory && Pixels && Encoded && Win32BenchStartGame(&Game))
+  {
+    game_offscreen_buffer GameBuffer = Win32BenchMakeBuffer(Buffer.Memory, Width, Height, PixelFormat_XRGB8888);
+    game_input Input = {};
+    Input.dtForFrame = FrameSeconds;
+    GameUpdateAndRender(&Game, &Input, &GameBuffer);
+
+    // Copie seule, sur le thread appelant puis dcoupe sur la file
+    int Iterations = 20;
+    real32 CopySeconds[2];
+    uint32 JobCounts[2] = {1, ThreadCount + 1};
+    for (int Pass = 0; Pass < 2; ++Pass)
+    {
+      win32_bench_timer Timer = Win32BenchBegin();
+      for (int Iteration = 0; Iteration < Iterations; ++Iteration)
+      {
+        CopyCaptureFrame(Pixels, Buffer.Memory, Width, Height, Buffer.Pitch, &Platform, Queue, JobCounts[Pass]);
+      }
+      CopySeconds[Pass] = Win32BenchEnd(Timer).Seconds / (real32)Iterations;
+    }
+    Win32BenchPrint(Report, "copie %dx%d : %6.3f ms sur 1 thread, %6.3f ms en %u bandes\n",
+                    Width, Height, 1000.0f*CopySeconds[0], 1000.0f*CopySeconds[1], JobCounts[1]);
+
+    // Compression d'une image du jeu, et d'un bruit qui ne se compresse pas (pire cas)
+    for (int Pass = 0; Pass < 2; ++Pass)
+    {
+      if (Pass == 1)
+      {
+        uint32 Random = 1;
+        for (size_t PixelIndex = 0; PixelIndex < PixelCount; ++PixelIndex)
+        {
+          Random = Random*1664525 + 1013904223;
+          Pixels[PixelIndex] = Random >> 8;
+        }
+      }
+      uint32 Size = 0;
+      win32_bench_timer Timer = Win32BenchBegin();
+      for (int Iteration = 0; Iteration < 4; ++Iteration)
+      {
+        Size = EncodeQOI(Pixels, Width, Height, Encoded);
+      }
+      win32_bench_timing Timing = Win32BenchEnd(Timer);
+      bool32 IsSame = Win32BenchDecodeQOI(Encoded, Size, Pixels + PixelCount, Width, Height) &&
+                      Win32BenchSameCapturedPixels(Pixels, Pixels + PixelCount, PixelCount);
+      Win32BenchPrint(Report, "QOI %-5s : %6.2f ms par image (%4.1f cy/px), %6llu Ko (%5.1f%% du brut), "
+                      "relecture : %s\n",
+                      Pass ? "bruit" : "jeu", 1000.0f*Timing.Seconds / 4.0f,
+                      (real32)Timing.Cycles / (4.0f*(real32)PixelCount), (uint64)Size / 1024,
+                      100.0f*(real32)Size / (real32)(PixelCount*sizeof(uint32)), IsSame ? "OK" : "ECHEC");
+    }
+
+    // Enregistrement au rythme du jeu : cot pour le thread de l'image, aucune image perdue
+    win32_capture *Capture = &GlobalCapture;
+    Capture->VideoFormat = CaptureFormat_QOI;
+    Capture->ToggleRequested = true;
+    uint32 CheckedFrames[BenchCaptureCheckedFrameCount] = {0, BenchCaptureFrameCount / 2,
+                                                           BenchCaptureFrameCount - 1};
+    uint32 CheckedIndex = 0;
+    win32_bench_timer RunTimer = Win32BenchBegin();
+    for (uint32 Frame = 0; Frame < BenchCaptureFrameCount; ++Frame)
+    {
+      LARGE_INTEGER FrameStart = Win32GetWallClock();
+      GameUpdateAndRender(&Game, &Input, &GameBuffer);
+      Win32CaptureFrame(Capture, &Buffer, &Platform, Queue, ThreadCount + 1);
+      if ((CheckedIndex < BenchCaptureCheckedFrameCount) && (CheckedFrames[CheckedIndex] == Frame))
+      {
+        memcpy(Pixels + (1 + CheckedIndex++)*PixelCount, Buffer.Memory, PixelCount*sizeof(uint32));
+      }
+      real32 LeftSeconds = FrameSeconds - Win32GetSecondsElapsed(FrameStart, Win32GetWallClock());
+      if (LeftSeconds > 0.0f) Sleep((DWORD)(1000.0f*LeftSeconds));
+    }
+    uint32 FileNumber = Capture->FileNumber;
+    Win32EndCaptureVideo(Capture);
+    real32 RunSeconds = Win32BenchEnd(RunTimer).Seconds;
+    real32 AverageMS = 1000.0f*(real32)(Capture->CaptureSecondsSum / (real64)BenchCaptureFrameCount);
+    real32 MaxMS = 1000.0f*Capture->CaptureSecondsMax;
+    Win32BenchPrint(Report, "video %u images en %.2f s : thread de l'image %.3f ms en moyenne, %.3f ms au plus "
+                    "(objectif 0.5 ms), %u attentes, %u erreurs : %s\n",
+                    BenchCaptureFrameCount, RunSeconds, AverageMS, MaxMS, Capture->StallCount,
+                    Capture->WriteErrorCount, ((MaxMS <= 0.5f) && !Capture->WriteErrorCount) ? "OK" : "TROP LENT");
+
+    // Relecture du fichier : toutes les images indexes, dans l'ordre, identiques  l'affichage
+    char Filename[CaptureMaxFilename];
+    _snprintf_s(Filename, sizeof(Filename), _TRUNCATE, "capture_%04u.fmc", FileNumber);
+    debug_read_file_result File = DEBUGPlatformReadEntireFile(Filename);
+    bool32 IsValid = false;
+    uint32 FrameCount = 0;
+    if (File.Contents && (File.ContentsSize >= sizeof(capture_file_header)))
+    {
+      uint8 *Contents = (uint8 *)File.Contents;
+      capture_file_header *Header = (capture_file_header *)Contents;
+      FrameCount = Header->FrameCount;
+      capture_index_entry *Index = (capture_index_entry *)(Contents + Header->IndexOffset);
+      IsValid = (Header->Magic == CaptureFileMagic) && (Header->Width == Width) && (Header->Height == Height) &&
+                (FrameCount == BenchCaptureFrameCount) &&
+                (Header->IndexOffset + FrameCount*sizeof(capture_index_entry) == File.ContentsSize);
+      for (uint32 Frame = 0; IsValid && (Frame < FrameCount); ++Frame)
+      {
+        IsValid = (Index[Frame].Offset + Index[Frame].Size <= Header->IndexOffset) &&
+                  ((Frame == 0) || (Index[Frame].Timestamp > Index[Frame - 1].Timestamp));
+      }
+      for (uint32 Checked = 0; IsValid && (Checked < BenchCaptureCheckedFrameCount); ++Checked)
+      {
+        capture_index_entry *Entry = Index + CheckedFrames[Checked];
+        IsValid = Win32BenchDecodeQOI(Contents + Entry->Offset, Entry->Size, Pixels, Width, Height) &&
+                  Win32BenchSameCapturedPixels(Pixels, Pixels + (1 + Checked)*PixelCount, PixelCount);
+      }
+      DEBUGPlatformFreeFileMemory(File.Contents);
+    }
+    DeleteFileA(Filename);
+    Win32BenchPrint(Report, "%s : %u images indexees sur %u, relecture : %s\n", Filename, FrameCount,
+                    BenchCaptureFrameCount, IsValid ? "OK" : "ECHEC");
+  }
+  if (Game.PermanentStorage) VirtualFree(Game.PermanentStorage, 0, MEM_RELEASE);
+  if (Encoded) VirtualFree(Encoded, 0, MEM_RELEASE);
+  if (Pixels) VirtualFree(Pixels, 0, MEM_RELEASE);
+  if (Buffer.Memory) VirtualFree(Buffer.Memory, 0, MEM_RELEASE);
+}
+
+/*
+  Scripts : beaucoup de travail dcoup en pas, sous le budget de l'ordonnanceur
+*/
+#define BenchScriptCount 200
+#define BenchScriptWaiterCount 50
+#define BenchScriptMaxUnits 20000
+#define BenchScriptHashesPerUnit 64
+#define BenchScriptMaxSteps 100000
+
+enum win32_bench_script_type
+{
+  BenchScript_Heavy,
+  BenchScript_Waiter,
+
+  BenchScript_Count,
+};
+
+struct win32_bench_script_results
+{
+  uint32 Sums[BenchScriptCount];
+  uint64 WakeDelays[BenchScriptWaiterCount];
+};
+
+struct win32_bench_heavy_frame
+{
+  uint32 ScriptIndex;
+  uint32 UnitCount;
+  uint32 Unit;
+  uint32 Sum;
+};
+
+struct win32_bench_waiter_frame
+{
+  uint32 WaiterIndex;
+  int32 StepCount;
+  uint64 StartStep;
+};
+
+// Attente d'un script de test : quelques-unes de 0 pas ou ngatives, qui durent 1 pas
+inline int32
+Win32BenchWaiterStepCount(uint32 WaiterIndex, uint32 Random)
+{
+  int32 Result = 1 + (int32)(Random & 0xFF);
+  if ((WaiterIndex % 10) == 3) Result = 0;
+  if ((WaiterIndex % 10) == 7) Result = -Result;
+  return(Result);
+}
+
+// Une unit de travail des scripts de test
+inline uint32
+Win32BenchScriptUnit(uint32 Sum, uint32 Unit)
+{
+  for (uint32 Hash = 0; Hash < BenchScriptHashesPerUnit; ++Hash)
+  {
+    Sum ^= Unit + Hash;
+    Sum *= 0x9E3779B1;
+    Sum ^= Sum >> 15;
+  }
+  return(Sum);
+}
+
+internal SCRIPT_FUNCTION(Win32BenchHeavyScript)
+{
+  win32_bench_script_results *Results = (win32_bench_script_results *)Context->Game;
+  win32_bench_heavy_frame *Frame = (win32_bench_heavy_frame *)Context->Frame;
+  SCRIPT_BEGIN(Context);
+  for (Frame->Unit = 0; Frame->Unit < Frame->UnitCount; ++Frame->Unit)
+  {
+    Frame->Sum = Win32BenchScriptUnit(Frame->Sum, Frame->Unit);
+    SCRIPT_WORK(Context, 1);
+    SCRIPT_CHECK_BUDGET(Context);
+  }
+  Results->Sums[Frame->ScriptIndex] = Frame->Sum;
+  SCRIPT_END(Context);
+}
+
+internal SCRIPT_FUNCTION(Win32BenchWaiterScript)
+{
+  win32_bench_script_results *Results = (win32_bench_script_results *)Context->Game;
+  win32_bench_waiter_frame *Frame = (win32_bench_waiter_frame *)Context->Frame;
+  SCRIPT_BEGIN(Context);
+  Frame->StartStep = Context->StepIndex;
+  SCRIPT_WAIT_STEPS(Context, Frame->StepCount);
+  Results->WakeDelays[Frame->WaiterIndex] = Context->StepIndex - Frame->StartStep;
+  SCRIPT_END(Context);
+}
+
+global_variable script_function *Win32BenchScriptFunctions[BenchScript_Count] =
+{
+  Win32BenchHeavyScript,
+  Win32BenchWaiterScript,
+};
+
+struct win32_bench_script_run
+{
+  uint32 StepCount;
+  int32 MaxWork;
+  uint64 MaxStepCycles;
+  uint64 TotalCycles;
+  real32 MaxStepSeconds;
+  uint32 TraceHash; // Travail et scripts repris  chaque pas
+};
+
+// Tous les scripts dmarrent au pas 0, on avance jusqu' ce qu'ils aient fini
+internal win32_bench_script_run
+Win32BenchRunScripts(memory_arena *Arena, int32 WorkBudget, win32_bench_script_results *Results)
+{
+  win32_bench_script_run Result = {};
+  Arena->Used = 0;
+  script_scheduler Scheduler;
+  InitializeScriptScheduler(&Scheduler, Arena, BenchScriptCount + BenchScriptWaiterCount, WorkBudget);
+  memset(Results, 0, sizeof(*Results));
+
+  uint32 Random = 1;
+  for (uint32 ScriptIndex = 0; ScriptIndex < BenchScriptCount; ++ScriptIndex)
+  {
+    Random = Random*1664525 + 1013904223;
+    win32_bench_heavy_frame *Frame = (win32_bench_heavy_frame *)
+      StartScript(&Scheduler, BenchScript_Heavy, sizeof(win32_bench_heavy_frame), 0);
+    Frame->ScriptIndex = ScriptIndex;
+    Frame->UnitCount = 1 + (Random >> 8) % BenchScriptMaxUnits;
+    // Les attentes sont intercales avec le travail
+    if (ScriptIndex % (BenchScriptCount / BenchScriptWaiterCount) == 0)
+    {
+      uint32 WaiterIndex = ScriptIndex / (BenchScriptCount / BenchScriptWaiterCount);
+      win32_bench_waiter_frame *Waiter = (win32_bench_waiter_frame *)
+        StartScript(&Scheduler, BenchScript_Waiter, sizeof(win32_bench_waiter_frame), 0);
+      Waiter->WaiterIndex = WaiterIndex;
+      Waiter->StepCount = Win32BenchWaiterStepCount(WaiterIndex, Random);
+    }
+  }
+
+  Result.TraceHash = 2166136261u;
+  for (uint64 StepIndex = 0; Scheduler.RunningCount && (StepIndex < BenchScriptMaxSteps); ++StepIndex)
+  {
+    win32_bench_timer Timer = Win32BenchBegin();
+    RunScripts(&Scheduler, Win32BenchScriptFunctions, BenchScript_Count, Results, StepIndex);
+    win32_bench_timing Timing = Win32BenchEnd(Timer);
+    Result.TotalCycles += Timing.Cycles;
+    if (Timing.Cycles > Result.MaxStepCycles)
+    {
+      Result.MaxStepCycles = Timing.Cycles;
+      Result.MaxStepSeconds = Timing.Seconds;
+    }
+    if (Scheduler.LastWork > Result.MaxWork) Result.MaxWork = Scheduler.LastWork;
+    Result.TraceHash = (Result.TraceHash ^ (uint32)Scheduler.LastWork)*16777619u;
+    Result.TraceHash = (Result.TraceHash ^ Scheduler.LastResumeCount)*16777619u;
+    ++Result.StepCount;
+  }
+  return(Result);
+}
+
+/**
+ * Scripts : rsultats identiques au mme travail fait d'un coup, budget
+ * respect  chaque pas, rveils  l'heure (une attente de 0 pas ou
+ * ngative dure 1 pas), deux excutions identiques pas  pas. Puis les buts des agents du jeu, donns par un script.
+ **/
+internal void
+Win32BenchScripts(win32_bench_report *Report)
+{
+  Win32BenchPrint(Report, "\n== Scripts ==\n");
+  memory_arena Arena;
+  uint64 ArenaSize = Megabytes(1);
+  void *ArenaMemory = VirtualAlloc(0, (SIZE_T)ArenaSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  win32_bench_script_results *Results = (win32_bench_script_results *)
+    VirtualAlloc(0, 2*sizeof(win32_bench_script_results), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (ArenaMemory && Results)
+  {
+    InitializeArena(&Arena, ArenaSize, ArenaMemory);
+
+    // Le mme travail, d'un seul tenant
+    uint32 Expected[BenchScriptCount];
+    uint32 Random = 1;
+    uint64 TotalUnits = 0;
+    win32_bench_timer Timer = Win32BenchBegin();
+    for (uint32 ScriptIndex = 0; ScriptIndex < BenchScriptCount; ++ScriptIndex)
+    {
+      Random = Random*1664525 + 1013904223;
+      uint32 UnitCount = 1 + (Random >> 8) % BenchScriptMaxUnits;
+      uint32 Sum = 0;
+      for (uint32 Unit = 0; Unit < UnitCount; ++Unit)
+      {
+        Sum = Win32BenchScriptUnit(Sum, Unit);
+      }
+      Expected[ScriptIndex] = Sum;
+      TotalUnits += UnitCount;
+    }
+    win32_bench_timing DirectTiming = Win32BenchEnd(Timer);
+    real64 SecondsPerUnit = (real64)DirectTiming.Seconds / (real64)TotalUnits;
+
+    int32 WorkBudgets[] = {1024, GameScriptWorkBudget, 16384};
+    for (int BudgetIndex = 0; BudgetIndex < ArrayCount(WorkBudgets); ++BudgetIndex)
+    {
+      int32 WorkBudget = WorkBudgets[BudgetIndex];
+      win32_bench_script_run Run = Win32BenchRunScripts(&Arena, WorkBudget, Results);
+      win32_bench_script_run Again = Win32BenchRunScripts(&Arena, WorkBudget, Results + 1);
+
+      uint32 WrongSums = 0;
+      for (uint32 ScriptIndex = 0; ScriptIndex < BenchScriptCount; ++ScriptIndex)
+      {
+        if (Results[0].Sums[ScriptIndex] != Expected[ScriptIndex]) ++WrongSums;
+      }
+      // Un rveil peut tre report par le budget, jamais avanc
+      uint32 EarlyWakes = 0;
+      uint32 LateWakes = 0;
+      uint64 MaxDelay = 0;
+      Random = 1;
+      for (uint32 ScriptIndex = 0; ScriptIndex < BenchScriptCount; ++ScriptIndex)
+      {
+        Random = Random*1664525 + 1013904223;
+        if (ScriptIndex % (BenchScriptCount / BenchScriptWaiterCount) == 0)
+        {
+          uint32 WaiterIndex = ScriptIndex / (BenchScriptCount / BenchScriptWaiterCount);
+          int32 WaitCount = Win32BenchWaiterStepCount(WaiterIndex, Random);
+          uint64 StepCount = (WaitCount > 0) ? (uint64)WaitCount : 1;
+          uint64 Delay = Results[0].WakeDelays[WaiterIndex];
+          if (Delay < StepCount) ++EarlyWakes;
+          if (Delay > StepCount)
+          {
+            ++LateWakes;
+            if (Delay - StepCount > MaxDelay) MaxDelay = Delay - StepCount;
+          }
+        }
+      }
+      bool32 SameRuns = ((Run.StepCount == Again.StepCount) && (Run.TraceHash == Again.TraceHash) &&
+                         (memcmp(Results, Results + 1, sizeof(*Results)) == 0));
+      bool32 IsOk = (!WrongSums && !EarlyWakes && (Run.MaxWork <= WorkBudget) && SameRuns &&
+                     (Run.StepCount < BenchScriptMaxSteps));
+      real64 ScriptSeconds = (real64)Run.TotalCycles*(real64)DirectTiming.Seconds / (real64)DirectTiming.Cycles;
+      Win32BenchPrint(Report, "budget %5d (%.3f ms) : %4u pas, %.3f ms par pas, %.3f ms au plus, travail au plus %d, "
+                      "%u resultats faux, reveils %u en avance %u en retard (%llu pas au plus), "
+                      "deux executions %s : %s\n",
+                      WorkBudget, 1000.0*SecondsPerUnit*WorkBudget, Run.StepCount,
+                      1000.0*ScriptSeconds / (real64)Run.StepCount, 1000.0f*Run.MaxStepSeconds,
+                      Run.MaxWork, WrongSums, EarlyWakes, LateWakes, MaxDelay,
+                      SameRuns ? "identiques" : "DIFFERENTES", IsOk ? "OK" : "ECHEC");
+      Win32BenchPrint(Report, "               %llu unites (%.1f ns/unite) : %.2f ms d'un coup, %.2f ms en scripts\n",
+                      TotalUnits, 1e9*SecondsPerUnit, 1000.0f*DirectTiming.Seconds, 1000.0*ScriptSeconds);
+    }
+  }
+
+  // Les buts des agents : un coin qui change toutes les 4 secondes
+  game_memory Game = {};
+  if (Win32BenchStartGame(&Game))
+  {
+    game_state *GameState = (game_state *)Game.PermanentStorage;
+    game_input Input = {};
+    Input.dtForFrame = SimulationStepSeconds;
+    uint32 WrongGoals = 0;
+    uint32 FrameCount = 10*SimulationHz;
+    for (uint32 Frame = 0; Frame < FrameCount; ++Frame)
+    {
+      // Le pas qui vient d'tre simul a choisi son but au dbut
+      GameSimulateFrame(&Game, &Input);
+      uint32 Corner = (uint32)(((GameState->SimulationStepIndex - 1) / (4*SimulationHz)) % 4);
+      if ((GameState->AgentGoalX != ((Corner & 1) ? 13 : -14)) ||
+          (GameState->AgentGoalY != ((Corner & 2) ? 6 : -7)))
+      {
+        ++WrongGoals;
+      }
+    }
+    Win32BenchPrint(Report, "jeu : %u scripts, buts des agents sur %u pas : %s (%u faux)\n",
+                    GameState->Scripts.RunningCount, FrameCount, WrongGoals ? "ECHEC" : "OK", WrongGoals);
+    VirtualFree(Game.PermanentStorage, 0, MEM_RELEASE);
+  }
+  if (Results) VirtualFree(Results, 0, MEM_RELEASE);
+  if (ArenaMemory) VirtualFree(ArenaMemory, 0, MEM_RELEASE);
+}
+
+/*
+  Suite de rgression : les noyaux principaux mesurs  plusieurs tailles et
+  compars  une rfrence JSON, misc/bench_baseline.json par dfaut. Le
+  dpt n'en contient pas encore : elle doit tre crite avec -benchsave sur
+  la machine de rfrence, par l'excutable de build.bat, puis enregistre.
+  Des mesures d'une autre compilation ou d'un autre processeur ne peuvent
+  pas servir de seuil. Le processeur est reconnu  son nom CPUID complet.
+  Sans rfrence, la suite ne fait que mesurer et ne peut pas chouer.
+
+  Chaque noyau est mesur en cycles par unit (pixel, frame de son, image...)
+  avec __rdtsc, en gardant la meilleure de plusieurs rptitions : c'est la
+  valeur la plus stable d'un lancement  l'autre. Un noyau plus lent que sa
+  rfrence de plus du seuil (-benchthreshold=P, en %) est une rgression et
+  le programme se termine avec le code 1. La rfrence n'est applique que sur
+  le processeur o elle a t mesure ; ailleurs la comparaison est indicative.
+
+  -benchregression : seulement cette suite
+  -benchbaseline=fichier : autre fichier de rfrence
+  -benchsave : rcrit la rfrence avec les mesures de ce lancement
+*/
+#define BenchRegressionMaxKernelCount 64
+#define BenchRegressionRepeatCount 7
+#define BenchRegressionRetryCount 3
+#define BenchRegressionDefaultThreshold 10.0f
+#define BenchRegressionDefaultBaseline "../misc/bench_baseline.json"
+
+#define WIN32_BENCH_KERNEL(name) void name(void *Data)
+typedef WIN32_BENCH_KERNEL(win32_bench_kernel);
+
+struct win32_bench_kernel_result
+{
+  char Name[48];
+  char *Unit;
+  real64 CyclesPerUnit;
+  real64 NanosecondsPerUnit;
+  real64 BaselineCyclesPerUnit; // 0 : absent de la rfrence
+};
+
+struct win32_bench_baseline_entry
+{
+  char Name[48];
+  real64 CyclesPerUnit;
+};
+
+struct win32_bench_regression
+{
+  real32 Threshold;
+  char Cpu[64];
+  char BaselineCpu[64];
+  bool32 HasBaseline;
+  uint32 BaselineCount;
+  win32_bench_baseline_entry Baseline[BenchRegressionMaxKernelCount];
+  uint32 KernelCount;
+  win32_bench_kernel_result Kernels[BenchRegressionMaxKernelCount];
+};
+
+// Nom du processeur, tel que le donne CPUID
+internal void
+Win32BenchGetCpuName(char *Dest, uint32 DestSize)
+{
+  int Info[12];
+  __cpuid(Info, 0x80000002);
+  __cpuid(Info + 4, 0x80000003);
+  __cpuid(Info + 8, 0x80000004);
+  char *Name = (char *)Info;
+  while ((Name < (char *)Info + 47) && (*Name == ' ')) ++Name;
+  uint32 Length = 0;
+  while ((Name < (char *)(Info + 12)) && *Name && (Length + 1 < DestSize))
+  {
+    // Pas de guillemets ni d'chappements dans le JSON
+    Dest[Length++] = ((*Name == '"') || (*Name == '\\')) ? ' ' : *Name;
+    ++Name;
+  }
+  while (Length && (Dest[Length - 1] == ' ')) --Length;
+  Dest[Length] = 0;
+}
+
+/*
+  Rfrence JSON
+*/
+
+// Position juste aprs "Key": dans [At, End), 0 si la cl n'y est pas
+internal char *
+Win32BenchFindJsonKey(char *At, char *End, char *Key)
+{
+  char *Result = 0;
+  size_t KeyLength = strlen(Key);
+  for (; !Result && (At + KeyLength + 2 <= End); ++At)
+  {
+    if ((At[0] == '"') && !strncmp(At + 1, Key, KeyLength) && (At[KeyLength + 1] == '"'))
+    {
+      char *Value = At + KeyLength + 2;
+      while ((Value < End) && ((*Value == ' ') || (*Value == ':'))) ++Value;
+      Result = Value;
+    }
+  }
+  return(Result);
+}
+
+// Chane JSON sans chappements, renvoie la position aprs le guillemet fermant
+internal char *
+Win32BenchReadJsonString(char *At, char *End, char *Dest, uint32 DestSize)
+{
+  uint32 Length = 0;
+  if ((At < End) && (*At == '"'))
+  {
+    ++At;
+    while ((At < End) && (*At != '"'))
+    {
+      if (Length + 1 < DestSize) Dest[Length++] = *At;
+      ++At;
+    }
+    if (At < End) ++At;
+  }
+  Dest[Length] = 0;
+  return(At);
+}
+
+internal real64
+Win32BenchReadJsonNumber(char *At, char *End)
+{
+  char Number[32];
+  uint32 Length = 0;
+  while ((At < End) && (Length + 1 < sizeof(Number)) && strchr("+-.0123456789eE", *At) && *At)
+  {
+    Number[Length++] = *At++;
+  }
+  Number[Length] = 0;
+  real64 Result = atof(Number);
+  return(Result);
+}
+
+/**
+ * Lecture de la rfrence : le processeur, puis pour chaque noyau son nom et
+ * ses cycles par unit
+ **/
+internal void
+Win32BenchReadBaseline(win32_bench_regression *Regression, char *Filename)
+{
+  debug_read_file_result File = DEBUGPlatformReadEntireFile(Filename);
+  if (File.Contents)
+  {
+    char *At = (char *)File.Contents;
+    char *End = At + File.ContentsSize;
+    char *Cpu = Win32BenchFindJsonKey(At, End, "cpu");
+    if (Cpu)
+    {
+      Win32BenchReadJsonString(Cpu, End, Regression->BaselineCpu, sizeof(Regression->BaselineCpu));
+      Regression->HasBaseline = true;
+    }
+    char *Name;
+    while ((Name = Win32BenchFindJsonKey(At, End, "name")) != 0)
+    {
+      char KernelName[sizeof(Regression->Baseline[0].Name)];
+      At = Win32BenchReadJsonString(Name, End, KernelName, sizeof(KernelName));
+      char *Cycles = Win32BenchFindJsonKey(At, End, "cycles");
+      if (Cycles && (Regression->BaselineCount < BenchRegressionMaxKernelCount))
+      {
+        win32_bench_baseline_entry *Entry = Regression->Baseline + Regression->BaselineCount++;
+        memcpy(Entry->Name, KernelName, sizeof(Entry->Name));
+        Entry->CyclesPerUnit = Win32BenchReadJsonNumber(Cycles, End);
+      }
+    }
+    DEBUGPlatformFreeFileMemory(File.Contents);
+  }
+}
+
+/**
+ * Meilleure de BenchRegressionRepeatCount rptitions de CallCount appels,
+ * chacun traitant UnitCount units, aprs un appel pour chauffer les caches.
+ * Une mesure au-del du seuil est reprise jusqu' BenchRegressionRetryCount fois :
+ * sur une machine partage, une autre tche peut ralentir toutes les rptitions.
+ **/
+internal void
+Win32BenchMeasureKernel(win32_bench_regression *Regression, char *Name, char *Unit,
+                        uint32 UnitCount, uint32 CallCount, win32_bench_kernel *Kernel, void *Data)
+{
+  if (Regression->KernelCount < BenchRegressionMaxKernelCount)
+  {
+    win32_bench_kernel_result *Result = Regression->Kernels + Regression->KernelCount++;
+    _snprintf_s(Result->Name, sizeof(Result->Name), _TRUNCATE, "%s", Name);
+    Result->Unit = Unit;
+    Result->BaselineCyclesPerUnit = 0.0;
+    for (uint32 EntryIndex = 0; EntryIndex < Regression->BaselineCount; ++EntryIndex)
+    {
+      win32_bench_baseline_entry *Entry = Regression->Baseline + EntryIndex;
+      if (!strcmp(Entry->Name, Result->Name)) Result->BaselineCyclesPerUnit = Entry->CyclesPerUnit;
+    }
+    real64 Units = (real64)UnitCount*(real64)CallCount;
+    real64 MaxCyclesPerUnit = Result->BaselineCyclesPerUnit*(1.0 + Regression->Threshold / 100.0);
+
+    Kernel(Data);
+    real64 BestCycles = 0.0;
+    real64 BestSeconds = 0.0;
+    uint32 RepeatCount = BenchRegressionRepeatCount;
+    for (uint32 Repeat = 0; Repeat < RepeatCount; ++Repeat)
+    {
+      win32_bench_timer Timer = Win32BenchBegin();
+      for (uint32 Call = 0; Call < CallCount; ++Call)
+      {
+        Kernel(Data);
+      }
+      win32_bench_timing Timing = Win32BenchEnd(Timer);
+      if (!Repeat || ((real64)Timing.Cycles < BestCycles))
+      {
+        BestCycles = (real64)Timing.Cycles;
+        BestSeconds = Timing.Seconds;
+      }
+      if ((Repeat + 1 == RepeatCount) && (MaxCyclesPerUnit > 0.0) && (BestCycles / Units > MaxCyclesPerUnit) &&
+          (RepeatCount < BenchRegressionRepeatCount*(1 + BenchRegressionRetryCount)))
+      {
+        RepeatCount += BenchRegressionRepeatCount;
+      }
+    }
+    Result->CyclesPerUnit = BestCycles / Units;
+    Result->NanosecondsPerUnit = 1e9*BestSeconds / Units;
+  }
+}
+
+/*
+  Les noyaux mesurs
+*/
+struct win32_bench_gradient
+{
+  draw_kernels *Kernels;
+  game_offscreen_buffer *Buffer;
+  int Offset;
+};
+
+internal WIN32_BENCH_KERNEL(Win32BenchGradientKernel)
+{
+  win32_bench_gradient *Gradient = (win32_bench_gradient *)Data;
+  Gradient->Kernels->RenderGradient(Gradient->Buffer, Gradient->Offset, 2*Gradient->Offset);
+  ++Gradient->Offset;
+}
+
+internal WIN32_BENCH_KERNEL(Win32BenchOutputSoundKernel)
+{
+  GameOutputSound((game_sound_output_buffer *)Data, 256, 0);
+}
+
+struct win32_bench_game_frame
+{
+  game_memory *Memory;
+  game_input *Input;
+  game_offscreen_buffer *Buffer;
+};
+
+internal WIN32_BENCH_KERNEL(Win32BenchUpdateAndRenderKernel)
+{
+  win32_bench_game_frame *Frame = (win32_bench_game_frame *)Data;
+  GameUpdateAndRender(Frame->Memory, Frame->Input, Frame->Buffer);
+}
+
+struct win32_bench_sound_conversion
+{
+  int16 *Dest;
+  real32 *Source;
+  uint32 SampleCount;
+  sound_dither Dither;
+};
+
+internal WIN32_BENCH_KERNEL(Win32BenchConvertSamplesKernel)
+{
+  win32_bench_sound_conversion *Conversion = (win32_bench_sound_conversion *)Data;
+  ConvertSamplesToInt16(Conversion->Dest, Conversion->Source, Conversion->SampleCount,
+                        &Conversion->Dither, 1.0f);
+}
+
+// Comme Win32FillSoundBuffer, sans DirectSound : l'criture avance dans l'anneau et le coupe parfois
+struct win32_bench_sound_ring
+{
+  uint8 *Ring;
+  uint32 RingSize;
+  uint32 Offset;
+  int16 *Samples;
+  uint32 FrameCount;
+};
+
+internal WIN32_BENCH_KERNEL(Win32BenchSoundRingKernel)
+{
+  win32_bench_sound_ring *SoundRing = (win32_bench_sound_ring *)Data;
+  uint32 BytesPerFrame = 2*sizeof(int16);
+  uint32 Size = SoundRing->FrameCount*BytesPerFrame;
+  sound_ring_regions Regions = GetSoundRingRegions(SoundRing->Ring, SoundRing->RingSize, SoundRing->Offset, Size);
+  CopyToSoundRing(&Regions, SoundRing->Samples, BytesPerFrame);
+  SoundRing->Offset = (SoundRing->Offset + Size) % SoundRing->RingSize;
+}
+
+struct win32_bench_gamepads
+{
+  XINPUT_GAMEPAD *Pads;
+  uint32 PadCount;
+  game_controller_input Controllers[2];
+};
+
+internal WIN32_BENCH_KERNEL(Win32BenchGamepadKernel)
+{
+  win32_bench_gamepads *Gamepads = (win32_bench_gamepads *)Data;
+  for (uint32 PadIndex = 0; PadIndex < Gamepads->PadCount; ++PadIndex)
+  {
+    game_controller_input *OldController = Gamepads->Controllers + (PadIndex & 1);
+    game_controller_input *NewController = Gamepads->Controllers + ((PadIndex + 1) & 1);
+    Win32ProcessXInputGamepad(Gamepads->Pads + PadIndex, OldController, NewController);
+  }
+}
+
+internal bool32
+Win32BenchWriteBaseline(win32_bench_regression *Regression, char *Filename)
+{
+  bool32 Result = false;
+  uint32 Size = (uint32)Kilobytes(16);
+  char *Text = (char *)VirtualAlloc(0, Size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (Text)
+  {
+    int Used = _snprintf_s(Text, Size, _TRUNCATE, "{\n  \"cpu\": \"%s\",\n  \"kernels\": [\n", Regression->Cpu);
+    for (uint32 KernelIndex = 0; (Used >= 0) && (KernelIndex < Regression->KernelCount); ++KernelIndex)
+    {
+      win32_bench_kernel_result *Kernel = Regression->Kernels + KernelIndex;
+      int Length = _snprintf_s(Text + Used, Size - Used, _TRUNCATE,
+                               "    {\"name\": \"%s\", \"unit\": \"%s\", \"cycles\": %.4f}%s\n",
+                               Kernel->Name, Kernel->Unit, Kernel->CyclesPerUnit,
+                               (KernelIndex + 1 < Regression->KernelCount) ? "," : "");
+      Used = (Length >= 0) ? Used + Length : -1;
+    }
+    if (Used >= 0)
+    {
+      int Length = _snprintf_s(Text + Used, Size - Used, _TRUNCATE, "  ]\n}\n");
+      if (Length >= 0)
+      {
+        Result = DEBUGPlatformWriteEntireFile(Filename, (uint32)(Used + Length), Text);
+      }
+    }
+    VirtualFree(Text, 0, MEM_RELEASE);
+  }
+  return(Result);
+}
+
+internal void
+Win32BenchGetBaselineFilename(LPSTR CommandLine, char *Filename, uint32 FilenameSize)
+{
+  char *Option = strstr(CommandLine, "-benchbaseline=");
+  if (Option)
+  {
+    char *At = Option + 15;
+    uint32 Length = 0;
+    while (*At && (*At != ' ') && (Length + 1 < FilenameSize))
+    {
+      Filename[Length++] = *At++;
+    }
+    Filename[Length] = 0;
+  }
+  else
+  {
+    _snprintf_s(Filename, FilenameSize, _TRUNCATE, "%s", BenchRegressionDefaultBaseline);
+  }
+}
+
+/**
+ * Mesure des noyaux, comparaison  la rfrence. Renvoie le nombre de rgressions.
+ **/
+internal uint32
+Win32BenchRegression(win32_bench_report *Report, LPSTR CommandLine)
+{
+  uint32 Result = 0;
+  char *ThresholdOption = strstr(CommandLine, "-benchthreshold=");
+  real32 Threshold = ThresholdOption ? (real32)atof(ThresholdOption + 16) : BenchRegressionDefaultThreshold;
+  char BaselineFilename[MAX_PATH];
+  Win32BenchGetBaselineFilename(CommandLine, BaselineFilename, sizeof(BaselineFilename));
+
+  win32_bench_regression *Regression = (win32_bench_regression *)
+    VirtualAlloc(0, sizeof(win32_bench_regression), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  int MaxWidth = 1920;
+  int MaxHeight = 1080;
+  void *PixelMemory = VirtualAlloc(0, (SIZE_T)MaxWidth*MaxHeight*GetBytesPerPixel(PixelFormat_RGBA32F),
+                                   MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  uint32 MaxFrameCount = 4800;
+  int16 *Samples = (int16 *)VirtualAlloc(0, MaxFrameCount*2*sizeof(int16), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  real32 *Mix = (real32 *)VirtualAlloc(0, MaxFrameCount*2*sizeof(real32), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  uint32 RingSize = 48000*2*sizeof(int16);
+  uint8 *Ring = (uint8 *)VirtualAlloc(0, RingSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  uint32 MaxPadCount = 4096;
+  XINPUT_GAMEPAD *Pads = (XINPUT_GAMEPAD *)VirtualAlloc(0, MaxPadCount*sizeof(XINPUT_GAMEPAD),
+                                                        MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  game_memory Game = {};
+  if (Regression && PixelMemory && Samples && Mix && Ring && Pads && Win32BenchStartGame(&Game))
+  {
+    Regression->Threshold = Threshold;
+    Win32BenchGetCpuName(Regression->Cpu, sizeof(Regression->Cpu));
+    Win32BenchReadBaseline(Regression, BaselineFilename);
+    char Name[48];
+
+    // Dgrad : toutes les tailles en XRGB8888, tous les formats en 1080p
+    int Sizes[][2] = {{320, 180}, {1280, 720}, {1920, 1080}};
+    for (int FormatIndex = 0; FormatIndex < PixelFormat_Count; ++FormatIndex)
+    {
+      for (int SizeIndex = 0; SizeIndex < ArrayCount(Sizes); ++SizeIndex)
+      {
+        if ((FormatIndex != PixelFormat_XRGB8888) && (SizeIndex + 1 < ArrayCount(Sizes))) continue;
+        int Width = Sizes[SizeIndex][0];
+        int Height = Sizes[SizeIndex][1];
+        game_offscreen_buffer Buffer = Win32BenchMakeBuffer(PixelMemory, Width, Height,
+                                                            (game_pixel_format)FormatIndex);
+        win32_bench_gradient Gradient = {GetDrawKernels(&Buffer), &Buffer, 0};
+        _snprintf_s(Name, sizeof(Name), _TRUNCATE, "gradient/%s/%dx%d",
+                    DebugPixelFormatNames[FormatIndex], Width, Height);
+        uint32 CallCount = (uint32)(4*1920*1080 / (Width*Height));
+        Win32BenchMeasureKernel(Regression, Name, "px", (uint32)(Width*Height), CallCount,
+                                Win32BenchGradientKernel, &Gradient);
+      }
+    }
+
+    // Le jeu complet, une image  chaque appel
+    for (int SizeIndex = 0; SizeIndex < ArrayCount(Sizes); ++SizeIndex)
+    {
+      int Width = Sizes[SizeIndex][0];
+      int Height = Sizes[SizeIndex][1];
+      game_offscreen_buffer Buffer = Win32BenchMakeBuffer(PixelMemory, Width, Height, PixelFormat_XRGB8888);
+      game_input Input = {};
+      Input.dtForFrame = 1.0f / 60.0f;
+      win32_bench_game_frame Frame = {&Game, &Input, &Buffer};
+      _snprintf_s(Name, sizeof(Name), _TRUNCATE, "update_and_render/%dx%d", Width, Height);
+      Win32BenchMeasureKernel(Regression, Name, "image", 1, 10, Win32BenchUpdateAndRenderKernel, &Frame);
+    }
+
+    // Son : un petit bloc, une image  30 Hz, le buffer circulaire de WinMain
+    uint32 FrameCounts[] = {256, 1600, MaxFrameCount};
+    uint32 Random = 1;
+    for (uint32 Index = 0; Index < 2*MaxFrameCount; ++Index)
+    {
+      Random = Random*1664525 + 1013904223;
+      Mix[Index] = ((real32)(Random >> 8) / (real32)(1 << 24) - 0.5f)*2.0f;
+      Samples[Index] = (int16)(Random >> 16);
+    }
+    for (int CountIndex = 0; CountIndex < ArrayCount(FrameCounts); ++CountIndex)
+    {
+      uint32 FrameCount = FrameCounts[CountIndex];
+      uint32 CallCount = 4*MaxFrameCount / FrameCount;
+      game_sound_output_buffer SoundBuffer = {};
+      SoundBuffer.SamplesPerSecond = 48000;
+      SoundBuffer.SampleCount = (int)FrameCount;
+      SoundBuffer.Samples = Samples;
+      _snprintf_s(Name, sizeof(Name), _TRUNCATE, "output_sound/%u", FrameCount);
+      Win32BenchMeasureKernel(Regression, Name, "frame", FrameCount, CallCount,
+                              Win32BenchOutputSoundKernel, &SoundBuffer);
+    }
+    for (int CountIndex = 0; CountIndex < ArrayCount(FrameCounts); ++CountIndex)
+    {
+      uint32 FrameCount = FrameCounts[CountIndex];
+      uint32 CallCount = 16*MaxFrameCount / FrameCount;
+      win32_bench_sound_conversion Conversion = {};
+      Conversion.Dest = Samples;
+      Conversion.Source = Mix;
+      Conversion.SampleCount = 2*FrameCount;
+      InitializeSoundDither(&Conversion.Dither, 1);
+      _snprintf_s(Name, sizeof(Name), _TRUNCATE, "convert_samples/%u", FrameCount);
+      Win32BenchMeasureKernel(Regression, Name, "frame", FrameCount, CallCount,
+                              Win32BenchConvertSamplesKernel, &Conversion);
+
+      // La copie est bien plus rapide : plus d'appels pour que la mesure dpasse le bruit du compteur
+      win32_bench_sound_ring SoundRing = {Ring, RingSize, 0, Samples, FrameCount};
+      _snprintf_s(Name, sizeof(Name), _TRUNCATE, "sound_ring/%u", FrameCount);
+      Win32BenchMeasureKernel(Regression, Name, "frame", FrameCount, 16*CallCount,
+                              Win32BenchSoundRingKernel, &SoundRing);
+    }
+
+    // Manettes : sticks et boutons au hasard, autour de la zone morte
+    for (uint32 PadIndex = 0; PadIndex < MaxPadCount; ++PadIndex)
+    {
+      Random = Random*1664525 + 1013904223;
+      Pads[PadIndex].wButtons = (WORD)(Random >> 16);
+      Pads[PadIndex].sThumbLX = (SHORT)(Random >> 8);
+      Random = Random*1664525 + 1013904223;
+      Pads[PadIndex].sThumbLY = (SHORT)((int32)((Random >> 16) % (4*XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE)) -
+                                        2*XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE);
+    }
+    uint32 PadCounts[] = {4, 256, MaxPadCount};
+    for (int CountIndex = 0; CountIndex < ArrayCount(PadCounts); ++CountIndex)
+    {
+      win32_bench_gamepads Gamepads = {};
+      Gamepads.Pads = Pads;
+      Gamepads.PadCount = PadCounts[CountIndex];
+      _snprintf_s(Name, sizeof(Name), _TRUNCATE, "xinput_gamepad/%u", PadCounts[CountIndex]);
+      Win32BenchMeasureKernel(Regression, Name, "manette", PadCounts[CountIndex], 4*MaxPadCount / PadCounts[CountIndex],
+                              Win32BenchGamepadKernel, &Gamepads);
+    }
+
+    // Comparaison
+    bool32 SameCpu = (Regression->HasBaseline && !strcmp(Regression->Cpu, Regression->BaselineCpu));
+    Win32BenchPrint(Report, "\n== Regression (%s, seuil %.1f%%) ==\n", BaselineFilename, Threshold);
+    Win32BenchPrint(Report, "processeur : %s\n", Regression->Cpu);
+    if (!Regression->HasBaseline)
+    {
+      Win32BenchPrint(Report, "pas de reference, -benchsave pour l'ecrire : mesures seules, "
+                      "aucune regression detectable\n");
+    }
+    else if (!SameCpu)
+    {
+      Win32BenchPrint(Report, "reference mesuree sur %s : comparaison indicative\n", Regression->BaselineCpu);
+    }
+    uint32 RegressionCount = 0;
+    for (uint32 KernelIndex = 0; KernelIndex < Regression->KernelCount; ++KernelIndex)
+    {
+      win32_bench_kernel_result *Kernel = Regression->Kernels + KernelIndex;
+      if (Kernel->BaselineCyclesPerUnit > 0.0)
+      {
+        real64 Change = 100.0*(Kernel->CyclesPerUnit / Kernel->BaselineCyclesPerUnit - 1.0);
+        char *Status = "OK";
+        if (Change > Threshold)
+        {
+          Status = "REGRESSION";
+          ++RegressionCount;
+        }
+        else if (Change < -Threshold)
+        {
+          Status = "plus rapide";
+        }
+        Win32BenchPrint(Report, "%-30s : %10.3f cy/%-7s %10.2f ns/%-7s ref %10.3f (%+6.1f%%) %s\n",
+                        Kernel->Name, Kernel->CyclesPerUnit, Kernel->Unit,
+                        Kernel->NanosecondsPerUnit, Kernel->Unit,
+                        Kernel->BaselineCyclesPerUnit, Change, Status);
+      }
+      else
+      {
+        Win32BenchPrint(Report, "%-30s : %10.3f cy/%-7s %10.2f ns/%-7s pas de reference\n",
+                        Kernel->Name, Kernel->CyclesPerUnit, Kernel->Unit,
+                        Kernel->NanosecondsPerUnit, Kernel->Unit);
+      }
+    }
+    Win32BenchPrint(Report, "%u regressions sur %u noyaux%s\n", RegressionCount, Regression->KernelCount,
+                    (RegressionCount && !SameCpu) ? ", ignorees (autre processeur)" : "");
+    if (SameCpu) Result = RegressionCount;
+
+    if (strstr(CommandLine, "-benchsave"))
+    {
+      bool32 Written = Win32BenchWriteBaseline(Regression, BaselineFilename);
+      Win32BenchPrint(Report, "reference %s : %s\n", Written ? "ecrite" : "ECHEC a l'ecriture", BaselineFilename);
+    }
+  }
+  if (Game.PermanentStorage) VirtualFree(Game.PermanentStorage, 0, MEM_RELEASE);
+  if (Pads) VirtualFree(Pads, 0, MEM_RELEASE);
+  if (Ring) VirtualFree(Ring, 0, MEM_RELEASE);
+  if (Mix) VirtualFree(Mix, 0, MEM_RELEASE);
+  if (Samples) VirtualFree(Samples, 0, MEM_RELEASE);
+  if (PixelMemory) VirtualFree(PixelMemory, 0, MEM_RELEASE);
+  if (Regression) VirtualFree(Regression, 0, MEM_RELEASE);
+  return(Result);
+}
+
+/**
+ * Point d'entre du mode -bench, renvoie le code de sortie : 1 si un noyau a rgress
+ **/
+internal int
+Win32RunBenchmarks(LPSTR CommandLine)
+{
+  int Result = 0;
+  win32_bench_report Report = {};
+  Report.Size = (uint32)Kilobytes(64);
+  Report.Text = (char *)VirtualAlloc(0, Report.Size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (Report.Text)
+  {
+    // -benchregression : la suite de rgression seule, plus courte
+    if (!strstr(CommandLine, "-benchregression"))
+    {
+      Win32BenchPixelConversions(&Report);
+      Win32BenchDrawKernels(&Report);
+      Win32BenchText(&Report);
+      Win32BenchUpscaler(&Report);
+      Win32BenchResampler(&Report);
+      Win32BenchSoundOutput(&Report);
+      Win32BenchMusicStreaming(&Report);
+      Win32BenchFramePipeline(&Report);
+      Win32BenchTileMap(&Report);
+      Win32BenchNav(&Report);
+      Win32BenchEntities(&Report);
+      Win32BenchSpatialGrid(&Report);
+      Win32BenchParticles(&Report);
+      Win32BenchLighting(&Report);
+      Win32BenchLogger(&Report);
+      Win32BenchGameMemory(&Report);
+      Win32BenchStateHash(&Report);
+      Win32BenchRollback(&Report);
+      Win32BenchReplay(&Report);
+      Win32BenchCapture(&Report);
+      Win32BenchScripts(&Report);
+    }
+    if (Win32BenchRegression(&Report, CommandLine)) Result = 1;
+
+    DEBUGPlatformWriteEntireFile("bench.out", Report.Used, Report.Text);
+    VirtualFree(Report.Text, 0, MEM_RELEASE);
+  }
+  return(Result);
+}
@@ -0,0 +1,425 @@
+/*
+  Capture des images affiches sur disque, sans bloquer le thread de l'image
+
+  F8 crit l'image suivante dans capture_NNNN.qoi. F9 lance ou arrte
+  l'enregistrement d'une vido dans capture_NNNN.fmc (voir
+  faitmain_capture.h), -capture la lance ds le dmarrage et -capture=raw
+  garde les images brutes au lieu de les compresser.
+
+  Le thread qui affiche (celui du jeu, ou celui de prsentation avec
+  -pipeline) copie l'image dans un des CaptureSlotCount buffers libres et
+  le passe aux threads de compression. Ceux-ci compressent puis crivent
+  avec WriteFileEx : l'criture se fait pendant qu'ils compressent
+  l'image suivante, et sa fin rend le buffer, dans l'attente alertable du
+  thread qui l'a lance. Aucune image n'est perdue : s'il n'y a plus de
+  buffer libre, le thread de l'image attend (compt dans les statistiques).
+*/
+
+#define CaptureSlotCount 8
+#define CaptureEncoderThreadCount 2
+#define CaptureMaxFrames (60*60*60) // Une heure  60 images par seconde
+#define CaptureMaxFilename 32
+
+enum win32_capture_slot_kind
+{
+  CaptureSlot_VideoFrame,
+  CaptureSlot_Screenshot,
+};
+
+struct win32_capture;
+
+struct win32_capture_slot
+{
+  // En premier : la fin d'criture retrouve le slot depuis son OVERLAPPED
+  OVERLAPPED Overlapped;
+  win32_capture *Capture;
+  win32_capture_slot_kind Kind;
+  uint32 FrameIndex;
+  uint64 Timestamp;
+  HANDLE File; // Celui de la vido, ou le fichier de l'image seule
+  uint32 WriteSize;
+
+  uint32 *Pixels;  // Width*Height pixels XRGB8888
+  uint8 *Encoded;  // GetQOIMaxSize octets
+};
+
+struct win32_capture
+{
+  // Demandes du clavier, traites par le thread qui affiche
+  bool32 volatile ScreenshotRequested;
+  bool32 volatile ToggleRequested;
+  capture_format VideoFormat;
+
+  // Buffers allous pour une taille d'image, rallous quand elle change
+  int Width;
+  int Height;
+  void *Memory;
+  win32_capture_slot Slots[CaptureSlotCount];
+  HANDLE FreeSlotSemaphore;
+  HANDLE ReadySlotSemaphore;
+  // Indices des slots  compresser, dans l'ordre des images
+  uint32 ReadySlots[CaptureSlotCount];
+  uint32 ReadyWriteIndex;
+  uint32 volatile ReadyReadIndex;
+  bool32 volatile FreeSlots[CaptureSlotCount];
+  uint32 NextFileNumber;
+
+  // Vido en cours
+  bool32 IsRecording;
+  uint32 FileNumber;
+  HANDLE VideoFile;
+  capture_index_entry *Index; // CaptureMaxFrames entres
+  uint32 FrameCount;
+  int64 volatile WriteOffset;
+
+  // Statistiques de la vido en cours, temps pris au thread de l'image
+  real64 CaptureSecondsSum;
+  real32 CaptureSecondsMax;
+  uint32 StallCount;
+  int64 volatile EncodedBytes;
+  uint32 volatile WriteErrorCount;
+};
+
+global_variable win32_capture GlobalCapture;
+
+// Fin d'une criture, appele dans l'attente alertable du thread qui l'a lance
+internal VOID CALLBACK
+Win32CaptureWriteDone(DWORD ErrorCode, DWORD BytesWritten, LPOVERLAPPED Overlapped)
+{
+  win32_capture_slot *Slot = (win32_capture_slot *)Overlapped;
+  win32_capture *Capture = Slot->Capture;
+  if ((ErrorCode != 0) || (BytesWritten != Slot->WriteSize))
+  {
+    InterlockedIncrement((LONG volatile *)&Capture->WriteErrorCount);
+  }
+  if (Slot->Kind == CaptureSlot_Screenshot)
+  {
+    CloseHandle(Slot->File);
+  }
+  uint32 SlotIndex = (uint32)(Slot - Capture->Slots);
+  Capture->FreeSlots[SlotIndex] = true;
+  CompletePreviousWritesBeforeFutureWrites;
+  ReleaseSemaphore(Capture->FreeSlotSemaphore, 1, 0);
+}
+
+internal void
+Win32WriteCaptureSlot(win32_capture_slot *Slot, void *Data, uint32 Size, uint64 Offset)
+{
+  memset(&Slot->Overlapped, 0, sizeof(Slot->Overlapped));
+  Slot->Overlapped.Offset = (DWORD)(Offset & 0xFFFFFFFF);
+  Slot->Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+  Slot->WriteSize = Size;
+  if (!WriteFileEx(Slot->File, Data, Size, &Slot->Overlapped, Win32CaptureWriteDone))
+  {
+    // Pas d'criture lance, pas de fin d'criture : le slot est rendu tout de suite
+    Win32CaptureWriteDone(GetLastError(), 0, &Slot->Overlapped);
+  }
+}
+
+/**
+ * Thread de compression : prend les slots prts dans l'ordre, les
+ * compresse et lance leur criture. Les fins d'criture s'excutent
+ * pendant l'attente du slot suivant.
+ **/
+DWORD WINAPI
+Win32CaptureThreadProc(LPVOID lpParameter)
+{
+  win32_capture *Capture = (win32_capture *)lpParameter;
+  for (;;)
+  {
+    if (WaitForSingleObjectEx(Capture->ReadySlotSemaphore, INFINITE, TRUE) != WAIT_OBJECT_0) continue;
+
+    uint32 ReadIndex = (uint32)InterlockedIncrement((LONG volatile *)&Capture->ReadyReadIndex) - 1;
+    win32_capture_slot *Slot = Capture->Slots + Capture->ReadySlots[ReadIndex % CaptureSlotCount];
+    void *Data = Slot->Pixels;
+    uint32 Size = (uint32)(Capture->Width*Capture->Height*sizeof(uint32));
+    if ((Slot->Kind == CaptureSlot_Screenshot) || (Capture->VideoFormat == CaptureFormat_QOI))
+    {
+      Size = EncodeQOI(Slot->Pixels, Capture->Width, Capture->Height, Slot->Encoded);
+      Data = Slot->Encoded;
+    }
+
+    uint64 Offset = 0;
+    if (Slot->Kind == CaptureSlot_VideoFrame)
+    {
+      // Les images sont crites dans l'ordre o elles sont prtes, l'index les remet dans l'ordre
+      Offset = (uint64)InterlockedExchangeAdd64(&Capture->WriteOffset, (LONG64)Size);
+      capture_index_entry *Entry = Capture->Index + Slot->FrameIndex;
+      Entry->Offset = Offset;
+      Entry->Timestamp = Slot->Timestamp;
+      Entry->Size = Size;
+      InterlockedExchangeAdd64(&Capture->EncodedBytes, (LONG64)Size);
+    }
+    Win32WriteCaptureSlot(Slot, Data, Size, Offset);
+  }
+}
+
+// Attend que tous les buffers soient rendus : plus rien en compression ni en criture
+internal void
+Win32DrainCapture(win32_capture *Capture)
+{
+  if (Capture->Memory)
+  {
+    for (uint32 SlotIndex = 0; SlotIndex < CaptureSlotCount; ++SlotIndex)
+    {
+      WaitForSingleObjectEx(Capture->FreeSlotSemaphore, INFINITE, FALSE);
+    }
+    ReleaseSemaphore(Capture->FreeSlotSemaphore, CaptureSlotCount, 0);
+  }
+}
+
+// Buffers pour des images de Width x Height, les threads au premier appel
+internal bool32
+Win32AllocateCapture(win32_capture *Capture, int Width, int Height)
+{
+  Win32DrainCapture(Capture);
+  if (Capture->Memory)
+  {
+    VirtualFree(Capture->Memory, 0, MEM_RELEASE);
+    Capture->Memory = 0;
+  }
+
+  uint64 PixelsSize = (uint64)Width*Height*sizeof(uint32);
+  uint64 EncodedSize = (GetQOIMaxSize(Width, Height) + 63) & ~(uint64)63;
+  Capture->Memory = VirtualAlloc(0, (SIZE_T)(CaptureSlotCount*(PixelsSize + EncodedSize)),
+                                 MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (Capture->Memory)
+  {
+    Capture->Width = Width;
+    Capture->Height = Height;
+    uint8 *At = (uint8 *)Capture->Memory;
+    for (uint32 SlotIndex = 0; SlotIndex < CaptureSlotCount; ++SlotIndex)
+    {
+      win32_capture_slot *Slot = Capture->Slots + SlotIndex;
+      Slot->Capture = Capture;
+      Slot->Pixels = (uint32 *)At;
+      // Pages touches ici : la premire copie dans le slot ne paie pas les dfauts de page
+      memset(Slot->Pixels, 0, (size_t)PixelsSize);
+      At += PixelsSize;
+      Slot->Encoded = At;
+      At += EncodedSize;
+      Capture->FreeSlots[SlotIndex] = true;
+    }
+  }
+
+  if (!Capture->FreeSlotSemaphore)
+  {
+    Capture->FreeSlotSemaphore = CreateSemaphoreExA(0, CaptureSlotCount, CaptureSlotCount, 0, 0,
+                                                    SEMAPHORE_ALL_ACCESS);
+    Capture->ReadySlotSemaphore = CreateSemaphoreExA(0, 0, CaptureSlotCount, 0, 0, SEMAPHORE_ALL_ACCESS);
+    for (uint32 ThreadIndex = 0; ThreadIndex < CaptureEncoderThreadCount; ++ThreadIndex)
+    {
+      DWORD ThreadID;
+      HANDLE ThreadHandle = CreateThread(0, 0, Win32CaptureThreadProc, Capture, 0, &ThreadID);
+      CloseHandle(ThreadHandle);
+    }
+  }
+  return(Capture->Memory != 0);
+}
+
+internal HANDLE
+Win32CreateCaptureFile(char *Extension, uint32 FileNumber)
+{
+  char Filename[CaptureMaxFilename];
+  _snprintf_s(Filename, sizeof(Filename), _TRUNCATE, "capture_%04u.%s", FileNumber, Extension);
+  HANDLE Result = CreateFileA(Filename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_FLAG_OVERLAPPED, 0);
+  return(Result);
+}
+
+// Ecriture qui attend sa fin, pour l'en-tte et l'index d'un fichier ouvert en FILE_FLAG_OVERLAPPED
+internal bool32
+Win32WriteCaptureFileAt(HANDLE File, void *Data, uint32 Size, uint64 Offset)
+{
+  OVERLAPPED Overlapped = {};
+  Overlapped.Offset = (DWORD)(Offset & 0xFFFFFFFF);
+  Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+  DWORD BytesWritten = 0;
+  bool32 Result = (WriteFile(File, Data, Size, 0, &Overlapped) || (GetLastError() == ERROR_IO_PENDING)) &&
+                  GetOverlappedResult(File, &Overlapped, &BytesWritten, TRUE) && (BytesWritten == Size);
+  return(Result);
+}
+
+internal void
+Win32BeginCaptureVideo(win32_capture *Capture)
+{
+  if (!Capture->Index)
+  {
+    Capture->Index = (capture_index_entry *)VirtualAlloc(0, CaptureMaxFrames*sizeof(capture_index_entry),
+                                                         MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  }
+  Capture->FileNumber = Capture->NextFileNumber++;
+  Capture->VideoFile = Win32CreateCaptureFile("fmc", Capture->FileNumber);
+  if (Capture->Index && (Capture->VideoFile != INVALID_HANDLE_VALUE))
+  {
+    Capture->IsRecording = true;
+    Capture->FrameCount = 0;
+    Capture->WriteOffset = sizeof(capture_file_header);
+    Capture->CaptureSecondsSum = 0.0;
+    Capture->CaptureSecondsMax = 0.0f;
+    Capture->StallCount = 0;
+    Capture->EncodedBytes = 0;
+    Capture->WriteErrorCount = 0;
+    WIN32_LOG(LogFormat_CaptureStarted, Capture->FileNumber,
+              (Capture->VideoFormat == CaptureFormat_QOI) ? "QOI" : "brute", Capture->Width, Capture->Height);
+  }
+  else
+  {
+    if (Capture->VideoFile != INVALID_HANDLE_VALUE) CloseHandle(Capture->VideoFile);
+    WIN32_LOG(LogFormat_CaptureFileFailed, Capture->FileNumber, "fmc");
+  }
+}
+
+// Fin de la vido : toutes les images crites, puis l'index et l'en-tte dfinitif
+internal void
+Win32EndCaptureVideo(win32_capture *Capture)
+{
+  if (Capture->IsRecording)
+  {
+    Win32DrainCapture(Capture);
+    capture_file_header Header = {};
+    Header.Magic = CaptureFileMagic;
+    Header.Version = CaptureFileVersion;
+    Header.Format = Capture->VideoFormat;
+    Header.Width = Capture->Width;
+    Header.Height = Capture->Height;
+    Header.FrameCount = Capture->FrameCount;
+    Header.IndexOffset = (uint64)Capture->WriteOffset;
+    Header.TimestampFrequency = (uint64)GlobalPerfCountFrequency;
+    if (!Win32WriteCaptureFileAt(Capture->VideoFile, Capture->Index,
+                                 Capture->FrameCount*sizeof(capture_index_entry), Header.IndexOffset) ||
+        !Win32WriteCaptureFileAt(Capture->VideoFile, &Header, sizeof(Header), 0))
+    {
+      ++Capture->WriteErrorCount;
+    }
+    CloseHandle(Capture->VideoFile);
+    Capture->IsRecording = false;
+
+    uint64 RawBytes = (uint64)Capture->FrameCount*Capture->Width*Capture->Height*sizeof(uint32);
+    real32 Ratio = RawBytes ? 100.0f*(real32)Capture->EncodedBytes / (real32)RawBytes : 0.0f;
+    real32 AverageMS = Capture->FrameCount ?
+      (real32)(1000.0*Capture->CaptureSecondsSum / (real64)Capture->FrameCount) : 0.0f;
+    WIN32_LOG(LogFormat_CaptureFinished, Capture->FileNumber, Capture->FrameCount,
+              (uint64)Capture->EncodedBytes / 1024, Ratio, AverageMS, 1000.0f*Capture->CaptureSecondsMax,
+              Capture->StallCount);
+    if (Capture->WriteErrorCount)
+    {
+      WIN32_LOG(LogFormat_CaptureWriteErrors, Capture->WriteErrorCount);
+    }
+  }
+}
+
+/**
+ * Capture de l'image affiche (XRGB8888),  appeler par le thread qui
+ * affiche, une fois l'image complte. Queue dcoupe la copie, 0 si elle
+ * n'est pas libre pour ce thread.
+ **/
+internal void
+Win32CaptureFrame(win32_capture *Capture, win32_offscreen_buffer *Buffer,
+                  platform_api *Platform, platform_work_queue *Queue, uint32 JobCount)
+{
+  if (Capture->ToggleRequested)
+  {
+    Capture->ToggleRequested = false;
+    if (Capture->IsRecording)
+    {
+      Win32EndCaptureVideo(Capture);
+    }
+    else if (((Capture->Width == Buffer->Width) && (Capture->Height == Buffer->Height)) ||
+             Win32AllocateCapture(Capture, Buffer->Width, Buffer->Height))
+    {
+      Win32BeginCaptureVideo(Capture);
+    }
+  }
+
+  bool32 WantsScreenshot = Capture->ScreenshotRequested;
+  if (!Capture->IsRecording && !WantsScreenshot) return;
+  Assert(Buffer->PixelFormat == PixelFormat_XRGB8888);
+
+  LARGE_INTEGER StartCounter = Win32GetWallClock();
+  // Une vido garde la taille de sa premire image
+  if ((Capture->Width != Buffer->Width) || (Capture->Height != Buffer->Height))
+  {
+    if (Capture->IsRecording)
+    {
+      Win32EndCaptureVideo(Capture);
+      WIN32_LOG(LogFormat_CaptureResized, Buffer->Width, Buffer->Height);
+    }
+    if (!Win32AllocateCapture(Capture, Buffer->Width, Buffer->Height)) return;
+    if (!WantsScreenshot) return;
+  }
+
+  uint32 KindCount = 0;
+  win32_capture_slot_kind Kinds[2];
+  if (Capture->IsRecording && (Capture->FrameCount < CaptureMaxFrames)) Kinds[KindCount++] = CaptureSlot_VideoFrame;
+  if (WantsScreenshot) Kinds[KindCount++] = CaptureSlot_Screenshot;
+  Capture->ScreenshotRequested = false;
+
+  for (uint32 KindIndex = 0; KindIndex < KindCount; ++KindIndex)
+  {
+    // Pas de slot libre : on attend plutt que de perdre l'image
+    if (WaitForSingleObjectEx(Capture->FreeSlotSemaphore, 0, FALSE) != WAIT_OBJECT_0)
+    {
+      ++Capture->StallCount;
+      WaitForSingleObjectEx(Capture->FreeSlotSemaphore, INFINITE, FALSE);
+    }
+    uint32 SlotIndex = 0;
+    while (!Capture->FreeSlots[SlotIndex]) ++SlotIndex;
+    Assert(SlotIndex < CaptureSlotCount);
+    Capture->FreeSlots[SlotIndex] = false;
+    win32_capture_slot *Slot = Capture->Slots + SlotIndex;
+
+    Slot->Kind = Kinds[KindIndex];
+    Slot->Timestamp = (uint64)StartCounter.QuadPart;
+    if (Slot->Kind == CaptureSlot_VideoFrame)
+    {
+      Slot->File = Capture->VideoFile;
+      Slot->FrameIndex = Capture->FrameCount++;
+    }
+    else
+    {
+      uint32 FileNumber = Capture->NextFileNumber++;
+      Slot->File = Win32CreateCaptureFile("qoi", FileNumber);
+      if (Slot->File == INVALID_HANDLE_VALUE)
+      {
+        WIN32_LOG(LogFormat_CaptureFileFailed, FileNumber, "qoi");
+        Capture->FreeSlots[SlotIndex] = true;
+        ReleaseSemaphore(Capture->FreeSlotSemaphore, 1, 0);
+        continue;
+      }
+      WIN32_LOG(LogFormat_CaptureScreenshot, FileNumber);
+    }
+    CopyCaptureFrame(Slot->Pixels, Buffer->Memory, Buffer->Width, Buffer->Height, Buffer->Pitch,
+                     Platform, Queue, JobCount);
+
+    Capture->ReadySlots[Capture->ReadyWriteIndex++ % CaptureSlotCount] = SlotIndex;
+    CompletePreviousWritesBeforeFutureWrites;
+    ReleaseSemaphore(Capture->ReadySlotSemaphore, 1, 0);
+  }
+
+  if (Capture->IsRecording)
+  {
+    real32 Seconds = Win32GetSecondsElapsed(StartCounter, Win32GetWallClock());
+    Capture->CaptureSecondsSum += Seconds;
+    if (Seconds > Capture->CaptureSecondsMax) Capture->CaptureSecondsMax = Seconds;
+  }
+}
+
+// -capture enregistre une vido ds la premire image, -capture=raw sans compression
+internal void
+Win32GetRequestedCapture(win32_capture *Capture, LPSTR CommandLine)
+{
+  char *Option = strstr(CommandLine, "-capture");
+  if (Option)
+  {
+    Capture->VideoFormat = strncmp(Option, "-capture=raw", 12) ? CaptureFormat_QOI : CaptureFormat_Raw;
+    Capture->ToggleRequested = true;
+  }
+}
+
+// A la fermeture : la vido en cours est termine, les images seules finissent d'tre crites
+internal void
+Win32EndCapture(win32_capture *Capture)
+{
+  Win32EndCaptureVideo(Capture);
+  Win32DrainCapture(Capture);
+}
\ No newline at end of file
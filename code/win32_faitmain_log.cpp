@@ -0,0 +1,338 @@
+/*
+  Journal de la couche plateforme
+
+  Remplace les OutputDebugStringA de la boucle principale : un appel 
+  WIN32_LOG n'crit qu'un enregistrement binaire dans l'anneau du thread
+  (voir faitmain_log.h). Un thread de fond vide tous les anneaux toutes les
+  LogFlushIntervalMS millisecondes, fusionne les enregistrements dans l'ordre
+  des horodatages, les formate et les crit dans faitmain.log, et dans la
+  sortie de debug si un dbogueur est attach.
+*/
+
+enum win32_log_format
+{
+  LogFormat_XInputMissing,
+  LogFormat_PrimaryBufferSet,
+  LogFormat_PrimaryBufferNotSet,
+  LogFormat_CooperativeLevelFailed,
+  LogFormat_SecondaryBufferCreated,
+  LogFormat_DirectSoundCreateFailed,
+  LogFormat_DirectSoundMissing,
+  LogFormat_ResolutionOverBudget,
+  LogFormat_ResolutionUnderBudget,
+  LogFormat_Resize,
+  LogFormat_Destroy,
+  LogFormat_Close,
+  LogFormat_ActivateApp,
+  LogFormat_AudioCursors,
+  LogFormat_FrameTime,
+  LogFormat_TimelineWritten,
+  LogFormat_MemoryNotAllocated,
+  LogFormat_CreateWindowFailed,
+  LogFormat_RegisterClassFailed,
+  LogFormat_GameMemoryStartup,
+  LogFormat_GameMemoryEnd,
+  LogFormat_ReplayStarted,
+  LogFormat_ReplayFileInvalid,
+  LogFormat_ReplaySizeDiverged,
+  LogFormat_ReplayDiverged,
+  LogFormat_ReplayFinished,
+  LogFormat_RecordFinished,
+  LogFormat_ReplaySeek,
+  LogFormat_ReplaySeekFailed,
+  LogFormat_NetSessionStarted,
+  LogFormat_NetSocketFailed,
+  LogFormat_NetSessionEnded,
+  LogFormat_CaptureStarted,
+  LogFormat_CaptureFileFailed,
+  LogFormat_CaptureScreenshot,
+  LogFormat_CaptureFinished,
+  LogFormat_CaptureWriteErrors,
+  LogFormat_CaptureResized,
+
+  LogFormat_Count,
+};
+
+global_variable char *LogFormats[LogFormat_Count] =
+{
+  "Cannot load xinput1_4.dll or xinput1_3.dll",
+  "Primary Buffer format was set.",
+  "Primary Buffer format was NOT set.",
+  "Cannot set DirectSound Cooperative Level",
+  "Secondary Buffer created successfully.",
+  "Cannot call DirectSoundCreate",
+  "Cannot load dsound.dll",
+  "RES frame:%u work:%.2fms (%.0f%% of budget) missed:%u over budget: scale %.2f -> %.2f",
+  "RES frame:%u work:%.2fms (%.0f%% of budget) missed:%u under budget: scale %.2f -> %.2f",
+  "WM_SIZE",
+  "WM_DESTROY",
+  "WM_CLOSE",
+  "WM_ACTIVATEAPP",
+  "BTL:%u TC:%u BTW:%u - PC:%u WC:%u DELTA:%u (%fs)",
+  "%0.2f ms/f, %0.2f f/s, %0.2f Mc/f, %0.2f ms lat",
+  "TIMELINE %s: %u evenements %s",
+  "Error: Memory not allocated",
+  "Error: CreateWindowEx",
+  "Error: RegisterClass",
+  "MEM %s: %llu Ko engages sur %llu Ko reserves, allocation %.3f ms, premiere image a %.1f ms, "
+  "ensemble de travail %llu Ko, engagement du processus %llu Ko",
+  "MEM fin: %llu Ko engages sur %llu Ko reserves, ensemble de travail max %llu Ko",
+  "REPLAY %s de %s",
+  "REPLAY %s: fichier illisible, ou ecrit par une autre version du jeu",
+  "REPLAY divergence a l'image %u: octets haches [%llu, %llu) au lieu de [%llu, %llu)",
+  "REPLAY divergence a l'image %u: empreinte %016llx au lieu de %016llx, premier morceau different: "
+  "octets [%llu, %llu) de la memoire permanente (game_state fait %u octets, l'arene du monde suit)",
+  "REPLAY fin apres %u images: %s",
+  "REPLAY %u images enregistrees en %.1f s: %llu Ko, soit %llu Ko par heure, dont %u images cles (%llu Ko)",
+  "REPLAY saut a %.2f min: image %u depuis l'image cle de l'image %u, %u images simulees en %.2f ms",
+  "REPLAY %s: saut impossible, pas d'index (enregistrement interrompu ?)",
+  "NET joueur %u sur %u, %s, images de %.2f ms",
+  "NET socket UDP impossible sur le port %u (erreur %u)",
+  "NET fin apres %u images: %u rollbacks, %u images resimulees (au plus %u d'un coup), "
+  "%u images en attente d'un joueur, %u paquets recus, %u rejetes",
+  "CAPTURE capture_%04u.fmc: video %s en %dx%d",
+  "CAPTURE capture_%04u.%s: creation du fichier impossible",
+  "CAPTURE capture_%04u.qoi",
+  "CAPTURE capture_%04u.fmc: %u images, %llu Ko (%.1f%% du brut), thread de l'image %.3f ms en moyenne, "
+  "%.3f ms au plus, %u attentes d'un buffer libre",
+  "CAPTURE %u ecritures en erreur",
+  "CAPTURE taille de l'image changee en %dx%d: video terminee",
+};
+
+#define Win32MaxLogRings 64
+#define LogFlushIntervalMS 10
+#define LogTextSize Kilobytes(64)
+#define LogMaxLineText 512
+
+struct win32_logger
+{
+  // Un anneau par thread qui a journalis, jamais rendu
+  log_ring *Rings[Win32MaxLogRings];
+  uint32 volatile RingCount;
+  uint32 ReportedDropped[Win32MaxLogRings];
+
+  char **Formats;
+  uint32 FormatCount;
+
+  HANDLE File;
+  HANDLE Thread;
+  HANDLE WakeEvent;
+  bool32 volatile IsStopping;
+  bool32 EchoToDebugger;
+
+  // Passage de __rdtsc au temps, rtalonn contre QueryPerformanceCounter  chaque vidage
+  uint64 StartCycles;
+  LARGE_INTEGER StartCounter;
+  real64 CyclesPerSecond;
+
+  char *Text; // LogTextSize, utilis par le thread de vidage seulement
+  uint32 TextUsed;
+  uint64 WrittenCount;
+};
+
+global_variable win32_logger GlobalLogger;
+global_variable __declspec(thread) log_ring *GlobalThreadLogRing;
+
+/**
+ * Nouvel anneau pour le thread appelant, 0 s'il y en a dj trop
+ * Sans verrou : la place est rserve par un incrment atomique, le lecteur
+ * saute une place rserve dont le pointeur n'est pas encore crit.
+ **/
+internal log_ring *
+Win32AddLogRing(win32_logger *Logger)
+{
+  log_ring *Result = 0;
+  if (Logger->RingCount < Win32MaxLogRings)
+  {
+    uint32 Slot = AtomicIncrementUInt32(&Logger->RingCount) - 1;
+    if (Slot < Win32MaxLogRings)
+    {
+      // VirtualAlloc rend une mmoire  zro : les index partent de 0
+      Result = (log_ring *)VirtualAlloc(0, sizeof(log_ring), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+      if (Result)
+      {
+        Result->ThreadId = GetCurrentThreadId();
+        CompletePreviousWritesBeforeFutureWrites;
+        Logger->Rings[Slot] = Result;
+      }
+    }
+  }
+  return(Result);
+}
+
+inline log_ring *
+Win32GetThreadLogRing(void)
+{
+  if (!GlobalThreadLogRing)
+  {
+    GlobalThreadLogRing = Win32AddLogRing(&GlobalLogger);
+  }
+  return(GlobalThreadLogRing);
+}
+
+#define WIN32_LOG(...) { log_ring *ThreadLogRing_ = Win32GetThreadLogRing(); \
+                         if (ThreadLogRing_) PushLog(ThreadLogRing_, __VA_ARGS__); }
+
+internal void
+Win32WriteLogText(win32_logger *Logger)
+{
+  if (Logger->TextUsed)
+  {
+    if (Logger->File && (Logger->File != INVALID_HANDLE_VALUE))
+    {
+      DWORD BytesWritten;
+      WriteFile(Logger->File, Logger->Text, Logger->TextUsed, &BytesWritten, 0);
+    }
+    if (Logger->EchoToDebugger)
+    {
+      Logger->Text[Logger->TextUsed] = 0;
+      OutputDebugStringA(Logger->Text);
+    }
+    Logger->TextUsed = 0;
+  }
+}
+
+internal void
+Win32AppendLogLine(win32_logger *Logger, char *Line, uint32 Length)
+{
+  // Une place pour le zro de fin de la sortie de debug
+  if (Logger->TextUsed + Length + 1 > LogTextSize)
+  {
+    Win32WriteLogText(Logger);
+  }
+  memcpy(Logger->Text + Logger->TextUsed, Line, Length);
+  Logger->TextUsed += Length;
+}
+
+/**
+ * Vidage de tous les anneaux, fusionns dans l'ordre des horodatages
+ * Un vidage traite au plus ce que les anneaux contiennent : un thread qui
+ * journalise sans arrt ne le retient pas indfiniment.
+ **/
+internal void
+Win32FlushLog(win32_logger *Logger)
+{
+  uint32 RingCount = Logger->RingCount;
+  if (RingCount > Win32MaxLogRings) RingCount = Win32MaxLogRings;
+
+  LARGE_INTEGER Counter;
+  QueryPerformanceCounter(&Counter);
+  uint64 Cycles = __rdtsc();
+  int64 ElapsedCounts = Counter.QuadPart - Logger->StartCounter.QuadPart;
+  if (ElapsedCounts > 0)
+  {
+    Logger->CyclesPerSecond = (real64)(Cycles - Logger->StartCycles)*(real64)GlobalPerfCountFrequency /
+                              (real64)ElapsedCounts;
+  }
+  real64 MillisecondsPerCycle = (Logger->CyclesPerSecond > 0.0) ? (1000.0 / Logger->CyclesPerSecond) : 0.0;
+
+  char Line[LogMaxLineText];
+  for (uint32 Remaining = RingCount*LogRingRecordCount; Remaining > 0; --Remaining)
+  {
+    log_ring *OldestRing = 0;
+    log_record *Oldest = 0;
+    for (uint32 RingIndex = 0; RingIndex < RingCount; ++RingIndex)
+    {
+      log_ring *Ring = Logger->Rings[RingIndex];
+      log_record *Record = Ring ? PeekLogRecord(Ring) : 0;
+      if (Record && (!Oldest || (Record->Timestamp < Oldest->Timestamp)))
+      {
+        OldestRing = Ring;
+        Oldest = Record;
+      }
+    }
+    if (!Oldest) break;
+
+    real64 Milliseconds = (real64)(int64)(Oldest->Timestamp - Logger->StartCycles)*MillisecondsPerCycle;
+    uint32 Length = (uint32)_snprintf_s(Line, sizeof(Line), _TRUNCATE, "%10.3f [%5u] ",
+                                        Milliseconds, OldestRing->ThreadId);
+    char *Format = (Oldest->FormatId < Logger->FormatCount) ? Logger->Formats[Oldest->FormatId] : "(format inconnu)";
+    Length += FormatLogRecord(Line + Length, sizeof(Line) - Length - 1, Format, Oldest);
+    Line[Length++] = '\n';
+    ReleaseLogRecord(OldestRing);
+    Win32AppendLogLine(Logger, Line, Length);
+    ++Logger->WrittenCount;
+  }
+
+  for (uint32 RingIndex = 0; RingIndex < RingCount; ++RingIndex)
+  {
+    log_ring *Ring = Logger->Rings[RingIndex];
+    if (Ring && (Ring->DroppedCount != Logger->ReportedDropped[RingIndex]))
+    {
+      uint32 Dropped = Ring->DroppedCount;
+      uint32 Length = (uint32)_snprintf_s(Line, sizeof(Line), _TRUNCATE,
+                                          "%10s [%5u] %u enregistrements perdus, anneau plein\n", "",
+                                          Ring->ThreadId, Dropped - Logger->ReportedDropped[RingIndex]);
+      Win32AppendLogLine(Logger, Line, Length);
+      Logger->ReportedDropped[RingIndex] = Dropped;
+    }
+  }
+  Win32WriteLogText(Logger);
+}
+
+DWORD WINAPI
+Win32LogThreadProc(LPVOID Parameter)
+{
+  win32_logger *Logger = (win32_logger *)Parameter;
+  for (;;)
+  {
+    WaitForSingleObject(Logger->WakeEvent, LogFlushIntervalMS);
+    // Lu avant le vidage : tout ce qui a t crit avant l'arrt est vid
+    bool32 IsStopping = Logger->IsStopping;
+    Win32FlushLog(Logger);
+    if (IsStopping) break;
+  }
+  return(0);
+}
+
+/**
+ * Ouverture du fichier et dmarrage du thread de vidage
+ * Les anneaux dj crs (des threads qui ont journalis avant) sont gards.
+ **/
+internal bool32
+Win32StartLogger(win32_logger *Logger, char *Filename, char **Formats, uint32 FormatCount)
+{
+  bool32 Result = false;
+  Logger->Formats = Formats;
+  Logger->FormatCount = FormatCount;
+  Logger->IsStopping = false;
+  Logger->EchoToDebugger = IsDebuggerPresent();
+  Logger->StartCycles = __rdtsc();
+  QueryPerformanceCounter(&Logger->StartCounter);
+  Logger->CyclesPerSecond = 0.0;
+  Logger->TextUsed = 0;
+  Logger->WrittenCount = 0;
+  Logger->Text = (char *)VirtualAlloc(0, LogTextSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  Logger->File = CreateFileA(Filename, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, 0, 0);
+  Logger->WakeEvent = CreateEventA(0, FALSE, FALSE, 0);
+  if (Logger->Text && Logger->WakeEvent)
+  {
+    DWORD ThreadID;
+    Logger->Thread = CreateThread(0, 0, Win32LogThreadProc, Logger, 0, &ThreadID);
+    Result = (Logger->Thread != 0);
+  }
+  return(Result);
+}
+
+/**
+ * Dernier vidage et arrt du thread. Les anneaux restent : d'autres threads
+ * peuvent encore y crire, sans que personne ne les lise.
+ **/
+internal void
+Win32StopLogger(win32_logger *Logger)
+{
+  if (Logger->Thread)
+  {
+    Logger->IsStopping = true;
+    SetEvent(Logger->WakeEvent);
+    WaitForSingleObject(Logger->Thread, INFINITE);
+    CloseHandle(Logger->Thread);
+    Logger->Thread = 0;
+  }
+  if (Logger->WakeEvent) CloseHandle(Logger->WakeEvent);
+  if (Logger->File && (Logger->File != INVALID_HANDLE_VALUE)) CloseHandle(Logger->File);
+  if (Logger->Text) VirtualFree(Logger->Text, 0, MEM_RELEASE);
+  Logger->WakeEvent = 0;
+  Logger->File = INVALID_HANDLE_VALUE;
+  Logger->Text = 0;
+}
\ No newline at end of file
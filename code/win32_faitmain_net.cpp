@@ -0,0 +1,328 @@
+/*
+  Session en rseau de la couche plateforme (voir faitmain_rollback.h)
+
+  -net=P,ip:port,ip:port[,...] : partie  2-4 joueurs en UDP, une adresse
+  par joueur dans le mme ordre chez tous, P est le joueur local ; la
+  socket coute sur le port de son adresse. Tous les joueurs doivent
+  lancer le jeu avec la mme frquence (-hz) : une image dure autant de
+  temps simul partout.
+
+  -net=loopback : un second joueur simul dans le processus, derrire un
+  faux rseau (-netlag=ms, -netjitter=ms, -netloss=pourcentage). Il change
+  de direction toutes les LoopbackPeerHoldFrames images : chaque changement
+  dment la prdiction et provoque un rollback.
+
+  Les pointeurs de l'tat sont sauvegards tels quels : la mmoire du jeu
+  est  la mme adresse fixe chez tous les joueurs.
+*/
+
+#define NetDefaultLatencyMS 80
+#define LoopbackPeerHoldFrames 20
+
+enum win32_net_mode
+{
+  NetMode_None,
+  NetMode_UDP,
+  NetMode_Loopback,
+};
+
+struct win32_net
+{
+  win32_net_mode Mode;
+  rollback_session Session;
+  // L'image courante avance : BeginRollbackFrame a russi
+  bool32 IsFrameAdvancing;
+
+  // UDP : une socket non bloquante, l'adresse de chaque joueur
+  SOCKET Socket;
+  sockaddr_in Addresses[RollbackMaxPlayers];
+
+  // Boucle locale : le joueur distant n'a pas de jeu, seulement sa session
+  net_loopback Loopback;
+  rollback_session LoopbackPeer;
+  LARGE_INTEGER StartCounter;
+
+  void *SnapshotMemory;
+};
+
+global_variable win32_net GlobalNet;
+
+// "a.b.c.d:port" jusqu' la virgule ou l'espace, false si mal form
+internal bool32
+Win32ParseNetAddress(char **At, sockaddr_in *Address)
+{
+  uint32 Parts[5] = {};
+  uint32 PartCount = 0;
+  char *Scan = *At;
+  while (PartCount < ArrayCount(Parts))
+  {
+    if ((*Scan < '0') || (*Scan > '9')) break;
+    uint32 Value = 0;
+    while ((*Scan >= '0') && (*Scan <= '9')) Value = 10*Value + (uint32)(*Scan++ - '0');
+    Parts[PartCount++] = Value;
+    char Separator = (PartCount < 4) ? '.' : ':';
+    if ((PartCount < 5) && (*Scan == Separator)) ++Scan;
+    else break;
+  }
+  bool32 Result = ((PartCount == 5) && (Parts[0] < 256) && (Parts[1] < 256) && (Parts[2] < 256) &&
+                   (Parts[3] < 256) && (Parts[4] > 0) && (Parts[4] < 65536));
+  if (Result)
+  {
+    memset(Address, 0, sizeof(*Address));
+    Address->sin_family = AF_INET;
+    Address->sin_port = htons((u_short)Parts[4]);
+    Address->sin_addr.s_addr = htonl((Parts[0] << 24) | (Parts[1] << 16) | (Parts[2] << 8) | Parts[3]);
+    *At = Scan;
+  }
+  return(Result);
+}
+
+internal uint32
+Win32GetNetOption(LPSTR CommandLine, char *Option, uint32 Default)
+{
+  uint32 Result = Default;
+  char *At = strstr(CommandLine, Option);
+  if (At) Result = (uint32)atoi(At + strlen(Option));
+  return(Result);
+}
+
+internal void
+Win32SendNetPacket(win32_net *Net, uint32 ToPlayer, uint8 *Packet, uint32 Size)
+{
+  if (Net->Mode == NetMode_UDP)
+  {
+    sendto(Net->Socket, (char *)Packet, (int)Size, 0,
+           (sockaddr *)(Net->Addresses + ToPlayer), sizeof(Net->Addresses[ToPlayer]));
+  }
+  else
+  {
+    real64 Now = Win32GetSecondsElapsed(Net->StartCounter, Win32GetWallClock());
+    SendLoopbackPacket(&Net->Loopback, Net->Session.LocalPlayer, ToPlayer, Packet, Size, Now);
+  }
+}
+
+// Un paquet reu par le joueur local, 0 quand il n'y en a plus
+internal uint32
+Win32ReceiveNetPacket(win32_net *Net, uint8 *Packet, uint32 PacketSize)
+{
+  uint32 Result = 0;
+  if (Net->Mode == NetMode_UDP)
+  {
+    // Les datagrammes qui ne viennent pas d'un joueur sont ignors
+    for (;;)
+    {
+      sockaddr_in From;
+      int FromSize = sizeof(From);
+      int Received = recvfrom(Net->Socket, (char *)Packet, (int)PacketSize, 0, (sockaddr *)&From, &FromSize);
+      if (Received == SOCKET_ERROR)
+      {
+        // WSAEWOULDBLOCK : plus rien  lire ; WSAECONNRESET : un ICMP d'un joueur pas encore lanc
+        if (WSAGetLastError() == WSAECONNRESET) continue;
+        break;
+      }
+      bool32 IsFromPlayer = false;
+      for (uint32 Player = 0; Player < Net->Session.PlayerCount; ++Player)
+      {
+        if ((From.sin_addr.s_addr == Net->Addresses[Player].sin_addr.s_addr) &&
+            (From.sin_port == Net->Addresses[Player].sin_port))
+        {
+          IsFromPlayer = IsRemotePlayer(&Net->Session, Player);
+        }
+      }
+      if (IsFromPlayer)
+      {
+        Result = (uint32)Received;
+        break;
+      }
+    }
+  }
+  else
+  {
+    real64 Now = Win32GetSecondsElapsed(Net->StartCounter, Win32GetWallClock());
+    Result = ReceiveLoopbackPacket(&Net->Loopback, Net->Session.LocalPlayer, Now, Packet, PacketSize);
+  }
+  return(Result);
+}
+
+/**
+ * Lance la session demande par -net, false s'il n'y en a pas ou si elle
+ * n'a pas pu tre lance. Le jeu doit dj tre initialis : la premire
+ * sauvegarde est l'tat de dpart commun.
+ **/
+internal bool32
+Win32BeginNetSession(win32_net *Net, LPSTR CommandLine, game_memory *Memory, real32 FrameSeconds)
+{
+  Net->Mode = NetMode_None;
+  Net->Socket = INVALID_SOCKET;
+  char *At = strstr(CommandLine, "-net=");
+  if (!At) return(false);
+  At += 5;
+
+  uint32 PlayerCount = 0;
+  uint32 LocalPlayer = 0;
+  win32_net_mode Mode = NetMode_None;
+  if (strncmp(At, "loopback", 8) == 0)
+  {
+    Mode = NetMode_Loopback;
+    PlayerCount = 2;
+  }
+  else if ((*At >= '0') && (*At <= '9'))
+  {
+    LocalPlayer = (uint32)(*At++ - '0');
+    while ((*At == ',') && (PlayerCount < RollbackMaxPlayers))
+    {
+      ++At;
+      if (!Win32ParseNetAddress(&At, Net->Addresses + PlayerCount)) break;
+      ++PlayerCount;
+    }
+    if ((PlayerCount >= 2) && (LocalPlayer < PlayerCount) && ((*At == 0) || (*At == ' ')))
+    {
+      Mode = NetMode_UDP;
+    }
+  }
+
+  if (Mode == NetMode_UDP)
+  {
+    WSADATA WSAData;
+    if (WSAStartup(MAKEWORD(2, 2), &WSAData) == 0)
+    {
+      Net->Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+      sockaddr_in Bound = {};
+      Bound.sin_family = AF_INET;
+      Bound.sin_port = Net->Addresses[LocalPlayer].sin_port;
+      Bound.sin_addr.s_addr = htonl(INADDR_ANY);
+      u_long NonBlocking = 1;
+      if ((Net->Socket == INVALID_SOCKET) ||
+          (bind(Net->Socket, (sockaddr *)&Bound, sizeof(Bound)) == SOCKET_ERROR) ||
+          (ioctlsocket(Net->Socket, FIONBIO, &NonBlocking) == SOCKET_ERROR))
+      {
+        WIN32_LOG(LogFormat_NetSocketFailed, (uint32)ntohs(Bound.sin_port), (uint32)WSAGetLastError());
+        if (Net->Socket != INVALID_SOCKET) closesocket(Net->Socket);
+        Net->Socket = INVALID_SOCKET;
+        WSACleanup();
+        Mode = NetMode_None;
+      }
+    }
+    else
+    {
+      WIN32_LOG(LogFormat_NetSocketFailed, 0, (uint32)WSAGetLastError());
+      Mode = NetMode_None;
+    }
+  }
+  else if (Mode == NetMode_Loopback)
+  {
+    memset(&Net->Loopback, 0, sizeof(Net->Loopback));
+    Net->Loopback.LatencySeconds = 0.001f*(real32)Win32GetNetOption(CommandLine, "-netlag=", NetDefaultLatencyMS);
+    Net->Loopback.JitterSeconds = 0.001f*(real32)Win32GetNetOption(CommandLine, "-netjitter=", 0);
+    Net->Loopback.LossRatio = 0.01f*(real32)Win32GetNetOption(CommandLine, "-netloss=", 0);
+    Net->Loopback.Random = 0x5EED;
+    InitializeRollbackSession(&Net->LoopbackPeer, PlayerCount, 1, FrameSeconds, 0, 0, 0);
+    Net->StartCounter = Win32GetWallClock();
+  }
+
+  // Les sauvegardes sont rserves  la taille de la mmoire permanente, engages en copiant
+  if (Mode != NetMode_None)
+  {
+    Net->SnapshotMemory = VirtualAlloc(0, (SIZE_T)(RollbackSnapshotCount*Memory->PermanentStorageSize),
+                                       MEM_RESERVE, PAGE_READWRITE);
+    if (!Net->SnapshotMemory) Mode = NetMode_None;
+  }
+  if (Mode != NetMode_None)
+  {
+    InitializeRollbackSession(&Net->Session, PlayerCount, LocalPlayer, FrameSeconds,
+                              Net->SnapshotMemory, Memory->PermanentStorageSize, Win32CommitMemory);
+    Net->Mode = Mode;
+    WIN32_LOG(LogFormat_NetSessionStarted, LocalPlayer, PlayerCount,
+              (Mode == NetMode_UDP) ? "UDP" : "boucle locale", 1000.0f*FrameSeconds);
+  }
+  return(Mode != NetMode_None);
+}
+
+internal void
+Win32EndNetSession(win32_net *Net)
+{
+  if (Net->Mode != NetMode_None)
+  {
+    rollback_session *Session = &Net->Session;
+    WIN32_LOG(LogFormat_NetSessionEnded, Session->CurrentFrame, Session->RollbackCount,
+              Session->ResimulatedFrameCount, Session->MaxRollbackDepth, Session->StallCount,
+              Session->PacketCount, Session->RejectedPacketCount);
+    if (Net->Mode == NetMode_UDP)
+    {
+      closesocket(Net->Socket);
+      WSACleanup();
+    }
+    VirtualFree(Net->SnapshotMemory, 0, MEM_RELEASE);
+    Net->Mode = NetMode_None;
+  }
+}
+
+// Le joueur simul : il tient une direction LoopbackPeerHoldFrames images puis tourne
+internal void
+Win32UpdateLoopbackPeer(win32_net *Net)
+{
+  rollback_session *Peer = &Net->LoopbackPeer;
+  real64 Now = Win32GetSecondsElapsed(Net->StartCounter, Win32GetWallClock());
+  uint8 Packet[RollbackMaxPacketSize];
+  uint32 Size;
+  while ((Size = ReceiveLoopbackPacket(&Net->Loopback, Peer->LocalPlayer, Now, Packet, sizeof(Packet))) != 0)
+  {
+    ReceiveRollbackPacket(Peer, Packet, Size);
+  }
+  if (CanAdvanceRollbackSession(Peer))
+  {
+    net_input Input = {};
+    Input.Flags = NetInput_Connected;
+    Input.Buttons = (uint16)(1 << ((Peer->CurrentFrame / LoopbackPeerHoldFrames) % 4));
+    AddLocalRollbackInput(Peer, Input);
+    EndRollbackFrame(Peer);
+  }
+  Size = BuildRollbackPacket(Peer, Net->Session.LocalPlayer, Packet);
+  SendLoopbackPacket(&Net->Loopback, Peer->LocalPlayer, Net->Session.LocalPlayer, Packet, Size, Now);
+}
+
+/**
+ * Avant la mise  jour du jeu : reoit les paquets, corrige les images mal
+ * prdites, puis prpare FrameInput avec les entres de tous les joueurs.
+ * Si un joueur est trop en retard l'image n'avance pas : FrameInput est
+ * vide et ne dure rien, le jeu ne fait que redessiner.
+ **/
+internal void
+Win32BeginNetFrame(win32_net *Net, win32_game_code *Game, game_memory *Memory,
+                   game_input *LocalInput, game_input *FrameInput)
+{
+  if (Net->Mode == NetMode_Loopback) Win32UpdateLoopbackPeer(Net);
+
+  uint8 Packet[RollbackMaxPacketSize];
+  uint32 Size;
+  while ((Size = Win32ReceiveNetPacket(Net, Packet, sizeof(Packet))) != 0)
+  {
+    ReceiveRollbackPacket(&Net->Session, Packet, Size);
+  }
+
+  TIMELINE_BEGIN(Timeline_Rollback);
+  ResimulateRollbackFrames(&Net->Session, Memory, Game->SimulateFrame);
+  TIMELINE_END(Timeline_Rollback);
+
+  Net->IsFrameAdvancing = BeginRollbackFrame(&Net->Session, Memory, EncodeNetInput(LocalInput), FrameInput);
+  if (!Net->IsFrameAdvancing)
+  {
+    memset(FrameInput, 0, sizeof(*FrameInput));
+  }
+}
+
+// Aprs la mise  jour du jeu : nos entres partent vers chaque joueur distant
+internal void
+Win32EndNetFrame(win32_net *Net)
+{
+  if (Net->IsFrameAdvancing) EndRollbackFrame(&Net->Session);
+  uint8 Packet[RollbackMaxPacketSize];
+  for (uint32 Player = 0; Player < Net->Session.PlayerCount; ++Player)
+  {
+    if (IsRemotePlayer(&Net->Session, Player))
+    {
+      uint32 Size = BuildRollbackPacket(&Net->Session, Player, Packet);
+      Win32SendNetPacket(Net, Player, Packet, Size);
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,567 @@
+/*
+  Enregistrement et relecture des entres, avec l'empreinte de l'tat simul
+
+  -record=fichier crit, pour chaque image simule, le game_input donn au
+  jeu et l'empreinte de l'tat qui en rsulte (voir faitmain_hash.h), cods
+  par diffrence et compresss par blocs (voir faitmain_replay.h).
+  -replay=fichier redonne ces entres au jeu  la place du clavier et des
+  manettes, compare chaque empreinte  celle de l'enregistrement et note
+  dans le journal la premire image qui diverge, avec la plage d'octets de
+  la mmoire permanente en cause. A la fin du fichier le programme s'arrte.
+  -seek=M, avec -replay, part de la minute M (dcimale) : l'tat est repris
+  de l'image cl qui la prcde, puis les images restantes sont simules.
+
+  Les deux excutions partent du mme tat : l'enregistrement commence au
+  dmarrage du jeu, aprs une image vide, et la mmoire du jeu est  la
+  mme adresse fixe pour que les pointeurs de l'tat soient les mmes.
+*/
+
+#define ReplayMaxFilename 260
+#define ReplayMaxKeyframes 65536 // Plus de 75 heures  60 images par seconde
+
+enum win32_replay_mode
+{
+  ReplayMode_None,
+  ReplayMode_Record,
+  ReplayMode_Replay,
+};
+
+struct win32_replay
+{
+  win32_replay_mode Mode;
+  char Filename[ReplayMaxFilename];
+  HANDLE File;
+  replay_file_header Header;
+  uint64 FileSize;
+  uint32 FrameIndex;
+  real64 Seconds; // Temps simul avant l'image FrameIndex
+  // Image en cours de relecture, lue avant la mise  jour et compare aprs
+  replay_frame Frame;
+  bool32 HasDiverged;
+
+  // Bloc en cours : images codes (Frames) et leur compression (Compressed)
+  replay_block_header Block;
+  uint8 *Frames;
+  uint32 FramesRead;
+  uint8 *Compressed;
+  // Rfrence du codage par diffrence, remise  zro au dbut de chaque bloc
+  replay_frame Previous;
+
+  // Buffers agrandis  la demande : image cl compresse, tat de la
+  // premire image cl (la base du OU exclusif), OU exclusif  compresser
+  uint8 *Keyframe;
+  uint32 KeyframeCapacity;
+  uint8 *Base;
+  uint32 BaseCapacity;
+  uint64 BaseSize; // 0 : pas encore de base
+  uint64 BaseOffset;
+  uint8 *Scratch;
+  uint32 ScratchCapacity;
+  uint64 KeyframeBytes;
+
+  replay_keyframe_entry *Keyframes; // ReplayMaxKeyframes entres
+  uint32 KeyframeCount;
+};
+
+global_variable win32_replay GlobalReplay;
+
+/**
+ * Mode et nom du fichier choisis en ligne de commande (-record=x ou -replay=x)
+ * Le nom s'arrte au premier espace.
+ **/
+internal win32_replay_mode
+Win32GetRequestedReplay(LPSTR CommandLine, char *Filename, uint32 FilenameSize)
+{
+  win32_replay_mode Result = ReplayMode_None;
+  char *Option = strstr(CommandLine, "-record=");
+  uint32 OptionLength = 8;
+  if (Option)
+  {
+    Result = ReplayMode_Record;
+  }
+  else
+  {
+    Option = strstr(CommandLine, "-replay=");
+    if (Option) Result = ReplayMode_Replay;
+  }
+  if (Option)
+  {
+    char *At = Option + OptionLength;
+    uint32 Length = 0;
+    while (*At && (*At != ' ') && (Length + 1 < FilenameSize))
+    {
+      Filename[Length++] = *At++;
+    }
+    Filename[Length] = 0;
+    if (!Length) Result = ReplayMode_None;
+  }
+  return(Result);
+}
+
+// Minute de dpart de la relecture (-seek=M), ngative sans l'option
+internal real32
+Win32GetRequestedSeek(LPSTR CommandLine)
+{
+  char *Option = strstr(CommandLine, "-seek=");
+  real32 Result = Option ? (real32)atof(Option + 6) : -1.0f;
+  return(Result);
+}
+
+internal bool32
+Win32ReadReplay(win32_replay *Replay, void *Dest, uint32 Size)
+{
+  DWORD BytesRead;
+  bool32 Result = ReadFile(Replay->File, Dest, Size, &BytesRead, 0) && (BytesRead == Size);
+  return(Result);
+}
+
+internal bool32
+Win32WriteReplay(win32_replay *Replay, void *Source, uint32 Size)
+{
+  DWORD BytesWritten;
+  bool32 Result = WriteFile(Replay->File, Source, Size, &BytesWritten, 0) && (BytesWritten == Size);
+  Replay->FileSize += Size;
+  return(Result);
+}
+
+internal bool32
+Win32SetReplayPosition(win32_replay *Replay, int64 Offset, DWORD MoveMethod)
+{
+  LARGE_INTEGER Distance;
+  Distance.QuadPart = Offset;
+  bool32 Result = SetFilePointerEx(Replay->File, Distance, 0, MoveMethod);
+  return(Result);
+}
+
+// Le buffer contient au moins Size octets
+internal bool32
+Win32ReserveReplayBuffer(uint8 **Buffer, uint32 *Capacity, uint64 Size)
+{
+  if (Size > *Capacity)
+  {
+    if (*Buffer) VirtualFree(*Buffer, 0, MEM_RELEASE);
+    *Capacity = (uint32)((Size + Megabytes(1) - 1) & ~(Megabytes(1) - 1));
+    *Buffer = (uint8 *)VirtualAlloc(0, *Capacity, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    if (!*Buffer) *Capacity = 0;
+  }
+  bool32 Result = (*Buffer != 0);
+  return(Result);
+}
+
+/**
+ * Dbut d'un bloc  l'enregistrement, avant l'image FrameIndex : l'image
+ * cl est l'tat simul actuel, en OU exclusif avec la premire
+ **/
+internal void
+Win32BeginRecordBlock(win32_replay *Replay, game_memory *Memory)
+{
+  replay_block_header *Block = &Replay->Block;
+  memset(Block, 0, sizeof(*Block));
+  Block->Magic = ReplayBlockMagic;
+  Block->FirstFrame = Replay->FrameIndex;
+  Block->Seconds = Replay->Seconds;
+  memset(&Replay->Previous, 0, sizeof(Replay->Previous));
+
+  uint8 *State = (uint8 *)Memory->PermanentStorage + Memory->SimulatedStateFirstByte;
+  uint64 Size = Memory->SimulatedStateSize;
+  uint8 *Source = 0;
+  if (Replay->KeyframeCount < ReplayMaxKeyframes)
+  {
+    if (!Replay->BaseSize)
+    {
+      if (Win32ReserveReplayBuffer(&Replay->Base, &Replay->BaseCapacity, Size))
+      {
+        memcpy(Replay->Base, State, (size_t)Size);
+        Replay->BaseSize = Size;
+        Replay->BaseOffset = Replay->FileSize;
+        Source = State;
+      }
+    }
+    else if (Win32ReserveReplayBuffer(&Replay->Scratch, &Replay->ScratchCapacity, Size))
+    {
+      XorReplayKeyframe(Replay->Scratch, State, Size, Replay->Base, Replay->BaseSize);
+      Block->KeyframeBaseOffset = Replay->BaseOffset;
+      Source = Replay->Scratch;
+    }
+  }
+  if (Source && Win32ReserveReplayBuffer(&Replay->Keyframe, &Replay->KeyframeCapacity, GetLZMaxSize((uint32)Size)))
+  {
+    Block->KeyframeFirstByte = Memory->SimulatedStateFirstByte;
+    Block->KeyframeSize = Size;
+    Block->KeyframeCompressedSize = CompressLZ(Source, (uint32)Size, Replay->Keyframe);
+  }
+}
+
+// Fin d'un bloc  l'enregistrement : en-tte, image cl puis images compresses
+internal void
+Win32WriteRecordBlock(win32_replay *Replay)
+{
+  replay_block_header *Block = &Replay->Block;
+  Block->FramesCompressedSize = CompressLZ(Replay->Frames, Block->FramesSize, Replay->Compressed);
+  if (Block->KeyframeCompressedSize)
+  {
+    replay_keyframe_entry *Entry = Replay->Keyframes + Replay->KeyframeCount++;
+    Entry->BlockOffset = Replay->FileSize;
+    Entry->FirstFrame = Block->FirstFrame;
+    Entry->Pad = 0;
+    Entry->Seconds = Block->Seconds;
+    Replay->KeyframeBytes += Block->KeyframeCompressedSize;
+  }
+  Win32WriteReplay(Replay, Block, sizeof(*Block));
+  Win32WriteReplay(Replay, Replay->Keyframe, Block->KeyframeCompressedSize);
+  Win32WriteReplay(Replay, Replay->Compressed, Block->FramesCompressedSize);
+}
+
+// Image cl du bloc dont l'en-tte vient d'tre lu, dcompresse dans Dest
+internal bool32
+Win32ReadReplayKeyframe(win32_replay *Replay, uint8 *Dest)
+{
+  replay_block_header *Block = &Replay->Block;
+  bool32 Result = Win32ReserveReplayBuffer(&Replay->Keyframe, &Replay->KeyframeCapacity,
+                                           Block->KeyframeCompressedSize) &&
+                  Win32ReadReplay(Replay, Replay->Keyframe, Block->KeyframeCompressedSize) &&
+                  DecompressLZ(Replay->Keyframe, Block->KeyframeCompressedSize, Dest, (uint32)Block->KeyframeSize);
+  return(Result);
+}
+
+/**
+ * Lecture du bloc suivant. Avec Memory, son image cl remplace l'tat
+ * simul (la base du OU exclusif doit tre charge) ; sans, elle est saute.
+ **/
+internal bool32
+Win32ReadReplayBlock(win32_replay *Replay, game_memory *Memory)
+{
+  replay_block_header *Block = &Replay->Block;
+  bool32 Result = Win32ReadReplay(Replay, Block, sizeof(*Block)) && (Block->Magic == ReplayBlockMagic) &&
+                  (Block->FramesSize <= ReplayMaxBlockSize) &&
+                  (Block->FramesCompressedSize <= GetLZMaxSize(ReplayMaxBlockSize));
+  if (Result && Block->KeyframeCompressedSize)
+  {
+    if (Memory)
+    {
+      // L'tat enregistr peut occuper des pages que cette excution n'a pas encore engages
+      uint8 *Dest = (uint8 *)Memory->PermanentStorage + Block->KeyframeFirstByte;
+      memory_arena *Arena = (memory_arena *)Dest;
+      memory_arena Current = {};
+      Result = (Block->KeyframeFirstByte == Memory->SimulatedStateFirstByte) &&
+               (Block->KeyframeSize >= sizeof(memory_arena)) &&
+               (Block->KeyframeFirstByte + Block->KeyframeSize <= Memory->PermanentStorageSize) &&
+               (!Block->KeyframeBaseOffset || (Block->KeyframeBaseOffset == Replay->BaseOffset));
+      if (Result) Current = *Arena;
+      Result = Result &&
+               (!Memory->IsCommittedOnDemand || Memory->PlatformAPI.CommitMemory(Dest, Block->KeyframeSize)) &&
+               Win32ReadReplayKeyframe(Replay, Dest);
+      if (Result)
+      {
+        if (Block->KeyframeBaseOffset)
+        {
+          XorReplayKeyframe(Dest, Dest, Block->KeyframeSize, Replay->Base, Replay->BaseSize);
+        }
+        // L'en-tte de l'arne vient de l'enregistrement : la fonction d'engagement
+        // et les pages engages sont celles de cette excution, qui couvrent au
+        // moins l'tat qui vient d'tre lu
+        Arena->CommitMemory = Current.CommitMemory;
+        Arena->CommittedSize = (Current.CommittedSize > Arena->Used) ? Current.CommittedSize : Arena->Used;
+        Memory->SimulatedStateSize = Block->KeyframeSize;
+      }
+    }
+    else
+    {
+      Result = Win32SetReplayPosition(Replay, Block->KeyframeCompressedSize, FILE_CURRENT);
+    }
+  }
+  Result = Result && Win32ReadReplay(Replay, Replay->Compressed, Block->FramesCompressedSize) &&
+           DecompressLZ(Replay->Compressed, Block->FramesCompressedSize, Replay->Frames, Block->FramesSize);
+  Replay->FramesRead = 0;
+  memset(&Replay->Previous, 0, sizeof(Replay->Previous));
+  return(Result);
+}
+
+internal void
+Win32FreeReplay(win32_replay *Replay)
+{
+  if (Replay->File != INVALID_HANDLE_VALUE) CloseHandle(Replay->File);
+  Replay->File = INVALID_HANDLE_VALUE;
+  if (Replay->Frames) VirtualFree(Replay->Frames, 0, MEM_RELEASE);
+  if (Replay->Keyframe) VirtualFree(Replay->Keyframe, 0, MEM_RELEASE);
+  if (Replay->Base) VirtualFree(Replay->Base, 0, MEM_RELEASE);
+  if (Replay->Scratch) VirtualFree(Replay->Scratch, 0, MEM_RELEASE);
+  Replay->Frames = 0;
+  Replay->Keyframe = 0;
+  Replay->KeyframeCapacity = 0;
+  Replay->Base = 0;
+  Replay->BaseCapacity = 0;
+  Replay->Scratch = 0;
+  Replay->ScratchCapacity = 0;
+  Replay->Mode = ReplayMode_None;
+}
+
+/**
+ * Ouvre l'enregistrement. Le jeu a dj simul son image vide de dpart,
+ * qui est la premire image cl d'un enregistrement.
+ **/
+internal bool32
+Win32BeginReplay(win32_replay *Replay, win32_replay_mode Mode, char *Filename, game_memory *Memory)
+{
+  bool32 Result = false;
+  strncpy_s(Replay->Filename, sizeof(Replay->Filename), Filename, _TRUNCATE);
+  Replay->File = INVALID_HANDLE_VALUE;
+  Replay->FileSize = 0;
+  Replay->FrameIndex = 0;
+  Replay->Seconds = 0.0;
+  Replay->HasDiverged = false;
+  Replay->KeyframeCount = 0;
+  Replay->KeyframeBytes = 0;
+  Replay->BaseSize = 0;
+  Replay->BaseOffset = 0;
+  memset(&Replay->Block, 0, sizeof(Replay->Block));
+  Replay->FramesRead = 0;
+
+  // Images codes, images compresses et index des images cls  la suite
+  uint32 CompressedOffset = (ReplayMaxBlockSize + 63) & ~63;
+  uint32 KeyframesOffset = CompressedOffset + ((GetLZMaxSize(ReplayMaxBlockSize) + 63) & ~63);
+  Replay->Frames = (uint8 *)VirtualAlloc(0, KeyframesOffset + ReplayMaxKeyframes*sizeof(replay_keyframe_entry),
+                                         MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (Replay->Frames)
+  {
+    Replay->Compressed = Replay->Frames + CompressedOffset;
+    Replay->Keyframes = (replay_keyframe_entry *)(Replay->Frames + KeyframesOffset);
+  }
+
+  replay_file_header *Header = &Replay->Header;
+  memset(Header, 0, sizeof(*Header));
+  if (Replay->Frames && (Mode == ReplayMode_Record))
+  {
+    Replay->File = CreateFileA(Filename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
+    if (Replay->File != INVALID_HANDLE_VALUE)
+    {
+      Header->Magic = ReplayMagic;
+      Header->Version = ReplayVersion;
+      Header->InputSize = sizeof(game_input);
+      Header->StateHashSize = sizeof(game_state_hash);
+      Header->PermanentStorageSize = Memory->PermanentStorageSize;
+      Result = Win32WriteReplay(Replay, Header, sizeof(*Header));
+      Win32BeginRecordBlock(Replay, Memory);
+    }
+  }
+  else if (Replay->Frames && (Mode == ReplayMode_Replay))
+  {
+    Replay->File = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+    if (Replay->File != INVALID_HANDLE_VALUE)
+    {
+      Result = Win32ReadReplay(Replay, Header, sizeof(*Header)) &&
+               (Header->Magic == ReplayMagic) && (Header->Version == ReplayVersion) &&
+               (Header->InputSize == sizeof(game_input)) &&
+               (Header->StateHashSize == sizeof(game_state_hash)) &&
+               (Header->PermanentStorageSize == Memory->PermanentStorageSize);
+    }
+  }
+
+  if (Result)
+  {
+    Replay->Mode = Mode;
+    WIN32_LOG(LogFormat_ReplayStarted, (Mode == ReplayMode_Record) ? "enregistrement" : "relecture",
+              Replay->Filename);
+  }
+  else
+  {
+    Win32FreeReplay(Replay);
+    WIN32_LOG(LogFormat_ReplayFileInvalid, Replay->Filename);
+  }
+  return(Result);
+}
+
+internal void
+Win32EndReplay(win32_replay *Replay)
+{
+  if (Replay->Mode == ReplayMode_Replay)
+  {
+    WIN32_LOG(LogFormat_ReplayFinished, Replay->FrameIndex,
+              Replay->HasDiverged ? "divergence, voir plus haut" : "aucune divergence");
+    Win32FreeReplay(Replay);
+  }
+  else if (Replay->Mode == ReplayMode_Record)
+  {
+    // Dernier bloc, index des images cls, puis l'en-tte qui donne leur place
+    if (Replay->Block.FrameCount) Win32WriteRecordBlock(Replay);
+    replay_file_header *Header = &Replay->Header;
+    Header->IndexOffset = Replay->FileSize;
+    Header->KeyframeCount = Replay->KeyframeCount;
+    Header->FrameCount = Replay->FrameIndex;
+    Win32WriteReplay(Replay, Replay->Keyframes, Replay->KeyframeCount*sizeof(replay_keyframe_entry));
+    Win32SetReplayPosition(Replay, 0, FILE_BEGIN);
+    Win32WriteReplay(Replay, Header, sizeof(*Header));
+    Replay->FileSize -= sizeof(*Header);
+
+    uint64 BytesPerHour = (Replay->Seconds > 0.0) ? (uint64)((real64)Replay->FileSize*3600.0 / Replay->Seconds) : 0;
+    WIN32_LOG(LogFormat_RecordFinished, Replay->FrameIndex, Replay->Seconds, Replay->FileSize / 1024,
+              BytesPerHour / 1024, Replay->KeyframeCount, Replay->KeyframeBytes / 1024);
+    Win32FreeReplay(Replay);
+  }
+}
+
+/**
+ * Remplace les entres de l'image par celles de l'enregistrement
+ * Renvoie false  la fin du fichier : la relecture est termine.
+ **/
+internal bool32
+Win32ReplayInput(win32_replay *Replay, game_input *Input)
+{
+  bool32 Result = true;
+  if (Replay->FramesRead == Replay->Block.FramesSize)
+  {
+    // Fin d'un enregistrement ferm : l'index suit le dernier bloc
+    LARGE_INTEGER Position = {};
+    LARGE_INTEGER Zero = {};
+    Result = !Replay->Header.IndexOffset ||
+             (SetFilePointerEx(Replay->File, Zero, &Position, FILE_CURRENT) &&
+              ((uint64)Position.QuadPart < Replay->Header.IndexOffset));
+    Result = Result && Win32ReadReplayBlock(Replay, 0);
+  }
+  if (Result)
+  {
+    uint8 *At = DecodeReplayFrame(Replay->Frames + Replay->FramesRead, Replay->Frames + Replay->Block.FramesSize,
+                                  &Replay->Previous);
+    Result = (At != 0);
+    if (Result)
+    {
+      Replay->FramesRead = (uint32)(At - Replay->Frames);
+      Replay->Frame = Replay->Previous;
+      *Input = Replay->Frame.Input;
+    }
+  }
+  return(Result);
+}
+
+/**
+ * Relecture  partir du temps simul Seconds : reprend l'tat de l'image
+ * cl qui le prcde puis simule les images jusqu' lui. Il faut l'index,
+ * crit  la fermeture de l'enregistrement.
+ **/
+internal bool32
+Win32SeekReplay(win32_replay *Replay, game_memory *Memory, game_simulate_frame *SimulateFrame, real64 Seconds)
+{
+  LARGE_INTEGER StartCounter;
+  QueryPerformanceCounter(&StartCounter);
+  replay_file_header *Header = &Replay->Header;
+  bool32 Result = ((Replay->Mode == ReplayMode_Replay) && Header->IndexOffset && Header->KeyframeCount &&
+                   (Header->KeyframeCount <= ReplayMaxKeyframes));
+  if (Result && (Replay->KeyframeCount != Header->KeyframeCount))
+  {
+    Result = Win32SetReplayPosition(Replay, (int64)Header->IndexOffset, FILE_BEGIN) &&
+             Win32ReadReplay(Replay, Replay->Keyframes, Header->KeyframeCount*sizeof(replay_keyframe_entry));
+    Replay->KeyframeCount = Result ? Header->KeyframeCount : 0;
+  }
+
+  // La premire image cl, base du OU exclusif des suivantes, est garde
+  if (Result && !Replay->BaseSize)
+  {
+    replay_block_header *Block = &Replay->Block;
+    Result = Win32SetReplayPosition(Replay, (int64)Replay->Keyframes[0].BlockOffset, FILE_BEGIN) &&
+             Win32ReadReplay(Replay, Block, sizeof(*Block)) && (Block->Magic == ReplayBlockMagic) &&
+             Block->KeyframeCompressedSize && !Block->KeyframeBaseOffset &&
+             Win32ReserveReplayBuffer(&Replay->Base, &Replay->BaseCapacity, Block->KeyframeSize) &&
+             Win32ReadReplayKeyframe(Replay, Replay->Base);
+    if (Result)
+    {
+      Replay->BaseSize = Block->KeyframeSize;
+      Replay->BaseOffset = Replay->Keyframes[0].BlockOffset;
+    }
+  }
+
+  replay_keyframe_entry *Entry = Replay->Keyframes;
+  if (Result)
+  {
+    for (uint32 KeyframeIndex = 1; KeyframeIndex < Replay->KeyframeCount; ++KeyframeIndex)
+    {
+      if (Replay->Keyframes[KeyframeIndex].Seconds > Seconds) break;
+      Entry = Replay->Keyframes + KeyframeIndex;
+    }
+    Result = Win32SetReplayPosition(Replay, (int64)Entry->BlockOffset, FILE_BEGIN) &&
+             Win32ReadReplayBlock(Replay, Memory);
+  }
+
+  uint32 SimulatedCount = 0;
+  if (Result)
+  {
+    Replay->FrameIndex = Entry->FirstFrame;
+    Replay->Seconds = Entry->Seconds;
+    Replay->HasDiverged = false;
+    game_input Input;
+    while ((Replay->Seconds < Seconds) && Win32ReplayInput(Replay, &Input))
+    {
+      SimulateFrame(Memory, &Input);
+      Replay->Seconds += Input.dtForFrame;
+      ++Replay->FrameIndex;
+      ++SimulatedCount;
+    }
+  }
+
+  LARGE_INTEGER EndCounter;
+  QueryPerformanceCounter(&EndCounter);
+  if (Result)
+  {
+    WIN32_LOG(LogFormat_ReplaySeek, Seconds / 60.0, Replay->FrameIndex, Entry->FirstFrame, SimulatedCount,
+              1000.0*(real64)(EndCounter.QuadPart - StartCounter.QuadPart) / (real64)GlobalPerfCountFrequency);
+  }
+  else
+  {
+    WIN32_LOG(LogFormat_ReplaySeekFailed, Replay->Filename);
+  }
+  return(Result);
+}
+
+/**
+ * Aprs la mise  jour : enregistre l'image, ou compare l'empreinte du jeu
+ *  celle de l'enregistrement. Seule la premire divergence est note, les
+ * suivantes en dcoulent.
+ **/
+internal void
+Win32EndReplayFrame(win32_replay *Replay, game_input *Input, game_memory *Memory)
+{
+  game_state_hash *StateHash = &Memory->StateHash;
+  if (Replay->Mode == ReplayMode_Record)
+  {
+    replay_frame Frame;
+    memset(&Frame, 0, sizeof(Frame));
+    Frame.Input = *Input;
+    Frame.StateHash = *StateHash;
+    replay_block_header *Block = &Replay->Block;
+    uint8 *At = EncodeReplayFrame(&Frame, &Replay->Previous, Replay->Frames + Block->FramesSize);
+    Block->FramesSize = (uint32)(At - Replay->Frames);
+    ++Block->FrameCount;
+  }
+  else if ((Replay->Mode == ReplayMode_Replay) && !Replay->HasDiverged)
+  {
+    game_state_hash *Expected = &Replay->Frame.StateHash;
+    if ((StateHash->FirstByte != Expected->FirstByte) || (StateHash->Size != Expected->Size))
+    {
+      Replay->HasDiverged = true;
+      WIN32_LOG(LogFormat_ReplaySizeDiverged, Replay->FrameIndex, StateHash->FirstByte,
+                StateHash->FirstByte + StateHash->Size, Expected->FirstByte,
+                Expected->FirstByte + Expected->Size);
+    }
+    else if (StateHash->Total != Expected->Total)
+    {
+      Replay->HasDiverged = true;
+      uint32 Range = FirstDifferentStateRange(StateHash, Expected);
+      uint64 FirstByte = StateHash->FirstByte + Range*StateHash->RangeSize;
+      uint64 OnePastLastByte = FirstByte + StateHash->RangeSize;
+      if (OnePastLastByte > StateHash->FirstByte + StateHash->Size)
+      {
+        OnePastLastByte = StateHash->FirstByte + StateHash->Size;
+      }
+      WIN32_LOG(LogFormat_ReplayDiverged, Replay->FrameIndex, StateHash->Total, Expected->Total,
+                FirstByte, OnePastLastByte, (uint32)sizeof(game_state));
+    }
+  }
+  Replay->Seconds += Input->dtForFrame;
+  ++Replay->FrameIndex;
+
+  // L'tat simul est maintenant celui d'avant l'image suivante, qui commence le bloc suivant
+  if ((Replay->Mode == ReplayMode_Record) && (Replay->Block.FrameCount == ReplayBlockFrameCount))
+  {
+    Win32WriteRecordBlock(Replay);
+    Win32BeginRecordBlock(Replay, Memory);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+/*
+  Enregistreur de timeline (builds internes seulement)
+
+  Chaque tape de la boucle principale (image, mise  jour, remplissage audio,
+  attente, affichage) et les curseurs de DirectSound sont nots dans un
+  grand buffer circulaire,  raison de 24 octets par vnement. Les threads de
+  fond y crivent aussi leurs tches. Sur demande (F7) les derniers vnements
+  sont crits au format Chrome trace JSON dans timeline.json, lisible dans
+  chrome://tracing ou ui.perfetto.dev pour analyser des milliers d'images.
+*/
+
+enum win32_timeline_event_type
+{
+  TimelineEvent_Begin,
+  TimelineEvent_End,
+  TimelineEvent_Instant,
+  TimelineEvent_Counter,
+};
+
+enum win32_timeline_name
+{
+  Timeline_Frame,
+  Timeline_Update,
+  Timeline_AudioFill,
+  Timeline_Sleep,
+  Timeline_Present,
+  Timeline_Work,
+  Timeline_MissedFrame,
+  Timeline_Rollback, // Resimulation des images mal prdites
+
+  // Curseurs audio, en octets dans le buffer secondaire
+  Timeline_PlayCursor,
+  Timeline_WriteCursor,
+  Timeline_ByteToLock,
+  Timeline_TargetCursor,
+  Timeline_BytesToWrite,
+  Timeline_FlipPlayCursor,
+  Timeline_FlipWriteCursor,
+  Timeline_RenderScale, // En pourcents
+
+  Timeline_NameCount,
+};
+
+global_variable char *TimelineNames[Timeline_NameCount] =
+{
+  "Frame",
+  "UpdateAndRender",
+  "AudioFill",
+  "Sleep",
+  "Present",
+  "Work",
+  "MissedFrame",
+  "Rollback",
+  "PlayCursor",
+  "WriteCursor",
+  "ByteToLock",
+  "TargetCursor",
+  "BytesToWrite",
+  "FlipPlayCursor",
+  "FlipWriteCursor",
+  "RenderScale",
+};
+
+struct win32_timeline_event
+{
+  uint64 Counter; // QueryPerformanceCounter
+  uint32 ThreadID;
+  uint32 Value;
+  uint16 Name;
+  uint16 Type;
+};
+
+#define TimelineEventCount (1 << 19) // 12 Mo, environ 30000 images  16 vnements par image
+
+struct win32_timeline
+{
+  win32_timeline_event *Events;
+  LONG64 volatile NextEvent; // Ne fait qu'augmenter, modulo TimelineEventCount pour l'index
+  DWORD MainThreadID;
+  bool32 ExportRequested;
+};
+
+global_variable win32_timeline GlobalTimeline;
+
+internal void
+Win32InitTimeline(win32_timeline *Timeline)
+{
+  Timeline->Events = (win32_timeline_event *)VirtualAlloc(0, TimelineEventCount*sizeof(win32_timeline_event),
+                                                          MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  Timeline->NextEvent = 0;
+  Timeline->MainThreadID = GetCurrentThreadId();
+}
+
+/**
+ * Ajout d'un vnement, utilisable depuis n'importe quel thread
+ * Les plus anciens vnements sont crass quand le buffer est plein
+ **/
+inline void
+Win32RecordTimelineEvent(win32_timeline *Timeline, win32_timeline_name Name,
+                         win32_timeline_event_type Type, uint32 Value)
+{
+  if (Timeline->Events)
+  {
+    uint64 Index = (uint64)(InterlockedIncrement64(&Timeline->NextEvent) - 1);
+    win32_timeline_event *Event = Timeline->Events + (Index & (TimelineEventCount - 1));
+    LARGE_INTEGER Counter;
+    QueryPerformanceCounter(&Counter);
+    Event->Counter = Counter.QuadPart;
+    Event->ThreadID = GetCurrentThreadId();
+    Event->Value = Value;
+    Event->Name = (uint16)Name;
+    Event->Type = (uint16)Type;
+  }
+}
+
+#define TIMELINE_BEGIN(Name) Win32RecordTimelineEvent(&GlobalTimeline, Name, TimelineEvent_Begin, 0)
+#define TIMELINE_END(Name) Win32RecordTimelineEvent(&GlobalTimeline, Name, TimelineEvent_End, 0)
+#define TIMELINE_INSTANT(Name) Win32RecordTimelineEvent(&GlobalTimeline, Name, TimelineEvent_Instant, 0)
+#define TIMELINE_COUNTER(Name, Value) Win32RecordTimelineEvent(&GlobalTimeline, Name, TimelineEvent_Counter, (uint32)(Value))
+
+/**
+ * Ecriture des vnements prsents dans le buffer au format Chrome trace JSON
+ * Les threads de fond peuvent crire pendant l'export : au pire quelques
+ * vnements parmi les plus anciens sont incohrents, c'est un outil de debug.
+ **/
+internal bool32
+Win32WriteTimeline(win32_timeline *Timeline, char *Filename)
+{
+  bool32 Result = false;
+  if (!Timeline->Events) return(Result);
+
+  uint64 End = (uint64)Timeline->NextEvent;
+  uint64 Start = (End > TimelineEventCount) ? (End - TimelineEventCount) : 0;
+  // On ignore les vnements les plus anciens qui risquent d'tre crass pendant l'export
+  if (Start > 0) Start += 1024;
+
+  // Un vnement fait au plus une centaine de caractres
+#define TimelineMaxEventText 160
+  uint32 TextSize = (uint32)((End - Start)*TimelineMaxEventText + Kilobytes(4));
+  char *Text = (char *)VirtualAlloc(0, TextSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if (Text)
+  {
+    uint32 Used = 0;
+    Used += (uint32)_snprintf_s(Text + Used, TextSize - Used, _TRUNCATE,
+                                "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Principal\"}}",
+                                (uint32)Timeline->MainThreadID);
+
+    // Un vnement de fin dont le dbut a t cras n'a pas de sens :
+    // on commence  la premire image complte
+    bool32 FoundFirstFrame = false;
+    uint64 BaseCounter = 0;
+    real64 MicrosecondsPerCount = 1000000.0 / (real64)GlobalPerfCountFrequency;
+    for (uint64 Index = Start; Index < End; ++Index)
+    {
+      win32_timeline_event *Event = Timeline->Events + (Index & (TimelineEventCount - 1));
+      if (!FoundFirstFrame)
+      {
+        if ((Event->Name != Timeline_Frame) || (Event->Type != TimelineEvent_Begin)) continue;
+        FoundFirstFrame = true;
+        BaseCounter = Event->Counter;
+      }
+      if (Event->Name >= Timeline_NameCount) continue;
+
+      real64 Timestamp = (real64)(int64)(Event->Counter - BaseCounter)*MicrosecondsPerCount;
+      char *Name = TimelineNames[Event->Name];
+      char *Format = 0;
+      switch (Event->Type)
+      {
+        case TimelineEvent_Begin:
+          Format = ",\n{\"name\":\"%s\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}";
+          break;
+        case TimelineEvent_End:
+          Format = ",\n{\"name\":\"%s\",\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}";
+          break;
+        case TimelineEvent_Instant:
+          Format = ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}";
+          break;
+        case TimelineEvent_Counter:
+          Format = ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%u}}";
+          break;
+      }
+      if (Format && (Used + TimelineMaxEventText < TextSize))
+      {
+        Used += (uint32)_snprintf_s(Text + Used, TextSize - Used, _TRUNCATE, Format,
+                                    Name, Timestamp, Event->ThreadID, Event->Value);
+      }
+    }
+    Used += (uint32)_snprintf_s(Text + Used, TextSize - Used, _TRUNCATE, "\n]}\n");
+
+    Result = DEBUGPlatformWriteEntireFile(Filename, Used, Text);
+    VirtualFree(Text, 0, MEM_RELEASE);
+  }
+
+  // Filename doit tre un littral : le journal ne garde que le pointeur
+  WIN32_LOG(LogFormat_TimelineWritten, Filename, (uint32)(End - Start), Result ? "ecrits" : "non ecrits");
+  return(Result);
+}